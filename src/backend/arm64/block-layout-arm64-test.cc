@@ -0,0 +1,127 @@
+#include "backend/arm64/block-layout-arm64.h"
+#include "backend/arm64/code-generate-arm64.h"
+#include "backend/constants-pool.h"
+#include "backend/linkage-symbols.h"
+#include "backend/registers-configuration.h"
+#include "backend/frame.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/base-test.h"
+#include "base/io.h"
+
+namespace yalx::backend {
+
+class Arm64BlockLayoutTest : public ir::BaseTest {
+public:
+    Arm64BlockLayoutTest(): const_pool_(&arena_), linkage_(&arena_), all_(&arena_) {}
+
+    void SetUp() override {
+        bool ok = true;
+        IRGen("tests/32-code-lower", &all_, &ok);
+        ASSERT_TRUE(ok);
+    }
+
+    std::string GenTo(InstructionFunction *fun) {
+        base::ArenaMap<std::string_view, InstructionFunction *> funs(arena());
+        funs[fun->symbol()->ToSlice()] = fun;
+
+        std::string buf;
+        auto file = base::NewMemoryWritableFile(&buf);
+        base::PrintingWriter printer{file, true};
+        Arm64CodeGenerator gen(funs, RegistersConfiguration::OfPosixArm64(), FindModuleOrNull("main:main"),
+                               &const_pool_, &linkage_, &printer);
+        gen.EmitFunction(fun);
+        return buf;
+    }
+
+    InstructionFunction *NewFunction(const char *name) {
+        auto module = FindModuleOrNull("main:main");
+        auto prototype = new (arena()) ir::PrototypeModel(arena(), String::kEmpty, false/*vargs*/);
+        auto symbol = String::New(arena(), name);
+        auto frame = new (arena()) Frame(arena(), module->NewFunction(ir::Function::kDefault, symbol, symbol,
+                                                                       prototype));
+        return new (arena()) InstructionFunction(arena(), symbol, frame);
+    }
+
+    Instruction *Emit(InstructionBlock *block, InstructionCode op, std::vector<InstructionOperand> outputs,
+                      std::vector<InstructionOperand> inputs) {
+        auto instr = Instruction::New(arena(), op, inputs.size(), inputs.data(), outputs.size(), outputs.data(), 0,
+                                      nullptr);
+        block->Add(instr);
+        return instr;
+    }
+
+    static void Link(InstructionBlock *from, InstructionBlock *to) {
+        from->AddSuccessor(to);
+        to->AddPredecessors(from);
+    }
+
+    static AllocatedOperand Reg(int id) { return AllocatedOperand::Register(MachineRepresentation::kWord64, id); }
+
+    ir::Module *FindModuleOrNull(std::string_view full_name) const {
+        if (auto iter = all_.find(full_name); iter != all_.end()) {
+            return iter->second;
+        } else {
+            return nullptr;
+        }
+    }
+
+protected:
+    Linkage linkage_;
+    ConstantsPool const_pool_;
+    base::ArenaMap<std::string_view, ir::Module *> all_;
+}; // class Arm64BlockLayoutTest
+
+TEST_F(Arm64BlockLayoutTest, DeferredToColdSection) {
+    auto fun = NewFunction("cold");
+    auto b0 = fun->NewBlock(0);
+    auto b1 = fun->NewBlock(1);
+    auto b2 = fun->NewBlock(2);
+    auto b3 = fun->NewBlock(3);
+    fun->set_entry(b0);
+    b1->set_deferred(true);
+    Link(b0, b1);
+    Link(b0, b2);
+    Link(b2, b3);
+    Link(b2, b1);
+    Emit(b0, Arm64Cbz, {}, {Reg(0), ReloactionOperand{b2}});
+    Emit(b1, ArchUnreachable, {}, {});
+    Emit(b2, Arm64Cmp, {}, {Reg(0), ImmediateOperand{1}});
+    Emit(b2, Arm64B_gt, {}, {ReloactionOperand{b1}});
+    Emit(b3, ArchRet, {}, {});
+
+    Arm64BlockLayout layout(arena());
+    layout.Run(fun);
+    EXPECT_EQ(1, layout.cold_blocks());
+    EXPECT_EQ(1, layout.negated_branches());
+    EXPECT_EQ(0, layout.inserted_jumps());
+    auto expected = GenTo(fun);
+    std::string z = R"(.global cold
+cold:
+.cfi_startproc
+Lblk0:
+    cbnz x0, Lblk1
+Lblk2:
+    cmp x0, #1
+    b.gt Lblk1
+Lblk3:
+    ret
+.cfi_endproc
+.section )";
+    z.append(GnuAsmGenerator::kColdTextSegmentName);
+    z.append(R"(
+cold.cold:
+.cfi_startproc
+    .cfi_def_cfa fp, 16
+    .cfi_offset lr, -8
+    .cfi_offset fp, -16
+Lblk1:
+    brk #0x3c
+.cfi_endproc
+.section )");
+    z.append(GnuAsmGenerator::kTextSegmentName);
+    z.append("\n");
+    ASSERT_EQ(z, expected) << expected;
+}
+
+} // namespace yalx::backend
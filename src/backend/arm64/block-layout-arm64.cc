@@ -0,0 +1,41 @@
+#include "backend/arm64/block-layout-arm64.h"
+
+namespace yalx::backend {
+
+#define ARM64_NEGATABLE_BRANCHS_LIST(V) \
+    V(B_cs, B_cc) \
+    V(B_cc, B_cs) \
+    V(B_mi, B_pl) \
+    V(B_pl, B_mi) \
+    V(B_vs, B_vc) \
+    V(B_vc, B_vs) \
+    V(B_hi, B_ls) \
+    V(B_ls, B_hi) \
+    V(B_eq, B_ne) \
+    V(B_ne, B_eq) \
+    V(B_lt, B_ge) \
+    V(B_ge, B_lt) \
+    V(B_le, B_gt) \
+    V(B_gt, B_le) \
+    V(Cbz,  Cbnz) \
+    V(Cbnz, Cbz)
+
+Arm64BlockLayout::Arm64BlockLayout(base::Arena *arena)
+: BlockLayout(arena) {
+}
+
+bool Arm64BlockLayout::IsConditionalBranch(Instruction *instr) const {
+    return NegateCondition(instr->op()) != ArchNop;
+}
+
+InstructionCode Arm64BlockLayout::NegateCondition(InstructionCode code) const {
+    switch (code) {
+#define DEFINE_CASE(name, negated) case Arm64##name: return Arm64##negated;
+        ARM64_NEGATABLE_BRANCHS_LIST(DEFINE_CASE)
+#undef DEFINE_CASE
+        default:
+            return ArchNop;
+    }
+}
+
+} // namespace yalx::backend
@@ -0,0 +1,20 @@
+#pragma once
+#ifndef YALX_BACKEND_ARM64_BLOCK_LAYOUT_ARM64_H
+#define YALX_BACKEND_ARM64_BLOCK_LAYOUT_ARM64_H
+
+#include "backend/block-layout.h"
+
+namespace yalx::backend {
+
+class Arm64BlockLayout final : public BlockLayout {
+public:
+    explicit Arm64BlockLayout(base::Arena *arena);
+
+private:
+    bool IsConditionalBranch(Instruction *instr) const override;
+    InstructionCode NegateCondition(InstructionCode code) const override;
+}; // class Arm64BlockLayout
+
+} // namespace yalx::backend
+
+#endif // YALX_BACKEND_ARM64_BLOCK_LAYOUT_ARM64_H
@@ -442,4 +442,29 @@ Jpt_0:
     ASSERT_EQ(z, expected) << expected;
 }
 
+// issue15_tail_call
+TEST_F(Arm64CodeGeneratorTest, TailCall) {
+    auto expected = GenTo("main:main", "issue15_tail_call");
+    static constexpr char z[] = R"(.global main_Zomain_Zdissue15_tail_call
+main_Zomain_Zdissue15_tail_call:
+.cfi_startproc
+Lblk0:
+    sub sp, sp, #32
+    stp fp, lr, [sp, #16]
+    add fp, sp, #16
+    .cfi_def_cfa fp, 16
+    .cfi_offset lr, -8
+    .cfi_offset fp, -16
+    stur w0, [fp, #-4]
+    stur w1, [fp, #-8]
+    ldur w0, [fp, #-8]
+    ldur w1, [fp, #-4]
+    ldp fp, lr, [sp, #16]
+    add sp, sp, #32
+    b main_Zomain_Zdissue04_simple_args
+.cfi_endproc
+)";
+    ASSERT_EQ(z, expected) << expected;
+}
+
 } // namespace yalx::backend
\ No newline at end of file
@@ -125,9 +125,10 @@ public:
         kPageOff,
     };
     
-    FunctionGenerator(Arm64CodeGenerator *owns, InstructionFunction *fun)
+    FunctionGenerator(Arm64CodeGenerator *owns, InstructionFunction *fun, base::PrintingWriter *printer)
     : owns_(owns)
-    , fun_(fun) {
+    , fun_(fun)
+    , printer_(printer) {
     }
     
     void EmitAll() {
@@ -136,7 +137,12 @@ public:
         printer()->Write(fun_->symbol()->ToSlice())->Writeln(":");
         printer()->Writeln(".cfi_startproc");
         position_ = 0;
+        bool cold = false;
         for (auto ib : fun_->blocks()) {
+            if (ib->cold() && !cold) {
+                EmitColdPartStart();
+                cold = true;
+            }
             printer()->Println("Lblk%d:", ib->label());
             for (auto instr : ib->instructions()) {
                 EmitParallelMove(instr->parallel_move(Instruction::kStart));
@@ -146,10 +152,26 @@ public:
             }
         }
         printer()->Writeln(".cfi_endproc");
+        if (cold) {
+            printer()->Println(".section %s", GnuAsmGenerator::kTextSegmentName);
+        }
     }
 
 private:
+    // Cold blocks are in the other section, as a part of function which has its own unwinding info, and the frame
+    // has been set up in the hot part.
+    void EmitColdPartStart() {
+        printer()->Writeln(".cfi_endproc");
+        printer()->Println(".section %s", GnuAsmGenerator::kColdTextSegmentName);
+        printer()->Write(fun_->symbol()->ToSlice())->Writeln(".cold:");
+        printer()->Writeln(".cfi_startproc");
+        Incoming()->Writeln(".cfi_def_cfa fp, 16");
+        Incoming()->Writeln(".cfi_offset lr, -8");
+        Incoming()->Writeln(".cfi_offset fp, -16");
+    }
+
     void Emit(InstructionBlock *ib, Instruction *instr);
+    void EmitTableSwitch(InstructionBlock *ib, Instruction *instr);
     void EmitParallelMove(const ParallelMove *moving);
     void EmitMove(InstructionOperand *dest, InstructionOperand *src);
     void EmitOperand(InstructionOperand *operand, RelocationStyle style = kDefault);
@@ -157,6 +179,8 @@ private:
     void EmitOperands(InstructionOperand *opd0, InstructionOperand *opd1, InstructionOperand *opd2,
                       RelocationStyle style = kDefault);
     void EmitOperands(InstructionOperand *opd0, InstructionOperand *opd1, InstructionOperand *opd2, const char *cond);
+    void EmitOperands(InstructionOperand *opd0, InstructionOperand *opd1, InstructionOperand *opd2,
+                      InstructionOperand *opd3);
 
     void Push(InstructionOperand *regs, size_t n);
     void Pop(InstructionOperand *regs, size_t n);
@@ -166,11 +190,12 @@ private:
     }
     
     base::PrintingWriter *Incoming() { return printer()->Indent(1); }
-    base::PrintingWriter *printer() { return owns_->printer_; }
+    base::PrintingWriter *printer() { return printer_; }
     Linkage *symbols() { return owns_->symbols_; }
     
     Arm64CodeGenerator *const owns_;
     InstructionFunction *fun_;
+    base::PrintingWriter *const printer_;
     int position_ = 0;
 }; // class Arm64CodeGenerator::FunctionGenerator
 
@@ -241,6 +266,14 @@ void Arm64CodeGenerator::FunctionGenerator::Emit(InstructionBlock *ib, Instructi
             Incoming()->Writeln("ret");
             break;
 
+        case ArchTailCall:
+            Incoming()->Println("ldp fp, lr, [sp, #%d]", FrameScopeHint::GetStackMaxSize(instr));
+            Incoming()->Println("add sp, sp, #%d", FrameScopeHint::GetStackMaxSize(instr) + 16);
+            Incoming()->Write("b ");
+            EmitOperand(instr->TempAt(1));
+            printer()->Writeln();
+            break;
+
         case ArchCallNative:
             Incoming()->Write("bl ");
             EmitOperand(instr->InputAt(0));
@@ -249,10 +282,31 @@ void Arm64CodeGenerator::FunctionGenerator::Emit(InstructionBlock *ib, Instructi
             
         case ArchJmp:
             Incoming()->Write("b ");
-            EmitOperand(instr->OutputAt(0));
+            EmitOperand(instr->InputAt(0));
             printer()->Writeln();
             break;
 
+        case ArchTableSwitch:
+            EmitTableSwitch(ib, instr);
+            break;
+
+        case ArchProfileCount: {
+            auto scratch0 = Scratch0Operand(MachineRepresentation::kPointer);
+            auto scratch1 = AllocatedOperand::Register(MachineRepresentation::kWord64, owns_->profile()->scratch1());
+            Incoming()->Write("adrp ");
+            EmitOperands(&scratch0, instr->InputAt(0), kPage);
+            Incoming()->Write("add ");
+            EmitOperands(&scratch0, &scratch0, instr->InputAt(0), kPageOff);
+            auto counter = AllocatedOperand::Location(MachineRepresentation::kWord64, scratch0.register_id(), 0);
+            Incoming()->Write("ldr ");
+            EmitOperands(&scratch1, &counter);
+            ImmediateOperand one{1};
+            Incoming()->Write("add ");
+            EmitOperands(&scratch1, &scratch1, &one);
+            Incoming()->Write("str ");
+            EmitOperands(&scratch1, &counter);
+        } break;
+
         case ArchLoadEffectAddress: {
             auto location = AllocatedOpdOperator::AsLocation(instr->InputAt(0));
             if (location->index() >= 0) {
@@ -283,6 +337,16 @@ void Arm64CodeGenerator::FunctionGenerator::Emit(InstructionBlock *ib, Instructi
             // Ignore
             break;
             
+        case Arm64Cbz:
+            Incoming()->Write("cbz ");
+            EmitOperands(instr->InputAt(0), instr->InputAt(1));
+            break;
+
+        case Arm64Cbnz:
+            Incoming()->Write("cbnz ");
+            EmitOperands(instr->InputAt(0), instr->InputAt(1));
+            break;
+            
         case Arm64B_al:
             Incoming()->Write("b.al ");
             EmitOperand(instr->InputAt(0));
@@ -612,6 +676,24 @@ void Arm64CodeGenerator::FunctionGenerator::Emit(InstructionBlock *ib, Instructi
             EmitOperands(instr->OutputAt(0), instr->InputAt(0), instr->InputAt(1));
             break;
             
+        case Arm64Mul32:
+        case Arm64Mul:
+            Incoming()->Write("mul ");
+            EmitOperands(instr->OutputAt(0), instr->InputAt(0), instr->InputAt(1));
+            break;
+
+        case Arm64Madd32:
+        case Arm64Madd:
+            Incoming()->Write("madd ");
+            EmitOperands(instr->OutputAt(0), instr->InputAt(0), instr->InputAt(1), instr->InputAt(2));
+            break;
+
+        case Arm64Msub32:
+        case Arm64Msub:
+            Incoming()->Write("msub ");
+            EmitOperands(instr->OutputAt(0), instr->InputAt(0), instr->InputAt(1), instr->InputAt(2));
+            break;
+            
         case Arm64And32:
         case Arm64And:
             Incoming()->Write("and ");
@@ -679,6 +761,18 @@ void Arm64CodeGenerator::FunctionGenerator::EmitOperands(InstructionOperand *opd
     printer()->Println(", %s", cond);
 }
 
+void Arm64CodeGenerator::FunctionGenerator::EmitOperands(InstructionOperand *opd0, InstructionOperand *opd1,
+                                                         InstructionOperand *opd2, InstructionOperand *opd3) {
+    EmitOperand(opd0, kDefault);
+    printer()->Write(", ");
+    EmitOperand(opd1, kDefault);
+    printer()->Write(", ");
+    EmitOperand(opd2, kDefault);
+    printer()->Write(", ");
+    EmitOperand(opd3, kDefault);
+    printer()->Writeln();
+}
+
 void Arm64CodeGenerator::FunctionGenerator::EmitOperands(InstructionOperand *opd0, InstructionOperand *opd1,
                                                          RelocationStyle style) {
     EmitOperand(opd0, style);
@@ -747,13 +841,8 @@ void Arm64CodeGenerator::FunctionGenerator::EmitOperand(InstructionOperand *oper
 
         case InstructionOperand::kReloaction: {
             auto opd = operand->AsReloaction();
-            if (opd->label()) {
-                if (opd->offset() == 0) {
-                    printer()->Print("Lblk%d", opd->label()->label());
-                } else {
-                    printer()->Print("Lblk%d%s%d", opd->label()->label(), opd->offset() < 0 ? "-" : "+",
-                                     std::abs(opd->offset()));
-                }
+            if (opd->is_label()) {
+                printer()->Print("Lblk%d", opd->label()->label());
             } else {
                 DCHECK(opd->symbol_name() != nullptr);
                 if (opd->offset() == 0) {
@@ -827,6 +916,77 @@ void Arm64CodeGenerator::FunctionGenerator::Pop(InstructionOperand *regs, size_t
     Incoming()->Println("add sp, sp, #%zd", total_in_bytes);
 }
 
+// The table follows the jump, entries of it are offsets of targets from the table:
+//     uxtb w19, w0
+//     movz w9, #min
+//     sub w19, w19, w9
+//     and w19, w19, #0xff
+//     cmp w19, #n-1
+//     b.hi Lblk_default
+//     adr x9, Ljt1
+//     ldrsw x19, [x9, x19, lsl #2]
+//     add x19, x9, x19
+//     br x19
+// Ljt1:
+//     .long Lblk2-Ljt1
+//     ...
+void Arm64CodeGenerator::FunctionGenerator::EmitTableSwitch(InstructionBlock *ib, Instruction *instr) {
+    auto selector = instr->InputAt(0)->AsAllocated();
+    DCHECK(selector->IsRegisterLocation());
+    auto lowest = instr->InputAt(1)->AsImmediate()->word32_value();
+    auto slots = instr->inputs_count() - 3;
+    auto temp = instr->TempAt(0)->AsAllocated()->register_id();
+    auto rep = selector->machine_representation();
+    auto wide = rep == MachineRepresentation::kWord64 || rep == MachineRepresentation::kPointer;
+    auto scratch = owns_->profile()->scratch0();
+    auto index = RegisterName(wide ? MachineRepresentation::kWord64 : MachineRepresentation::kWord32, scratch);
+    auto index64 = RegisterName(MachineRepresentation::kWord64, scratch);
+    auto base = RegisterName(MachineRepresentation::kWord64, temp);
+
+    switch (rep) {
+        case MachineRepresentation::kWord8:
+            Incoming()->Println("uxtb %s, %s", index, RegisterName(rep, selector->register_id()));
+            break;
+        case MachineRepresentation::kWord16:
+            Incoming()->Println("uxth %s, %s", index, RegisterName(rep, selector->register_id()));
+            break;
+        default:
+            Incoming()->Println("mov %s, %s", index, RegisterName(rep, selector->register_id()));
+            break;
+    }
+    if (lowest != 0) {
+        // Keys are in width of selector
+        auto bits = static_cast<uint32_t>(lowest);
+        auto min = RegisterName(MachineRepresentation::kWord32, temp);
+        Incoming()->Println("movz %s, #%u", min, bits & 0xffff);
+        if (bits >> 16) {
+            Incoming()->Println("movk %s, #%u, lsl #16", min, bits >> 16);
+        }
+        if (wide) {
+            Incoming()->Println("sxtw %s, %s", base, min);
+        }
+        Incoming()->Println("sub %s, %s, %s", index, index, wide ? base : min);
+        if (rep == MachineRepresentation::kWord8) {
+            Incoming()->Println("and %s, %s, #0xff", index, index);
+        } else if (rep == MachineRepresentation::kWord16) {
+            Incoming()->Println("and %s, %s, #0xffff", index, index);
+        }
+    }
+    Incoming()->Println("cmp %s, #%d", index, slots - 1);
+    Incoming()->Write("b.hi ");
+    EmitOperand(instr->InputAt(2));
+    printer()->Writeln();
+    Incoming()->Println("adr %s, Ljt%d", base, ib->label());
+    Incoming()->Println("ldrsw %s, [%s, %s, lsl #2]", index64, base, index64);
+    Incoming()->Println("add %s, %s, %s", index64, base, index64);
+    Incoming()->Println("br %s", index64);
+    printer()->Println("Ljt%d:", ib->label());
+    for (int i = 0; i < slots; i++) {
+        auto target = instr->InputAt(3 + i)->AsReloaction();
+        Incoming()->Println(".long Lblk%d-Ljt%d", target->label()->label(), ib->label());
+    }
+}
+
 void Arm64CodeGenerator::FunctionGenerator::EmitParallelMove(const ParallelMove *moving) {
     if (!moving) {
         return; // Dont need emit moving
@@ -951,12 +1111,12 @@ Arm64CodeGenerator::Arm64CodeGenerator(const base::ArenaMap<std::string_view, In
 
 Arm64CodeGenerator::~Arm64CodeGenerator() = default;
 
-void Arm64CodeGenerator::EmitFunction(InstructionFunction *fun) {
-    FunctionGenerator gen(this, fun);
+void Arm64CodeGenerator::EmitFunction(InstructionFunction *fun, base::PrintingWriter *printer) {
+    FunctionGenerator gen(this, fun, printer);
     gen.EmitAll();
     
     if (fun->native_handle()) {
-        FunctionGenerator g2(this, fun->native_handle());
+        FunctionGenerator g2(this, fun->native_handle(), printer);
         g2.EmitAll();
     }
 }
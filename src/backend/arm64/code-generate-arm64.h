@@ -20,9 +20,13 @@ public:
     ~Arm64CodeGenerator() override;
 
     friend class Arm64CodeGeneratorTest;
+    friend class Arm64PeepholeOptimizerTest;
+    friend class Arm64BlockLayoutTest;
+    friend class FunctionCompilerTest;
     DISALLOW_IMPLICIT_CONSTRUCTORS(Arm64CodeGenerator);
 private:
-    void EmitFunction(InstructionFunction *fun) override;
+    using GnuAsmGenerator::EmitFunction;
+    void EmitFunction(InstructionFunction *fun, base::PrintingWriter *printer) override;
 }; // class Arm64CodeGenerator
 
 } // namespace yalx::backend
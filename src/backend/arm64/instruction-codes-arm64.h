@@ -90,6 +90,8 @@ namespace yalx::backend {
     V(Arm64TestAndBranch)                     \
     V(Arm64CompareAndBranch32)                \
     V(Arm64CompareAndBranch)                  \
+    V(Arm64Cbz)                               \
+    V(Arm64Cbnz)                              \
     V(Arm64Claim)                             \
     V(Arm64Poke)                              \
     V(Arm64PokePair)                          \
@@ -29,7 +29,7 @@ void Arm64PosixLower::VisitCondBr(ir::Value *instr) {
         auto code = ir::OperatorWith<ir::IConditionId>::Data(cond->op()).value;
         switch (code) {
             case ir::IConditionId::k_sle:
-                Emit(Arm64B_gt, output);
+                Emit(Arm64B_gt, NoOutput(), output);
                 break;
 
             default:
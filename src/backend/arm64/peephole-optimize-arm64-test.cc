@@ -0,0 +1,176 @@
+#include "backend/arm64/peephole-optimize-arm64.h"
+#include "backend/arm64/code-generate-arm64.h"
+#include "backend/arm64/lower-posix-arm64.h"
+#include "backend/barrier-set.h"
+#include "backend/constants-pool.h"
+#include "backend/linkage-symbols.h"
+#include "backend/registers-configuration.h"
+#include "backend/zero-slot-allocator.h"
+#include "backend/frame.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/type.h"
+#include "ir/operator.h"
+#include "ir/utils.h"
+#include "ir/base-test.h"
+#include "base/io.h"
+
+namespace yalx::backend {
+
+class Arm64PeepholeOptimizerTest : public ir::BaseTest {
+public:
+    Arm64PeepholeOptimizerTest(): const_pool_(&arena_), linkage_(&arena_), all_(&arena_) {}
+
+    void SetUp() override {
+        bool ok = true;
+        IRGen("tests/32-code-lower", &all_, &ok);
+        ASSERT_TRUE(ok);
+    }
+
+    std::string GenTo(const char *pkg_name, const char *name) {
+        auto mod = FindModuleOrNull(pkg_name);
+        auto ir_fun = mod->FindFunOrNull(name);
+        Arm64PosixLower lower(&arena_, RegistersConfiguration::OfPosixArm64(), &linkage_,
+                            &const_pool_, BarrierSet::OfYGCPosixArm64());
+        auto fun = lower.VisitFunction(ir_fun);
+        ZeroSlotAllocator allocator{arena(), RegistersConfiguration::OfPosixArm64(), fun};
+        allocator.Run();
+        Arm64PeepholeOptimizer optimizer(arena(), RegistersConfiguration::OfPosixArm64());
+        optimizer.Run(fun);
+        return GenTo(mod, fun);
+    }
+
+    std::string GenTo(ir::Module *root, InstructionFunction *fun) {
+        base::ArenaMap<std::string_view, InstructionFunction *> funs(arena());
+        funs[fun->symbol()->ToSlice()] = fun;
+
+        std::string buf;
+        auto file = base::NewMemoryWritableFile(&buf);
+        base::PrintingWriter printer{file, true};
+        Arm64CodeGenerator gen(funs, RegistersConfiguration::OfPosixArm64(), root, &const_pool_, &linkage_, &printer);
+        gen.EmitFunction(fun);
+        return buf;
+    }
+
+    InstructionFunction *NewFunction(const char *name) {
+        auto module = FindModuleOrNull("main:main");
+        auto prototype = new (arena()) ir::PrototypeModel(arena(), String::kEmpty, false/*vargs*/);
+        auto symbol = String::New(arena(), name);
+        auto frame = new (arena()) Frame(arena(), module->NewFunction(ir::Function::kDefault, symbol, symbol,
+                                                                       prototype));
+        return new (arena()) InstructionFunction(arena(), symbol, frame);
+    }
+
+    Instruction *Emit(InstructionBlock *block, InstructionCode op, std::vector<InstructionOperand> outputs,
+                      std::vector<InstructionOperand> inputs) {
+        auto instr = Instruction::New(arena(), op, inputs.size(), inputs.data(), outputs.size(), outputs.data(), 0,
+                                      nullptr);
+        block->Add(instr);
+        return instr;
+    }
+
+    static AllocatedOperand Reg(int id) { return AllocatedOperand::Register(MachineRepresentation::kWord64, id); }
+    static AllocatedOperand Reg32(int id) { return AllocatedOperand::Register(MachineRepresentation::kWord32, id); }
+
+    ir::Module *FindModuleOrNull(std::string_view full_name) const {
+        if (auto iter = all_.find(full_name); iter != all_.end()) {
+            return iter->second;
+        } else {
+            return nullptr;
+        }
+    }
+
+protected:
+    Linkage linkage_;
+    ConstantsPool const_pool_;
+    base::ArenaMap<std::string_view, ir::Module *> all_;
+}; // class Arm64PeepholeOptimizerTest
+
+TEST_F(Arm64PeepholeOptimizerTest, ForwardStoredValue) {
+    auto expected = GenTo("main:main", "issue02_simple_add");
+    static constexpr char z[] = R"(.global main_Zomain_Zdissue02_simple_add
+main_Zomain_Zdissue02_simple_add:
+.cfi_startproc
+Lblk0:
+    sub sp, sp, #32
+    stp fp, lr, [sp, #16]
+    add fp, sp, #16
+    .cfi_def_cfa fp, 16
+    .cfi_offset lr, -8
+    .cfi_offset fp, -16
+    mov w1, #1
+    add w0, w1, #2
+    stur w0, [fp, #-4]
+    str w0, [fp, #28]
+    ldp fp, lr, [sp, #16]
+    add sp, sp, #32
+    ret
+.cfi_endproc
+)";
+    ASSERT_EQ(z, expected) << expected;
+}
+
+TEST_F(Arm64PeepholeOptimizerTest, CombineCmpAndBranch) {
+    auto fun = NewFunction("cbz");
+    auto b0 = fun->NewBlock(0);
+    auto b1 = fun->NewBlock(1);
+    auto b2 = fun->NewBlock(2);
+    Emit(b0, Arm64Cmp, {}, {Reg(0), ImmediateOperand{0}});
+    Emit(b0, Arm64B_ne, {}, {ReloactionOperand{b2}});
+    Emit(b1, Arm64Cmp32, {}, {Reg32(1), ImmediateOperand{0}});
+    Emit(b1, Arm64B_eq, {}, {ReloactionOperand{b0}});
+    // Flags are still used by b.lt
+    Emit(b2, Arm64Cmp, {}, {Reg(0), ImmediateOperand{0}});
+    Emit(b2, Arm64B_eq, {}, {ReloactionOperand{b0}});
+    Emit(b2, Arm64B_lt, {}, {ReloactionOperand{b1}});
+
+    Arm64PeepholeOptimizer optimizer(arena(), RegistersConfiguration::OfPosixArm64());
+    optimizer.Run(fun);
+    EXPECT_EQ(2, optimizer.combined_instructions());
+    EXPECT_EQ(3, b2->instructions_size());
+    auto expected = GenTo(FindModuleOrNull("main:main"), fun);
+    static constexpr char z[] = R"(.global cbz
+cbz:
+.cfi_startproc
+Lblk0:
+    cbnz x0, Lblk2
+Lblk1:
+    cbz w1, Lblk0
+Lblk2:
+    cmp x0, #0
+    b.eq Lblk0
+    b.lt Lblk1
+.cfi_endproc
+)";
+    ASSERT_EQ(z, expected) << expected;
+}
+
+TEST_F(Arm64PeepholeOptimizerTest, CombineMulAndArith) {
+    auto fun = NewFunction("madd");
+    auto b0 = fun->NewBlock(0);
+    Emit(b0, Arm64Mul, {Reg(0)}, {Reg(1), Reg(2)});
+    Emit(b0, Arm64Add, {Reg(0)}, {Reg(3), Reg(0)});
+    Emit(b0, Arm64Mul32, {Reg32(4)}, {Reg32(1), Reg32(2)});
+    Emit(b0, Arm64Sub32, {Reg32(4)}, {Reg32(3), Reg32(4)});
+    // The product is still alive
+    Emit(b0, Arm64Mul, {Reg(5)}, {Reg(1), Reg(2)});
+    Emit(b0, Arm64Add, {Reg(6)}, {Reg(5), Reg(3)});
+
+    Arm64PeepholeOptimizer optimizer(arena(), RegistersConfiguration::OfPosixArm64());
+    optimizer.Run(fun);
+    EXPECT_EQ(2, optimizer.combined_instructions());
+    auto expected = GenTo(FindModuleOrNull("main:main"), fun);
+    static constexpr char z[] = R"(.global madd
+madd:
+.cfi_startproc
+Lblk0:
+    madd x0, x1, x2, x3
+    msub w4, w1, w2, w3
+    mul x5, x1, x2
+    add x6, x5, x3
+.cfi_endproc
+)";
+    ASSERT_EQ(z, expected) << expected;
+}
+
+} // namespace yalx::backend
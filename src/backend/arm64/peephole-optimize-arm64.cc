@@ -0,0 +1,132 @@
+#include "backend/arm64/peephole-optimize-arm64.h"
+#include "backend/move-resolver.h"
+#include "backend/registers-configuration.h"
+
+namespace yalx::backend {
+
+#define ARM64_READING_FLAGS_LIST(V) \
+    V(B_cs) V(B_cc) V(B_mi) V(B_pl) V(B_vs) V(B_vc) V(B_hi) V(B_ls) V(B_eq) V(B_ne) V(B_lt) V(B_le) V(B_gt) \
+    V(B_ge) V(Select_cs) V(Select_cc) V(Select_mi) V(Select_pl) V(Select_vs) V(Select_vc) V(Select_hi)      \
+    V(Select_ls) V(Select_eq) V(Select_ne) V(Select_lt) V(Select_le) V(Select_gt) V(Select_ge)
+
+#define ARM64_WRITING_FLAGS_LIST(V) \
+    V(Cmp) V(Cmp32) V(Cmn) V(Cmn32) V(Tst) V(Tst32) V(Float32Cmp) V(Float64Cmp)
+
+#define ARM64_WRITING_OUTPUTS_ONLY_LIST(V) \
+    ARM64_WRITING_FLAGS_LIST(V) \
+    V(Add) V(Add32) V(AddOff) V(Sub) V(Sub32) V(And) V(And32) V(Mul) V(Mul32) V(Madd) V(Madd32) V(Msub) \
+    V(Msub32) V(Adr) V(Adrp) V(Mov) V(Mov32) V(FMov) V(Uxtb) V(Uxth) V(Sxtb32) V(Sxth32) V(Sxtw32)       \
+    V(Ldr) V(LdrS) V(LdrD) V(Ldrb) V(Ldrsb) V(LdrW) V(Ldrsw) V(Ldp) V(Str) V(StrS) V(StrD) V(Strb)       \
+    V(Strh) V(StrW) V(B_al) V(Cbz) V(Cbnz)
+
+#define DEFINE_CASE(name) case Arm64##name:
+
+Arm64PeepholeOptimizer::Arm64PeepholeOptimizer(base::Arena *arena, const RegistersConfiguration *regconf)
+: PeepholeOptimizer(arena, regconf) {
+}
+
+bool Arm64PeepholeOptimizer::Combine(InstructionBlock *block, size_t position) {
+    return CombineCmpAndBranch(block, position) || CombineMulAndArith(block, position);
+}
+
+bool Arm64PeepholeOptimizer::IsWritingOutputsOnly(Instruction *instr) const {
+    switch (instr->op()) {
+        ARM64_READING_FLAGS_LIST(DEFINE_CASE)
+        ARM64_WRITING_OUTPUTS_ONLY_LIST(DEFINE_CASE)
+            return true;
+        default:
+            return PeepholeOptimizer::IsWritingOutputsOnly(instr);
+    }
+}
+
+// Arm64Cmp {qword $0}, #0
+// Arm64B_eq <Lblk1>
+// ----------------------------
+// Arm64Cbz {qword $0}, <Lblk1>
+bool Arm64PeepholeOptimizer::CombineCmpAndBranch(InstructionBlock *block, size_t position) {
+    auto cmp = InstructionAt(block, position);
+    auto branch = InstructionAt(block, position + 1);
+    if (!cmp || (cmp->op() != Arm64Cmp && cmp->op() != Arm64Cmp32) || !IsAdjacent(cmp, branch)) {
+        return false;
+    }
+    if (branch->op() != Arm64B_eq && branch->op() != Arm64B_ne) {
+        return false;
+    }
+    int32_t imm = -1;
+    if (!AllocatedOpdOperator::IsRegister(cmp->InputAt(0)) || !GetImmediate32(cmp->InputAt(1), &imm) || imm != 0) {
+        return false;
+    }
+    // `cbz' does not set flags.
+    if (IsFlagsLive(block, position + 2)) {
+        return false;
+    }
+    InstructionOperand inputs[] = {*cmp->InputAt(0), *branch->InputAt(0)};
+    Replace(block, position, 2, NewInstruction(branch->op() == Arm64B_eq ? Arm64Cbz : Arm64Cbnz, 0, nullptr, 2,
+                                               inputs));
+    return true;
+}
+
+// {qword $0} = Arm64Mul {qword $1}, {qword $2}
+// {qword $0} = Arm64Add {qword $0}, {qword $3}
+// ----------------------------
+// {qword $0} = Arm64Madd {qword $1}, {qword $2}, {qword $3}
+bool Arm64PeepholeOptimizer::CombineMulAndArith(InstructionBlock *block, size_t position) {
+    auto mul = InstructionAt(block, position);
+    auto arith = InstructionAt(block, position + 1);
+    if (!mul || (mul->op() != Arm64Mul && mul->op() != Arm64Mul32) || !IsAdjacent(mul, arith)) {
+        return false;
+    }
+    auto is_word64 = mul->op() == Arm64Mul;
+    auto product = mul->OutputAt(0);
+    // The product must be dead after arith, so only combine it when arith overwrites it.
+    if (!AllocatedOpdOperator::IsRegister(product) || !arith->OutputAt(0)->Equals(product)) {
+        return false;
+    }
+
+    InstructionOperand *addend = nullptr;
+    Instruction::Code op = ArchNop;
+    if (arith->op() == (is_word64 ? Arm64Add : Arm64Add32)) {
+        op = is_word64 ? Arm64Madd : Arm64Madd32;
+        addend = arith->InputAt(0)->Equals(product) ? arith->InputAt(1) : arith->InputAt(0);
+    } else if (arith->op() == (is_word64 ? Arm64Sub : Arm64Sub32) && arith->InputAt(1)->Equals(product)) {
+        op = is_word64 ? Arm64Msub : Arm64Msub32;
+        addend = arith->InputAt(0);
+    } else {
+        return false;
+    }
+    if (!AllocatedOpdOperator::IsRegister(addend) || MoveResolver::IsOverlap(*addend, *product) ||
+        (!arith->InputAt(0)->Equals(product) && !arith->InputAt(1)->Equals(product))) {
+        return false;
+    }
+
+    InstructionOperand output = *product;
+    InstructionOperand inputs[] = {*mul->InputAt(0), *mul->InputAt(1), *addend};
+    Replace(block, position, 2, NewInstruction(op, 1, &output, 3, inputs));
+    return true;
+}
+
+bool Arm64PeepholeOptimizer::IsFlagsLive(InstructionBlock *block, size_t position) {
+    for (size_t i = position; i < block->instructions_size(); i++) {
+        switch (block->instruction(i)->op()) {
+            ARM64_READING_FLAGS_LIST(DEFINE_CASE)
+                return true;
+            ARM64_WRITING_FLAGS_LIST(DEFINE_CASE)
+            case ArchJmp:
+            case ArchTableSwitch:
+            case ArchRet:
+            case ArchCall:
+            case ArchTailCall:
+            case ArchCallNative:
+            case ArchBeforeCall:
+            case ArchFrameExit:
+                return false;
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+#undef DEFINE_CASE
+
+} // namespace yalx::backend
@@ -0,0 +1,29 @@
+#pragma once
+#ifndef YALX_BACKEND_ARM64_PEEPHOLE_OPTIMIZE_ARM64_H
+#define YALX_BACKEND_ARM64_PEEPHOLE_OPTIMIZE_ARM64_H
+
+#include "backend/peephole-optimizer.h"
+
+namespace yalx::backend {
+
+// arm64 combinations:
+// * compare with zero and branch into one: `cmp x0, #0; b.eq L' => `cbz x0, L'
+// * multiply and add/sub into one: `mul x0, x1, x2; add x0, x0, x3' => `madd x0, x1, x2, x3'
+class Arm64PeepholeOptimizer final : public PeepholeOptimizer {
+public:
+    Arm64PeepholeOptimizer(base::Arena *arena, const RegistersConfiguration *regconf);
+
+private:
+    bool Combine(InstructionBlock *block, size_t position) override;
+    bool IsWritingOutputsOnly(Instruction *instr) const override;
+
+    bool CombineCmpAndBranch(InstructionBlock *block, size_t position);
+    bool CombineMulAndArith(InstructionBlock *block, size_t position);
+
+    // The flags be read by instructions start at `position' before be written again?
+    static bool IsFlagsLive(InstructionBlock *block, size_t position);
+}; // class Arm64PeepholeOptimizer
+
+} // namespace yalx::backend
+
+#endif // YALX_BACKEND_ARM64_PEEPHOLE_OPTIMIZE_ARM64_H
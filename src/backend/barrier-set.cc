@@ -2,9 +2,12 @@
 #include "backend/linkage-symbols.h"
 #include "backend/instruction-selector.h"
 #include "backend/registers-configuration.h"
+#include "backend/frame.h"
+#include "ir/pass/analysis.h"
 #include "ir/node.h"
 #include "ir/metadata.h"
 #include "base/format.h"
+#include <memory>
 
 namespace yalx::backend {
 
@@ -23,7 +26,16 @@ public:
     X64PosixYGCBarrierSet() = default;
     ~X64PosixYGCBarrierSet() override = default;
 
+    void BeforeFun(InstructionSelector *selector, InstructionFunction *) override {
+        elision_ = std::make_unique<ir::BarrierElision>(selector->frame()->fun());
+    }
+
+    void AfterFun(InstructionSelector *selector, InstructionFunction *) override { elision_.reset(); }
+
     void PostLoad(InstructionSelector *selector, ir::Value *ir) override {
+        if (elision_ && elision_->IsBarrierFree(ir)) {
+            return;
+        }
         auto profile = selector->registers();
         auto bad_mask = AllocatedOperand::Register(MachineRepresentation::kWord64, profile->scratch0());
         auto bad_mask_symbol = ReloactionOperand{kRt_YGC_ADDRESS_BAD_MASK};
@@ -74,6 +86,7 @@ public:
     void PostStore(InstructionSelector *selector) override {}
 
 private:
+    std::unique_ptr<ir::BarrierElision> elision_;
     int next_id_ = 0;
 }; // class X64PosixYGCBarrierSet
 
@@ -83,7 +96,16 @@ public:
     Arm64PosixYGCBarrierSet() = default;
     ~Arm64PosixYGCBarrierSet() override = default;
 
+    void BeforeFun(InstructionSelector *selector, InstructionFunction *) override {
+        elision_ = std::make_unique<ir::BarrierElision>(selector->frame()->fun());
+    }
+
+    void AfterFun(InstructionSelector *selector, InstructionFunction *) override { elision_.reset(); }
+
     void PostLoad(InstructionSelector *selector, ir::Value *ir) override {
+        if (elision_ && elision_->IsBarrierFree(ir)) {
+            return;
+        }
         auto profile = selector->registers();
         auto bad_mask = AllocatedOperand::Register(MachineRepresentation::kWord64,
                                                    profile->scratch0());
@@ -139,6 +161,7 @@ public:
     void PostStore(InstructionSelector *selector) override {}
 
 private:
+    std::unique_ptr<ir::BarrierElision> elision_;
     int next_id_ = 0;
 }; // class Arm64PosixYGCBarrierSet
 
@@ -0,0 +1,272 @@
+#include "backend/block-layout.h"
+#include <algorithm>
+
+namespace yalx::backend {
+
+BlockLayout::BlockLayout(base::Arena *arena)
+: arena_(arena) {
+}
+
+void BlockLayout::Run(InstructionFunction *fun) {
+    fun_ = fun;
+    back_edges_.clear();
+    loops_.clear();
+    probabilities_.clear();
+    if (fun->blocks().empty()) {
+        return;
+    }
+
+    std::vector<bool> on_stack(fun->blocks_size(), false);
+    std::vector<bool> visited(fun->blocks_size(), false);
+    ComputeLoops(fun->entry(), &on_stack, &visited);
+    ComputeLoopBlocks();
+    ComputeDeferredBlocks();
+    ComputeProbabilities();
+    PlaceBlocks();
+}
+
+float BlockLayout::ProbabilityOf(const InstructionBlock *from, const InstructionBlock *to) const {
+    DCHECK(from->id() >= 0 && from->id() < probabilities_.size());
+    for (size_t i = 0; i < from->successors_size(); i++) {
+        if (from->successor(i) == to) {
+            return probabilities_[from->id()][i];
+        }
+    }
+    return 0;
+}
+
+void BlockLayout::ComputeLoops(InstructionBlock *block, std::vector<bool> *on_stack, std::vector<bool> *visited) {
+    (*visited)[block->id()] = true;
+    (*on_stack)[block->id()] = true;
+    for (auto succ : block->successors()) {
+        if ((*on_stack)[succ->id()]) {
+            back_edges_.emplace_back(block->id(), succ->id());
+        } else if (!(*visited)[succ->id()]) {
+            ComputeLoops(succ, on_stack, visited);
+        }
+    }
+    (*on_stack)[block->id()] = false;
+}
+
+void BlockLayout::ComputeLoopBlocks() {
+    // Blocks reach the loop end without passing the loop header are in the loop.
+    for (auto [end, header] : back_edges_) {
+        std::vector<bool> loop(fun_->blocks_size(), false);
+        std::vector<InstructionBlock *> work_list{fun_->block(end)};
+        loop[header] = true;
+        loop[end] = true;
+        while (!work_list.empty()) {
+            auto node = work_list.back();
+            work_list.pop_back();
+            for (auto pred : node->predecessors()) {
+                if (!loop[pred->id()]) {
+                    loop[pred->id()] = true;
+                    work_list.push_back(pred);
+                }
+            }
+        }
+        loops_.push_back(std::move(loop));
+    }
+}
+
+void BlockLayout::ComputeDeferredBlocks() {
+    auto entry = fun_->entry();
+    if (entry->frequency() > 0) {
+        for (auto block : fun_->blocks()) {
+            if (block != entry && block->frequency() == 0) {
+                block->set_deferred(true);
+            }
+        }
+    }
+
+    auto all_deferred = [](const base::ArenaVector<InstructionBlock *> &blocks) {
+        return !blocks.empty() && std::all_of(blocks.begin(), blocks.end(), [](InstructionBlock *block) {
+            return block->deferred();
+        });
+    };
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto block : fun_->blocks()) {
+            if (block == entry || block->deferred()) {
+                continue;
+            }
+            if (all_deferred(block->successors()) || all_deferred(block->predecessors())) {
+                block->set_deferred(true);
+                changed = true;
+            }
+        }
+    }
+    // Entries of a jump table are offsets from the table, so the targets must be in the same section.
+    for (auto block : fun_->blocks()) {
+        if (!block->instructions().empty() && block->instructions().back()->op() == ArchTableSwitch) {
+            block->set_deferred(false);
+            for (auto succ : block->successors()) {
+                succ->set_deferred(false);
+            }
+        }
+    }
+}
+
+void BlockLayout::ComputeProbabilities() {
+    probabilities_.resize(fun_->blocks_size());
+    for (auto block : fun_->blocks()) {
+        std::vector<double> weights;
+        double total = 0;
+        auto profiled = std::all_of(block->successors().begin(), block->successors().end(),
+                                    [](InstructionBlock *succ) { return HasCount(succ); });
+        if (profiled) {
+            for (auto succ : block->successors()) {
+                weights.push_back(static_cast<double>(succ->frequency()));
+                total += weights.back();
+            }
+        }
+        if (total == 0) {
+            weights.clear();
+            for (auto succ : block->successors()) {
+                if (succ->deferred() && !block->deferred()) {
+                    weights.push_back(kDeferredWeight);
+                } else if (IsBackEdge(block, succ)) {
+                    weights.push_back(kBackEdgeWeight);
+                } else if (IsLoopExit(block, succ)) {
+                    weights.push_back(kLoopExitWeight);
+                } else {
+                    weights.push_back(kDefaultWeight);
+                }
+                total += weights.back();
+            }
+        }
+
+        auto probabilities = &probabilities_[block->id()];
+        probabilities->clear();
+        for (auto weight : weights) {
+            probabilities->push_back(static_cast<float>(weight / total));
+        }
+    }
+}
+
+void BlockLayout::PlaceBlocks() {
+    std::vector<InstructionBlock *> order;
+    std::vector<bool> placed(fun_->blocks_size(), false);
+    PlaceChain(fun_->entry(), false/*cold*/, &order, &placed);
+    for (auto block : fun_->blocks()) {
+        if (!placed[block->id()] && !block->deferred()) {
+            PlaceChain(block, false/*cold*/, &order, &placed);
+        }
+    }
+    for (auto block : fun_->blocks()) {
+        if (!placed[block->id()]) {
+            PlaceChain(block, true/*cold*/, &order, &placed);
+        }
+    }
+    DCHECK(order.size() == fun_->blocks_size());
+
+    for (size_t i = 0; i < order.size(); i++) {
+        auto block = order[i];
+        // Never falls through to the other text section.
+        auto next = i + 1 < order.size() && order[i + 1]->cold() == block->cold() ? order[i + 1] : nullptr;
+        FixFallingThrough(block, next);
+    }
+    fun_->mutable_blocks()->assign(order.begin(), order.end());
+}
+
+void BlockLayout::PlaceChain(InstructionBlock *head, bool cold, std::vector<InstructionBlock *> *order,
+                             std::vector<bool> *placed) {
+    for (auto block = head; block != nullptr;) {
+        (*placed)[block->id()] = true;
+        order->push_back(block);
+        block->set_cold(cold);
+        if (cold) {
+            cold_blocks_++;
+        }
+
+        InstructionBlock *next = nullptr;
+        float likely = -1;
+        for (size_t i = 0; i < block->successors_size(); i++) {
+            auto succ = block->successor(i);
+            if ((*placed)[succ->id()] || succ->deferred() != cold) {
+                continue;
+            }
+            if (auto probability = probabilities_[block->id()][i]; probability > likely) {
+                likely = probability;
+                next = succ;
+            }
+        }
+        block = next;
+    }
+}
+
+void BlockLayout::FixFallingThrough(InstructionBlock *block, InstructionBlock *next) {
+    if (block->successors().empty()) {
+        return;
+    }
+    auto last = block->instructions().empty() ? nullptr : block->instructions().back();
+    if (last && (last->op() == ArchJmp || last->op() == ArchTableSwitch)) {
+        return;
+    }
+
+    // Without a branch, a block falls through to its first successor, e.g. the normal continuation of a call.
+    auto target = block->successor(0);
+    auto label = last && !last->is_jumping_dest() && IsConditionalBranch(last) ? BranchLabel(last) : nullptr;
+    if (label) {
+        auto taken = label->label();
+        for (auto succ : block->successors()) {
+            if (succ != taken) {
+                target = succ;
+                break;
+            }
+        }
+        auto code = NegateCondition(last->op());
+        auto after = last->parallel_move(Instruction::kEnd);
+        if (target != next && taken == next && code != ArchNop && (!after || after->moves().empty())) {
+            std::vector<InstructionOperand> inputs, outputs, temps;
+            for (int i = 0; i < last->inputs_count(); i++) {
+                inputs.push_back(last->InputAt(i) == label ? ReloactionOperand(target) : *last->InputAt(i));
+            }
+            for (int i = 0; i < last->outputs_count(); i++) {
+                outputs.push_back(*last->OutputAt(i));
+            }
+            for (int i = 0; i < last->temps_count(); i++) {
+                temps.push_back(*last->TempAt(i));
+            }
+            auto instr = Instruction::New(arena_, code, inputs.size(), inputs.data(), outputs.size(), outputs.data(),
+                                          temps.size(), temps.data());
+            if (auto before = last->mutable_parallel_move(Instruction::kStart)) {
+                for (auto move : before->moves()) {
+                    instr->GetOrNewParallelMove(Instruction::kStart, arena_)->mutable_moves()->push_back(move);
+                }
+            }
+            instr->set_id(last->id());
+            block->mutable_instructions()->back() = instr;
+            negated_branches_++;
+            return;
+        }
+    }
+    if (target == next) {
+        return;
+    }
+    InstructionOperand input = ReloactionOperand(target);
+    block->Add(Instruction::New(arena_, ArchJmp, 1, &input, 0, nullptr, 0, nullptr));
+    inserted_jumps_++;
+}
+
+bool BlockLayout::IsBackEdge(const InstructionBlock *from, const InstructionBlock *to) const {
+    return std::find(back_edges_.begin(), back_edges_.end(), std::make_pair(from->id(), to->id())) !=
+           back_edges_.end();
+}
+
+bool BlockLayout::IsLoopExit(const InstructionBlock *from, const InstructionBlock *to) const {
+    return std::any_of(loops_.begin(), loops_.end(), [from, to](const std::vector<bool> &loop) {
+        return loop[from->id()] && !loop[to->id()];
+    });
+}
+
+ReloactionOperand *BlockLayout::BranchLabel(Instruction *instr) {
+    for (int i = 0; i < instr->inputs_count(); i++) {
+        if (auto opd = instr->InputAt(i)->AsReloaction(); opd && opd->is_label()) {
+            return opd;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace yalx::backend
@@ -0,0 +1,87 @@
+#pragma once
+#ifndef YALX_BACKEND_BLOCK_LAYOUT_H_
+#define YALX_BACKEND_BLOCK_LAYOUT_H_
+
+#include "backend/instruction.h"
+#include "base/base.h"
+#include <vector>
+
+namespace yalx::base {
+class Arena;
+}
+
+namespace yalx::backend {
+
+// Orders blocks of an allocated function by branch probabilities, runs after register (or slot) allocation and
+// before the peephole optimizer, which removes the jumps to the next block:
+// * The most likely successor of a block follows it, so it is reached by falling through;
+// * Deferred blocks, and blocks reached only from or leading only to them, go to the end of function, into the cold
+//   text section;
+// * Conditional branches are negated, or followed by a jump, to keep falling through to the right block.
+// Probabilities come from execution counts of blocks (frequencies from the profile) if they are known, or static
+// heuristics:
+// * Jumping back to a loop header is likely;
+// * Leaving a loop is unlikely;
+// * Going to a deferred block is very unlikely.
+class BlockLayout {
+public:
+    // Weights of edges by static heuristics.
+    static constexpr int kDeferredWeight = 1;
+    static constexpr int kLoopExitWeight = 16;
+    static constexpr int kDefaultWeight = 64;
+    static constexpr int kBackEdgeWeight = 448;
+
+    explicit BlockLayout(base::Arena *arena);
+    virtual ~BlockLayout() = default;
+
+    void Run(InstructionFunction *fun);
+
+    // Probability of jumping from `from' to its successor `to' in the last run.
+    float ProbabilityOf(const InstructionBlock *from, const InstructionBlock *to) const;
+
+    DEF_VAL_GETTER(int, cold_blocks);
+    DEF_VAL_GETTER(int, negated_branches);
+    DEF_VAL_GETTER(int, inserted_jumps);
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(BlockLayout);
+protected:
+    // Is `instr' a conditional branch to a block? It falls through to the other successor if not taken.
+    virtual bool IsConditionalBranch(Instruction *instr) const = 0;
+
+    // Code of the branch taken on the opposite condition, ArchNop if it can not be negated.
+    virtual InstructionCode NegateCondition(InstructionCode code) const = 0;
+
+    base::Arena *arena() const { return arena_; }
+
+private:
+    void ComputeLoops(InstructionBlock *block, std::vector<bool> *on_stack, std::vector<bool> *visited);
+    void ComputeLoopBlocks();
+    void ComputeDeferredBlocks();
+    void ComputeProbabilities();
+    void PlaceBlocks();
+    void PlaceChain(InstructionBlock *head, bool cold, std::vector<InstructionBlock *> *order,
+                    std::vector<bool> *placed);
+    void FixFallingThrough(InstructionBlock *block, InstructionBlock *next);
+
+    bool IsBackEdge(const InstructionBlock *from, const InstructionBlock *to) const;
+    bool IsLoopExit(const InstructionBlock *from, const InstructionBlock *to) const;
+    static bool HasCount(const InstructionBlock *block) { return block->frequency() >= 0; }
+
+    static ReloactionOperand *BranchLabel(Instruction *instr);
+
+    base::Arena *const arena_;
+    InstructionFunction *fun_ = nullptr;
+    // Back edges, from the loop end to the loop header.
+    std::vector<std::pair<int, int>> back_edges_;
+    // Blocks in each loop, indexed by block id.
+    std::vector<std::vector<bool>> loops_;
+    // Probabilities of successors, indexed by block id and successor index.
+    std::vector<std::vector<float>> probabilities_;
+    int cold_blocks_ = 0;
+    int negated_branches_ = 0;
+    int inserted_jumps_ = 0;
+}; // class BlockLayout
+
+} // namespace yalx::backend
+
+#endif // YALX_BACKEND_BLOCK_LAYOUT_H_
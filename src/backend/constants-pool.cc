@@ -33,4 +33,17 @@ int ConstantsPool::FindOrInsertString(const String *value) {
     return id;
 }
 
+void ConstantsPool::Merge(const ConstantsPool &other, std::vector<int> *strings, std::vector<int> *numbers) {
+    for (auto value : other.string_pool()) {
+        strings->push_back(FindOrInsertString(value));
+    }
+    std::vector<const Slot *> slots(other.numbers().size());
+    for (const auto &[slot, id] : other.numbers()) {
+        slots[id] = &slot;
+    }
+    for (auto slot : slots) {
+        numbers->push_back(FindOrInsertSlot(slot->kind, slot->data, sizeof(slot->data)));
+    }
+}
+
 } // namespace yalx
@@ -68,6 +68,9 @@ public:
     }
     
     int FindOrInsertString(const String *value);
+    
+    // Insert all constants of `other' in order of their ids, returns new ids of them, indexed by old ones.
+    void Merge(const ConstantsPool &other, std::vector<int> *strings, std::vector<int> *numbers);
 private:
     int FindOrInsertSlot(MachineRepresentation kind, const void *data, size_t size);
     
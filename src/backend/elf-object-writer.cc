@@ -0,0 +1,282 @@
+#include "backend/elf-object-writer.h"
+#include "base/io.h"
+#include "base/checking.h"
+#include <algorithm>
+
+namespace yalx::backend {
+
+namespace {
+
+// ELF constants, see: https://refspecs.linuxfoundation.org/elf/gabi4+/contents.html
+constexpr uint16_t ET_REL = 1;
+constexpr uint32_t SHT_PROGBITS = 1;
+constexpr uint32_t SHT_SYMTAB = 2;
+constexpr uint32_t SHT_STRTAB = 3;
+constexpr uint32_t SHT_RELA = 4;
+constexpr uint32_t SHT_X86_64_UNWIND = 0x70000001;
+constexpr uint64_t SHF_WRITE = 0x1;
+constexpr uint64_t SHF_ALLOC = 0x2;
+constexpr uint64_t SHF_EXECINSTR = 0x4;
+constexpr uint64_t SHF_INFO_LINK = 0x40;
+constexpr uint8_t STB_LOCAL = 0;
+constexpr uint8_t STB_GLOBAL = 1;
+constexpr uint8_t STT_NOTYPE = 0;
+constexpr uint8_t STT_OBJECT = 1;
+constexpr uint8_t STT_FUNC = 2;
+
+constexpr size_t kElfHeaderSize = 64;
+constexpr size_t kSectionHeaderSize = 64;
+constexpr size_t kSymbolSize = 24;
+constexpr size_t kRelaSize = 24;
+
+template<class T>
+inline void Put(std::string *buf, T value) {
+    buf->append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+inline void PadTo(std::string *buf, uint64_t align) {
+    buf->append(RoundUp(buf->size(), static_cast<intptr_t>(align)) - buf->size(), '\0');
+}
+
+class StringTable {
+public:
+    StringTable() { buf_.push_back('\0'); }
+
+    uint32_t Add(std::string_view s) {
+        if (s.empty()) {
+            return 0;
+        }
+        auto offset = static_cast<uint32_t>(buf_.size());
+        buf_.append(s);
+        buf_.push_back('\0');
+        return offset;
+    }
+
+    DEF_VAL_GETTER(std::string, buf);
+private:
+    std::string buf_;
+}; // class StringTable
+
+struct SectionHeader {
+    uint32_t name;
+    uint32_t type;
+    uint64_t flags;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t link;
+    uint32_t info;
+    uint64_t align;
+    uint64_t entsize;
+}; // struct SectionHeader
+
+} // namespace
+
+ElfObjectWriter::ElfObjectWriter(Machine machine): machine_(machine) {}
+
+int ElfObjectWriter::FindOrInsertSection(std::string_view name, SectionKind kind, uint64_t align) {
+    for (size_t i = 0; i < sections_.size(); i++) {
+        if (sections_[i].name == name) {
+            sections_[i].align = std::max(sections_[i].align, align);
+            return static_cast<int>(i);
+        }
+    }
+    sections_.push_back({std::string(name), kind, align, "", {}});
+    return static_cast<int>(sections_.size() - 1);
+}
+
+void ElfObjectWriter::Align(int section, uint64_t align) {
+    auto s = &sections_[section];
+    s->align = std::max(s->align, align);
+    PadTo(&s->data, align);
+}
+
+int ElfObjectWriter::FindOrInsertSymbol(std::string_view name) {
+    if (auto iter = symbol_index_.find(std::string(name)); iter != symbol_index_.end()) {
+        return iter->second;
+    }
+    symbols_.push_back({std::string(name), -1, 0, 0, true/*global*/, false});
+    auto index = static_cast<int>(symbols_.size() - 1);
+    symbol_index_[std::string(name)] = index;
+    return index;
+}
+
+void ElfObjectWriter::DefineSymbol(std::string_view name, int section, uint64_t offset, bool global, bool function,
+                                   uint64_t size) {
+    auto symbol = &symbols_[FindOrInsertSymbol(name)];
+    DCHECK(symbol->section < 0).Hint("Duplicated symbol: %s", symbol->name.c_str());
+    symbol->section = section;
+    symbol->offset = offset;
+    symbol->size = size;
+    symbol->global = global;
+    symbol->function = function;
+}
+
+const ElfObjectWriter::Symbol *ElfObjectWriter::FindSymbolOrNull(std::string_view name) const {
+    if (auto iter = symbol_index_.find(std::string(name)); iter != symbol_index_.end()) {
+        return &symbols_[iter->second];
+    }
+    return nullptr;
+}
+
+void ElfObjectWriter::AddRelocation(int section, uint64_t offset, std::string_view symbol, uint32_t type,
+                                    int64_t addend) {
+    FindOrInsertSymbol(symbol);
+    sections_[section].relocations.push_back({offset, std::string(symbol), type, addend});
+}
+
+void ElfObjectWriter::AppendAbsolute64(int section, std::string_view symbol, int64_t addend) {
+    AddRelocation(section, section_size(section), symbol, machine_ == kX64 ? kX64Abs64 : kArm64Abs64, addend);
+    Append<uint64_t>(section, 0);
+}
+
+base::Status ElfObjectWriter::WriteTo(base::WritableFile *file) const {
+    std::string buf;
+    WriteTo(&buf);
+    return file->Append(buf);
+}
+
+void ElfObjectWriter::WriteTo(std::string *buf) const {
+    // Symbol table: null symbol, local symbols then global symbols.
+    std::vector<int> order;
+    for (size_t i = 0; i < symbols_.size(); i++) {
+        order.push_back(static_cast<int>(i));
+    }
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        return !symbols_[a].global && symbols_[b].global;
+    });
+    std::vector<uint32_t> symbol_number(symbols_.size());
+    uint32_t first_global = 1;
+    for (size_t i = 0; i < order.size(); i++) {
+        symbol_number[order[i]] = static_cast<uint32_t>(i + 1);
+        if (!symbols_[order[i]].global) {
+            first_global = static_cast<uint32_t>(i + 2);
+        }
+    }
+
+    const auto n_sections = static_cast<uint32_t>(sections_.size());
+    uint32_t n_relas = 0;
+    for (const auto &section : sections_) {
+        n_relas += section.relocations.empty() ? 0 : 1;
+    }
+    // [0] null, [1...] sections, rela sections, .note.GNU-stack, .symtab, .strtab, .shstrtab
+    const uint32_t note_index = 1 + n_sections + n_relas;
+    const uint32_t symtab_index = note_index + 1;
+    const uint32_t strtab_index = symtab_index + 1;
+    const uint32_t shstrtab_index = strtab_index + 1;
+
+    StringTable shstrtab;
+    StringTable strtab;
+    std::vector<SectionHeader> headers;
+    headers.push_back({0, 0, 0, 0, 0, 0, 0, 0, 0});
+
+    buf->clear();
+    buf->resize(kElfHeaderSize, '\0');
+    for (const auto &section : sections_) {
+        uint32_t type = SHT_PROGBITS;
+        uint64_t flags = SHF_ALLOC;
+        switch (section.kind) {
+            case kText:
+                flags |= SHF_EXECINSTR;
+                break;
+            case kData:
+                flags |= SHF_WRITE;
+                break;
+            case kUnwind:
+                type = machine_ == kX64 ? SHT_X86_64_UNWIND : SHT_PROGBITS;
+                break;
+            case kReadOnly:
+            default:
+                break;
+        }
+        PadTo(buf, section.align);
+        headers.push_back({shstrtab.Add(section.name), type, flags, buf->size(), section.data.size(), 0, 0,
+                           section.align, 0});
+        buf->append(section.data);
+    }
+
+    for (uint32_t i = 0; i < n_sections; i++) {
+        const auto &section = sections_[i];
+        if (section.relocations.empty()) {
+            continue;
+        }
+        PadTo(buf, 8);
+        auto offset = buf->size();
+        for (const auto &rela : section.relocations) {
+            auto number = symbol_number[symbol_index_.find(rela.symbol)->second];
+            Put<uint64_t>(buf, rela.offset);
+            Put<uint64_t>(buf, (static_cast<uint64_t>(number) << 32) | rela.type);
+            Put<int64_t>(buf, rela.addend);
+        }
+        headers.push_back({shstrtab.Add(".rela" + section.name), SHT_RELA, SHF_INFO_LINK, offset,
+                           buf->size() - offset, symtab_index, i + 1, 8, kRelaSize});
+    }
+
+    // Mark the stack as non-executable.
+    headers.push_back({shstrtab.Add(".note.GNU-stack"), SHT_PROGBITS, 0, buf->size(), 0, 0, 0, 1, 0});
+
+    PadTo(buf, 8);
+    auto symtab_offset = buf->size();
+    buf->append(kSymbolSize, '\0');
+    for (auto i : order) {
+        const auto &symbol = symbols_[i];
+        uint8_t type = STT_NOTYPE;
+        if (symbol.section >= 0) {
+            type = symbol.function ? STT_FUNC : STT_OBJECT;
+        }
+        Put<uint32_t>(buf, strtab.Add(symbol.name));
+        Put<uint8_t>(buf, ((symbol.global ? STB_GLOBAL : STB_LOCAL) << 4) | type);
+        Put<uint8_t>(buf, 0);
+        Put<uint16_t>(buf, symbol.section < 0 ? 0 : static_cast<uint16_t>(symbol.section + 1));
+        Put<uint64_t>(buf, symbol.offset);
+        Put<uint64_t>(buf, symbol.size);
+    }
+    headers.push_back({shstrtab.Add(".symtab"), SHT_SYMTAB, 0, symtab_offset, buf->size() - symtab_offset,
+                       strtab_index, first_global, 8, kSymbolSize});
+
+    headers.push_back({shstrtab.Add(".strtab"), SHT_STRTAB, 0, buf->size(), strtab.buf().size(), 0, 0, 1, 0});
+    buf->append(strtab.buf());
+
+    auto shstrtab_name = shstrtab.Add(".shstrtab");
+    headers.push_back({shstrtab_name, SHT_STRTAB, 0, buf->size(), shstrtab.buf().size(), 0, 0, 1, 0});
+    buf->append(shstrtab.buf());
+    DCHECK(headers.size() == shstrtab_index + 1);
+
+    PadTo(buf, 8);
+    auto shoff = buf->size();
+    for (const auto &header : headers) {
+        Put<uint32_t>(buf, header.name);
+        Put<uint32_t>(buf, header.type);
+        Put<uint64_t>(buf, header.flags);
+        Put<uint64_t>(buf, 0); // sh_addr
+        Put<uint64_t>(buf, header.offset);
+        Put<uint64_t>(buf, header.size);
+        Put<uint32_t>(buf, header.link);
+        Put<uint32_t>(buf, header.info);
+        Put<uint64_t>(buf, header.align);
+        Put<uint64_t>(buf, header.entsize);
+    }
+
+    std::string ehdr;
+    ehdr.append("\x7f" "ELF", 4);
+    Put<uint8_t>(&ehdr, 2); // ELFCLASS64
+    Put<uint8_t>(&ehdr, 1); // ELFDATA2LSB
+    Put<uint8_t>(&ehdr, 1); // EV_CURRENT
+    ehdr.append(9, '\0');   // ELFOSABI_NONE and paddings
+    Put<uint16_t>(&ehdr, ET_REL);
+    Put<uint16_t>(&ehdr, machine_);
+    Put<uint32_t>(&ehdr, 1); // e_version
+    Put<uint64_t>(&ehdr, 0); // e_entry
+    Put<uint64_t>(&ehdr, 0); // e_phoff
+    Put<uint64_t>(&ehdr, shoff);
+    Put<uint32_t>(&ehdr, 0); // e_flags
+    Put<uint16_t>(&ehdr, kElfHeaderSize);
+    Put<uint16_t>(&ehdr, 0); // e_phentsize
+    Put<uint16_t>(&ehdr, 0); // e_phnum
+    Put<uint16_t>(&ehdr, kSectionHeaderSize);
+    Put<uint16_t>(&ehdr, static_cast<uint16_t>(headers.size()));
+    Put<uint16_t>(&ehdr, static_cast<uint16_t>(shstrtab_index));
+    DCHECK(ehdr.size() == kElfHeaderSize);
+    buf->replace(0, kElfHeaderSize, ehdr);
+}
+
+} // namespace yalx::backend
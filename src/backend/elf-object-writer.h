@@ -0,0 +1,125 @@
+#pragma once
+#ifndef YALX_BACKEND_ELF_OBJECT_WRITER_H_
+#define YALX_BACKEND_ELF_OBJECT_WRITER_H_
+
+#include "base/status.h"
+#include "base/base.h"
+#include <unordered_map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace yalx {
+namespace base {
+class WritableFile;
+} // namespace base
+namespace backend {
+
+// Writes relocatable ELF64 objects (ET_REL, little-endian) without an external assembler.
+//
+// Layout:
+//   ELF header
+//   contents of sections...
+//   .rela.* sections, .symtab, .strtab, .shstrtab
+//   section headers
+//
+// Symbols are referenced by name; a symbol referenced by a relocation but never defined is an undefined global
+// symbol, resolved by the linker.
+class ElfObjectWriter final {
+public:
+    enum Machine : uint16_t {
+        kX64 = 62,     // EM_X86_64
+        kArm64 = 183,  // EM_AARCH64
+    };
+
+    enum SectionKind {
+        kText,
+        kReadOnly,
+        kData,
+        kUnwind, // Call frame information: .eh_frame
+    };
+
+    // Relocation types
+    static constexpr uint32_t kX64Abs64 = 1;      // R_X86_64_64
+    static constexpr uint32_t kX64PC32 = 2;       // R_X86_64_PC32
+    static constexpr uint32_t kX64PLT32 = 4;      // R_X86_64_PLT32
+    static constexpr uint32_t kArm64Abs64 = 257;  // R_AARCH64_ABS64
+    static constexpr uint32_t kArm64Call26 = 283; // R_AARCH64_CALL26
+
+    struct Relocation {
+        uint64_t offset;
+        std::string symbol;
+        uint32_t type;
+        int64_t addend;
+    }; // struct Relocation
+
+    struct Section {
+        std::string name;
+        SectionKind kind;
+        uint64_t align;
+        std::string data;
+        std::vector<Relocation> relocations;
+    }; // struct Section
+
+    struct Symbol {
+        std::string name;
+        int section; // -1: undefined
+        uint64_t offset;
+        uint64_t size;
+        bool global;
+        bool function;
+    }; // struct Symbol
+
+    explicit ElfObjectWriter(Machine machine);
+
+    DEF_VAL_GETTER(Machine, machine);
+    DEF_VAL_GETTER(std::vector<Section>, sections);
+    DEF_VAL_GETTER(std::vector<Symbol>, symbols);
+
+    // Returns index of the section, an exists section with the same name is reused.
+    int FindOrInsertSection(std::string_view name, SectionKind kind, uint64_t align);
+
+    std::string *mutable_data(int section) { return &sections_[section].data; }
+    size_t section_size(int section) const { return sections_[section].data.size(); }
+
+    void Align(int section, uint64_t align);
+
+    void DefineSymbol(std::string_view name, int section, uint64_t offset, bool global, bool function = false,
+                      uint64_t size = 0);
+
+    // Define a symbol at the current end of the section.
+    void DefineSymbolHere(std::string_view name, int section, bool global) {
+        DefineSymbol(name, section, section_size(section), global);
+    }
+
+    const Symbol *FindSymbolOrNull(std::string_view name) const;
+
+    void AddRelocation(int section, uint64_t offset, std::string_view symbol, uint32_t type, int64_t addend);
+
+    // Append a 64-bits absolute address of `symbol + addend' into the data of section.
+    void AppendAbsolute64(int section, std::string_view symbol, int64_t addend = 0);
+
+    template<class T>
+    void Append(int section, T value) {
+        mutable_data(section)->append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    void AppendZero(int section, size_t n) { mutable_data(section)->append(n, '\0'); }
+
+    void WriteTo(std::string *buf) const;
+    base::Status WriteTo(base::WritableFile *file) const;
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(ElfObjectWriter);
+private:
+    int FindOrInsertSymbol(std::string_view name);
+
+    const Machine machine_;
+    std::vector<Section> sections_;
+    std::vector<Symbol> symbols_;
+    std::unordered_map<std::string, int> symbol_index_;
+}; // class ElfObjectWriter
+
+} // namespace backend
+} // namespace yalx
+
+#endif // YALX_BACKEND_ELF_OBJECT_WRITER_H_
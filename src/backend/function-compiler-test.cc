@@ -0,0 +1,174 @@
+#include "backend/function-compiler.h"
+#include "backend/x64/code-generate-x64.h"
+#include "backend/x64/lower-posix-x64.h"
+#include "backend/x64/block-layout-x64.h"
+#include "backend/x64/peephole-optimize-x64.h"
+#include "backend/arm64/code-generate-arm64.h"
+#include "backend/zero-slot-allocator.h"
+#include "backend/barrier-set.h"
+#include "backend/constants-pool.h"
+#include "backend/linkage-symbols.h"
+#include "backend/registers-configuration.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/base-test.h"
+#include "base/thread-pool.h"
+#include "base/io.h"
+#include <set>
+
+namespace yalx::backend {
+
+class FunctionCompilerTest : public ir::BaseTest {
+public:
+    using FunctionsMap = base::ArenaMap<std::string_view, InstructionFunction *>;
+
+    FunctionCompilerTest(): all_(&arena_) {}
+
+    void SetUp() override {
+        bool ok = true;
+        IRGen("tests/32-code-lower", &all_, &ok);
+        ASSERT_TRUE(ok);
+        module_ = all_["main:main"];
+        ASSERT_NE(nullptr, module_);
+        // Functions of the package initializing and classes are not supported by lowers yet.
+        for (auto fun : module_->funs()) {
+            auto name = fun->name()->ToSlice();
+            if (name.find("issue") == 0 && name != "issue14_new_obj_and_simple_load_barrier") {
+                ir_funs_.push_back(fun);
+            }
+        }
+    }
+
+    // Compile and emit functions one by one, with one linkage, constants pool and barrier set.
+    std::string SerialX64(ConstantsPool *const_pool) {
+        Linkage linkage(arena());
+        std::unique_ptr<BarrierSet> barrier_set(BarrierSet::OfYGCPosixX64());
+        auto regconf = RegistersConfiguration::OfPosixX64();
+        FunctionsMap funs(arena());
+        for (auto ir_fun : ir_funs_) {
+            X64PosixLower lower(arena(), regconf, &linkage, const_pool, barrier_set.get());
+            auto fun = lower.VisitFunction(ir_fun);
+            ZeroSlotAllocator{arena(), regconf, fun}.Run();
+            X64BlockLayout(arena()).Run(fun);
+            X64PeepholeOptimizer(arena(), regconf).Run(fun);
+            funs[ir_fun->full_name()->ToSlice()] = fun;
+        }
+
+        std::string buf;
+        base::PrintingWriter printer(base::NewMemoryWritableFile(&buf), true/*ownership*/);
+        X64CodeGenerator gen(funs, regconf, module_, const_pool, &linkage, &printer);
+        gen.EmitFunctions(Ordered(funs));
+        return buf;
+    }
+
+    std::string ParallelX64(int workers, ConstantsPool *const_pool) {
+        Linkage linkage(arena());
+        base::ThreadPool pool(workers);
+        std::unique_ptr<FunctionCompiler> compiler(FunctionCompiler::OfPosixX64(const_pool, &linkage, 1, &pool));
+        FunctionsMap funs(arena());
+        compiler->Run(ir_funs_, &funs);
+
+        std::string buf;
+        base::PrintingWriter printer(base::NewMemoryWritableFile(&buf), true/*ownership*/);
+        X64CodeGenerator gen(funs, compiler->regconf(), module_, const_pool, &linkage, &printer);
+        gen.set_thread_pool(&pool);
+        gen.EmitFunctions(Ordered(funs));
+        return buf;
+    }
+
+    std::string ParallelArm64(int workers) {
+        ConstantsPool const_pool(arena());
+        Linkage linkage(arena());
+        base::ThreadPool pool(workers);
+        std::unique_ptr<FunctionCompiler> compiler(FunctionCompiler::OfPosixArm64(&const_pool, &linkage, 1, &pool));
+        FunctionsMap funs(arena());
+        compiler->Run(ir_funs_, &funs);
+
+        std::string buf;
+        base::PrintingWriter printer(base::NewMemoryWritableFile(&buf), true/*ownership*/);
+        Arm64CodeGenerator gen(funs, compiler->regconf(), module_, &const_pool, &linkage, &printer);
+        gen.set_thread_pool(&pool);
+        gen.EmitFunctions(Ordered(funs));
+        return buf;
+    }
+
+    static void EmitFunctions(X64CodeGenerator *gen, const std::vector<InstructionFunction *> &funs) {
+        gen->EmitFunctions(funs);
+    }
+
+    std::vector<InstructionFunction *> Ordered(const FunctionsMap &funs) const {
+        std::vector<InstructionFunction *> ordered;
+        for (auto fun : ir_funs_) {
+            ordered.push_back(funs.find(fun->full_name()->ToSlice())->second);
+        }
+        return ordered;
+    }
+
+protected:
+    ir::Module *module_ = nullptr;
+    std::vector<ir::Function *> ir_funs_;
+    base::ArenaMap<std::string_view, ir::Module *> all_;
+}; // class FunctionCompilerTest
+
+TEST_F(FunctionCompilerTest, SameAsSerial) {
+    ASSERT_LT(10, ir_funs_.size());
+    ConstantsPool serial_pool(arena());
+    auto serial = SerialX64(&serial_pool);
+    EXPECT_NE(std::string::npos, serial.find("main_Zomain_Zdissue01_returning_one:"));
+
+    for (int workers : {0, 1, 4}) {
+        ConstantsPool pool(arena());
+        EXPECT_EQ(serial, ParallelX64(workers, &pool)) << workers;
+        EXPECT_EQ(serial_pool.string_pool().size(), pool.string_pool().size());
+        for (size_t i = 0; i < pool.string_pool().size(); i++) {
+            EXPECT_EQ(serial_pool.string_pool()[i]->ToSlice(), pool.string_pool()[i]->ToSlice());
+        }
+        EXPECT_EQ(serial_pool.numbers().size(), pool.numbers().size());
+    }
+}
+
+TEST_F(FunctionCompilerTest, Deterministic) {
+    auto expected = ParallelArm64(0);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(expected, ParallelArm64(3));
+    }
+}
+
+TEST_F(FunctionCompilerTest, UniqueLabels) {
+    ConstantsPool const_pool(arena());
+    Linkage linkage(arena());
+    base::ThreadPool pool(2);
+    std::unique_ptr<FunctionCompiler> compiler(FunctionCompiler::OfPosixX64(&const_pool, &linkage, 1, &pool));
+    // Numbering goes on in next running
+    std::vector<ir::Function *> ir_funs{module_->FindFunOrNull("issue13_simple_load_barrier")};
+    FunctionsMap funs1(arena()), funs2(arena());
+    compiler->Run(ir_funs, &funs1);
+    compiler->Run(ir_funs, &funs2);
+    auto fun1 = funs1.begin()->second;
+    auto fun2 = funs2.begin()->second;
+    ASSERT_NE(fun1, fun2);
+    EXPECT_EQ(fun1->blocks_size() + fun1->blocks()[0]->label(), fun2->blocks()[0]->label());
+    EXPECT_EQ(linkage.next_block_label(), fun2->blocks_size() * 2);
+
+    std::string buf;
+    base::PrintingWriter printer(base::NewMemoryWritableFile(&buf), true/*ownership*/);
+    X64CodeGenerator gen(funs1, compiler->regconf(), module_, &const_pool, &linkage, &printer);
+    gen.set_thread_pool(&pool);
+    EmitFunctions(&gen, {fun1, fun2});
+    EXPECT_NE(std::string::npos, buf.find("jz Jpt_0\n"));
+    EXPECT_NE(std::string::npos, buf.find("\nJpt_0:"));
+    EXPECT_NE(std::string::npos, buf.find("jz Jpt_1\n"));
+    EXPECT_NE(std::string::npos, buf.find("\nJpt_1:"));
+}
+
+TEST_F(FunctionCompilerTest, FunctionsOfModule) {
+    auto ir_funs = FunctionCompiler::FunctionsOf(module_);
+    EXPECT_LE(ir_funs_.size(), ir_funs.size());
+    std::set<ir::Function *> unique_funs(ir_funs.begin(), ir_funs.end());
+    EXPECT_EQ(unique_funs.size(), ir_funs.size());
+    for (auto fun : ir_funs_) {
+        EXPECT_TRUE(unique_funs.count(fun));
+    }
+}
+
+} // namespace yalx::backend
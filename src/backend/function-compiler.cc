@@ -0,0 +1,225 @@
+#include "backend/function-compiler.h"
+#include "backend/x64/lower-posix-x64.h"
+#include "backend/x64/block-layout-x64.h"
+#include "backend/x64/peephole-optimize-x64.h"
+#include "backend/arm64/lower-posix-arm64.h"
+#include "backend/arm64/block-layout-arm64.h"
+#include "backend/arm64/peephole-optimize-arm64.h"
+#include "backend/zero-slot-allocator.h"
+#include "backend/registers-configuration.h"
+#include "backend/barrier-set.h"
+#include "backend/constants-pool.h"
+#include "backend/linkage-symbols.h"
+#include "backend/instruction.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "base/thread-pool.h"
+#include "base/format.h"
+#include "base/arena.h"
+#include <algorithm>
+#include <set>
+
+namespace yalx::backend {
+
+namespace {
+
+class X64PosixFunctionCompiler final : public FunctionCompiler {
+public:
+    X64PosixFunctionCompiler(ConstantsPool *const_pool, Linkage *linkage, int optimizing_level,
+                             base::ThreadPool *pool)
+    : FunctionCompiler(RegistersConfiguration::OfPosixX64(), const_pool, linkage, optimizing_level, pool) {}
+
+    InstructionFunction *Select(base::Arena *arena, Linkage *linkage, ConstantsPool *const_pool,
+                                ir::Function *fun) override {
+        std::unique_ptr<BarrierSet> barrier_set(BarrierSet::OfYGCPosixX64());
+        X64PosixLower lower(arena, regconf(), linkage, const_pool, barrier_set.get());
+        return lower.VisitFunction(fun);
+    }
+
+    void Optimize(base::Arena *arena, InstructionFunction *fun) override {
+        X64BlockLayout(arena).Run(fun);
+        X64PeepholeOptimizer(arena, regconf()).Run(fun);
+    }
+}; // class X64PosixFunctionCompiler
+
+class Arm64PosixFunctionCompiler final : public FunctionCompiler {
+public:
+    Arm64PosixFunctionCompiler(ConstantsPool *const_pool, Linkage *linkage, int optimizing_level,
+                               base::ThreadPool *pool)
+    : FunctionCompiler(RegistersConfiguration::OfPosixArm64(), const_pool, linkage, optimizing_level, pool) {}
+
+    InstructionFunction *Select(base::Arena *arena, Linkage *linkage, ConstantsPool *const_pool,
+                                ir::Function *fun) override {
+        std::unique_ptr<BarrierSet> barrier_set(BarrierSet::OfYGCPosixArm64());
+        Arm64PosixLower lower(arena, regconf(), linkage, const_pool, barrier_set.get());
+        return lower.VisitFunction(fun);
+    }
+
+    void Optimize(base::Arena *arena, InstructionFunction *fun) override {
+        Arm64BlockLayout(arena).Run(fun);
+        Arm64PeepholeOptimizer(arena, regconf()).Run(fun);
+    }
+}; // class Arm64PosixFunctionCompiler
+
+// Labels of jumping positions, see `BarrierSet::PostLoad()'
+constexpr const char kJumpingPositionPrefix[] = "Jpt_";
+
+bool IsCompilable(const ir::Function *fun) {
+    return fun->decoration() == ir::Function::kDefault || fun->decoration() == ir::Function::kOverride;
+}
+
+} // namespace
+
+struct FunctionCompiler::Unit {
+    ir::Function *fun;
+    InstructionFunction *instr_fun = nullptr;
+    // Numbering of labels and constants in the function
+    Linkage *linkage = nullptr;
+    ConstantsPool *const_pool = nullptr;
+}; // struct FunctionCompiler::Unit
+
+FunctionCompiler::FunctionCompiler(const RegistersConfiguration *regconf, ConstantsPool *const_pool, Linkage *linkage,
+                                   int optimizing_level, base::ThreadPool *pool)
+: regconf_(regconf)
+, const_pool_(const_pool)
+, linkage_(linkage)
+, optimizing_level_(optimizing_level)
+, pool_(pool) {
+    for (int i = 0; i < (pool ? pool->slots() : 1); i++) {
+        arenas_.push_back(std::make_unique<base::Arena>());
+    }
+}
+
+FunctionCompiler::~FunctionCompiler() = default;
+
+FunctionCompiler *FunctionCompiler::OfPosixX64(ConstantsPool *const_pool, Linkage *linkage, int optimizing_level,
+                                               base::ThreadPool *pool) {
+    return new X64PosixFunctionCompiler(const_pool, linkage, optimizing_level, pool);
+}
+
+FunctionCompiler *FunctionCompiler::OfPosixArm64(ConstantsPool *const_pool, Linkage *linkage, int optimizing_level,
+                                                 base::ThreadPool *pool) {
+    return new Arm64PosixFunctionCompiler(const_pool, linkage, optimizing_level, pool);
+}
+
+std::vector<ir::Function *> FunctionCompiler::FunctionsOf(ir::Module *module) {
+    std::vector<ir::Function *> ir_funs;
+    std::set<ir::Function *> unique_funs;
+    auto add = [&ir_funs, &unique_funs](ir::Function *fun) {
+        if (IsCompilable(fun) && unique_funs.insert(fun).second) {
+            ir_funs.push_back(fun);
+        }
+    };
+    for (auto fun : module->funs()) {
+        add(fun);
+    }
+    for (auto clazz : module->structures()) {
+        for (auto method : clazz->methods()) {
+            add(method.fun);
+        }
+    }
+    return ir_funs;
+}
+
+void FunctionCompiler::Run(const std::vector<ir::Function *> &ir_funs,
+                           base::ArenaMap<std::string_view, InstructionFunction *> *funs) {
+    std::vector<Unit> units;
+    for (auto fun : ir_funs) {
+        units.push_back({fun});
+    }
+
+    for (auto &unit : units) {
+        if (pool_) {
+            pool_->Post([this, &unit](int worker) { Compile(&unit, worker); });
+        } else {
+            Compile(&unit, 0);
+        }
+    }
+    if (pool_) {
+        pool_->Wait();
+    }
+
+    for (auto &unit : units) {
+        Relocate(&unit);
+        (*funs)[unit.fun->full_name()->ToSlice()] = unit.instr_fun;
+    }
+}
+
+void FunctionCompiler::Compile(Unit *unit, int worker) {
+    auto arena = arenas_[worker].get();
+    unit->linkage = arena->New<Linkage>(arena);
+    unit->const_pool = arena->New<ConstantsPool>(arena);
+
+    auto fun = Select(arena, unit->linkage, unit->const_pool, unit->fun);
+    ZeroSlotAllocator{arena, regconf_, fun}.Run();
+    if (optimizing_level_ > 0) {
+        Optimize(arena, fun);
+    }
+    unit->instr_fun = fun;
+}
+
+void FunctionCompiler::Relocate(Unit *unit) {
+    std::vector<int> strings, numbers;
+    const_pool_->Merge(*unit->const_pool, &strings, &numbers);
+    const auto label_base = linkage_->ReserveBlockLabels(unit->linkage->next_block_label());
+
+    std::vector<InstructionFunction *> parts{unit->instr_fun};
+    if (unit->instr_fun->native_handle()) {
+        parts.push_back(unit->instr_fun->native_handle());
+    }
+    int jumping_positions = 0;
+    for (auto fun : parts) {
+        for (auto block : fun->blocks()) {
+            for (auto instr : block->instructions()) {
+                if (auto id = block->JumpingPosition(instr)) {
+                    jumping_positions = std::max(jumping_positions, id.value() + 1);
+                }
+            }
+        }
+    }
+    const auto jumping_base = next_jumping_position_;
+    next_jumping_position_ += jumping_positions;
+
+    auto relocate = [&](InstructionOperand *operand) {
+        if (operand->IsConstant()) {
+            auto constant = operand->AsConstant();
+            auto id = constant->type() == ConstantOperand::kString ? strings[constant->symbol_id()]
+                                                                   : numbers[constant->symbol_id()];
+            *operand = ConstantOperand{constant->type(), id};
+        } else if (operand->IsReloaction() && operand->AsReloaction()->is_symbol() && jumping_base > 0) {
+            auto reloc = operand->AsReloaction();
+            auto name = reloc->symbol_name()->ToSlice();
+            if (name.find(kJumpingPositionPrefix) != 0) {
+                return;
+            }
+            int64_t id = 0;
+            auto prefix_len = sizeof(kJumpingPositionPrefix) - 1;
+            base::ParseI64(name.data() + prefix_len, name.size() - prefix_len, &id);
+            auto buf = base::Sprintf("%s%d", kJumpingPositionPrefix, static_cast<int>(id) + jumping_base);
+            *operand = ReloactionOperand{String::New(arenas_[0].get(), buf.data(), buf.size()), reloc->offset(),
+                                         reloc->should_fetch_address()};
+        }
+    };
+
+    for (auto fun : parts) {
+        for (auto block : fun->blocks()) {
+            block->set_label(label_base + block->label());
+            block->RebaseJumpingPositions(jumping_base);
+            for (auto instr : block->instructions()) {
+                for (size_t i = 0; i < instr->operands_size(); i++) {
+                    relocate(instr->OperandAt(i));
+                }
+                for (auto pos : {Instruction::kStart, Instruction::kEnd}) {
+                    if (auto moves = instr->mutable_parallel_move(pos)) {
+                        for (auto move : moves->moves()) {
+                            relocate(move->mutable_src());
+                            relocate(move->mutable_dest());
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace yalx::backend
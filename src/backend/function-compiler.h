@@ -0,0 +1,85 @@
+#pragma once
+#ifndef YALX_BACKEND_FUNCTION_COMPILER_H_
+#define YALX_BACKEND_FUNCTION_COMPILER_H_
+
+#include "base/arena-utils.h"
+#include "base/base.h"
+#include <memory>
+#include <vector>
+
+namespace yalx {
+namespace base {
+class ThreadPool;
+} // namespace base
+namespace ir {
+class Module;
+class Function;
+} // namespace ir
+namespace backend {
+
+class RegistersConfiguration;
+class ConstantsPool;
+class Linkage;
+class InstructionFunction;
+
+// Compiles functions of a module through the backend pipeline: instruction selection, slot allocation, then block
+// layout and peephole optimizing if optimizing. Each function is compiled by a task of the thread pool, with the
+// arena of its worker, and its own labels, constants and symbols, so no state is shared between tasks.
+// After all tasks done, block labels, jumping positions and constants of functions are moved into numbering of the
+// module one by one in order of `GnuAsmGenerator::EmitAll', so the result does not depend on the number of workers,
+// and it is the same as compiling the functions in that order by one thread.
+// Instruction functions are allocated in arenas of the compiler, it must be alive until they are emitted.
+class FunctionCompiler {
+public:
+    virtual ~FunctionCompiler();
+
+    // Run tasks in the calling thread if `pool' is null.
+    static FunctionCompiler *OfPosixX64(ConstantsPool *const_pool, Linkage *linkage, int optimizing_level,
+                                        base::ThreadPool *pool);
+    static FunctionCompiler *OfPosixArm64(ConstantsPool *const_pool, Linkage *linkage, int optimizing_level,
+                                          base::ThreadPool *pool);
+
+    DEF_PTR_GETTER(const RegistersConfiguration, regconf);
+
+    // Compile all functions and methods of `module', put them into `funs' by full name of IR functions.
+    void Run(ir::Module *module, base::ArenaMap<std::string_view, InstructionFunction *> *funs) {
+        Run(FunctionsOf(module), funs);
+    }
+    // Compile `ir_funs' in order of them.
+    void Run(const std::vector<ir::Function *> &ir_funs,
+             base::ArenaMap<std::string_view, InstructionFunction *> *funs);
+
+    // Compilable functions and methods of `module' in order of emitting.
+    static std::vector<ir::Function *> FunctionsOf(ir::Module *module);
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(FunctionCompiler);
+protected:
+    FunctionCompiler(const RegistersConfiguration *regconf, ConstantsPool *const_pool, Linkage *linkage,
+                     int optimizing_level, base::ThreadPool *pool);
+
+    // Instruction selection by target lower
+    virtual InstructionFunction *Select(base::Arena *arena, Linkage *linkage, ConstantsPool *const_pool,
+                                        ir::Function *fun) = 0;
+    // Target block layout and peephole optimizer
+    virtual void Optimize(base::Arena *arena, InstructionFunction *fun) = 0;
+
+private:
+    struct Unit;
+
+    void Compile(Unit *unit, int worker);
+    void Relocate(Unit *unit);
+
+    const RegistersConfiguration *const regconf_;
+    ConstantsPool *const const_pool_;
+    Linkage *const linkage_;
+    const int optimizing_level_;
+    base::ThreadPool *const pool_;
+    // Indexed by worker
+    std::vector<std::unique_ptr<base::Arena>> arenas_;
+    int next_jumping_position_ = 0;
+}; // class FunctionCompiler
+
+} // namespace backend
+} // namespace yalx
+
+#endif // YALX_BACKEND_FUNCTION_COMPILER_H_
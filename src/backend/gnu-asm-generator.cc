@@ -2,10 +2,12 @@
 #include "backend/linkage-symbols.h"
 #include "backend/constants-pool.h"
 #include "backend/instruction.h"
+#include "backend/frame.h"
 #include "ir/metadata.h"
 #include "ir/node.h"
 #include "ir/type.h"
 #include "ir/operator.h"
+#include "base/thread-pool.h"
 #include "base/io.h"
 #include "runtime/object/type.h"
 #include <inttypes.h>
@@ -40,10 +42,11 @@ void GnuAsmGenerator::EmitAll() {
     EmitSourceFilesInfo();
 
     printer_->Println(".p2align %s", text_p2align_)->Write("\n")->Println("%s functions", comment_);
+    std::vector<InstructionFunction *> funs;
     for (auto fun : module_->funs()) {
         auto iter = funs_.find(fun->full_name()->ToSlice());
         assert(iter != funs_.end());
-        EmitFunction(iter->second);
+        funs.push_back(iter->second);
     }
     
     for (auto clazz : module_->structures()) {
@@ -55,7 +58,7 @@ void GnuAsmGenerator::EmitAll() {
             if (iter == funs_.end()) {
                 continue;
             }
-            EmitFunction(iter->second);
+            funs.push_back(iter->second);
         }
         for (auto field : clazz->fields()) {
             const_pool_->FindOrInsertString(field.name);
@@ -63,6 +66,13 @@ void GnuAsmGenerator::EmitAll() {
         const_pool_->FindOrInsertString(clazz->name());
         const_pool_->FindOrInsertString(clazz->full_name());
     }
+    EmitFunctions(funs);
+    
+    // For names of profile records
+    auto profiled = ProfiledFunctionsOf(funs_, module_);
+    for (auto fun : profiled) {
+        const_pool_->FindOrInsertString(fun->frame()->fun()->full_name());
+    }
     
     // string constants:
     if (!const_pool_->string_pool().empty()) {
@@ -128,6 +138,50 @@ void GnuAsmGenerator::EmitAll() {
         printer_->Println("%s string constants:", comment_);
         EmitStringConstants();
     }
+    
+    printer_->Println("%s package init record:", comment_);
+    EmitPackageInitRecord();
+    
+    if (!profiled.empty()) {
+        printer_->Println("%s profile records:", comment_);
+        EmitProfileRecords(profiled);
+    }
+}
+
+// Each function is emitted into its own buffer by the pool, then buffers are written in order of functions, so the
+// output is the same as emitting them one by one.
+void GnuAsmGenerator::EmitFunctions(const std::vector<InstructionFunction *> &funs) {
+    if (!thread_pool_) {
+        for (auto fun : funs) {
+            EmitFunction(fun);
+        }
+        return;
+    }
+
+    std::vector<std::string> bufs(funs.size());
+    for (size_t i = 0; i < funs.size(); i++) {
+        thread_pool_->Post([this, &funs, &bufs, i] (int) {
+            base::PrintingWriter printer(base::NewMemoryWritableFile(&bufs[i]), true/*ownership*/);
+            EmitFunction(funs[i], &printer);
+        });
+    }
+    thread_pool_->Wait();
+    for (const auto &buf : bufs) {
+        printer_->Write(buf);
+    }
+}
+
+std::vector<InstructionFunction *>
+GnuAsmGenerator::ProfiledFunctionsOf(const base::ArenaMap<std::string_view, InstructionFunction *> &funs,
+                                     const ir::Module *module) {
+    std::vector<InstructionFunction *> profiled;
+    for (auto [name, fun] : funs) {
+        auto ir_fun = fun->frame()->fun();
+        if (ir_fun->owns() == module && ir_fun->profile_counters() > 0) {
+            profiled.push_back(fun);
+        }
+    }
+    return profiled;
 }
 
 int GnuAsmGenerator::EmitGlobalSlots(std::vector<int> *refs_offset) {
@@ -188,8 +242,8 @@ void GnuAsmGenerator::MarkRefsInClass(const ir::StructureModel *clazz, const int
     }
 }
 
-static int DeclarationToKind(ir::Model::Declaration decl) {
-    switch (decl) {
+int GnuAsmGenerator::DeclarationToKind(const ir::Model *clazz) {
+    switch (clazz->declaration()) {
         case ir::Model::kStruct:
             return K_STRUCT;
         case ir::Model::kClass:
@@ -203,10 +257,11 @@ static int DeclarationToKind(ir::Model::Declaration decl) {
     return -1;
 }
 
-static int CompactFieldCode(const ir::Model::Field &field, ir::Model::Declaration decl) {
+int GnuAsmGenerator::CompactFieldCode(const ir::StructureModel *clazz, size_t field_index) {
 //            uint32_t access: 2; // yalx_access_desc
 //            uint32_t constraint: 2; // val? var?
 //            uint32_t enum_code: 16;
+    const auto &field = clazz->fields()[field_index];
     int code = 0;
     switch (field.access) {
         case ir::kPublic:
@@ -224,7 +279,7 @@ static int CompactFieldCode(const ir::Model::Field &field, ir::Model::Declaratio
     }
     // TODO: constraint
     
-    if (decl == ir::Model::kEnum) {
+    if (clazz->declaration() == ir::Model::kEnum) {
         code |= (field.enum_value << 4);
     }
     
@@ -262,7 +317,7 @@ void GnuAsmGenerator::EmitMetadata() {
         printer_->Println(".global %s", buf.c_str());
         printer_->Println("%s:", buf.c_str());
         printer_->Indent(1)->Println(".quad %d %s id", 0/*TODO:class_id*/, comment_);
-        printer_->Indent(1)->Println(".byte %d %s constraint", DeclarationToKind(clazz->declaration()), comment_);
+        printer_->Indent(1)->Println(".byte %d %s constraint", DeclarationToKind(clazz), comment_);
         printer_->Indent(1)->Println(".byte %d %s compact enum", static_cast<int>(clazz->IsCompactEnum()), comment_);
         printer_->Indent(1)->Println(".space 2 %s padding", comment_);
         printer_->Indent(1)->Println(".long %d %s reference_size", clazz->ReferenceSizeInBytes(), comment_);
@@ -329,7 +384,8 @@ void GnuAsmGenerator::EmitMetadata() {
             symbol.append("$fields");
             printer_->Println("%s:", symbol.c_str());
         }
-        for (auto field : clazz->fields()) {
+        for (size_t i = 0; i < clazz->fields_size(); i++) {
+            const auto &field = clazz->fields()[i];
 //            uint32_t access: 2; // yalx_access_desc
 //            uint32_t constraint: 2; // val? var?
 //            uint32_t enum_code: 16;
@@ -339,7 +395,7 @@ void GnuAsmGenerator::EmitMetadata() {
 //            struct yalx_class *type;
 //            uint32_t offset_of_head;
             printer_->Indent(1)->Println("%s %s::%s", comment_, clazz->name()->data(), field.name->data());
-            printer_->Indent(1)->Println(".long %d %s access|constraint", CompactFieldCode(field, clazz->declaration()),
+            printer_->Indent(1)->Println(".long %d %s access|constraint", CompactFieldCode(clazz, i),
                                          comment_);
             printer_->Indent(1)->Println(".long 0 %s n_annotations", comment_);
             printer_->Indent(1)->Println(".quad 0 %s reserved0", comment_);
@@ -429,75 +485,85 @@ void GnuAsmGenerator::EmitMetadata() {
 }
 
 void GnuAsmGenerator::EmitTypeRelocation(const ir::Type &ty, base::PrintingWriter *printer) {
+    std::string symbol;
+    int offset = 0;
+    if (!ClassSymbolOf(ty, &symbol, &offset)) {
+        printer->Write("0");
+    } else if (symbol == kBuiltinClassesSymbol) {
+        printer->Print("%s+%d", kBuiltinClassesSymbol, offset);
+    } else {
+        printer->Write(symbol);
+    }
+    printer->Println(" %s type", comment_);
+}
+
+bool GnuAsmGenerator::ClassSymbolOf(const ir::Type &ty, std::string *symbol, int *offset) {
+    *offset = 0;
     switch (ty.kind()) {
         case ir::Type::kVoid:
-            printer->Write("0");
-            break;
+            return false;
         case ir::Type::kWord8:
         case ir::Type::kUInt8:
-            printer->Print("_builtin_classes+%d", Type_u8 * sizeof(yalx_class));
+            *offset = Type_u8 * sizeof(yalx_class);
             break;
         case ir::Type::kWord16:
         case ir::Type::kUInt16:
-            printer->Print("_builtin_classes+%d", Type_u16 * sizeof(yalx_class));
+            *offset = Type_u16 * sizeof(yalx_class);
             break;
         case ir::Type::kWord32:
         case ir::Type::kUInt32:
-            printer->Print("_builtin_classes+%d", Type_u32 * sizeof(yalx_class));
+            *offset = Type_u32 * sizeof(yalx_class);
             break;
         case ir::Type::kWord64:
         case ir::Type::kUInt64:
-            printer->Print("_builtin_classes+%d", Type_u32 * sizeof(yalx_class));
+            *offset = Type_u32 * sizeof(yalx_class);
             break;
         case ir::Type::kInt8:
-            printer->Print("_builtin_classes+%d", Type_i8 * sizeof(yalx_class));
+            *offset = Type_i8 * sizeof(yalx_class);
             break;
         case ir::Type::kInt16:
-            printer->Print("_builtin_classes+%d", Type_i16 * sizeof(yalx_class));
+            *offset = Type_i16 * sizeof(yalx_class);
             break;
         case ir::Type::kInt32:
-            printer->Print("_builtin_classes+%d", Type_i32 * sizeof(yalx_class));
+            *offset = Type_i32 * sizeof(yalx_class);
             break;
         case ir::Type::kInt64:
-            printer->Print("_builtin_classes+%d", Type_i64 * sizeof(yalx_class));
+            *offset = Type_i64 * sizeof(yalx_class);
             break;
         case ir::Type::kFloat32:
-            printer->Print("_builtin_classes+%d", Type_f32 * sizeof(yalx_class));
+            *offset = Type_f32 * sizeof(yalx_class);
             break;
         case ir::Type::kFloat64:
-            printer->Print("_builtin_classes+%d", Type_f64 * sizeof(yalx_class));
+            *offset = Type_f64 * sizeof(yalx_class);
             break;
         case ir::Type::kString:
-            printer->Write("_yalx_Zplang_Zolang_ZdString$class");
-            break;
-        case ir::Type::kValue: {
-            std::string symbol;
-            Linkage::Build(&symbol, ty.model()->full_name()->ToSlice());
-            symbol.append("$class");
-            printer->Write(symbol);
-        } break;
+            symbol->assign("_yalx_Zplang_Zolang_ZdString$class");
+            return true;
+        case ir::Type::kValue:
+            Linkage::Build(symbol, ty.model()->full_name()->ToSlice());
+            symbol->append("$class");
+            return true;
         case ir::Type::kReference: {
             if (ty.model()->declaration() == ir::Model::kArray) {
                 auto model = down_cast<ir::ArrayModel>(ty.model());
                 if (model->dimension_count() > 1) {
-                    printer->Print("_builtin_classes+%d", Type_multi_dims_array * sizeof(yalx_class));
+                    *offset = Type_multi_dims_array * sizeof(yalx_class);
                 } else {
-                    printer->Print("_builtin_classes+%d", Type_array * sizeof(yalx_class));
+                    *offset = Type_array * sizeof(yalx_class);
                 }
+                break;
             } else if (ty.model()->declaration() == ir::Model::kChannel) {
                 UNREACHABLE();
-            } else {
-                std::string symbol;
-                Linkage::Build(&symbol, ty.model()->full_name()->ToSlice());
-                symbol.append("$class");
-                printer->Write(symbol);
             }
-        } break;
+            Linkage::Build(symbol, ty.model()->full_name()->ToSlice());
+            symbol->append("$class");
+        } return true;
         default:
             UNREACHABLE();
             break;
     }
-    printer->Println(" %s type", comment_);
+    symbol->assign(kBuiltinClassesSymbol);
+    return true;
 }
 
 void GnuAsmGenerator::EmitSourceFilesInfo() {
@@ -576,4 +642,87 @@ void GnuAsmGenerator::EmitStringConstants() {
     }
 }
 
+void GnuAsmGenerator::EmitPackageInitRecord() {
+//    struct pkg_init_record {
+//        _Atomic int state;
+//        int reserved0;
+//        _Atomic uintptr_t owner;
+//        const char *name;
+//        const struct lksz_header *lksz;
+//        struct kstr_header *kstr;
+//        struct pkg_global_slots *global_slots;
+//        struct pkg_init_record *next;
+//    };
+    auto symbol = symbols_->Mangle(module_->full_name());
+    const bool has_kstr = !const_pool_->string_pool().empty();
+    printer_->Println(".section %s", kDataSegmentName);
+    printer_->Writeln(".p2align 3");
+    printer_->Println(".global %s$pkg", symbol->data());
+    printer_->Println("%s$pkg:", symbol->data());
+    printer_->Indent(1)->Println(".long 0 %s state", comment_);
+    printer_->Indent(1)->Println(".long 0 %s reserved0", comment_);
+    printer_->Indent(1)->Println(".quad 0 %s owner", comment_);
+    printer_->Indent(1)->Println(".quad Lpkg.name %s name", comment_);
+    if (has_kstr) {
+        printer_->Indent(1)->Println(".quad %s_Lksz %s lksz", symbol->data(), comment_);
+        printer_->Indent(1)->Println(".quad %s_Kstr %s kstr", symbol->data(), comment_);
+    } else {
+        printer_->Indent(1)->Println(".quad 0 %s lksz", comment_);
+        printer_->Indent(1)->Println(".quad 0 %s kstr", comment_);
+    }
+    printer_->Indent(1)->Println(".quad %s$global_slots %s global_slots", symbol->data(), comment_);
+    printer_->Indent(1)->Println(".quad 0 %s next", comment_);
+    
+    // Registration for runtime: no symbol lookup needed
+    printer_->Println(".section %s", kPkgsSegmentName);
+    printer_->Writeln(".p2align 3");
+    printer_->Indent(1)->Println(".quad %s$pkg", symbol->data());
+
+    // Name is only a C string, not in the string pool: no Yalx-String built for it at initializing
+    printer_->Println(".section %s", kCStringSegmentName);
+    printer_->Println("Lpkg.name:");
+    printer_->Indent(1)->Write(".asciz \"")->EscapingWrite(module_->full_name()->ToSlice())->Writeln("\"");
+}
+
+void GnuAsmGenerator::EmitProfileRecords(const std::vector<InstructionFunction *> &profiled) {
+//    struct yalx_profile_record {
+//        const char *name;
+//        size_t n_counters;
+//        uint64_t *counters;
+//        size_t n_sites;
+//        struct yalx_profile_site *sites;
+//    };
+    printer_->Println(".section %s", kDataSegmentName);
+    printer_->Writeln(".p2align 3");
+    for (auto fun : profiled) {
+        auto ir_fun = fun->frame()->fun();
+        auto symbol = fun->symbol()->data();
+        auto counters = symbols_->MangleProfileCounters(fun->symbol());
+        printer_->Println("%s:", counters->data());
+        printer_->Indent(1)->Println(".space %d", ir_fun->profile_counters() * 8);
+        if (ir_fun->profile_sites() > 0) {
+            printer_->Println("%s$sites:", symbol);
+            printer_->Indent(1)->Println(".space %d", ir_fun->profile_sites() * kProfileSiteSizeInBytes);
+        }
+        printer_->Println("%s$prof:", symbol);
+        auto kid = const_pool_->FindOrInsertString(ir_fun->full_name());
+        printer_->Indent(1)->Println(".quad Lkzs.%zd %s name", kid, comment_);
+        printer_->Indent(1)->Println(".quad %d %s n_counters", ir_fun->profile_counters(), comment_);
+        printer_->Indent(1)->Println(".quad %s %s counters", counters->data(), comment_);
+        printer_->Indent(1)->Println(".quad %d %s n_sites", ir_fun->profile_sites(), comment_);
+        if (ir_fun->profile_sites() > 0) {
+            printer_->Indent(1)->Println(".quad %s$sites %s sites", symbol, comment_);
+        } else {
+            printer_->Indent(1)->Println(".quad 0 %s sites", comment_);
+        }
+    }
+    
+    // Registration for runtime: written into the profile file at exit
+    printer_->Println(".section %s", kProfSegmentName);
+    printer_->Writeln(".p2align 3");
+    for (auto fun : profiled) {
+        printer_->Indent(1)->Println(".quad %s$prof", fun->symbol()->data());
+    }
+}
+
 } // namespace yalx
@@ -7,6 +7,7 @@
 namespace yalx {
 namespace base {
 class PrintingWriter;
+class ThreadPool;
 } // namespace base
 namespace ir {
 class StructureModel;
@@ -28,6 +29,15 @@ public:
     static constexpr const char kCStringSegmentName[] = "__TEXT,__cstring,cstring_literals";
     static constexpr const char kConstSegmentName[] = "__TEXT,__const";
     static constexpr const char kDataSegmentName[] = "__DATA,__data";
+#ifdef YALX_OS_DARWIN
+    static constexpr const char kPkgsSegmentName[] = "__DATA,__yalx_pkgs";
+    static constexpr const char kProfSegmentName[] = "__DATA,__yalx_prof";
+    static constexpr const char kColdTextSegmentName[] = "__TEXT,__text_cold,regular,pure_instructions";
+#else
+    static constexpr const char kPkgsSegmentName[] = "yalx_pkgs,\"aw\"";
+    static constexpr const char kProfSegmentName[] = "yalx_prof,\"aw\"";
+    static constexpr const char kColdTextSegmentName[] = ".text.cold,\"ax\",@progbits";
+#endif
     
     GnuAsmGenerator(const base::ArenaMap<std::string_view, InstructionFunction *> &funs,
                     const RegistersConfiguration *profile,
@@ -40,18 +50,38 @@ public:
     DEF_PTR_SETTER(const char, comment);
     DEF_PTR_SETTER(const char, text_p2align);
     DEF_PTR_GETTER(const RegistersConfiguration, profile);
+    // Functions are emitted in parallel if it has been set.
+    DEF_PTR_PROP_RW(base::ThreadPool, thread_pool);
     
     void EmitAll();
     
+    // Shared with the object file generators:
+    static int DeclarationToKind(const ir::Model *clazz);
+    static int CompactFieldCode(const ir::StructureModel *clazz, size_t field_index);
+    static void MarkRefsInClass(const ir::StructureModel *clazz, int offset, std::vector<int> *refs_offset);
+    // Find symbol and offset of the class of type, returns false if the type has no class: `void'
+    static bool ClassSymbolOf(const ir::Type &ty, std::string *symbol, int *offset);
+    // Instrumented functions of module, which have execution counters
+    static std::vector<InstructionFunction *> ProfiledFunctionsOf(
+            const base::ArenaMap<std::string_view, InstructionFunction *> &funs, const ir::Module *module);
+    
+    static constexpr const char kBuiltinClassesSymbol[] = "_builtin_classes";
+    // sizeof(struct yalx_profile_site)
+    static constexpr const int kProfileSiteSizeInBytes = 40;
+    
     DISALLOW_IMPLICIT_CONSTRUCTORS(GnuAsmGenerator);
 protected:
-    virtual void EmitFunction(InstructionFunction *) = 0;
+    void EmitFunction(InstructionFunction *fun) { EmitFunction(fun, printer_); }
+    // Emit text of function into `printer', it's called by multi-threads if there is a thread pool.
+    virtual void EmitFunction(InstructionFunction *fun, base::PrintingWriter *printer) = 0;
+    void EmitFunctions(const std::vector<InstructionFunction *> &funs);
     void EmitSourceFilesInfo();
     void EmitNumberConstants();
     void EmitStringConstants();
+    void EmitPackageInitRecord();
+    void EmitProfileRecords(const std::vector<InstructionFunction *> &profiled);
     void EmitMetadata();
     int EmitGlobalSlots(std::vector<int> *refs_offset);
-    void MarkRefsInClass(const ir::StructureModel *clazz, int offset, std::vector<int> *refs_offset);
     void EmitTypeRelocation(const ir::Type &ty, base::PrintingWriter *printer);
     
     const char *comment_ = "#";
@@ -63,6 +93,7 @@ protected:
     ConstantsPool *const const_pool_;
     Linkage *const symbols_;
     base::PrintingWriter *const printer_;
+    base::ThreadPool *thread_pool_ = nullptr;
 }; // class GnuAsmGenerator
 
 } // namespace backend
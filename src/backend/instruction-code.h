@@ -9,22 +9,25 @@
 namespace yalx::backend {
 
 #define ARCH_OPCODE_LIST(V) \
-    V(ArchNop)              \
-    V(ArchDebugBreak)       \
-    V(ArchRet)              \
-    V(ArchJmp)              \
-    V(ArchCall)             \
-    V(ArchCallNative)       \
-    V(ArchAfterCall)        \
-    V(ArchBeforeCall)       \
-    V(ArchFrameEnter)       \
-    V(ArchFrameExit)        \
-    V(ArchUnreachable)      \
-    V(ArchSafepoint)        \
-    V(ArchStackAlloc)       \
-    V(ArchStackLoad)        \
-    V(ArchLoadRelocation)   \
-    V(ArchLoadEffectAddress)
+    V(ArchNop)               \
+    V(ArchDebugBreak)        \
+    V(ArchRet)               \
+    V(ArchJmp)               \
+    V(ArchTableSwitch)       \
+    V(ArchCall)              \
+    V(ArchTailCall)          \
+    V(ArchCallNative)        \
+    V(ArchAfterCall)         \
+    V(ArchBeforeCall)        \
+    V(ArchFrameEnter)        \
+    V(ArchFrameExit)         \
+    V(ArchUnreachable)       \
+    V(ArchSafepoint)         \
+    V(ArchStackAlloc)        \
+    V(ArchStackLoad)         \
+    V(ArchLoadRelocation)    \
+    V(ArchLoadEffectAddress) \
+    V(ArchProfileCount)
 
 enum InstructionCode {
 #define DEFINE_ENUM(name) name,
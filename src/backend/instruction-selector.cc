@@ -4,17 +4,63 @@
 #include "backend/linkage-symbols.h"
 #include "backend/instruction.h"
 #include "backend/frame.h"
+#include "ir/pass/tail-call-elimination.h"
 #include "ir/metadata.h"
 #include "ir/utils.h"
 #include "ir/node.h"
 #include "ir/type.h"
 #include "base/utils.h"
 #include "base/io.h"
+#include <algorithm>
 #include <memory>
 
 
 namespace yalx::backend {
 
+// Exception handling and never returning paths are rarely executed.
+static bool IsDeferredBlock(ir::BasicBlock *block) {
+    for (auto instr : block->instructions()) {
+        switch (instr->op()->value()) {
+            case ir::Operator::kUnreachable:
+            case ir::Operator::kUnwind:
+            case ir::Operator::kCatch:
+                return true;
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+// Bits of integral constant, sign or zero extended, only lower bits of selector's width are significant.
+static uint64_t IntegralBitsOf(ir::Value *value) {
+    switch (value->op()->value()) {
+        case ir::Operator::kI8Constant:
+        case ir::Operator::kU8Constant:
+        case ir::Operator::kWord8Constant:
+            return ir::OperatorWith<int8_t>::Data(value);
+
+        case ir::Operator::kI16Constant:
+        case ir::Operator::kU16Constant:
+        case ir::Operator::kWord16Constant:
+            return ir::OperatorWith<int16_t>::Data(value);
+
+        case ir::Operator::kI32Constant:
+        case ir::Operator::kU32Constant:
+        case ir::Operator::kWord32Constant:
+            return ir::OperatorWith<int32_t>::Data(value);
+
+        case ir::Operator::kI64Constant:
+        case ir::Operator::kU64Constant:
+        case ir::Operator::kWord64Constant:
+            return ir::OperatorWith<int64_t>::Data(value);
+
+        default:
+            UNREACHABLE();
+            return 0;
+    }
+}
+
 InstructionSelector::InstructionSelector(base::Arena *arena,
                                          const RegistersConfiguration *config,
                                          Linkage *linkage,
@@ -56,6 +102,7 @@ InstructionFunction *InstructionSelector::VisitFunction(ir::Function *fun) {
 InstructionFunction *InstructionSelector::BuildFunction(ir::Function *fun) {
     frame_ = new (arena_) Frame(arena_, fun);
     auto instr_fun = new (arena_) InstructionFunction(arena_, linkage()->Mangle(fun->full_name()), frame_);
+    barrier_set_->BeforeFun(this, instr_fun);
 
     std::vector<InstructionOperand> parameters;
     VisitParameters(fun, &parameters);
@@ -75,6 +122,8 @@ InstructionFunction *InstructionSelector::BuildFunction(ir::Function *fun) {
         for (auto successor : basic_block->outputs()) {
             instr_block->AddSuccessor(block_mapping_[successor]);
         }
+        instr_block->set_deferred(IsDeferredBlock(basic_block));
+        instr_block->set_frequency(basic_block->frequency());
 
         current_block_ = instr_block;
 
@@ -93,12 +142,22 @@ InstructionFunction *InstructionSelector::BuildFunction(ir::Function *fun) {
         current_block_ = nullptr;
     }
     block_mapping_.clear();
+    barrier_set_->AfterFun(this, instr_fun);
     return instr_fun;
 }
 
 void InstructionSelector::VisitBasicBlock(ir::BasicBlock *block) {
-    
+    auto tail_call = ir::TailCallEliminationPass::TailCallOf(block);
+    if (tail_call && !CanTailCall(tail_call)) {
+        tail_call = nullptr;
+    }
+
     for (auto instr : block->instructions()) {
+        if (instr == tail_call) {
+            // Returning values are returned by the callee itself.
+            VisitTailCall(instr);
+            break;
+        }
         Select(instr);
     }
     
@@ -128,6 +187,7 @@ void InstructionSelector::Select(ir::Value *instr) {
 //        case ir::Operator::kCallVirtual:
         case ir::Operator::kCallDirectly:
 //        case ir::Operator::kCallAbstract:
+//        case ir::Operator::kProfileReceiver: // Lowering with calls of virtual and abstract
 //        case ir::Operator::kCallIndirectly:
             VisitCallDirectly(instr);
             break;
@@ -149,6 +209,10 @@ void InstructionSelector::Select(ir::Value *instr) {
             }
             break;
 
+        case ir::Operator::kSwitch:
+            VisitSwitch(instr);
+            break;
+
         case ir::Operator::kRet:
             VisitReturn(instr);
             break;
@@ -161,6 +225,12 @@ void InstructionSelector::Select(ir::Value *instr) {
             // Ignore returning-val nodes.
             break;
 
+        case ir::Operator::kProfileCount: {
+            auto counters = linkage()->MangleProfileCounters(current_block_->owns()->symbol());
+            auto index = ir::OperatorWith<int>::Data(instr);
+            Emit(ArchProfileCount, NoOutput(), ReloactionOperand(counters, index * 8));
+        } break;
+
         case ir::Operator::kLoadAddress:
             VisitLoadAddress(instr);
             break;
@@ -378,6 +448,62 @@ void InstructionSelector::VisitCallDirectly(ir::Value *ir) {
     Emit(ArchAfterCall, NoOutput(), arraysize(hints), hints);
 }
 
+// The frame is torn down before jumping to the callee, so the callee returns to our caller directly. Both frames
+// have no overflow arguments and same returning values, so the callee writes them to the same place.
+void InstructionSelector::VisitTailCall(ir::Value *ir) {
+    auto callee = ir::OperatorWith<ir::Function *>::Data(ir->op());
+
+    std::vector<std::pair<UnallocatedOperand, InstructionOperand>> moving;
+    std::vector<UnallocatedOperand> inputs;
+    int gp_index = 0, fp_index = 0;
+    for (int i = 0; i < ir->op()->value_in(); i++) {
+        auto arg = ir->InputValue(i);
+        auto opd = arg->type().IsFloating()
+                   ? UseAsFixedFPRegister(arg, registers()->argument_fp_register(fp_index++))
+                   : UseAsFixedRegister(arg, registers()->argument_gp_register(gp_index++));
+        if (auto imm = TryUseAsConstantOrImmediate(arg); !imm.IsInvalid()) {
+            moving.emplace_back(opd, imm);
+        }
+        inputs.push_back(opd);
+    }
+
+    InstructionOperand temps[2] = {
+        ImmediateOperand{-1}, // Size of frame
+        ReloactionOperand{linkage()->Mangle(callee->full_name())},
+    };
+    auto instr = Emit(ArchTailCall, 0, nullptr, static_cast<int>(inputs.size()), inputs.data(), 2, temps);
+    for (auto [dest, src] : moving) {
+        instr->GetOrNewParallelMove(Instruction::kStart, arena())->AddMove(dest, src, arena());
+    }
+}
+
+bool InstructionSelector::CanTailCall(ir::Value *call) const {
+    auto fun = frame_->fun();
+    auto callee = ir::OperatorWith<ir::Function *>::Data(call->op());
+    if (OverflowParametersSizeInBytes(fun) > 0) {
+        return false;
+    }
+
+    int gp_count = registers()->number_of_argument_gp_registers();
+    int fp_count = registers()->number_of_argument_fp_registers();
+    for (int i = 0; i < call->op()->value_in(); i++) {
+        auto ty = call->InputValue(i)->type();
+        // Values and pointers may be addresses in the frame.
+        if (ty.kind() == ir::Type::kValue || ty.IsPointer()) {
+            return false;
+        }
+        if (--(ty.IsFloating() ? fp_count : gp_count) < 0) {
+            return false;
+        }
+    }
+
+    const auto &returning = fun->prototype()->return_types();
+    const auto &callee_returning = callee->prototype()->return_types();
+    return returning.size() == callee_returning.size() &&
+           std::equal(returning.begin(), returning.end(), callee_returning.begin(),
+                      [](const ir::Type &a, const ir::Type &b) { return a.Equals(b); });
+}
+
 void InstructionSelector::VisitReturn(ir::Value *value) {
     auto fun = frame_->fun();
     auto overflow_args_size = OverflowParametersSizeInBytes(fun);
@@ -449,6 +575,33 @@ void InstructionSelector::VisitHeapAlloc(ir::Value *value) {
     Emit(AndBits(ArchAfterCall, CallDescriptorField::Encode(kCallNative)), NoOutput());
 }
 
+// Switch value, key1, key2, ... out [case1, case2, ..., default]
+// Keys are sorted and dense (see `ir::SwitchLoweringPass'), so it becomes:
+// ArchTableSwitch value, lowest, default, slot0, slot1, ...
+// Slot `i' is the target of key `lowest + i', the holes jump to default. The temp holds address of the table.
+void InstructionSelector::VisitSwitch(ir::Value *instr) {
+    const auto n = instr->op()->value_in() - 1;
+    DCHECK(n > 0);
+    const auto bits = instr->InputValue(0)->type().bits();
+    const auto mask = bits >= 64 ? ~static_cast<uint64_t>(0) : (static_cast<uint64_t>(1) << bits) - 1;
+    const auto lowest = IntegralBitsOf(instr->InputValue(1));
+    const auto slots = ((IntegralBitsOf(instr->InputValue(n)) - lowest) & mask) + 1;
+    DCHECK(slots + 3 <= UINT8_MAX);
+    DCHECK(static_cast<int64_t>(lowest) == static_cast<int32_t>(lowest) || bits <= 32);
+
+    auto otherwise = ReloactionOperand(GetBlock(instr->OutputControl(n)));
+    std::vector<InstructionOperand> inputs(3 + slots, otherwise);
+    inputs[0] = UseAsRegister(instr->InputValue(0));
+    inputs[1] = ImmediateOperand{static_cast<int32_t>(lowest)};
+    for (int i = 0; i < n; i++) {
+        auto slot = (IntegralBitsOf(instr->InputValue(1 + i)) - lowest) & mask;
+        inputs[3 + slot] = ReloactionOperand(GetBlock(instr->OutputControl(i)));
+    }
+    InstructionOperand temps[1];
+    temps[0] = UnallocatedOperand(UnallocatedOperand::kMustHaveRegister, frame()->NextVirtualRegister());
+    Emit(ArchTableSwitch, 0, nullptr, static_cast<int>(inputs.size()), &inputs[0], arraysize(temps), temps);
+}
+
 Instruction *InstructionSelector::Emit(InstructionCode opcode, InstructionOperand output,
                                        int temps_count, InstructionOperand *temps) {
     int outputs_count = output.IsInvalid() ? 0 : 1;
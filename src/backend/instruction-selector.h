@@ -51,9 +51,11 @@ public:
     void VisitParameters(ir::Function *fun, std::vector<InstructionOperand> *parameters);
     void VisitPhi(ir::Value *instr);
     void VisitCallDirectly(ir::Value *ir);
+    void VisitTailCall(ir::Value *ir);
     void VisitReturn(ir::Value *value);
     void VisitStackAlloc(ir::Value *value);
     void VisitHeapAlloc(ir::Value *value);
+    void VisitSwitch(ir::Value *instr);
 
     virtual void VisitCondBr(ir::Value *instr) {UNREACHABLE();}
     virtual void VisitAddOrSub(ir::Value *instr) {UNREACHABLE();}
@@ -129,6 +131,8 @@ public:
     size_t ParametersSizeInBytes(const ir::Function *fun) const;
     size_t OverflowParametersSizeInBytes(const ir::Function *fun) const;
     size_t YalxHandleStackSizeInBytes(const ir::Function *fun) const;
+    // Can the call in tail position be a jump? Frames of caller and callee must be compatible.
+    bool CanTailCall(ir::Value *call) const;
 
     void UpdateRenames(Instruction *instr);
     void TryRename(InstructionOperand *opd);
@@ -32,6 +32,8 @@ bool InstructionOperand::Equals(const InstructionOperand *other) const {
             auto rhs = other->AsAllocated();
             return lhs->location_kind() == rhs->location_kind() &&
                    lhs->machine_representation() == rhs->machine_representation() &&
+                   lhs->register_id() == rhs->register_id() &&
+                   lhs->IsSlot() == rhs->IsSlot() &&
                    lhs->index() == rhs->index();
         } break;
         case kImmediate: {
@@ -512,13 +514,7 @@ InstructionBlock::InstructionBlock(base::Arena *arena, InstructionFunction *owns
 
 int InstructionBlock::GetLowerId() const { return instructions().front()->id(); }
 
-int InstructionBlock::GetUpperId() const {
-    int upper_id = instructions().back()->id();
-    for (auto end : loop_end_nodes_) {
-        upper_id = std::max(end->instructions().back()->id(), upper_id);
-    }
-    return upper_id;
-}
+int InstructionBlock::GetUpperId() const { return instructions().back()->id(); }
 
 void InstructionBlock::PrintTo(base::PrintingWriter *printer) const {
     printer->Println("L%d:", label());
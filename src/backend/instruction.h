@@ -631,9 +631,15 @@ public:
 
     DEF_PTR_GETTER(InstructionFunction, owns);
     DEF_VAL_GETTER(int, id);
-    DEF_VAL_GETTER(int, label);
+    DEF_VAL_PROP_RW(int, label);
     DEF_VAL_PROP_RW(int, loop_index);
     DEF_VAL_PROP_RW(int, loop_depth);
+    // Rarely executed, e.g. exception handling paths.
+    DEF_VAL_PROP_RW(bool, deferred);
+    // Placed into the cold text section by the block layout.
+    DEF_VAL_PROP_RW(bool, cold);
+    // Execution count from the profile, -1 if unknown.
+    DEF_VAL_PROP_RW(int64_t, frequency);
     DEF_ARENA_VECTOR_GETTER(InstructionBlock *, successor);
     DEF_ARENA_VECTOR_GETTER(InstructionBlock *, predecessor);
     DEF_ARENA_VECTOR_GETTER(InstructionBlock *, loop_end_node);
@@ -656,6 +662,11 @@ public:
         jumping_table_.emplace(instructions().back(), id);
     }
 
+    // Move ids of jumping positions by `base', for putting functions into one module.
+    void RebaseJumpingPositions(int base) {
+        for (auto &[_, id] : jumping_table_) { id += base; }
+    }
+
     std::optional<int> JumpingPosition(Instruction *instr) const {
         if (auto iter = jumping_table_.find(instr); iter != jumping_table_.end()) {
             return {iter->second};
@@ -684,6 +695,9 @@ private:
     int label_;
     int loop_index_ = 0;
     int loop_depth_ = 0;
+    bool deferred_ = false;
+    bool cold_ = false;
+    int64_t frequency_ = -1;
 }; // class InstructionBlock
 
 class InstructionBlockLabelGenerator final {
@@ -727,7 +741,7 @@ struct AllocatedOpdOperator {
 
 struct FrameScopeHint {
     static inline int GetStackMaxSize(Instruction *instr) {
-        DCHECK(instr->op() == ArchFrameEnter || instr->op() == ArchFrameExit);
+        DCHECK(instr->op() == ArchFrameEnter || instr->op() == ArchFrameExit || instr->op() == ArchTailCall);
         return instr->TempAt(0)->AsImmediate()->word32_value();
     }
 };
@@ -28,6 +28,13 @@ public:
         return String::New(arena_, buf);
     }
     
+    // Execution counters of the instrumented function of `symbol'
+    const String *MangleProfileCounters(const String *symbol) {
+        std::string buf(symbol->ToSlice());
+        buf.append("$counters");
+        return String::New(arena_, buf);
+    }
+    
     static void BuildNativeStub(std::string *buf, std::string_view name) {
         Build(buf, name);
         buf->append("_stub");
@@ -39,6 +46,13 @@ public:
     static void Build(std::string *buf, std::string_view name);
     
     int NextBlockLabel() { return next_block_label_++; }
+    // Take `n' labels at once, returns the first one.
+    int ReserveBlockLabels(int n) {
+        auto label = next_block_label_;
+        next_block_label_ += n;
+        return label;
+    }
+    DEF_VAL_GETTER(int, next_block_label);
     
     DISALLOW_IMPLICIT_CONSTRUCTORS(Linkage);
 private:
@@ -55,6 +69,7 @@ extern const String *const kLibc_memset;
 #define DECLARE_RUNTIME_FUNS(V) \
     V(builtin_classes) \
     V(pkg_init_once) \
+    V(pkg_init_record_once) \
     V(reserve_handle_returning_vals) \
     V(current_root) \
     V(yalx_exit_returning_scope) \
@@ -0,0 +1,152 @@
+#include "backend/move-resolver.h"
+#include "backend/registers-configuration.h"
+#include "backend/instruction.h"
+#include "backend/frame.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/base-test.h"
+#include <gtest/gtest.h>
+#include <map>
+
+namespace yalx::backend {
+
+class MoveResolverTest : public ir::ModuleTest {
+public:
+    void SetUp() override {
+        ir::ModuleTest::SetUp();
+        frame_ = new (arena()) Frame(arena(), NewFun("main", {}, {}));
+        regconf_ = RegistersConfiguration::OfPosixX64();
+    }
+
+    static AllocatedOperand Reg(int id) { return AllocatedOperand::Register(MachineRepresentation::kWord64, id); }
+
+    AllocatedOperand Slot(int offset) const {
+        return AllocatedOperand::Slot(MachineRepresentation::kWord64, regconf_->fp(), offset);
+    }
+
+    static std::string KeyOf(const InstructionOperand &opd) {
+        auto allocated = opd.AsAllocated();
+        return (allocated->IsRegisterLocation() ? "r" : "m") + std::to_string(allocated->register_id()) + ":" +
+               std::to_string(allocated->index());
+    }
+
+    // Emit moves one by one, returns the final value of every location but the temporaries.
+    static std::map<std::string, int> Simulate(const ParallelMove &moves, std::map<std::string, int> values) {
+        auto locations = values;
+        for (auto move : moves.moves()) {
+            locations[KeyOf(move->dest())] = locations[KeyOf(move->src())];
+        }
+        for (auto &[key, value] : values) {
+            value = locations[key];
+        }
+        return values;
+    }
+
+    // Expected values of parallel semantics: all sources are read before any destination is written.
+    static std::map<std::string, int> Expect(const std::vector<std::pair<AllocatedOperand, AllocatedOperand>> &moves,
+                                             std::map<std::string, int> values) {
+        auto origin = values;
+        for (auto [dest, src] : moves) {
+            values[KeyOf(dest)] = origin[KeyOf(src)];
+        }
+        return values;
+    }
+
+    ParallelMove *NewMoves(const std::vector<std::pair<AllocatedOperand, AllocatedOperand>> &moves) {
+        auto rs = new (arena()) ParallelMove(arena());
+        for (auto [dest, src] : moves) {
+            rs->AddMove(dest, src, arena());
+        }
+        return rs;
+    }
+
+    static std::map<std::string, int> Initial(const std::vector<std::pair<AllocatedOperand, AllocatedOperand>> &moves) {
+        std::map<std::string, int> values;
+        int value = 100;
+        for (auto [dest, src] : moves) {
+            values[KeyOf(dest)] = value++;
+            values[KeyOf(src)] = value++;
+        }
+        return values;
+    }
+
+protected:
+    Frame *frame_ = nullptr;
+    const RegistersConfiguration *regconf_ = nullptr;
+}; // class MoveResolverTest
+
+TEST_F(MoveResolverTest, Chain) {
+    // r1 <- r2, r2 <- r3, r3 <- r4
+    std::vector<std::pair<AllocatedOperand, AllocatedOperand>> moves{
+        {Reg(1), Reg(2)},
+        {Reg(2), Reg(3)},
+        {Reg(3), Reg(4)},
+    };
+    auto pm = NewMoves(moves);
+    MoveResolver resolver(arena(), regconf_, frame_);
+    resolver.Resolve(pm);
+    ASSERT_EQ(3, pm->moves_size());
+    EXPECT_EQ(Expect(moves, Initial(moves)), Simulate(*pm, Initial(moves)));
+    EXPECT_EQ(0, resolver.temp_slot());
+}
+
+TEST_F(MoveResolverTest, SwapRegisters) {
+    std::vector<std::pair<AllocatedOperand, AllocatedOperand>> moves{
+        {Reg(1), Reg(2)},
+        {Reg(2), Reg(1)},
+    };
+    auto pm = NewMoves(moves);
+    MoveResolver resolver(arena(), regconf_, frame_);
+    resolver.Resolve(pm);
+    ASSERT_EQ(3, pm->moves_size());
+    auto scratch = Reg(regconf_->scratch0());
+    EXPECT_TRUE(pm->move(0)->dest().Equals(&scratch));
+    EXPECT_EQ(Expect(moves, Initial(moves)), Simulate(*pm, Initial(moves)));
+    EXPECT_EQ(0, resolver.temp_slot());
+}
+
+TEST_F(MoveResolverTest, CycleAndTree) {
+    // cycle: r1 -> r2 -> r3 -> r1 and r4, r5 read r1
+    std::vector<std::pair<AllocatedOperand, AllocatedOperand>> moves{
+        {Reg(2), Reg(1)},
+        {Reg(3), Reg(2)},
+        {Reg(1), Reg(3)},
+        {Reg(4), Reg(1)},
+        {Reg(5), Reg(3)},
+    };
+    auto pm = NewMoves(moves);
+    MoveResolver resolver(arena(), regconf_, frame_);
+    resolver.Resolve(pm);
+    EXPECT_EQ(6, pm->moves_size()); // Only one more move for the cycle
+    EXPECT_EQ(Expect(moves, Initial(moves)), Simulate(*pm, Initial(moves)));
+}
+
+TEST_F(MoveResolverTest, SwapSlots) {
+    auto a = Slot(frame_->AllocateSlot(8, 0));
+    auto b = Slot(frame_->AllocateSlot(8, 0));
+    std::vector<std::pair<AllocatedOperand, AllocatedOperand>> moves{
+        {a, b},
+        {b, a},
+        {Reg(1), a},
+    };
+    auto pm = NewMoves(moves);
+    MoveResolver resolver(arena(), regconf_, frame_);
+    resolver.Resolve(pm);
+    EXPECT_EQ(4, pm->moves_size());
+    // scratch0 is used by memory to memory moves.
+    EXPECT_NE(0, resolver.temp_slot());
+    EXPECT_EQ(Expect(moves, Initial(moves)), Simulate(*pm, Initial(moves)));
+}
+
+TEST_F(MoveResolverTest, Overlap) {
+    EXPECT_TRUE(MoveResolver::IsOverlap(Reg(1), Reg(1)));
+    EXPECT_FALSE(MoveResolver::IsOverlap(Reg(1), AllocatedOperand::Register(MachineRepresentation::kFloat64, 1)));
+    EXPECT_TRUE(MoveResolver::IsOverlap(Slot(-8), AllocatedOperand::Slot(MachineRepresentation::kWord32,
+                                                                         regconf_->fp(), -4)));
+    EXPECT_FALSE(MoveResolver::IsOverlap(Slot(-8), Slot(-16)));
+    auto location = AllocatedOperand::Location(MachineRepresentation::kWord64, 1, 16);
+    EXPECT_TRUE(MoveResolver::IsReading(location, Reg(1)));
+    EXPECT_FALSE(MoveResolver::IsReading(Reg(1), location));
+}
+
+} // namespace yalx::backend
@@ -0,0 +1,115 @@
+#include "backend/move-resolver.h"
+#include "backend/registers-configuration.h"
+#include "backend/instruction.h"
+#include "backend/frame.h"
+#include <algorithm>
+#include <vector>
+
+namespace yalx::backend {
+
+static inline bool IsFloating(MachineRepresentation rep) {
+    return rep == MachineRepresentation::kFloat32 || rep == MachineRepresentation::kFloat64;
+}
+
+MoveResolver::MoveResolver(base::Arena *arena, const RegistersConfiguration *regconf, Frame *frame)
+: arena_(arena)
+, regconf_(regconf)
+, frame_(frame) {
+}
+
+void MoveResolver::Resolve(ParallelMove *moves) {
+    std::vector<ParallelMove::Operands *> pending;
+    for (auto move : moves->moves()) {
+        if (!move->src().Equals(&move->dest())) {
+            pending.push_back(move);
+        }
+    }
+    moves->mutable_moves()->clear();
+
+    while (!pending.empty()) {
+        // Find a move which destination is not read by any other pending move.
+        auto ready = pending.end();
+        for (auto iter = pending.begin(); iter != pending.end() && ready == pending.end(); iter++) {
+            ready = iter;
+            for (auto other : pending) {
+                if (other != *iter && IsReading(other->src(), (*iter)->dest())) {
+                    ready = pending.end();
+                    break;
+                }
+            }
+        }
+        if (ready != pending.end()) {
+            moves->mutable_moves()->push_back(*ready);
+            pending.erase(ready);
+            continue;
+        }
+
+        // All pending moves are blocked: there is a cycle. Save the first destination to a temporary, then readers
+        // of the destination read the temporary, so the first move is unblocked.
+        auto blocked = pending.front();
+        // The code generators use `scratch0' for memory to memory moves, so it is a temporary only if all of pending
+        // moves are between general registers.
+        bool registers_only = std::all_of(pending.begin(), pending.end(), [](auto move) {
+            return AllocatedOpdOperator::IsRegister(move->mutable_src()) &&
+                   AllocatedOpdOperator::IsRegister(move->mutable_dest());
+        });
+        auto temp = GetTemporary(*blocked->dest().AsAllocated(), registers_only);
+        moves->mutable_moves()->push_back(new (arena_) ParallelMove::Operands(blocked->dest(), temp, nullptr));
+        for (auto move : pending) {
+            if (move != blocked && IsOverlap(move->src(), blocked->dest())) {
+                auto src = move->src().AsAllocated();
+                DCHECK(src->IsRegisterLocation() || src->index() == blocked->dest().AsAllocated()->index());
+                auto rep = src->machine_representation();
+                *move->mutable_src() = temp.IsRegisterLocation()
+                        ? AllocatedOperand::Register(rep, temp.register_id())
+                        : AllocatedOperand::Slot(rep, temp.register_id(), temp.index());
+            }
+        }
+        DCHECK(std::none_of(pending.begin(), pending.end(), [blocked](auto move) {
+            return move != blocked && IsReading(move->src(), blocked->dest());
+        }));
+    }
+}
+
+AllocatedOperand MoveResolver::GetTemporary(const AllocatedOperand &dest, bool registers_only) {
+    auto rep = dest.machine_representation();
+    if (registers_only && !IsFloating(rep) && regconf_->scratch0() >= 0) {
+        return AllocatedOperand::Register(rep, regconf_->scratch0());
+    }
+    if (temp_slot_ == 0) {
+        temp_slot_ = frame_->AllocateSlot(kPointerSize, 0);
+    }
+    return AllocatedOperand::Slot(rep, regconf_->fp(), temp_slot_);
+}
+
+bool MoveResolver::IsOverlap(const InstructionOperand &lhs, const InstructionOperand &rhs) {
+    auto a = lhs.AsAllocated(), b = rhs.AsAllocated();
+    if (!a || !b) {
+        return false;
+    }
+    if (a->IsRegisterLocation() && b->IsRegisterLocation()) {
+        return a->register_id() == b->register_id() &&
+               IsFloating(a->machine_representation()) == IsFloating(b->machine_representation());
+    }
+    if (a->IsMemoryLocation() && b->IsMemoryLocation()) {
+        if (a->register_id() != b->register_id()) {
+            return false;
+        }
+        auto a_size = static_cast<int>(MachineRepresentationInBytes(a->machine_representation()));
+        auto b_size = static_cast<int>(MachineRepresentationInBytes(b->machine_representation()));
+        return a->index() < b->index() + b_size && b->index() < a->index() + a_size;
+    }
+    return false;
+}
+
+bool MoveResolver::IsReading(const InstructionOperand &src, const InstructionOperand &dest) {
+    if (IsOverlap(src, dest)) {
+        return true;
+    }
+    // Memory location reads its base register too.
+    auto a = src.AsAllocated(), b = dest.AsAllocated();
+    return a && b && a->IsMemoryLocation() && b->IsRegisterLocation() &&
+           !IsFloating(b->machine_representation()) && a->register_id() == b->register_id();
+}
+
+} // namespace yalx::backend
@@ -0,0 +1,49 @@
+#pragma once
+#ifndef YALX_BACKEND_MOVE_RESOLVER_H_
+#define YALX_BACKEND_MOVE_RESOLVER_H_
+
+#include "base/base.h"
+
+namespace yalx::base {
+class Arena;
+}
+
+namespace yalx::backend {
+
+class RegistersConfiguration;
+class InstructionOperand;
+class AllocatedOperand;
+class ParallelMove;
+class Frame;
+
+// Order the moves of a parallel move, so the code generators can emit them one by one:
+// A move is emitted only when no other pending move still reads its destination; a cycle is broken by
+// saving one destination to a temporary, so a cycle of `k' moves costs `k + 1' moves and no swap is needed.
+// The temporary is `scratch0' for the general registers cycles, otherwise a stack slot.
+class MoveResolver final {
+public:
+    MoveResolver(base::Arena *arena, const RegistersConfiguration *regconf, Frame *frame);
+
+    // Reorder moves in place, all operands must be allocated.
+    void Resolve(ParallelMove *moves);
+
+    // Stack slot for breaking the cycles, 0 if never be allocated.
+    DEF_VAL_GETTER(int, temp_slot);
+
+    static bool IsOverlap(const InstructionOperand &lhs, const InstructionOperand &rhs);
+    // Does `src' read the location `dest'?
+    static bool IsReading(const InstructionOperand &src, const InstructionOperand &dest);
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(MoveResolver);
+private:
+    AllocatedOperand GetTemporary(const AllocatedOperand &dest, bool registers_only);
+
+    base::Arena *const arena_;
+    const RegistersConfiguration *const regconf_;
+    Frame *const frame_;
+    int temp_slot_ = 0;
+}; // class MoveResolver
+
+} // namespace yalx::backend
+
+#endif // YALX_BACKEND_MOVE_RESOLVER_H_
@@ -0,0 +1,410 @@
+#include "backend/object-file-generator.h"
+#include "backend/gnu-asm-generator.h"
+#include "backend/elf-object-writer.h"
+#include "backend/linkage-symbols.h"
+#include "backend/constants-pool.h"
+#include "backend/instruction.h"
+#include "backend/frame.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/type.h"
+#include "ir/operator.h"
+#include "base/format.h"
+
+namespace yalx::backend {
+
+ObjectFileGenerator::ObjectFileGenerator(const base::ArenaMap<std::string_view, InstructionFunction *> &funs,
+                                         const RegistersConfiguration *profile,
+                                         ir::Module *module,
+                                         ConstantsPool *const_pool,
+                                         Linkage *symbols,
+                                         ElfObjectWriter *writer)
+: funs_(funs)
+, profile_(profile)
+, module_(module)
+, const_pool_(const_pool)
+, symbols_(symbols)
+, writer_(writer) {
+}
+
+ObjectFileGenerator::~ObjectFileGenerator() = default;
+
+void ObjectFileGenerator::EmitAll() {
+    for (auto fun : module_->funs()) {
+        auto iter = funs_.find(fun->full_name()->ToSlice());
+        assert(iter != funs_.end());
+        EmitFunction(iter->second);
+    }
+
+    for (auto clazz : module_->structures()) {
+        for (auto method : clazz->methods()) {
+            const_pool_->FindOrInsertString(method.fun->prototype()->name());
+            const_pool_->FindOrInsertString(method.fun->name());
+
+            auto iter = funs_.find(method.fun->full_name()->ToSlice());
+            if (iter == funs_.end()) {
+                continue;
+            }
+            EmitFunction(iter->second);
+        }
+        for (auto field : clazz->fields()) {
+            const_pool_->FindOrInsertString(field.name);
+        }
+        const_pool_->FindOrInsertString(clazz->name());
+        const_pool_->FindOrInsertString(clazz->full_name());
+    }
+    EmitCallFrames();
+    // For names of profile records
+    auto profiled = GnuAsmGenerator::ProfiledFunctionsOf(funs_, module_);
+    for (auto fun : profiled) {
+        const_pool_->FindOrInsertString(fun->frame()->fun()->full_name());
+    }
+
+    // string constants:
+    if (!const_pool_->string_pool().empty()) {
+        auto cstring = writer_->FindOrInsertSection(kCStringSectionName, ElfObjectWriter::kReadOnly, 1);
+        for (size_t i = 0; i < const_pool_->string_pool().size(); i++) {
+            auto kval = const_pool_->string_pool()[i];
+            writer_->DefineSymbolHere(base::Sprintf("Lkzs.%zd", i), cstring, false/*global*/);
+            writer_->mutable_data(cstring)->append(kval->data(), kval->size());
+            writer_->AppendZero(cstring, 1);
+        }
+    }
+
+    if (!const_pool_->numbers().empty()) {
+        EmitNumberConstants();
+    }
+
+    data_ = writer_->FindOrInsertSection(kDataSectionName, ElfObjectWriter::kData, 16);
+    if (!module_->structures().empty()) {
+        writer_->Align(data_, 16);
+        EmitMetadata();
+    }
+
+    writer_->Align(data_, 16);
+    std::string symbol;
+    Linkage::Build(&symbol, module_->full_name()->ToSlice());
+    symbol.append("$global_slots");
+    //    struct pkg_global_slots {
+    //        size_t size_in_bytes;
+    //        Address slots;
+    //        size_t mark_size;
+    //        int marks[0];
+    //    };
+    if (!module_->values().empty()) {
+        std::vector<int> marked_refs;
+        auto size_in_bytes = EmitGlobalSlots(&marked_refs);
+        writer_->DefineSymbolHere(symbol, data_, true/*global*/);
+        writer_->Append<uint64_t>(data_, size_in_bytes);
+        EmitAddress("pkg_global_slots");
+        writer_->Append<uint64_t>(data_, marked_refs.size());
+        for (const auto off : marked_refs) {
+            writer_->Append<int32_t>(data_, off);
+        }
+    } else {
+        writer_->DefineSymbolHere(symbol, data_, true/*global*/);
+        writer_->AppendZero(data_, 24);
+    }
+
+    if (!const_pool_->string_pool().empty()) {
+        EmitStringConstants();
+    }
+    EmitPackageInitRecord();
+    if (!profiled.empty()) {
+        EmitProfileRecords(profiled);
+    }
+}
+
+int ObjectFileGenerator::text() {
+    if (text_ < 0) {
+        text_ = writer_->FindOrInsertSection(kTextSectionName, ElfObjectWriter::kText, 16);
+    }
+    return text_;
+}
+
+int ObjectFileGenerator::EmitGlobalSlots(std::vector<int> *refs_offset) {
+    writer_->DefineSymbolHere("pkg_global_slots", data_, false/*global*/);
+    int offset = 0;
+
+    for (auto val : module_->values()) {
+        if (!val->Is(ir::Operator::kGlobalValue) &&
+            !val->Is(ir::Operator::kLazyValue)) {
+            continue;
+        }
+
+        std::string symbol;
+        Linkage::Build(&symbol, val->name()->ToSlice());
+        writer_->DefineSymbolHere(symbol, data_, false/*global*/);
+
+        auto size_in_bytes = val->type().ReferenceSizeInBytes();
+        if (val->type().IsReference()) {
+            refs_offset->push_back(offset);
+        } else if (size_in_bytes != 1 && size_in_bytes != 2 && size_in_bytes != 4 && size_in_bytes != 8) {
+            GnuAsmGenerator::MarkRefsInClass(down_cast<const ir::StructureModel>(val->type().model()), offset,
+                                             refs_offset);
+        }
+        writer_->AppendZero(data_, RoundUp(size_in_bytes, 4));
+        offset += RoundUp(size_in_bytes, 4);
+    }
+    return offset;
+}
+
+void ObjectFileGenerator::EmitMetadata() {
+    // See `GnuAsmGenerator::EmitMetadata()' for layout of `struct yalx_class'
+    for (auto clazz : module_->structures()) {
+        std::string buf;
+        Linkage::Build(&buf, clazz->full_name()->ToSlice());
+        const auto prefix_size = buf.size();
+        auto name_of = [&buf, prefix_size](const char *postfix) {
+            buf.resize(prefix_size);
+            return buf.append(postfix);
+        };
+
+        writer_->DefineSymbolHere(name_of("$class"), data_, true/*global*/);
+        writer_->Append<uint64_t>(data_, 0/*TODO:class_id*/); // id
+        writer_->Append<uint8_t>(data_, GnuAsmGenerator::DeclarationToKind(clazz)); // constraint
+        writer_->Append<uint8_t>(data_, clazz->IsCompactEnum()); // compact enum
+        writer_->AppendZero(data_, 2); // padding
+        writer_->Append<int32_t>(data_, clazz->ReferenceSizeInBytes()); // reference_size
+        writer_->Append<int32_t>(data_, clazz->PlacementSizeInBytes()); // instance_size
+        writer_->AppendZero(data_, 4); // padding
+        if (clazz->base_of()) {
+            std::string base_name;
+            Linkage::Build(&base_name, clazz->base_of()->full_name()->ToSlice());
+            base_name.append("$class");
+            EmitAddress(base_name); // super
+        } else {
+            writer_->Append<uint64_t>(data_, 0); // super
+        }
+        EmitStringHeader(clazz->name()); // name
+        EmitStringHeader(clazz->full_name()); // location
+        writer_->Append<uint32_t>(data_, 0/*TODO*/); // n_annotations
+        writer_->AppendZero(data_, 4); // padding
+        writer_->Append<uint64_t>(data_, 0); // reserved0
+        writer_->Append<uint32_t>(data_, clazz->fields_size()); // n_fields
+        writer_->AppendZero(data_, 4); // padding
+        if (clazz->fields().empty()) {
+            writer_->Append<uint64_t>(data_, 0); // fields
+        } else {
+            EmitAddress(name_of("$fields"));
+        }
+        if (!clazz->constructor()) {
+            writer_->Append<uint64_t>(data_, 0); // ctor
+        } else {
+            EmitAddress(name_of("$ctor"));
+        }
+        writer_->Append<uint32_t>(data_, clazz->methods_size()); // n_methods
+        writer_->AppendZero(data_, 4); // padding
+        if (clazz->methods().empty()) {
+            writer_->Append<uint64_t>(data_, 0); // methods
+        } else {
+            EmitAddress(name_of("$methods"));
+        }
+        writer_->Append<uint32_t>(data_, clazz->vtab().size()); // n_vtab
+        writer_->Append<uint32_t>(data_, clazz->itab().size()); // n_itab
+        if (clazz->vtab().empty()) {
+            writer_->Append<uint64_t>(data_, 0); // vtab
+        } else {
+            EmitAddress(name_of("$vtab"));
+        }
+        if (clazz->itab().empty()) {
+            writer_->Append<uint64_t>(data_, 0); // itab
+        } else {
+            EmitAddress(name_of("$itab"));
+        }
+        writer_->Append<uint32_t>(data_, clazz->refs_marks_size()); // refs_mark_len
+        writer_->AppendZero(data_, 4);
+        for (auto mark : clazz->refs_marks()) {
+            EmitTypeRelocation(mark.ty);
+            writer_->Append<int32_t>(data_, static_cast<int32_t>(mark.offset));
+        }
+
+        if (!clazz->fields().empty()) {
+            writer_->DefineSymbolHere(name_of("$fields"), data_, false/*global*/);
+        }
+        for (size_t i = 0; i < clazz->fields_size(); i++) {
+            const auto &field = clazz->fields()[i];
+            writer_->Append<int32_t>(data_, GnuAsmGenerator::CompactFieldCode(clazz, i)); // access|constraint
+            writer_->Append<uint32_t>(data_, 0); // n_annotations
+            writer_->Append<uint64_t>(data_, 0); // reserved0
+            EmitStringHeader(field.name); // name
+            EmitTypeRelocation(field.type); // type
+            writer_->Append<uint32_t>(data_, field.offset); // offset_of_head
+            writer_->AppendZero(data_, 4); // padding
+        }
+
+        if (!clazz->methods().empty()) {
+            writer_->DefineSymbolHere(name_of("$methods"), data_, false/*global*/);
+        }
+        auto method_index = 0;
+        for (auto method : clazz->methods()) {
+            if (method.fun == clazz->constructor()) {
+                writer_->DefineSymbolHere(name_of("$ctor"), data_, false/*global*/);
+            }
+            writer_->Append<uint32_t>(data_, method_index++); // index
+            writer_->Append<uint32_t>(data_, 0); // access|is_native|is_override|... TODO:
+            writer_->Append<uint32_t>(data_, 0); // n_annotations
+            writer_->AppendZero(data_, 4); // padding
+            writer_->Append<uint64_t>(data_, 0); // reserved0
+            EmitStringHeader(method.fun->name()); // name
+            EmitStringHeader(method.fun->prototype()->name()); // prototype_desc
+            std::string symbol;
+            Linkage::Build(&symbol, method.fun->full_name()->ToSlice());
+            EmitAddress(symbol); // entry
+        }
+
+        if (!clazz->vtab().empty()) {
+            writer_->DefineSymbolHere(name_of("$vtab"), data_, false/*global*/);
+        }
+        for (auto handle : clazz->vtab()) {
+            auto method = std::get<const ir::Model::Method *>(handle->owns()->GetMember(handle));
+            EmitAddress(symbols_->Mangle(method->fun->full_name())->ToSlice());
+        }
+
+        if (!clazz->itab().empty()) {
+            writer_->DefineSymbolHere(name_of("$itab"), data_, false/*global*/);
+        }
+        for (auto handle : clazz->itab()) {
+            auto method = std::get<const ir::Model::Method *>(handle->owns()->GetMember(handle));
+            EmitAddress(symbols_->Mangle(method->fun->full_name())->ToSlice());
+        }
+    }
+}
+
+void ObjectFileGenerator::EmitTypeRelocation(const ir::Type &ty) {
+    std::string symbol;
+    int offset = 0;
+    if (GnuAsmGenerator::ClassSymbolOf(ty, &symbol, &offset)) {
+        EmitAddress(symbol, offset);
+    } else {
+        writer_->Append<uint64_t>(data_, 0);
+    }
+}
+
+void ObjectFileGenerator::EmitAddress(std::string_view symbol, int64_t addend) {
+    writer_->AppendAbsolute64(data_, symbol, addend);
+}
+
+// struct yalx_str {
+//     const char *z;
+//     uint32_t n;
+// };
+void ObjectFileGenerator::EmitStringHeader(const base::ArenaString *str) {
+    auto kid = const_pool_->FindOrInsertString(str);
+    EmitAddress(base::Sprintf("Lkzs.%d", kid));
+    writer_->Append<uint32_t>(data_, str->size());
+    writer_->AppendZero(data_, 4); // padding
+}
+
+void ObjectFileGenerator::EmitNumberConstants() {
+    auto section = writer_->FindOrInsertSection(kConstSectionName, ElfObjectWriter::kReadOnly, 16);
+    for (const auto &[slot, id] : const_pool_->numbers()) {
+        size_t size = 0;
+        switch (slot.kind) {
+            case MachineRepresentation::kWord8:
+                size = 1;
+                break;
+            case MachineRepresentation::kWord16:
+                size = 2;
+                break;
+            case MachineRepresentation::kWord32:
+            case MachineRepresentation::kFloat32:
+                size = 4;
+                break;
+            case MachineRepresentation::kWord64:
+            case MachineRepresentation::kFloat64:
+                size = 8;
+                break;
+            default:
+                UNREACHABLE();
+                break;
+        }
+        writer_->Align(section, size);
+        writer_->DefineSymbolHere(base::Sprintf("Knnn.%d", id), section, false/*global*/);
+        writer_->mutable_data(section)->append(reinterpret_cast<const char *>(slot.data), size);
+    }
+}
+
+void ObjectFileGenerator::EmitStringConstants() {
+    auto symbol = symbols_->Mangle(module_->full_name());
+    const auto n = const_pool_->string_pool().size();
+    writer_->DefineSymbolHere(base::Sprintf("%s_Lksz", symbol->data()), data_, true/*global*/);
+    writer_->Append<uint32_t>(data_, n);
+    writer_->Append<uint32_t>(data_, 0); // padding for struct lksz_header
+    for (size_t i = 0; i < n; i++) {
+        EmitAddress(base::Sprintf("Lkzs.%zd", i));
+    }
+
+    writer_->DefineSymbolHere(base::Sprintf("%s_Kstr", symbol->data()), data_, true/*global*/);
+    writer_->Append<uint32_t>(data_, n);
+    writer_->Append<uint32_t>(data_, 0); // padding for struct kstr_header
+    for (size_t i = 0; i < n; i++) {
+        writer_->DefineSymbolHere(base::Sprintf("Kstr.%zd", i), data_, false/*global*/);
+        writer_->Append<uint64_t>(data_, 0);
+    }
+}
+
+void ObjectFileGenerator::EmitPackageInitRecord() {
+    // See `GnuAsmGenerator::EmitPackageInitRecord()' for layout of `struct pkg_init_record'
+    auto symbol = symbols_->Mangle(module_->full_name());
+    const bool has_kstr = !const_pool_->string_pool().empty();
+    writer_->Align(data_, 8);
+    writer_->DefineSymbolHere(base::Sprintf("%s$pkg", symbol->data()), data_, true/*global*/);
+    writer_->Append<uint32_t>(data_, 0); // state
+    writer_->Append<uint32_t>(data_, 0); // reserved0
+    writer_->Append<uint64_t>(data_, 0); // owner
+    EmitAddress("Lpkg.name"); // name
+    if (has_kstr) {
+        EmitAddress(base::Sprintf("%s_Lksz", symbol->data())); // lksz
+        EmitAddress(base::Sprintf("%s_Kstr", symbol->data())); // kstr
+    } else {
+        writer_->AppendZero(data_, 16);
+    }
+    EmitAddress(base::Sprintf("%s$global_slots", symbol->data())); // global_slots
+    writer_->Append<uint64_t>(data_, 0); // next
+
+    // Registration for runtime: no symbol lookup needed
+    auto pkgs = writer_->FindOrInsertSection(kPkgsSectionName, ElfObjectWriter::kData, 8);
+    writer_->AppendAbsolute64(pkgs, base::Sprintf("%s$pkg", symbol->data()));
+
+    // Name is only a C string, not in the string pool
+    auto cstring = writer_->FindOrInsertSection(kCStringSectionName, ElfObjectWriter::kReadOnly, 1);
+    writer_->DefineSymbolHere("Lpkg.name", cstring, false/*global*/);
+    writer_->mutable_data(cstring)->append(module_->full_name()->data(), module_->full_name()->size());
+    writer_->AppendZero(cstring, 1);
+}
+
+void ObjectFileGenerator::EmitProfileRecords(const std::vector<InstructionFunction *> &profiled) {
+    // See `GnuAsmGenerator::EmitProfileRecords()' for layout of `struct yalx_profile_record'
+    writer_->Align(data_, 8);
+    for (auto fun : profiled) {
+        auto ir_fun = fun->frame()->fun();
+        auto symbol = fun->symbol()->data();
+        auto counters = symbols_->MangleProfileCounters(fun->symbol());
+        writer_->DefineSymbolHere(counters->ToSlice(), data_, false/*global*/);
+        writer_->AppendZero(data_, ir_fun->profile_counters() * 8);
+        if (ir_fun->profile_sites() > 0) {
+            writer_->DefineSymbolHere(base::Sprintf("%s$sites", symbol), data_, false/*global*/);
+            writer_->AppendZero(data_, ir_fun->profile_sites() * GnuAsmGenerator::kProfileSiteSizeInBytes);
+        }
+        writer_->DefineSymbolHere(base::Sprintf("%s$prof", symbol), data_, false/*global*/);
+        auto kid = const_pool_->FindOrInsertString(ir_fun->full_name());
+        EmitAddress(base::Sprintf("Lkzs.%d", kid)); // name
+        writer_->Append<uint64_t>(data_, ir_fun->profile_counters()); // n_counters
+        EmitAddress(counters->ToSlice()); // counters
+        writer_->Append<uint64_t>(data_, ir_fun->profile_sites()); // n_sites
+        if (ir_fun->profile_sites() > 0) {
+            EmitAddress(base::Sprintf("%s$sites", symbol)); // sites
+        } else {
+            writer_->Append<uint64_t>(data_, 0);
+        }
+    }
+
+    // Registration for runtime: written into the profile file at exit
+    auto prof = writer_->FindOrInsertSection(kProfSectionName, ElfObjectWriter::kData, 8);
+    for (auto fun : profiled) {
+        writer_->AppendAbsolute64(prof, base::Sprintf("%s$prof", fun->symbol()->data()));
+    }
+}
+
+} // namespace yalx::backend
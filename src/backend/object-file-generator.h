@@ -0,0 +1,75 @@
+#pragma once
+#ifndef YALX_BACKEND_OBJECT_FILE_GENERATOR_H_
+#define YALX_BACKEND_OBJECT_FILE_GENERATOR_H_
+
+#include "base/arena-utils.h"
+
+namespace yalx {
+namespace ir {
+class Module;
+class Type;
+} // namespace ir
+namespace backend {
+
+class ConstantsPool;
+class ElfObjectWriter;
+class Linkage;
+class InstructionFunction;
+class RegistersConfiguration;
+
+// Emit the same contents as `GnuAsmGenerator' but straight into a relocatable object file: the functions are encoded
+// by the in-tree assemblers, the metadata, constants and package init record are written as bytes and relocations.
+class ObjectFileGenerator {
+public:
+    static constexpr const char kTextSectionName[] = ".text";
+    static constexpr const char kCStringSectionName[] = ".rodata.str";
+    static constexpr const char kConstSectionName[] = ".rodata";
+    static constexpr const char kDataSectionName[] = ".data";
+    static constexpr const char kPkgsSectionName[] = "yalx_pkgs";
+    static constexpr const char kProfSectionName[] = "yalx_prof";
+    static constexpr const char kEhFrameSectionName[] = ".eh_frame";
+
+    ObjectFileGenerator(const base::ArenaMap<std::string_view, InstructionFunction *> &funs,
+                        const RegistersConfiguration *profile,
+                        ir::Module *module,
+                        ConstantsPool *const_pool,
+                        Linkage *symbols,
+                        ElfObjectWriter *writer);
+    virtual ~ObjectFileGenerator();
+
+    DEF_PTR_GETTER(const RegistersConfiguration, profile);
+
+    void EmitAll();
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(ObjectFileGenerator);
+protected:
+    // Encode function into the text section
+    virtual void EmitFunction(InstructionFunction *) = 0;
+    // Describe frames of the encoded functions into the .eh_frame, runtime unwinds yalx frames by them.
+    virtual void EmitCallFrames() = 0;
+    void EmitNumberConstants();
+    void EmitStringConstants();
+    void EmitPackageInitRecord();
+    void EmitProfileRecords(const std::vector<InstructionFunction *> &profiled);
+    void EmitMetadata();
+    int EmitGlobalSlots(std::vector<int> *refs_offset);
+    void EmitTypeRelocation(const ir::Type &ty);
+    void EmitAddress(std::string_view symbol, int64_t addend = 0);
+    void EmitStringHeader(const base::ArenaString *str);
+
+    int text();
+
+    const base::ArenaMap<std::string_view, InstructionFunction *> &funs_;
+    const RegistersConfiguration *const profile_;
+    ir::Module *const module_;
+    ConstantsPool *const const_pool_;
+    Linkage *const symbols_;
+    ElfObjectWriter *const writer_;
+    int text_ = -1;
+    int data_ = -1;
+}; // class ObjectFileGenerator
+
+} // namespace backend
+} // namespace yalx
+
+#endif // YALX_BACKEND_OBJECT_FILE_GENERATOR_H_
@@ -0,0 +1,250 @@
+#include "backend/peephole-optimizer.h"
+#include "backend/move-resolver.h"
+#include "backend/registers-configuration.h"
+#include <algorithm>
+
+namespace yalx::backend {
+
+PeepholeOptimizer::PeepholeOptimizer(base::Arena *arena, const RegistersConfiguration *regconf)
+: arena_(arena)
+, regconf_(regconf) {
+}
+
+void PeepholeOptimizer::Run(InstructionFunction *fun) {
+    for (size_t i = 0; i < fun->blocks_size(); i++) {
+        auto next = i + 1 < fun->blocks_size() ? fun->block(i + 1) : nullptr;
+        VisitBlock(fun->block(i), next);
+    }
+}
+
+void PeepholeOptimizer::VisitBlock(InstructionBlock *block, InstructionBlock *next) {
+    values_.clear();
+    for (auto instr : block->instructions()) {
+        VisitParallelMove(instr->mutable_parallel_move(Instruction::kStart));
+        VisitInstruction(instr);
+        if (instr->is_jumping_dest()) {
+            // The label of jumping in the block is in front of the moves after instruction.
+            values_.clear();
+        }
+        VisitParallelMove(instr->mutable_parallel_move(Instruction::kEnd));
+    }
+
+    for (size_t i = 0; i < block->instructions_size(); i++) {
+        while (Combine(block, i)) {
+            // Combine again, the new one may be combined with the next one.
+        }
+    }
+
+    RemoveJumpingToNext(block, next);
+}
+
+void PeepholeOptimizer::VisitParallelMove(ParallelMove *moves) {
+    if (!moves) {
+        return;
+    }
+    // After allocation moves are emitted one by one, so visit them in order.
+    auto iter = moves->mutable_moves()->begin();
+    while (iter != moves->mutable_moves()->end()) {
+        auto move = *iter;
+        auto dest = move->dest().AsAllocated();
+        auto src = move->src().AsAllocated();
+        if (!dest) {
+            iter++;
+            continue;
+        }
+        if (!src || move->should_load_address()) {
+            Kill(*dest);
+            iter++;
+            continue;
+        }
+
+        if (src->IsMemoryLocation()) {
+            if (auto holding = FindRegisterHolding(*src)) {
+                *move->mutable_src() = *holding;
+                src = move->src().AsAllocated();
+                forwarded_moves_++;
+            }
+        }
+        auto number = ValueNumberOf(*src);
+        if (src->Equals(dest) || (number >= 0 && number == ValueNumberOf(*dest) &&
+                                  src->machine_representation() == dest->machine_representation())) {
+            iter = moves->mutable_moves()->erase(iter);
+            removed_moves_++;
+            continue;
+        }
+
+        if (number < 0) {
+            number = next_value_number_++;
+            values_.push_back({*src, number});
+        }
+        Kill(*dest);
+        if (src->machine_representation() != dest->machine_representation() ||
+            MoveResolver::IsReading(*src, *dest)) {
+            number = next_value_number_++;
+        }
+        values_.push_back({*dest, number});
+        iter++;
+    }
+}
+
+void PeepholeOptimizer::VisitInstruction(Instruction *instr) {
+    if (!IsWritingOutputsOnly(instr)) {
+        values_.clear();
+        return;
+    }
+    for (size_t i = 0; i < instr->outputs_count(); i++) {
+        if (auto opd = instr->OutputAt(i)->AsAllocated()) {
+            Kill(*opd);
+        }
+    }
+    for (size_t i = 0; i < instr->temps_count(); i++) {
+        if (auto opd = instr->TempAt(i)->AsAllocated()) {
+            Kill(*opd);
+        }
+    }
+}
+
+bool PeepholeOptimizer::RemoveJumpingToNext(InstructionBlock *block, InstructionBlock *next) {
+    // Never falls through to the other text section.
+    if (!next || next->cold() != block->cold() || block->instructions().empty()) {
+        return false;
+    }
+    auto jmp = block->instructions().back();
+    if (jmp->op() != ArchJmp || jmp->is_jumping_dest()) {
+        return false;
+    }
+    auto label = jmp->InputAt(0)->AsReloaction();
+    if (!label || label->label() != next) {
+        return false;
+    }
+    if (auto moves = jmp->parallel_move(Instruction::kEnd); moves && !moves->moves().empty()) {
+        return false;
+    }
+    if (auto moves = jmp->mutable_parallel_move(Instruction::kStart); moves && !moves->moves().empty()) {
+        if (block->instructions_size() < 2) {
+            return false;
+        }
+        // Moves before jumping go to after the prev instruction.
+        auto prev = block->instruction(block->instructions_size() - 2);
+        auto into = prev->GetOrNewParallelMove(Instruction::kEnd, arena_);
+        for (auto move : moves->moves()) {
+            into->mutable_moves()->push_back(move);
+        }
+    }
+    block->mutable_instructions()->pop_back();
+    removed_jumps_++;
+    return true;
+}
+
+int PeepholeOptimizer::ValueNumberOf(const AllocatedOperand &opd) const {
+    for (const auto &value : values_) {
+        if (value.location.Equals(&opd)) {
+            return value.number;
+        }
+    }
+    return -1;
+}
+
+const AllocatedOperand *PeepholeOptimizer::FindRegisterHolding(const AllocatedOperand &opd) const {
+    auto number = ValueNumberOf(opd);
+    if (number < 0) {
+        return nullptr;
+    }
+    for (const auto &value : values_) {
+        if (value.number == number && value.location.IsRegisterLocation() &&
+            value.location.machine_representation() == opd.machine_representation()) {
+            return &value.location;
+        }
+    }
+    return nullptr;
+}
+
+void PeepholeOptimizer::Kill(const AllocatedOperand &opd) {
+    auto fp = regconf_->fp();
+    // Frame slots may be addressed by any other pointer, but nothing but the frame slots are addressed by `fp'.
+    auto aliasing = [fp, &opd](const AllocatedOperand &other) {
+        if (MoveResolver::IsReading(other, opd)) {
+            return true;
+        }
+        return opd.IsMemoryLocation() && other.IsMemoryLocation() &&
+               (opd.register_id() != fp || other.register_id() != fp);
+    };
+    values_.erase(std::remove_if(values_.begin(), values_.end(), [&aliasing](const Value &value) {
+        return aliasing(value.location);
+    }), values_.end());
+}
+
+bool PeepholeOptimizer::IsWritingOutputsOnly(Instruction *instr) const {
+    switch (instr->op()) {
+        case ArchNop:
+        case ArchDebugBreak:
+        case ArchStackLoad:
+        case ArchLoadEffectAddress:
+        case ArchLoadRelocation:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void PeepholeOptimizer::Replace(InstructionBlock *block, size_t position, size_t n, Instruction *instr) {
+    DCHECK(n > 0 && position + n <= block->instructions_size());
+    auto first = block->instruction(position);
+    auto last = block->instruction(position + n - 1);
+    if (auto moves = first->mutable_parallel_move(Instruction::kStart)) {
+        for (auto move : moves->moves()) {
+            instr->GetOrNewParallelMove(Instruction::kStart, arena_)->mutable_moves()->push_back(move);
+        }
+    }
+    if (auto moves = last->mutable_parallel_move(Instruction::kEnd)) {
+        for (auto move : moves->moves()) {
+            instr->GetOrNewParallelMove(Instruction::kEnd, arena_)->mutable_moves()->push_back(move);
+        }
+    }
+    instr->set_id(first->id());
+
+    auto instrs = block->mutable_instructions();
+    instrs->erase(instrs->begin() + static_cast<ptrdiff_t>(position),
+                  instrs->begin() + static_cast<ptrdiff_t>(position + n));
+    instrs->insert(instrs->begin() + static_cast<ptrdiff_t>(position), instr);
+    combined_instructions_++;
+}
+
+Instruction *PeepholeOptimizer::NewInstruction(Instruction::Code op,
+                                               size_t outputs_count,
+                                               InstructionOperand outputs[],
+                                               size_t inputs_count,
+                                               InstructionOperand inputs[]) {
+    return Instruction::New(arena_, op, inputs_count, inputs, outputs_count, outputs, 0, nullptr);
+}
+
+bool PeepholeOptimizer::IsAdjacent(Instruction *instr, Instruction *next) {
+    if (!instr || !next || instr->is_jumping_dest() || next->is_jumping_dest()) {
+        return false;
+    }
+    auto after = instr->parallel_move(Instruction::kEnd);
+    auto before = next->parallel_move(Instruction::kStart);
+    return (!after || after->moves().empty()) && (!before || before->moves().empty());
+}
+
+bool PeepholeOptimizer::GetImmediate32(InstructionOperand *opd, int32_t *value) {
+    auto imm = opd->AsImmediate();
+    if (!imm) {
+        return false;
+    }
+    switch (imm->machine_representation()) {
+        case MachineRepresentation::kWord8:
+            *value = imm->word8_value();
+            return true;
+        case MachineRepresentation::kWord16:
+            *value = imm->word16_value();
+            return true;
+        case MachineRepresentation::kWord32:
+            *value = imm->word32_value();
+            return true;
+        default:
+            return false;
+    }
+}
+
+} // namespace yalx::backend
@@ -0,0 +1,101 @@
+#pragma once
+#ifndef YALX_BACKEND_PEEPHOLE_OPTIMIZER_H_
+#define YALX_BACKEND_PEEPHOLE_OPTIMIZER_H_
+
+#include "backend/instruction.h"
+#include "base/base.h"
+#include <vector>
+
+namespace yalx::base {
+class Arena;
+}
+
+namespace yalx::backend {
+
+class RegistersConfiguration;
+
+// Local clean-ups on allocated instructions, runs after register (or slot) allocation and before code generation:
+// * Remove identity moves and moves of a value into a location which already holds it;
+// * Forward a value reloaded from a slot from the register which stored it, e.g.
+//       movl %eax, -4(%rbp)             movl %eax, -4(%rbp)
+//       movl -4(%rbp), %r13d      =>    movl %eax, 28(%rbp)
+//       movl %r13d, 28(%rbp)
+// * Remove a jump to the next block of the layout;
+// * Combine neighbour instructions into target specific forms, see `Combine'.
+// Values are tracked in one block only, and forgot at every call or unknown side-effect instruction.
+class PeepholeOptimizer {
+public:
+    PeepholeOptimizer(base::Arena *arena, const RegistersConfiguration *regconf);
+    virtual ~PeepholeOptimizer() = default;
+
+    void Run(InstructionFunction *fun);
+
+    DEF_VAL_GETTER(int, removed_moves);
+    DEF_VAL_GETTER(int, forwarded_moves);
+    DEF_VAL_GETTER(int, removed_jumps);
+    DEF_VAL_GETTER(int, combined_instructions);
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(PeepholeOptimizer);
+protected:
+    // Try to combine the instructions start at `position' of `block' into a cheaper form, returns true if any
+    // instruction has been replaced.
+    virtual bool Combine(InstructionBlock *block, size_t position) { return false; }
+
+    // Does `instr' only write its outputs and temps (and flags)?
+    // Any other instruction forget all of values tracked.
+    virtual bool IsWritingOutputsOnly(Instruction *instr) const;
+
+    // Replace `n' instructions start at `position' of block by `instr', and keep the moves before the first and after
+    // the last one.
+    void Replace(InstructionBlock *block, size_t position, size_t n, Instruction *instr);
+
+    Instruction *NewInstruction(Instruction::Code op,
+                                size_t outputs_count,
+                                InstructionOperand outputs[],
+                                size_t inputs_count,
+                                InstructionOperand inputs[]);
+
+    static Instruction *InstructionAt(InstructionBlock *block, size_t position) {
+        return position < block->instructions_size() ? block->instruction(position) : nullptr;
+    }
+
+    // No moves between `instr' and `next', and no jumping label in front of `next'.
+    static bool IsAdjacent(Instruction *instr, Instruction *next);
+
+    static bool GetImmediate32(InstructionOperand *opd, int32_t *value);
+
+    base::Arena *arena() const { return arena_; }
+    const RegistersConfiguration *regconf() const { return regconf_; }
+
+private:
+    // Locations hold the same value have the same number.
+    struct Value {
+        AllocatedOperand location;
+        int number;
+    };
+
+    void VisitBlock(InstructionBlock *block, InstructionBlock *next);
+    void VisitParallelMove(ParallelMove *moves);
+    void VisitInstruction(Instruction *instr);
+    bool RemoveJumpingToNext(InstructionBlock *block, InstructionBlock *next);
+
+    // Number of value in `opd', -1 if unknown.
+    int ValueNumberOf(const AllocatedOperand &opd) const;
+    // A register holds the same value as `opd', nullptr if not found.
+    const AllocatedOperand *FindRegisterHolding(const AllocatedOperand &opd) const;
+    // `opd' has been written, forget values of locations which might read it.
+    void Kill(const AllocatedOperand &opd);
+
+    base::Arena *const arena_;
+    const RegistersConfiguration *const regconf_;
+    std::vector<Value> values_;
+    int next_value_number_ = 0;
+    int removed_moves_ = 0;
+    int forwarded_moves_ = 0;
+    int removed_jumps_ = 0;
+    int combined_instructions_ = 0;
+}; // class PeepholeOptimizer
+
+} // namespace yalx::backend
+
+#endif // YALX_BACKEND_PEEPHOLE_OPTIMIZER_H_
@@ -0,0 +1,407 @@
+#include "backend/register-allocator.h"
+#include "backend/registers-configuration.h"
+#include "backend/instruction.h"
+#include "backend/frame.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/operators-factory.h"
+#include "ir/base-test.h"
+#include <gtest/gtest.h>
+#include <map>
+
+namespace yalx::backend {
+
+class RegisterAllocatorTest : public ir::ModuleTest {
+public:
+    void SetUp() override {
+        ir::ModuleTest::SetUp();
+        fun_ = NewFun("main", {}, {});
+    }
+
+    // Synthetic function: chain of diamonds, every block computes `n' values from the previous two and few
+    // long-living values of entry block.
+    //
+    //  entry -> head -> left  -> join(head) -> ...
+    //               \-> right -/
+    InstructionFunction *NewDiamonds(int diamonds, int n) {
+        auto frame = new (arena()) Frame(arena(), fun_);
+        auto fun = new (arena()) InstructionFunction(arena(), String::New(arena(), "foo"), frame);
+        int label = 0;
+        auto entry = fun->NewBlock(label++);
+        fun->set_entry(entry);
+
+        std::vector<int> longs;
+        for (int i = 0; i < kLongLiving; i++) {
+            longs.push_back(NewVR(frame));
+            UnallocatedOperand output(UnallocatedOperand::kRegisterOrSlot, longs.back());
+            entry->Add(Instruction::New(arena(), ArchNop, 0, nullptr, 1, &output, 0, nullptr));
+        }
+        int a = longs[0], b = longs[1];
+        auto prev = entry;
+        for (int i = 0; i < diamonds; i++) {
+            auto head = fun->NewBlock(label++);
+            auto left = fun->NewBlock(label++);
+            auto right = fun->NewBlock(label++);
+            auto join = fun->NewBlock(label++);
+            Link(prev, head);
+            Link(head, left);
+            Link(head, right);
+            Link(left, join);
+            Link(right, join);
+
+            EmitValues(frame, head, longs, n, &a, &b);
+            int la = a, lb = b;
+            EmitValues(frame, left, longs, n, &la, &lb);
+            la = a, lb = b;
+            EmitValues(frame, right, longs, n, &la, &lb);
+            EmitValues(frame, join, longs, n, &a, &b);
+            prev = join;
+        }
+        for (auto vr : longs) {
+            UnallocatedOperand input(UnallocatedOperand::kRegisterOrSlot, vr);
+            prev->Add(Instruction::New(arena(), ArchNop, 1, &input, 0, nullptr, 0, nullptr));
+        }
+        return fun;
+    }
+
+    void EmitValues(Frame *frame, InstructionBlock *block, const std::vector<int> &longs, int n, int *a, int *b) {
+        for (int i = 0; i < n; i++) {
+            InstructionOperand inputs[2];
+            inputs[0] = UnallocatedOperand(UnallocatedOperand::kMustHaveRegister, *a);
+            inputs[1] = UnallocatedOperand(UnallocatedOperand::kRegisterOrSlot,
+                                           i % 8 == 0 ? longs[(i / 8) % longs.size()] : *b);
+            UnallocatedOperand output(UnallocatedOperand::kMustHaveRegister, NewVR(frame));
+            block->Add(Instruction::New(arena(), ArchNop, 2, inputs, 1, &output, 0, nullptr));
+            *b = *a;
+            *a = output.virtual_register();
+        }
+    }
+
+    int NewVR(Frame *frame) {
+        auto value = ir::Value::New(arena(), ir::SourcePosition::Unknown(), ir::Types::Int32, ops()->Argument(0));
+        return frame->GetVirtualRegister(value);
+    }
+
+    static void Link(InstructionBlock *from, InstructionBlock *to) {
+        from->AddSuccessor(to);
+        to->AddPredecessors(from);
+    }
+
+    static size_t CountInstructions(InstructionFunction *fun) {
+        size_t n = 0;
+        for (auto block : fun->blocks()) { n += block->instructions_size(); }
+        return n;
+    }
+
+    static bool AllAllocated(InstructionFunction *fun) {
+        for (auto block : fun->blocks()) {
+            for (auto instr : block->instructions()) {
+                for (int i = 0; i < instr->operands_size(); i++) {
+                    if (instr->OperandAt(i)->IsUnallocated()) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    // Values define `n' values, then use them in reverse order, so all of them are live at the same time.
+    void EmitPressure(Frame *frame, InstructionBlock *block, int n) {
+        std::vector<int> values;
+        for (int i = 0; i < n; i++) {
+            UnallocatedOperand output(UnallocatedOperand::kMustHaveRegister, NewVR(frame));
+            block->Add(Instruction::New(arena(), ArchNop, 0, nullptr, 1, &output, 0, nullptr));
+            values.push_back(output.virtual_register());
+        }
+        for (auto iter = values.rbegin(); iter != values.rend(); iter++) {
+            UnallocatedOperand input(UnallocatedOperand::kMustHaveRegister, *iter);
+            block->Add(Instruction::New(arena(), ArchNop, 1, &input, 0, nullptr, 0, nullptr));
+        }
+    }
+
+    InstructionFunction *NewFunction() {
+        auto frame = new (arena()) Frame(arena(), fun_);
+        return new (arena()) InstructionFunction(arena(), String::New(arena(), "foo"), frame);
+    }
+
+    // Record virtual registers of operands before allocation, then run the allocated code along the `path',
+    // every operand must hold the value of its virtual register.
+    void Record(InstructionFunction *fun) {
+        for (auto block : fun->blocks()) {
+            for (auto instr : block->instructions()) {
+                for (int i = 0; i < instr->operands_size(); i++) {
+                    if (auto opd = instr->OperandAt(i)->AsUnallocated()) {
+                        expected_[instr->OperandAt(i)] = opd->virtual_register();
+                    }
+                }
+                for (int i = 0; i < 2; i++) {
+                    if (auto moves = instr->parallel_move(static_cast<Instruction::GapPosition>(i))) {
+                        for (auto opds : moves->moves()) {
+                            if (auto opd = opds->src().AsUnallocated()) {
+                                expected_[&opds->src()] = opd->virtual_register();
+                            }
+                            if (auto opd = opds->dest().AsUnallocated(); opd && opds->src().IsImmediate()) {
+                                constants_[opd->virtual_register()] = opds->src().AsImmediate()->word32_value();
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    int64_t ValueOf(int vr) const {
+        auto iter = constants_.find(vr);
+        return iter == constants_.end() ? 1000000 + vr : iter->second;
+    }
+
+    static std::string KeyOf(const InstructionOperand &opd) {
+        auto allocated = opd.AsAllocated();
+        if (allocated->IsRegisterLocation()) {
+            return (allocated->machine_representation() == MachineRepresentation::kFloat64 ? "f" : "r") +
+                   std::to_string(allocated->register_id());
+        }
+        return "m" + std::to_string(allocated->register_id()) + ":" + std::to_string(allocated->index());
+    }
+
+    int64_t Read(const std::map<std::string, int64_t> &locations, const InstructionOperand &opd) const {
+        if (opd.IsImmediate()) {
+            return opd.AsImmediate()->word32_value();
+        }
+        auto iter = locations.find(KeyOf(opd));
+        return iter == locations.end() ? -1 : iter->second;
+    }
+
+    void Simulate(const std::vector<InstructionBlock *> &path) {
+        std::map<std::string, int64_t> locations;
+        auto check = [&](const InstructionOperand *opd) {
+            if (auto iter = expected_.find(opd); iter != expected_.end()) {
+                EXPECT_EQ(ValueOf(iter->second), Read(locations, *opd)) << "v" << iter->second;
+            }
+        };
+        auto run_moves = [&](const ParallelMove *moves) {
+            if (!moves) {
+                return;
+            }
+            for (auto opds : moves->moves()) {
+                check(&opds->src());
+                locations[KeyOf(opds->dest())] = Read(locations, opds->src());
+            }
+        };
+        for (auto block : path) {
+            for (auto instr : block->instructions()) {
+                run_moves(instr->parallel_move(Instruction::kStart));
+                for (int i = 0; i < instr->inputs_count(); i++) {
+                    check(instr->InputAt(i));
+                }
+                for (int i = 0; i < instr->outputs_count(); i++) {
+                    auto iter = expected_.find(instr->OutputAt(i));
+                    ASSERT_TRUE(iter != expected_.end());
+                    locations[KeyOf(*instr->OutputAt(i))] = ValueOf(iter->second);
+                }
+                run_moves(instr->parallel_move(Instruction::kEnd));
+            }
+        }
+    }
+
+    static size_t CountMoves(InstructionBlock *block) {
+        size_t n = 0;
+        for (auto instr : block->instructions()) {
+            for (int i = 0; i < 2; i++) {
+                if (auto moves = instr->parallel_move(static_cast<Instruction::GapPosition>(i))) {
+                    n += moves->moves_size();
+                }
+            }
+        }
+        return n;
+    }
+
+    static int CountSpilled(RegisterAllocator *allocator, int virtual_registers) {
+        int n = 0;
+        for (int vr = 0; vr < virtual_registers; vr++) {
+            auto interval = allocator->IntervalOf(vr);
+            auto spilled = interval->has_assigned_slot();
+            for (auto child : interval->split_children()) { spilled |= child->has_assigned_slot(); }
+            n += spilled;
+        }
+        return n;
+    }
+
+    static constexpr int kLongLiving = 4;
+protected:
+    std::map<const InstructionOperand *, int> expected_;
+    std::map<int, int64_t> constants_;
+    ir::Function *fun_ = nullptr;
+}; // class RegisterAllocatorTest
+
+TEST_F(RegisterAllocatorTest, Sanity) {
+    auto fun = NewDiamonds(1, 4);
+    RegisterAllocator allocator(arena(), RegistersConfiguration::OfPosixX64(), fun);
+    allocator.Run();
+    ASSERT_EQ(5, allocator.ordered_blocks_size());
+    EXPECT_EQ(fun->entry(), allocator.OrderedBlockAt(0));
+    EXPECT_EQ(fun->block(1), allocator.OrderedBlockAt(1));
+    EXPECT_EQ(fun->block(4), allocator.OrderedBlockAt(4));
+    EXPECT_TRUE(AllAllocated(fun));
+
+    // Long living values must be live out of every block.
+    for (int i = 0; i < allocator.ordered_blocks_size() - 1; i++) {
+        auto state = allocator.BlockLivenssStateOf(allocator.OrderedBlockAt(i));
+        for (int vr = 0; vr < kLongLiving; vr++) {
+            EXPECT_TRUE(state->DoesInLiveOut(vr)) << "block: " << i << " vr: " << vr;
+        }
+    }
+    auto join = allocator.BlockLivenssStateOf(fun->block(4));
+    EXPECT_TRUE(join->DoesInLiveIn(kLongLiving + 3)); // last value of head
+    EXPECT_TRUE(join->DoesNotInLiveIn(kLongLiving + 4)); // defined in left
+}
+
+TEST_F(RegisterAllocatorTest, LongLivingIntervals) {
+    auto fun = NewDiamonds(8, 16);
+    RegisterAllocator allocator(arena(), RegistersConfiguration::OfPosixX64(), fun);
+    allocator.Run();
+    EXPECT_TRUE(AllAllocated(fun));
+    for (int vr = 0; vr < kLongLiving; vr++) {
+        auto interval = allocator.IntervalOf(vr);
+        EXPECT_TRUE(interval->has_any_assinged());
+        EXPECT_EQ(vr * 2 + 2, interval->earliest_range().from); // ranges start at the definition
+        auto last = interval->ChildCovers(allocator.OrderedBlockAt(allocator.ordered_blocks_size() - 1)->GetLowerId());
+        ASSERT_TRUE(last != nullptr);
+        EXPECT_EQ(allocator.OrderedBlockAt(allocator.ordered_blocks_size() - 1)->GetLowerId() - 1,
+                  last->latest_range().from);
+    }
+}
+
+TEST_F(RegisterAllocatorTest, DiamondsDataFlow) {
+    auto fun = NewDiamonds(4, 24);
+    Record(fun);
+    RegisterAllocator allocator(arena(), RegistersConfiguration::OfPosixX64(), fun);
+    allocator.Run();
+    ASSERT_TRUE(AllAllocated(fun));
+    std::vector<InstructionBlock *> left{fun->entry()}, right{fun->entry()};
+    for (int i = 0; i < 4; i++) {
+        left.insert(left.end(), {fun->block(i * 4 + 1), fun->block(i * 4 + 2), fun->block(i * 4 + 4)});
+        right.insert(right.end(), {fun->block(i * 4 + 1), fun->block(i * 4 + 3), fun->block(i * 4 + 4)});
+    }
+    Simulate(left);
+    Simulate(right);
+}
+
+TEST_F(RegisterAllocatorTest, HighPressure) {
+    static constexpr int kValues = 24;
+    auto fun = NewFunction();
+    auto entry = fun->NewBlock(0);
+    fun->set_entry(entry);
+    EmitPressure(fun->frame(), entry, kValues);
+    Record(fun);
+    RegisterAllocator allocator(arena(), RegistersConfiguration::OfPosixX64(), fun);
+    allocator.Run();
+    ASSERT_TRUE(AllAllocated(fun));
+    Simulate({entry});
+    EXPECT_LT(0, CountSpilled(&allocator, kValues));
+}
+
+TEST_F(RegisterAllocatorTest, SpillSlotsReuse) {
+    static constexpr int kValues = 24;
+    auto fun = NewFunction();
+    auto entry = fun->NewBlock(0);
+    fun->set_entry(entry);
+    EmitPressure(fun->frame(), entry, kValues);
+    EmitPressure(fun->frame(), entry, kValues);
+    Record(fun);
+    RegisterAllocator allocator(arena(), RegistersConfiguration::OfPosixX64(), fun);
+    allocator.Run();
+    ASSERT_TRUE(AllAllocated(fun));
+    Simulate({entry});
+    auto spilled = CountSpilled(&allocator, kValues * 2);
+    EXPECT_LT(0, spilled);
+    // Values of two parts never live at the same time.
+    EXPECT_GE(spilled / 2, allocator.spill_slots_size());
+}
+
+TEST_F(RegisterAllocatorTest, SpillOutOfLoop) {
+    //  entry -> header -> body
+    //              \  <-/
+    //               \-> exit
+    static constexpr int kValues = 8;
+    auto fun = NewFunction();
+    auto frame = fun->frame();
+    auto entry = fun->NewBlock(0);
+    auto header = fun->NewBlock(1);
+    auto body = fun->NewBlock(2);
+    auto exit = fun->NewBlock(3);
+    fun->set_entry(entry);
+    Link(entry, header);
+    Link(header, body);
+    Link(header, exit);
+    Link(body, header);
+
+    std::vector<int> values;
+    for (int i = 0; i < kValues; i++) {
+        UnallocatedOperand output(UnallocatedOperand::kMustHaveRegister, NewVR(frame));
+        entry->Add(Instruction::New(arena(), ArchNop, 0, nullptr, 1, &output, 0, nullptr));
+        values.push_back(output.virtual_register());
+    }
+    header->Add(Instruction::New(arena(), ArchNop, 0, nullptr, 0, nullptr, 0, nullptr));
+    EmitPressure(frame, body, kValues);
+    for (auto vr : values) {
+        UnallocatedOperand input(UnallocatedOperand::kMustHaveRegister, vr);
+        exit->Add(Instruction::New(arena(), ArchNop, 1, &input, 0, nullptr, 0, nullptr));
+    }
+    Record(fun);
+    RegisterAllocator allocator(arena(), RegistersConfiguration::OfPosixX64(), fun);
+    allocator.Run();
+    ASSERT_TRUE(AllAllocated(fun));
+    EXPECT_EQ(1, header->loop_depth());
+    EXPECT_EQ(1, body->loop_depth());
+    EXPECT_EQ(0, exit->loop_depth());
+    EXPECT_LT(0, CountSpilled(&allocator, kValues));
+    // Spilling and reloading moves are out of the loop.
+    EXPECT_EQ(0, CountMoves(header));
+    EXPECT_EQ(0, CountMoves(body));
+    EXPECT_LT(0, CountMoves(entry));
+    Simulate({entry, header, body, header, body, header, exit});
+}
+
+TEST_F(RegisterAllocatorTest, Rematerialization) {
+    auto fun = NewFunction();
+    auto frame = fun->frame();
+    auto entry = fun->NewBlock(0);
+    fun->set_entry(entry);
+    UnallocatedOperand constant(UnallocatedOperand::kRegisterOrSlot, NewVR(frame));
+    auto def = Instruction::New(arena(), ArchNop, 0, nullptr, 0, nullptr, 0, nullptr);
+    def->GetOrNewParallelMove(Instruction::kStart, arena())->AddMove(constant, ImmediateOperand{42}, arena());
+    entry->Add(def);
+    EmitPressure(frame, entry, 24);
+    UnallocatedOperand use(UnallocatedOperand::kRegisterOrSlotOrConstant, constant.virtual_register());
+    auto last = Instruction::New(arena(), ArchNop, 1, &use, 0, nullptr, 0, nullptr);
+    entry->Add(last);
+    UnallocatedOperand reg_use(UnallocatedOperand::kMustHaveRegister, constant.virtual_register());
+    entry->Add(Instruction::New(arena(), ArchNop, 1, &reg_use, 0, nullptr, 0, nullptr));
+    Record(fun);
+    RegisterAllocator allocator(arena(), RegistersConfiguration::OfPosixX64(), fun);
+    allocator.Run();
+    ASSERT_TRUE(AllAllocated(fun));
+    Simulate({entry});
+
+    auto interval = allocator.IntervalOf(constant.virtual_register());
+    ASSERT_NE(nullptr, interval->rematerialization());
+    EXPECT_FALSE(interval->has_assigned_slot());
+    for (auto child : interval->split_children()) {
+        EXPECT_FALSE(child->has_assigned_slot());
+    }
+    ASSERT_TRUE(last->InputAt(0)->IsImmediate());
+    EXPECT_EQ(42, last->InputAt(0)->AsImmediate()->word32_value());
+}
+
+TEST_F(RegisterAllocatorTest, LargeFunction) {
+    // Timing of the same function is in yalx-bench.
+    auto fun = NewDiamonds(50, 50);
+    ASSERT_GE(CountInstructions(fun), 10000);
+    RegisterAllocator allocator(arena(), RegistersConfiguration::OfPosixX64(), fun);
+    allocator.Run();
+    EXPECT_TRUE(AllAllocated(fun));
+}
+
+} // namespace yalx::backend
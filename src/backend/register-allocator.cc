@@ -2,9 +2,11 @@
 #include "backend/registers-configuration.h"
 #include "backend/instruction.h"
 #include "backend/frame.h"
+#include "backend/move-resolver.h"
 #include "ir/metadata.h"
 #include "ir/type.h"
 #include "ir/node.h"
+#include <algorithm>
 #include <numeric>
 
 namespace yalx {
@@ -12,11 +14,10 @@ namespace yalx {
 namespace backend {
 
 void BlockLivenssState::Reset(size_t capacity) {
-    live_kill_.clear();
-    live_gen_.clear();
-    live_in_.clear();
-    live_out_.clear();
-    capacity_ = capacity;
+    live_kill_.Reset(capacity);
+    live_gen_.Reset(capacity);
+    live_in_.Reset(capacity);
+    live_out_.Reset(capacity);
 }
 
 LifetimeInterval::LifetimeInterval(int virtual_register, ir::Type type)
@@ -39,7 +40,7 @@ void LifetimeInterval::AddChild(LifetimeInterval *child, int pos) {
     child->split_parent_->split_children_.push_back(child);
     
     if (has_any_used()) {
-        while (use_positions_.front().position >= pos) {
+        while (!use_positions_.empty() && use_positions_.front().position >= pos) {
             child->use_positions_.push_back(use_positions_.front());
             use_positions_.erase(use_positions_.begin());
         }
@@ -48,7 +49,7 @@ void LifetimeInterval::AddChild(LifetimeInterval *child, int pos) {
     // [0, 4) [4, 10) [10, 20)
     //           6
     //
-    while (ranges_.front().to >= pos) {
+    while (!ranges_.empty() && ranges_.front().to > pos) {
         auto range = ranges_.front();
         if (range.from > pos) {
             child->ranges_.push_back(range);
@@ -67,6 +68,53 @@ void LifetimeInterval::AddChild(LifetimeInterval *child, int pos) {
         }
     }
     DCHECK(!child->ranges_.empty());
+    DCHECK(!ranges_.empty());
+}
+
+const LifetimeInterval *LifetimeInterval::ChildCovers(int position) const {
+    if (IsCovers(position)) {
+        return this;
+    }
+    for (auto child : split_children_) {
+        if (child->IsCovers(position)) {
+            return child;
+        }
+    }
+    return nullptr;
+}
+
+int LifetimeInterval::FindRegisterUseAfter(int pos) const {
+    auto constant = rematerialization() != nullptr;
+    for (int i = static_cast<int>(use_positions_.size()) - 1; i >= 0; i--) {
+        auto use = use_positions_[i];
+        // Moves of gap accept any location and constant
+        if (use.position < pos || (use.position & 1)) {
+            continue;
+        }
+        switch (static_cast<UnallocatedOperand::Policy>(use.use_kind)) {
+            case UnallocatedOperand::kMustHaveRegister:
+            case UnallocatedOperand::kFixedRegister:
+            case UnallocatedOperand::kFixedFPRegister:
+                return use.position;
+            case UnallocatedOperand::kRegisterOrSlot:
+                if (constant) {
+                    return use.position;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return std::numeric_limits<int>::max();
+}
+
+int LifetimeInterval::FindUsePositionBefore(int pos) const {
+    for (auto use : use_positions_) {
+        if (use.position < pos) {
+            return use.position;
+        }
+    }
+    return -1;
 }
 
 const LifetimeInterval *LifetimeInterval::ChildAt(int opid) const {
@@ -76,8 +124,10 @@ const LifetimeInterval *LifetimeInterval::ChildAt(int opid) const {
         }
     }
     for (auto child : split_children_) {
-        if (auto rs = child->ChildAt(opid)) {
-            return rs;
+        for (auto use : child->use_positions_) {
+            if (use.position == opid) {
+                return child;
+            }
         }
     }
     UNREACHABLE();
@@ -98,6 +148,8 @@ void RegisterAllocator::Run() {
     ComputeGlobalLiveSets();
     BuildIntervals();
     WalkIntervals();
+    AssignSpillSlots();
+    ResolveDataFlow();
     AssignRegisters();
 }
 
@@ -107,60 +159,93 @@ RegisterAllocator::~RegisterAllocator() {
 
 void RegisterAllocator::Prepare() {
     std::vector<bool> visited(fun_->blocks_size(), false);
-    ComputeBlocksLoop(&visited, fun_->entry());
+    std::vector<bool> on_stack(fun_->blocks_size(), false);
+    ComputeBlocksLoop(&visited, &on_stack, fun_->entry());
 }
 
-void RegisterAllocator::ComputeBlocksLoop(std::vector<bool> *visited, InstructionBlock *block) {
+void RegisterAllocator::ComputeBlocksLoop(std::vector<bool> *visited, std::vector<bool> *on_stack,
+                                          InstructionBlock *block) {
     DCHECK(block->id() >= 0 && block->id() < visited->size());
     (*visited)[block->id()] = true;
+    (*on_stack)[block->id()] = true;
     for (auto succ : block->successors()) {
-        if ((*visited)[succ->id()]) {
+        if ((*on_stack)[succ->id()]) {
+            // Only the back edge makes a loop, a visited merge block is not a loop header.
             succ->AddLoopEnd(block);
-        } else {
-            ComputeBlocksLoop(visited, succ);
+        } else if (!(*visited)[succ->id()]) {
+            ComputeBlocksLoop(visited, on_stack, succ);
         }
     }
+    (*on_stack)[block->id()] = false;
 }
 
 void RegisterAllocator::ComputeBlocksOrder() {
     std::deque<InstructionBlock *> work_list;
-    std::map<InstructionBlock *, int> incoming_forward_branchs;
+    std::vector<int> incoming_forward_branchs(fun_->blocks_size());
     for (auto block : fun_->blocks()) {
-        incoming_forward_branchs[block] = static_cast<int>(block->predecessors_size());
+        incoming_forward_branchs[block->id()] = static_cast<int>(block->predecessors_size() -
+                                                                 block->loop_end_nodes_size());
     }
+    blocks_order_.resize(fun_->blocks_size(), -1);
     work_list.push_back(fun_->entry());
     
     while (!work_list.empty()) {
         auto block = work_list.front();
         work_list.pop_front();
-        auto iter = std::find(blocks_.begin(), blocks_.end(), block);
-        if (iter == blocks_.end()) {
-            blocks_.push_back(block);
+        if (blocks_order_[block->id()] >= 0) {
+            continue; // Reached by the back edge
         }
+        blocks_order_[block->id()] = static_cast<int>(blocks_.size());
+        blocks_.push_back(block);
         
         if (block->successors_size() == 1) {
             auto succ = block->successors().front();
-            --incoming_forward_branchs[succ];
+            --incoming_forward_branchs[succ->id()];
             work_list.push_back(succ);
         } else {
             for (auto succ : block->successors()) {
-                auto current = incoming_forward_branchs[succ];
+                auto current = incoming_forward_branchs[succ->id()];
                 if (current == 0) {
                     continue;
                 }
-                if (--incoming_forward_branchs[succ] == 0) {
+                if (--incoming_forward_branchs[succ->id()] == 0) {
                     work_list.push_back(succ);
                 }
             }
         }
     }
+    ComputeBlocksLoopDepth();
+}
+
+void RegisterAllocator::ComputeBlocksLoopDepth() {
+    // Blocks from the loop header to its last loop end in order are in the loop.
+    std::vector<int> depth_delta(blocks_.size() + 1, 0);
+    for (auto block : blocks_) {
+        if (block->loop_end_nodes().empty()) {
+            continue;
+        }
+        auto last = blocks_order_[block->id()];
+        for (auto end : block->loop_end_nodes()) {
+            last = std::max(last, blocks_order_[end->id()]);
+        }
+        depth_delta[blocks_order_[block->id()]]++;
+        depth_delta[last + 1]--;
+    }
+    int depth = 0;
+    for (size_t i = 0; i < blocks_.size(); i++) {
+        depth += depth_delta[i];
+        blocks_[i]->set_loop_depth(depth);
+    }
 }
 
 void RegisterAllocator::NumberizeAllInstructions() {
-    int next_id = 0;
+    // Starts from 2, so the start gap of first instruction is not negative.
+    int next_id = 2;
+    instructions_.resize(1, nullptr);
     for (auto block : blocks_) {
         for (auto instr : block->instructions()) {
             instr->set_id(next_id);
+            instructions_.push_back(instr);
             next_id += 2;
         }
     }
@@ -226,20 +311,23 @@ void RegisterAllocator::ComputeLocalLiveSets() {
 }
 
 void RegisterAllocator::ComputeGlobalLiveSets() {
-    for (int i = static_cast<int>(blocks_.size()) - 1; i >= 0; i--) {
-        auto block = blocks_[i];
-        auto block_state = &blocks_liveness_state_[i];
-        
-        block_state->ClearLiveOut();
-        
-        for (auto succ : block->successors()) {
-
-            auto succ_state = BlockLivenssStateOf(succ);
-            block_state->Union(block_state->mutable_live_out(), succ_state->live_in());
+    // Live sets only grow, iterate until no changes for the back edges.
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int i = static_cast<int>(blocks_.size()) - 1; i >= 0; i--) {
+            auto block = blocks_[i];
+            auto block_state = &blocks_liveness_state_[i];
+            
+            for (auto succ : block->successors()) {
+                auto succ_state = BlockLivenssStateOf(succ);
+                block_state->Union(block_state->mutable_live_out(), succ_state->live_in());
+            }
+            
+            base::BitVector live_in(block_state->live_in().length());
+            block_state->Subtract(&live_in, block_state->live_out(), block_state->live_kill());
+            block_state->Union(&live_in, block_state->live_gen());
+            changed |= block_state->mutable_live_in()->Union(live_in);
         }
-        
-        block_state->Subtract(block_state->mutable_live_in(), block_state->live_out(), block_state->live_kill());
-        block_state->Union(block_state->mutable_live_in(), block_state->live_gen());
     }
 }
 
@@ -250,8 +338,9 @@ void RegisterAllocator::BuildIntervals() {
         auto block = blocks_[i];
         auto block_state = &blocks_liveness_state_[i];
         
-        auto local_from = block->GetLowerId();
-        auto local_to   = block->GetUpperId() + 2;
+        // Block starts at the start gap of its first instruction.
+        auto local_from = block->GetLowerId() - 1;
+        auto local_to   = block->GetUpperId() + 1;
         
         BlockLivenssState::Walk(block_state->live_out(), [this, local_from, local_to](int virtual_register) {
             IntervalOf(virtual_register)->AddRange(local_from, local_to);
@@ -260,18 +349,10 @@ void RegisterAllocator::BuildIntervals() {
         for (int j = static_cast<int>(block->instructions_size()) - 1; j >= 0; j--) {
             auto instr = block->instruction(j);
             
-            if (auto moves = instr->mutable_parallel_move(Instruction::kStart)) {
+            if (auto moves = instr->mutable_parallel_move(Instruction::kEnd)) {
                 for (auto opds : moves->moves()) {
                     if (auto opd = opds->mutable_dest()->AsUnallocated()) {
-                        auto interval = IntervalOf(opd);
-                        interval->TouchEarliestRange(instr->id());
-
-                        AddUsePosition(instr->id(), interval, opd);
-                    }
-                    if (auto opd = opds->mutable_src()->AsUnallocated()) {
-                        auto interval = IntervalOf(opd);
-                        interval->AddRange(local_from, instr->id());
-                        AddUsePosition(instr->id(), interval, opd);
+                        IntervalOf(opd)->AddDefinition(nullptr);
                     }
                 }
             }
@@ -279,8 +360,9 @@ void RegisterAllocator::BuildIntervals() {
             for (int k = 0; k < instr->outputs_count(); k++) {
                 if (auto opd = instr->OutputAt(k)->AsUnallocated()) {
                     auto interval = IntervalOf(opd);
-                    interval->TouchEarliestRange(instr->id());
-
+                    // Definition shortens the range which starts at the block begin.
+                    interval->TouchEarliestRange(instr->id())->from = instr->id();
+                    interval->AddDefinition(nullptr);
                     AddUsePosition(instr->id(), interval, opd);
                 }
             }
@@ -289,6 +371,7 @@ void RegisterAllocator::BuildIntervals() {
                 if (auto opd = instr->TempAt(k)->AsUnallocated()) {
                     auto interval = IntervalOf(opd);
                     interval->AddRange(instr->id(), instr->id() + 1);
+                    interval->AddDefinition(nullptr);
                     AddUsePosition(instr->id(), interval, opd);
                 }
             }
@@ -296,28 +379,42 @@ void RegisterAllocator::BuildIntervals() {
             for (int k = 0; k < instr->inputs_count(); k++) {
                 if (auto opd = instr->InputAt(k)->AsUnallocated()) {
                     auto interval = IntervalOf(opd);
-                    auto upper_id = block->loop_end_nodes().empty()
-                                  ? instr->id()
-                                  : local_to;
-                    interval->AddRange(local_from, upper_id);
+                    interval->AddRange(local_from, instr->id());
                     AddUsePosition(instr->id(), interval, opd);
                 }
             }
+            
+            // Moves of start gap are at the odd position before instruction.
+            auto gap = instr->id() - 1;
+            if (auto moves = instr->mutable_parallel_move(Instruction::kStart)) {
+                for (auto opds : moves->moves()) {
+                    if (auto opd = opds->mutable_dest()->AsUnallocated()) {
+                        auto interval = IntervalOf(opd);
+                        interval->TouchEarliestRange(gap)->from = gap;
+                        auto src = opds->src();
+                        interval->AddDefinition(src.IsImmediate() || src.IsConstant() ? &opds->src() : nullptr);
+                        AddUsePosition(gap, interval, opd);
+                    }
+                }
+                for (auto opds : moves->moves()) {
+                    if (auto opd = opds->mutable_src()->AsUnallocated()) {
+                        auto interval = IntervalOf(opd);
+                        // Keep it live over the whole gap, the moves are emitted one by one.
+                        interval->AddRange(local_from, instr->id());
+                        AddUsePosition(gap, interval, opd);
+                    }
+                }
+            }
         }
     }
 }
 
 void RegisterAllocator::WalkIntervals() {
-    LifetimeIntervalSet unhanded, active, inactive;
-    for (int i = 0; i < fun_->frame()->virtual_registers_size(); i++) {
-        if (!intervals_[i]) {
-            continue;
-        }
-        unhanded.insert(intervals_[i]);
-    }
+    LifetimeIntervalList active, inactive;
     
     // process paramater first;
     DCHECK_NOTNULL(fun_->block(0));
+    std::vector<bool> fixed(intervals_.size(), false);
     if (fun_->block(0)->instruction(0)->op() == ArchFrameEnter) {
         auto instr = fun_->block(0)->instruction(0);
         for (int i = 0; i < instr->outputs_count(); i++) {
@@ -331,61 +428,182 @@ void RegisterAllocator::WalkIntervals() {
                 interval->AssignRegister(opd->fixed_fp_register_id());
             }
             if (interval) {
-                Remove(&unhanded, interval);
-                active.insert(interval);
+                fixed[interval->virtual_register()] = true;
+                Insert(&active, interval);
             }
         }
     }
     
+    std::vector<LifetimeInterval *> incoming;
+    for (int i = 0; i < fun_->frame()->virtual_registers_size(); i++) {
+        if (intervals_[i] && !fixed[i]) {
+            incoming.push_back(intervals_[i]);
+        }
+    }
+    LifetimeIntervalQueue unhanded(LifetimeIntervalStartsLater{}, std::move(incoming));
+    
     // note: new intervals may be sorted into the unhandled list during
     // allocation when intervals are split
     while (!unhanded.empty()) {
-        auto current = *unhanded.begin();
-        unhanded.erase(unhanded.begin());
+        auto current = unhanded.top();
+        unhanded.pop();
         //const auto position = current->first_range().from;
         const auto position = current->earliest_range().from;
         
         // check for intervals in active that are expired or inactive
-        std::vector<LifetimeInterval *> incoming_remove;
+        RemoveExpired(&active, position);
+        size_t n = 0;
         for (auto it : active) {
-            if (it->latest_range().to < position) {
-                incoming_remove.push_back(it);
-            } else if (it->IsNotCovers(position)) {
-                incoming_remove.push_back(it);
-                inactive.insert(it);
+            if (it->IsNotCovers(position)) {
+                Insert(&inactive, it);
+            } else {
+                active[n++] = it;
             }
         }
-        RemoveAll(&active, std::move(incoming_remove));
+        active.resize(n);
         
         // check for intervals in inactive that are expired or active
+        RemoveExpired(&inactive, position);
+        n = 0;
         for (auto it : inactive) {
-            if (it->latest_range().to < position) {
-                incoming_remove.push_back(it);
-            } else if (it->IsCovers(position)) {
-                incoming_remove.push_back(it);
-                active.insert(it);
+            if (it->IsCovers(position)) {
+                Insert(&active, it);
+            } else {
+                inactive[n++] = it;
             }
         }
-        RemoveAll(&inactive, std::move(incoming_remove));
-        
+        inactive.resize(n);
         
         // find a register for current
         if (!TryAllocateFreeRegister(current, &unhanded, active, inactive)) {
             // fail to allocation
-            AllocateBlockedRegister(current, &unhanded, active, inactive);
+            AllocateBlockedRegister(current, &unhanded, &active, &inactive);
         }
 
         if (current->has_assigned_any_register()) {
-            active.insert(current);
+            Insert(&active, current);
+        }
+    }
+}
+
+void RegisterAllocator::Insert(LifetimeIntervalList *list, LifetimeInterval *interval) {
+    auto iter = std::upper_bound(list->begin(), list->end(), interval, [](auto a, auto b) {
+        return a->latest_range().to < b->latest_range().to;
+    });
+    list->insert(iter, interval);
+}
+
+void RegisterAllocator::RemoveExpired(LifetimeIntervalList *list, int position) {
+    auto iter = std::find_if(list->begin(), list->end(), [position](auto it) {
+        return it->latest_range().to >= position;
+    });
+    list->erase(list->begin(), iter);
+}
+
+void RegisterAllocator::Remove(LifetimeIntervalList *list, LifetimeInterval *interval) {
+    auto iter = std::find(list->begin(), list->end(), interval);
+    DCHECK(iter != list->end());
+    list->erase(iter);
+}
+
+void RegisterAllocator::AssignSpillSlots() {
+    // Extent of every spilled original interval: [from, to)
+    std::map<int, LifetimeInterval::Range> extents;
+    for (auto interval : intervals_) {
+        if (!interval || !interval->has_spilled()) {
+            continue;
+        }
+        auto [iter, ok] = extents.insert({interval->GetOriginalVR(), {interval->earliest_range().from,
+                                                                       interval->latest_range().to}});
+        if (!ok) {
+            iter->second.from = std::min(iter->second.from, interval->earliest_range().from);
+            iter->second.to = std::max(iter->second.to, interval->latest_range().to);
+        }
+    }
+    
+    std::vector<std::tuple<LifetimeInterval::Range, int>> incoming;
+    for (auto [vr, extent] : extents) {
+        incoming.emplace_back(extent, vr);
+    }
+    std::sort(incoming.begin(), incoming.end(), [](const auto &a, const auto &b) {
+        return std::get<0>(a).from < std::get<0>(b).from;
+    });
+    
+    // Linear scan the extents again, intervals never live at the same time share the slot.
+    std::map<int, int> assigned; // original virtual register -> slot offset
+    for (auto [extent, vr] : incoming) {
+        auto size_in_bytes = static_cast<int>(IntervalOf(vr)->type().ReferenceSizeInBytes());
+        auto iter = std::find_if(spill_slots_.begin(), spill_slots_.end(), [&](const SpillSlot &slot) {
+            return slot.size_in_bytes == size_in_bytes && slot.busy_until <= extent.from;
+        });
+        if (iter == spill_slots_.end()) {
+            spill_slots_.push_back({fun_->frame()->AllocateSlot(size_in_bytes, 0), size_in_bytes, extent.to});
+            iter = spill_slots_.end() - 1;
+        }
+        iter->busy_until = extent.to;
+        assigned[vr] = iter->offset;
+    }
+    
+    for (auto interval : intervals_) {
+        if (interval && interval->has_spilled()) {
+            interval->AssignSlot(assigned[interval->GetOriginalVR()]);
         }
-        
-//        if (!active.empty()) {
-//            printf("------\n");
-//            for (auto it : active) {
-//                printf("%d->%d, ", it->virtual_register(), it->assigned_operand());
-//            }
-//            printf("\n");
-//        }
+    }
+}
+
+void RegisterAllocator::ResolveDataFlow() {
+    // Moves between the split siblings in the middle of block
+    for (auto interval : intervals_) {
+        if (!interval || !interval->split_parent()) {
+            continue;
+        }
+        auto position = interval->earliest_range().from;
+        auto block = BlockAt(position);
+        if (position == block->GetLowerId() - 1) {
+            continue; // Block boundary, resolved by edges.
+        }
+        DCHECK(position & 1);
+        if (auto from = interval->split_parent()->ChildCovers(position - 1)) {
+            AddResolvingMove(InstructionAt(position + 1), kBeforeStartGap, from, interval);
+        }
+    }
+    
+    // Moves for the control flow edges
+    for (auto block : blocks_) {
+        auto state = BlockLivenssStateOf(block);
+        for (auto pred : block->predecessors()) {
+            Instruction *instr = nullptr;
+            ResolvingPoint where;
+            if (block->predecessors_size() == 1) {
+                instr = block->instruction(0);
+                where = kBeforeStartGap;
+            } else {
+                // The lowering never makes conditional branches, so there is no critical edge.
+                DCHECK(pred->successors_size() == 1);
+                instr = pred->instruction(pred->instructions_size() - 1);
+                where = instr->op() == ArchJmp ? kAfterStartGap : kAfterInstruction;
+            }
+            
+            BlockLivenssState::Walk(state->live_in(), [&](int virtual_register) {
+                auto interval = IntervalOf(virtual_register);
+                auto from = interval->ChildCovers(pred->GetUpperId());
+                auto to = interval->ChildCovers(block->GetLowerId() - 1);
+                if (from && to && from != to) {
+                    AddResolvingMove(instr, where, from, to);
+                }
+            });
+        }
+    }
+    
+    MoveResolver resolver(arena_, regconf_, fun_->frame());
+    for (auto [key, moves] : resolving_moves_) {
+        resolver.Resolve(moves);
+        auto instr = InstructionAt(std::get<0>(key));
+        auto where = static_cast<ResolvingPoint>(std::get<1>(key));
+        auto receiver = instr->GetOrNewParallelMove(where == kAfterInstruction ? Instruction::kEnd : Instruction::kStart,
+                                                    arena_)->mutable_moves();
+        receiver->insert(where == kBeforeStartGap ? receiver->begin() : receiver->end(), moves->moves().begin(),
+                         moves->moves().end());
     }
 }
 
@@ -393,16 +611,29 @@ void RegisterAllocator::AssignRegisters() {
     for (auto block : blocks_) {
         for (auto instr : block->instructions()) {
             for (int i = 0; i < 2; i++) {
-                if (auto moves = instr->mutable_parallel_move(static_cast<Instruction::GapPosition>(i))) {
-                    for (auto opds : moves->moves()) {
-                        if (auto opd = opds->mutable_src()->AsUnallocated()) {
-                            AssignOperand(instr->id(), opds->mutable_src(), opd);
+                auto moves = instr->mutable_parallel_move(static_cast<Instruction::GapPosition>(i));
+                if (!moves) {
+                    continue;
+                }
+                auto opid = i == Instruction::kStart ? instr->id() - 1 : instr->id();
+                size_t n = 0;
+                for (auto opds : moves->moves()) {
+                    if (auto opd = opds->mutable_dest()->AsUnallocated()) {
+                        if (IntervalOf(opd)->ChildAt(opid)->has_rematerialized()) {
+                            continue; // Never be stored, the constant will be used
                         }
-                        if (auto opd = opds->mutable_dest()->AsUnallocated()) {
-                            AssignOperand(instr->id(), opds->mutable_dest(), opd);
+                        AssignOperand(opid, opds->mutable_dest(), opd);
+                    }
+                    if (auto opd = opds->mutable_src()->AsUnallocated()) {
+                        if (auto interval = IntervalOf(opd)->ChildAt(opid); interval->has_rematerialized()) {
+                            *opds->mutable_src() = *interval->rematerialization();
+                        } else {
+                            AssignOperand(opid, opds->mutable_src(), opd);
                         }
                     }
+                    (*moves->mutable_moves())[n++] = opds;
                 }
+                moves->mutable_moves()->resize(n);
             }
             
             for (int i = 0; i < instr->operands_size(); i++) {
@@ -499,9 +730,9 @@ bool RegisterAllocator::ShouldSplitByUsePolicy(int policy0, int latest_hint, int
 }
 
 bool RegisterAllocator::TryAllocateFreeRegister(LifetimeInterval *current,
-                                                LifetimeIntervalSet *unhandled,
-                                                const LifetimeIntervalSet &active,
-                                                const LifetimeIntervalSet &inactive) {
+                                                LifetimeIntervalQueue *unhandled,
+                                                const LifetimeIntervalList &active,
+                                                const LifetimeIntervalList &inactive) {
     UnallocatedOperand::Policy policy = UnallocatedOperand::kNone;
     int hint = 0;
     if (current->has_any_used()) {
@@ -513,10 +744,9 @@ bool RegisterAllocator::TryAllocateFreeRegister(LifetimeInterval *current,
             case UnallocatedOperand::kFixedSlot:
                 current->AssignSlot(hint);
                 return true;
-            case UnallocatedOperand::kMustHaveSlot: {
-                auto value = fun_->frame()->GetValue(current->GetOriginalVR());
-                current->AssignSlot(fun_->frame()->AllocateSlot(value->type().ReferenceSizeInBytes(), 0));
-            } return true;
+            case UnallocatedOperand::kMustHaveSlot:
+                current->Spill();
+                return true;
 
             default:
                 break;
@@ -577,82 +807,143 @@ bool RegisterAllocator::TryAllocateFreeRegister(LifetimeInterval *current,
             break;
     }
 
-    if (pos == 0) {
-        return false; // allocate fail
-    }
-
-    if (pos > current->latest_range().to) {
-        DCHECK(current->IsNotCovers(pos));
+    const auto start = current->earliest_range().from;
+    if (pos >= current->latest_range().to) {
         // register available for whole current
         current->AssignRegister(reg);
-    } else {
-        DCHECK(current->IsCovers(pos));
-        // register available for first part of current
-        current->AssignRegister(reg);
-        // split
-        unhandled->insert(SplitInterval(current, pos));
+        return true;
+    }
+    if (GapBefore(pos) <= start) {
+        return false; // allocate fail
     }
+    // register available for first part of current
+    current->AssignRegister(reg);
+    // split
+    auto split_pos = FindOptimalSplitPosition(std::max(start, current->FindUsePositionBefore(pos)) + 1, GapBefore(pos));
+    unhandled->push(SplitInterval(current, split_pos));
     return true;
 }
 
-void RegisterAllocator::AllocateBlockedRegister(LifetimeInterval *current, LifetimeIntervalSet *unhandled,
-                                                const LifetimeIntervalSet &active,
-                                                const LifetimeIntervalSet &inactive) {
+void RegisterAllocator::AllocateBlockedRegister(LifetimeInterval *current, LifetimeIntervalQueue *unhandled,
+                                                LifetimeIntervalList *active,
+                                                LifetimeIntervalList *inactive) {
+    const auto start = current->earliest_range().from;
+    // The register can be taken by current, if the interval holding it does not need register during
+    // [GapBefore(start), its next use]. So the position is the next use of the register.
     std::vector<int> use_gp_position(regconf_->max_gp_register(), std::numeric_limits<int>::max());
     std::vector<int> use_fp_position(regconf_->max_fp_register(), std::numeric_limits<int>::max());
-
-    for (auto it : active) {
+    auto update = [&](LifetimeInterval *it, int split_pos) {
         DCHECK(it->has_assigned_any_register());
-        auto use = it->FindUsePositionAfter(current->earliest_range().from);
-        if (it->has_assigned_gp_register()) {
-            use_gp_position[it->assigned_operand()] = use.position;
-        } else {
-            use_fp_position[it->assigned_operand()] = use.position;
+        auto use = it->FindRegisterUseAfter(split_pos);
+        if (split_pos <= it->earliest_range().from || GapBefore(use) <= split_pos) {
+            use = 0; // can not be spilled
         }
+        auto position = it->has_assigned_gp_register() ? &use_gp_position : &use_fp_position;
+        (*position)[it->assigned_operand()] = std::min((*position)[it->assigned_operand()], use);
+    };
+
+    for (auto it : *active) {
+        update(it, GapBefore(start));
     }
-    
-    for (auto it : inactive) {
-        DCHECK(it->has_assigned_any_register());
-        if (it->IsNotIntersects(current)) {
-            continue;
-        }
-        auto use = it->FindUsePositionAfter(current->earliest_range().from);
-        if (it->has_assigned_gp_register()) {
-            use_gp_position[it->assigned_operand()] = use.position;
-        } else {
-            use_fp_position[it->assigned_operand()] = use.position;
+    for (auto it : *inactive) {
+        if (auto rs = it->GetIntersection(current); rs.from >= 0) {
+            update(it, GapBefore(rs.from));
         }
     }
-    
-    UnallocatedOperand::Policy policy = UnallocatedOperand::kNone;
-    int hint = 0;
-    if (current->has_any_used()) {
-        auto use = current->earliest_use_position();
-        policy = static_cast<UnallocatedOperand::Policy>(use.use_kind);
-        hint = use.hint;
-    }
 
     auto [reg, pos] = GetHighest(current->should_gp_register()
-                         ? use_gp_position
-                         : use_fp_position,
-                         current->should_gp_register()
-                         ? regconf_->allocatable_gp_bitmap()
-                         : regconf_->allocatable_fp_bitmap());
-    if (pos < current->earliest_use_position().position) {
+                                 ? use_gp_position
+                                 : use_fp_position,
+                                 current->should_gp_register()
+                                 ? regconf_->allocatable_gp_bitmap()
+                                 : regconf_->allocatable_fp_bitmap());
+    auto use = current->FindRegisterUseAfter(start);
+    if (use == std::numeric_limits<int>::max()) {
+        // never need a register
+        current->Spill();
+        return;
+    }
+    if (pos < use && GapBefore(use) > start) {
         // all active and inactive intervals are used before current, so it is best to spill current itself
-        auto ty = fun_->frame()->GetType(current->GetOriginalVR());
-        current->AssignSlot(fun_->frame()->AllocateSlot(ty.ReferenceSizeInBytes(), 0));
-        unhandled->insert(SplitInterval(current, current->earliest_use_position().position + 1));
-    } else {
-        // spilling made a register free for first part of current
-        current->AssignRegister(reg);
-        if (pos >= current->latest_range().to) {
-            return;
-        }
-        printd("reg=%d, pos=%d", reg, pos);
+        current->Spill();
+        unhandled->push(SplitInterval(current, FindOptimalSplitPosition(start + 1, GapBefore(use))));
+        return;
+    }
+    if (pos == 0) {
+        printd("No register can be spilled for v%d at %d", current->virtual_register(), start);
         UNREACHABLE();
-        unhandled->insert(SplitInterval(current, pos));
     }
+
+    // spilling made a register free for current: spill the intersecting intervals of the register
+    current->AssignRegister(reg);
+    std::vector<LifetimeInterval *> evicted;
+    for (auto it : *active) {
+        if (it->has_assigned_any_register() && it->assigned_operand() == reg &&
+            it->should_gp_register() == current->should_gp_register()) {
+            evicted.push_back(it);
+        }
+    }
+    for (auto it : evicted) {
+        Remove(active, it);
+        auto split_pos = GapBefore(start);
+        SplitAndSpill(it, FindOptimalSplitPosition(std::max(it->earliest_range().from,
+                                                            it->FindUsePositionBefore(split_pos)) + 1, split_pos),
+                      start, unhandled);
+    }
+    evicted.clear();
+    for (auto it : *inactive) {
+        if (it->has_assigned_any_register() && it->assigned_operand() == reg &&
+            it->should_gp_register() == current->should_gp_register() && it->IsIntersects(current)) {
+            evicted.push_back(it);
+        }
+    }
+    for (auto it : evicted) {
+        Remove(inactive, it);
+        auto split_pos = GapBefore(it->GetIntersection(current).from);
+        SplitAndSpill(it, FindOptimalSplitPosition(std::max(it->earliest_range().from,
+                                                            it->FindUsePositionBefore(split_pos)) + 1, split_pos),
+                      start, unhandled);
+        Insert(inactive, it);
+    }
+}
+
+void RegisterAllocator::SplitAndSpill(LifetimeInterval *interval, int pos, int reload_from,
+                                      LifetimeIntervalQueue *unhandled) {
+    auto child = SplitInterval(interval, pos);
+    child->Spill();
+    auto use = child->FindRegisterUseAfter(pos);
+    if (use != std::numeric_limits<int>::max()) {
+        DCHECK(GapBefore(use) > pos);
+        // Reload can not be earlier than the walking position.
+        unhandled->push(SplitInterval(child, FindOptimalSplitPosition(std::max(pos + 1, reload_from),
+                                                                      GapBefore(use))));
+    }
+}
+
+int RegisterAllocator::FindOptimalSplitPosition(int min_pos, int max_pos) const {
+    DCHECK(max_pos & 1);
+    if (min_pos >= max_pos) {
+        return max_pos;
+    }
+    auto min_block = BlockAt(min_pos);
+    auto max_block = BlockAt(max_pos);
+    if (min_block == max_block) {
+        return max_pos;
+    }
+    // The moves at start of loop header are placed at the end of its predecessor (out of loop) by the resolution.
+    auto cost = [](InstructionBlock *block) {
+        return block->loop_depth() - (block->loop_end_nodes().empty() ? 0 : 1);
+    };
+    auto best_pos = max_pos;
+    auto best_cost = max_block->loop_depth();
+    for (auto i = blocks_order_[max_block->id()]; i >= blocks_order_[min_block->id()]; i--) {
+        auto block = blocks_[i];
+        if (block->GetLowerId() - 1 >= min_pos && cost(block) < best_cost) {
+            best_cost = cost(block);
+            best_pos = block->GetLowerId() - 1;
+        }
+    }
+    return best_pos;
 }
 
 // split interval and returning child
@@ -668,19 +959,18 @@ LifetimeInterval *RegisterAllocator::SplitInterval(LifetimeInterval *interval, i
 void RegisterAllocator::AssignOperand(int opid, InstructionOperand *receiver, UnallocatedOperand *unalloc) {
     auto interval = IntervalOf(unalloc->virtual_register())->ChildAt(opid);
     switch (unalloc->policy()) {
+        case UnallocatedOperand::kRegisterOrSlotOrConstant:
         case UnallocatedOperand::kRegisterOrSlot:
-        case UnallocatedOperand::kRegisterOrSlotOrConstant: {
+        case UnallocatedOperand::kMustHaveSlot:
             DCHECK(interval->has_any_assinged());
-            *receiver = interval->has_assigned_any_register()
-                    ? AllocatedOperand::Register(interval->representation(), interval->assigned_operand())
-                    : AllocatedOperand::Slot(interval->representation(), regconf_->fp(), interval->assigned_operand());
-        } break;
+            DCHECK(!interval->has_rematerialized() ||
+                   unalloc->policy() == UnallocatedOperand::kRegisterOrSlotOrConstant);
+            *receiver = LocationOf(interval);
+            break;
         case UnallocatedOperand::kMustHaveRegister: {
             DCHECK(interval->has_assigned_any_register());
             *receiver = AllocatedOperand::Register(interval->representation(), interval->assigned_operand());
         } break;
-        case UnallocatedOperand::kMustHaveSlot:
-            break;
         case UnallocatedOperand::kFixedSlot:
             *receiver = AllocatedOperand::Slot(interval->representation(), regconf_->fp(), unalloc->fixed_slot_offset());
             break;
@@ -697,6 +987,55 @@ void RegisterAllocator::AssignOperand(int opid, InstructionOperand *receiver, Un
     }
 }
 
+InstructionOperand RegisterAllocator::LocationOf(const LifetimeInterval *interval) const {
+    switch (interval->status()) {
+        case LifetimeInterval::kRegisterAssigned:
+            return AllocatedOperand::Register(interval->representation(), interval->assigned_operand());
+        case LifetimeInterval::kSlotAssigned:
+            return AllocatedOperand::Slot(interval->representation(), regconf_->fp(), interval->assigned_operand());
+        case LifetimeInterval::kRematerialized:
+            return *interval->rematerialization();
+        default:
+            UNREACHABLE();
+            break;
+    }
+    return {};
+}
+
+void RegisterAllocator::AddResolvingMove(Instruction *instr, ResolvingPoint where, const LifetimeInterval *from,
+                                         const LifetimeInterval *to) {
+    if (to->has_rematerialized()) {
+        return;
+    }
+    auto key = std::make_tuple(instr->id(), static_cast<int>(where));
+    auto iter = resolving_moves_.find(key);
+    if (iter == resolving_moves_.end()) {
+        iter = resolving_moves_.insert({key, new (arena_) ParallelMove(arena_)}).first;
+    }
+    iter->second->AddMove(LocationOf(to), LocationOf(from), arena_);
+}
+
+InstructionBlock *RegisterAllocator::BlockAt(int position) const {
+    // Blocks in order: [lower id - 1, upper id + 1)
+    auto iter = std::upper_bound(blocks_.begin(), blocks_.end(), position, [](int pos, InstructionBlock *block) {
+        return pos < block->GetUpperId() + 1;
+    });
+    DCHECK(iter != blocks_.end());
+    return *iter;
+}
+
+Instruction *RegisterAllocator::InstructionAt(int position) const {
+    DCHECK(position > 0 && position / 2 < instructions_.size());
+    return instructions_[position / 2];
+}
+
+BlockLivenssState *RegisterAllocator::BlockLivenssStateOf(InstructionBlock *block) {
+    DCHECK(block->id() >= 0 && block->id() < blocks_order_.size());
+    auto index = blocks_order_[block->id()];
+    DCHECK(index >= 0 && index < blocks_liveness_state_.size());
+    return &blocks_liveness_state_[index];
+}
+
 LifetimeInterval *RegisterAllocator::IntervalOf(UnallocatedOperand *opd) {
     return IntervalOf(opd->virtual_register());
 }
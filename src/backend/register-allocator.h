@@ -4,12 +4,14 @@
 
 #include "backend/machine-type.h"
 #include "ir/type.h"
+#include "base/bit-vector.h"
 #include "base/checking.h"
 #include "base/base.h"
 #include <numeric>
 #include <vector>
-#include <set>
-#include <functional>
+#include <map>
+#include <tuple>
+#include <queue>
 
 namespace yalx {
 namespace base {
@@ -26,6 +28,8 @@ class UnallocatedOperand;
 class InstructionOperand;
 class InstructionFunction;
 class InstructionBlock;
+class Instruction;
+class ParallelMove;
 class RegistersConfiguration;
 class Frame;
 
@@ -42,81 +46,35 @@ public:
     void Reset(size_t capacity);
 
 #define DEFINE_LIVENESS_OPS(kind, name) \
-    const std::vector<bool> &live_##name() const { return live_##name##_; } \
-    std::vector<bool> *mutable_live_##name() { return &live_##name##_; } \
-    void set_live_##name(const std::vector<bool> &other) { live_##name##_ = other; } \
-    bool DoesNotInLive##kind(int virtual_register) const { return !DoesIn(live_##name##_, virtual_register); } \
-    bool DoesInLive##kind(int virtual_register) const { return DoesIn(live_##name##_, virtual_register); } \
-    void AddLive##kind(int virtual_register) { Add(&live_##name##_, virtual_register); } \
-    void RemoveLive##kind(int virtual_register) { Remove(&live_##name##_, virtual_register); } \
-    void ClearLive##kind() { live_##name##_.clear(); }
+    const base::BitVector &live_##name() const { return live_##name##_; } \
+    base::BitVector *mutable_live_##name() { return &live_##name##_; } \
+    void set_live_##name(const base::BitVector &other) { live_##name##_ = other; } \
+    bool DoesNotInLive##kind(int virtual_register) const { return !live_##name##_.Contains(virtual_register); } \
+    bool DoesInLive##kind(int virtual_register) const { return live_##name##_.Contains(virtual_register); } \
+    void AddLive##kind(int virtual_register) { live_##name##_.Add(virtual_register); } \
+    void RemoveLive##kind(int virtual_register) { live_##name##_.Remove(virtual_register); } \
+    void ClearLive##kind() { live_##name##_.Clear(); }
     
     DECL_LIVENESS_KINDS(DEFINE_LIVENESS_OPS)
 
 #undef DEFINE_LIVENESS_OPS
     
-    void Union(std::vector<bool> *lhs, const std::vector<bool> &rhs) {
-        for (int i = 0; i < rhs.size(); i++) {
-            if (rhs[i]) {
-                Add(lhs, i);
-            }
-        }
-    }
+    void Union(base::BitVector *lhs, const base::BitVector &rhs) { lhs->Union(rhs); }
     
-    void Subtract(std::vector<bool> *receiver, const std::vector<bool> &lhs, const std::vector<bool> &rhs) {
-        for (int i = 0; i < lhs.size(); i++) {
-            if (lhs[i]) {
-                Add(receiver, i);
-            }
-        }
-        for (int i = 0; i < rhs.size(); i++) {
-            if (rhs[i]) {
-                Remove(receiver, i);
-            }
-        }
+    // receiver = (receiver | lhs) - rhs
+    void Subtract(base::BitVector *receiver, const base::BitVector &lhs, const base::BitVector &rhs) {
+        receiver->Union(lhs);
+        receiver->Subtract(rhs);
     }
     
-    static void Walk(const std::vector<bool> &set, std::function<void (int)> &&callback) {
-        for (int i = 0; i < set.size(); i++) {
-            if (set[i]) {
-                callback(i);
-            }
-        }
-    }
+    template<class Callback>
+    static void Walk(const base::BitVector &set, Callback &&callback) { set.ForEach(std::forward<Callback>(callback)); }
     
 private:
-    bool DoesIn(const std::vector<bool> &set, int virtual_register) const {
-        DCHECK(virtual_register >= 0);
-        DCHECK(virtual_register < capacity_);
-        if (virtual_register < set.size()) {
-            return set[virtual_register];
-        } else {
-            return false;
-        }
-    }
-    
-    void Add(std::vector<bool> *set, int virtual_register) {
-        DCHECK(virtual_register >= 0);
-        DCHECK(virtual_register < capacity_);
-        if (virtual_register >= set->size()) {
-            set->resize(virtual_register + 1, false);
-        }
-        (*set)[virtual_register] = true;
-    }
-    
-    void Remove(std::vector<bool> *set, int virtual_register) {
-        DCHECK(virtual_register >= 0);
-        DCHECK(virtual_register < capacity_);
-        if (virtual_register < set->size()) {
-            (*set)[virtual_register] = false;
-        }
-    }
-    
-    std::vector<bool> live_kill_;
-    std::vector<bool> live_gen_;
-    std::vector<bool> live_in_;
-    std::vector<bool> live_out_;
-    size_t capacity_ = 0;
+    base::BitVector live_kill_;
+    base::BitVector live_gen_;
+    base::BitVector live_in_;
+    base::BitVector live_out_;
 };
 
 
@@ -126,6 +84,8 @@ public:
         kUnassigned,
         kRegisterAssigned,
         kSlotAssigned,
+        kSpilled, // Slot will be assigned after all intervals walked
+        kRematerialized, // Never live in a slot, use the constant of its definition
     };
     
     struct Range {
@@ -176,7 +136,9 @@ public:
     
     bool has_assigned_any_register() const { return status() == kRegisterAssigned; }
     bool has_assigned_slot() const { return status() == kSlotAssigned; }
-    bool has_any_assinged() const { return has_assigned_slot() || has_assigned_any_register(); }
+    bool has_spilled() const { return status() == kSpilled; }
+    bool has_rematerialized() const { return status() == kRematerialized; }
+    bool has_any_assinged() const { return status() != kUnassigned; }
     
     bool has_any_used() const { return !use_positions_.empty(); }
     bool has_never_used() const { return use_positions_.empty(); }
@@ -185,13 +147,27 @@ public:
     DEF_VAL_GETTER(Status, status);
     DEF_VAL_GETTER(int, assigned_operand);
     DEF_VAL_GETTER(std::vector<UsePosition>, use_positions);
+    DEF_PTR_GETTER(LifetimeInterval, split_parent);
+    DEF_VAL_GETTER(std::vector<LifetimeInterval *>, split_children);
     
     const LifetimeInterval *ChildAt(int opid) const;
+    // Find the split child or itself which is live at `position'
+    const LifetimeInterval *ChildCovers(int position) const;
     
     int GetOriginalVR() const {
         return split_parent_ ? split_parent_->virtual_register() : virtual_register();
     }
     
+    // The constant definition of original interval, nullptr if it is not defined by a constant only once.
+    const InstructionOperand *rematerialization() const {
+        return split_parent_ ? split_parent_->rematerialization() : constant_;
+    }
+    
+    void AddDefinition(const InstructionOperand *constant) {
+        DCHECK(!split_parent_);
+        constant_ = definitions_++ == 0 ? constant : nullptr;
+    }
+    
     void AssignRegister(int reg) {
         DCHECK(!has_any_assinged());
         assigned_operand_ = reg;
@@ -199,11 +175,17 @@ public:
     }
     
     void AssignSlot(int offset) {
-        DCHECK(!has_any_assinged());
+        DCHECK(!has_any_assinged() || has_spilled());
         assigned_operand_ = offset;
         status_ = kSlotAssigned;
     }
     
+    // Spill to a slot, or rematerialize the constant definition at every use.
+    void Spill() {
+        DCHECK(!has_any_assinged());
+        status_ = rematerialization() ? kRematerialized : kSpilled;
+    }
+    
     const UsePosition &earliest_use_position() const {
         DCHECK(!use_positions_.empty());
         return use_positions_.back();
@@ -225,7 +207,7 @@ public:
 
     Range *TouchEarliestRange(int pos) {
         if (ranges_.empty()) {
-            AddRange(pos, pos);
+            AddRange(pos, pos + 1); // Never used definition
         }
         return &ranges_.back();
     }
@@ -238,15 +220,7 @@ public:
     bool IsNotCovers(int position) const { return !IsCovers(position); }
     bool IsCovers(int position) const {
         for (auto range : ranges_) {
-            if (position == range.from) {
-                return true;
-            }
-            if (position > range.from && position < range.to) {
-                return true;
-            }
-        }
-        for (auto child : split_children_) {
-            if (child->IsCovers(position)) {
+            if (position >= range.from && position < range.to) {
                 return true;
             }
         }
@@ -266,15 +240,19 @@ public:
         return false;
     }
     
+    // The earliest intersection
     Range GetIntersection(const LifetimeInterval *it) const {
+        Range earliest{-1, -1};
         for (auto rhs : it->ranges_) {
             for (auto lhs : ranges_) {
                 if (auto rs = lhs.Intersects(rhs); rs.from >= 0 && rs.to >= 0) {
-                    return rs;
+                    if (earliest.from < 0 || rs.from < earliest.from) {
+                        earliest = rs;
+                    }
                 }
             }
         }
-        return {-1,-1};
+        return earliest;
     }
     
     void AddRange(int from, int to) {
@@ -290,15 +268,10 @@ public:
         use_positions_.push_back({position, used_kind, hint});
     }
     
-    UsePosition FindUsePositionAfter(int pos) const {
-        for (int i = static_cast<int>(use_positions_.size()) - 1; i >= 0; i--) {
-            auto use_position = use_positions_[i];
-            if (use_position.position > pos) {
-                return use_position;
-            }
-        }
-        return use_positions_[0];
-    }
+    // The first use which can not be a slot at or after `pos', max integer if no such use.
+    int FindRegisterUseAfter(int pos) const;
+    // The last use before `pos', -1 if no such use.
+    int FindUsePositionBefore(int pos) const;
     
     void AddChild(LifetimeInterval *child, int pos);
 private:
@@ -307,6 +280,8 @@ private:
     MachineRepresentation const rep_;
     Status status_ = kUnassigned;
     int assigned_operand_ = 0;
+    int definitions_ = 0;
+    const InstructionOperand *constant_ = nullptr;
     LifetimeInterval *split_parent_ = nullptr;
     std::vector<LifetimeInterval *> split_children_;
     std::vector<Range> ranges_;
@@ -335,6 +310,10 @@ public:
     // step 6
     void WalkIntervals();
     // step 7
+    void AssignSpillSlots();
+    // step 8
+    void ResolveDataFlow();
+    // step 9
     void AssignRegisters();
 
     InstructionBlock *OrderedBlockAt(int i) const {
@@ -345,44 +324,53 @@ public:
     
     size_t ordered_blocks_size() const { return blocks_.size(); }
     
-    BlockLivenssState *BlockLivenssStateOf(InstructionBlock *block) {
-        auto iter = std::find(blocks_.begin(), blocks_.end(), block);
-        DCHECK(iter != blocks_.end());
-        auto index = static_cast<int>(iter - blocks_.begin());
-        DCHECK(index >= 0 && index < blocks_liveness_state_.size());
-        return &blocks_liveness_state_[index];
-    }
+    BlockLivenssState *BlockLivenssStateOf(InstructionBlock *block);
+    
+    // Number of stack slots for the spilled intervals, the slots are shared by the intervals do not live at same time.
+    size_t spill_slots_size() const { return spill_slots_.size(); }
     
     
     LifetimeInterval *IntervalOf(UnallocatedOperand *opd);
     LifetimeInterval *IntervalOf(ir::Value *value);
     LifetimeInterval *IntervalOf(int virtual_register);
 private:
-    struct LifetimeIntervalComparator {
+    // Unhandled intervals are popped by start position, the longer one first if they start at the same position.
+    struct LifetimeIntervalStartsLater {
         bool operator() (LifetimeInterval *a, LifetimeInterval *b) const {
-            if (a->earliest_range().from == b->earliest_range().from) {
-                return a->latest_range().to >= b->latest_range().to;
-            } else {
-                return a->earliest_range().from < b->earliest_range().from;
+            if (a->earliest_range().from != b->earliest_range().from) {
+                return a->earliest_range().from > b->earliest_range().from;
+            }
+            if (a->latest_range().to != b->latest_range().to) {
+                return a->latest_range().to < b->latest_range().to;
             }
+            return a->virtual_register() > b->virtual_register();
         }
     };
 
-    using LifetimeIntervalSet = std::set<LifetimeInterval *, LifetimeIntervalComparator>;
+    using LifetimeIntervalQueue = std::priority_queue<LifetimeInterval *, std::vector<LifetimeInterval *>,
+                                                      LifetimeIntervalStartsLater>;
+    // Active and inactive intervals are sorted by end position, so the expired ones are always a prefix.
+    using LifetimeIntervalList = std::vector<LifetimeInterval *>;
+    
+    enum ResolvingPoint {
+        kBeforeStartGap, // Before the moves of `Instruction::kStart'
+        kAfterStartGap,  // After the moves of `Instruction::kStart'
+        kAfterInstruction, // After the moves of `Instruction::kEnd'
+    };
     
-    static void RemoveAll(LifetimeIntervalSet *set, std::vector<LifetimeInterval *> &&incoming) {
-        for (auto it : incoming) { Remove(set, it); }
-        incoming.clear();
-    }
+    struct SpillSlot {
+        int offset;
+        int size_in_bytes;
+        int busy_until;
+    };
     
-    static void Remove(LifetimeIntervalSet *set, LifetimeInterval *incoming) {
-        for (auto iter = set->begin(); iter != set->end(); iter++) {
-            if (*iter == incoming) {
-                set->erase(iter);
-                return;
-            }
-        }
-    }
+    static void Insert(LifetimeIntervalList *list, LifetimeInterval *interval);
+    static void RemoveExpired(LifetimeIntervalList *list, int position);
+    static void Remove(LifetimeIntervalList *list, LifetimeInterval *interval);
+    
+    // Instructions are numbered by even integers, the odd position before instruction is its start gap (parallel
+    // moves of `Instruction::kStart'), so intervals are always split at a gap.
+    static int GapBefore(int position) { return (position - 1) | 1; }
     
     int offset_of_virtual_register() const { return 0; }
     int offset_of_gp_register() const;
@@ -390,27 +378,43 @@ private:
     
     static void AddUsePosition(int pos, LifetimeInterval *interval, const UnallocatedOperand *opd);
     
-    void ComputeBlocksLoop(std::vector<bool> *visited, InstructionBlock *block);
+    void ComputeBlocksLoop(std::vector<bool> *visited, std::vector<bool> *on_stack, InstructionBlock *block);
+    void ComputeBlocksLoopDepth();
+    
+    InstructionBlock *BlockAt(int position) const;
+    Instruction *InstructionAt(int position) const;
     
     void SplitByUsePolicy(LifetimeInterval *current, std::vector<LifetimeInterval *> *splitted);
     bool ShouldSplitByUsePolicy(int policy0, int hint0, int policy1, int hint1);
-    bool TryAllocateFreeRegister(LifetimeInterval *current, LifetimeIntervalSet *unhandled,
-                                 const LifetimeIntervalSet &active,
-                                 const LifetimeIntervalSet &inactive);
-    void AllocateBlockedRegister(LifetimeInterval *current, LifetimeIntervalSet *unhandled,
-                                 const LifetimeIntervalSet &active,
-                                 const LifetimeIntervalSet &inactive);
+    bool TryAllocateFreeRegister(LifetimeInterval *current, LifetimeIntervalQueue *unhandled,
+                                 const LifetimeIntervalList &active,
+                                 const LifetimeIntervalList &inactive);
+    void AllocateBlockedRegister(LifetimeInterval *current, LifetimeIntervalQueue *unhandled,
+                                 LifetimeIntervalList *active,
+                                 LifetimeIntervalList *inactive);
     
     LifetimeInterval *SplitInterval(LifetimeInterval *interval, int whit_opid);
-    
+    // Spill interval from the split position, and split it again before it needs register.
+    void SplitAndSpill(LifetimeInterval *interval, int pos, int reload_from, LifetimeIntervalQueue *unhandled);
+    // Find a position in [min_pos, max_pos] to split, prefer the block boundary out of loops, so the moves for
+    // spilling or reloading are not in the loop.
+    int FindOptimalSplitPosition(int min_pos, int max_pos) const;
+    
+    InstructionOperand LocationOf(const LifetimeInterval *interval) const;
+    void AddResolvingMove(Instruction *instr, ResolvingPoint where, const LifetimeInterval *from,
+                          const LifetimeInterval *to);
     void AssignOperand(int opid, InstructionOperand *receiver, UnallocatedOperand *unalloc);
     
     base::Arena *const arena_;
     const RegistersConfiguration *const regconf_;
     InstructionFunction *const fun_;
     std::vector<InstructionBlock *> blocks_;
+    std::vector<int> blocks_order_; // block id -> index of `blocks_'
     std::vector<BlockLivenssState> blocks_liveness_state_;
     std::vector<LifetimeInterval *> intervals_;
+    std::vector<Instruction *> instructions_; // instruction id / 2 -> instruction
+    std::vector<SpillSlot> spill_slots_;
+    std::map<std::tuple<int, int>, ParallelMove *> resolving_moves_; // (instruction id, point) -> moves
 }; // class RegisterAllocator
 
 } // namespace backend
@@ -0,0 +1,284 @@
+#include "backend/x64/block-layout-x64.h"
+#include "backend/x64/code-generate-x64.h"
+#include "backend/x64/peephole-optimize-x64.h"
+#include "backend/constants-pool.h"
+#include "backend/linkage-symbols.h"
+#include "backend/registers-configuration.h"
+#include "backend/frame.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/base-test.h"
+#include "base/io.h"
+
+namespace yalx::backend {
+
+class X64BlockLayoutTest : public ir::BaseTest {
+public:
+    X64BlockLayoutTest(): const_pool_(&arena_), linkage_(&arena_), all_(&arena_) {}
+
+    void SetUp() override {
+        bool ok = true;
+        IRGen("tests/32-code-lower", &all_, &ok);
+        ASSERT_TRUE(ok);
+    }
+
+    std::string GenTo(InstructionFunction *fun) {
+        base::ArenaMap<std::string_view, InstructionFunction *> funs(arena());
+        funs[fun->symbol()->ToSlice()] = fun;
+
+        std::string buf;
+        auto file = base::NewMemoryWritableFile(&buf);
+        base::PrintingWriter printer{file, true};
+        X64CodeGenerator gen(funs, RegistersConfiguration::OfPosixX64(), FindModuleOrNull("main:main"), &const_pool_,
+                             &linkage_, &printer);
+        gen.EmitFunction(fun);
+        return buf;
+    }
+
+    InstructionFunction *NewFunction(const char *name) {
+        auto module = FindModuleOrNull("main:main");
+        auto prototype = new (arena()) ir::PrototypeModel(arena(), String::kEmpty, false/*vargs*/);
+        auto symbol = String::New(arena(), name);
+        auto frame = new (arena()) Frame(arena(), module->NewFunction(ir::Function::kDefault, symbol, symbol,
+                                                                       prototype));
+        return new (arena()) InstructionFunction(arena(), symbol, frame);
+    }
+
+    Instruction *Emit(InstructionBlock *block, InstructionCode op, std::vector<InstructionOperand> outputs,
+                      std::vector<InstructionOperand> inputs) {
+        auto instr = Instruction::New(arena(), op, inputs.size(), inputs.data(), outputs.size(), outputs.data(), 0,
+                                      nullptr);
+        block->Add(instr);
+        return instr;
+    }
+
+    static void Link(InstructionBlock *from, InstructionBlock *to) {
+        from->AddSuccessor(to);
+        to->AddPredecessors(from);
+    }
+
+    static AllocatedOperand Reg(int id) { return AllocatedOperand::Register(MachineRepresentation::kWord64, id); }
+
+    ir::Module *FindModuleOrNull(std::string_view full_name) const {
+        if (auto iter = all_.find(full_name); iter != all_.end()) {
+            return iter->second;
+        } else {
+            return nullptr;
+        }
+    }
+
+protected:
+    Linkage linkage_;
+    ConstantsPool const_pool_;
+    base::ArenaMap<std::string_view, ir::Module *> all_;
+}; // class X64BlockLayoutTest
+
+TEST_F(X64BlockLayoutTest, StaticProbabilities) {
+    auto fun = NewFunction("loop");
+    auto b0 = fun->NewBlock(0);
+    auto b1 = fun->NewBlock(1);
+    auto b2 = fun->NewBlock(2);
+    auto b3 = fun->NewBlock(3);
+    auto b4 = fun->NewBlock(4);
+    fun->set_entry(b0);
+    b4->set_deferred(true);
+    Link(b0, b1);
+    Link(b1, b2); // b1: loop header
+    Link(b1, b3); // leave the loop
+    Link(b2, b1); // b2: loop end
+    Link(b2, b4); // to the deferred
+    Link(b3, b4);
+
+    X64BlockLayout layout(arena());
+    layout.Run(fun);
+    EXPECT_FLOAT_EQ(1, layout.ProbabilityOf(b0, b1));
+    EXPECT_GT(layout.ProbabilityOf(b1, b2), layout.ProbabilityOf(b1, b3));
+    EXPECT_GT(layout.ProbabilityOf(b2, b1), 0.99);
+    EXPECT_FLOAT_EQ(1, layout.ProbabilityOf(b2, b1) + layout.ProbabilityOf(b2, b4));
+    // b3 only leads to the deferred b4.
+    EXPECT_TRUE(b3->deferred());
+    EXPECT_EQ(2, layout.cold_blocks());
+}
+
+TEST_F(X64BlockLayoutTest, PlaceLoopInOrder) {
+    auto fun = NewFunction("loop");
+    auto b0 = fun->NewBlock(0);
+    auto exit = fun->NewBlock(1);
+    auto header = fun->NewBlock(2);
+    auto end = fun->NewBlock(3);
+    fun->set_entry(b0);
+    Link(b0, header);
+    Link(header, end);
+    Link(header, exit);
+    Link(end, header);
+    Link(end, exit);
+    Emit(b0, ArchJmp, {}, {ReloactionOperand{header}});
+    Emit(exit, ArchRet, {}, {});
+    Emit(header, X64Cmp, {}, {Reg(0), ImmediateOperand{0}});
+    Emit(header, X64Jz, {}, {ReloactionOperand{exit}});
+    Emit(end, X64Sub, {Reg(0)}, {ImmediateOperand{1}});
+    Emit(end, X64Jnz, {}, {ReloactionOperand{header}});
+
+    X64BlockLayout layout(arena());
+    layout.Run(fun);
+    ASSERT_EQ(4, fun->blocks_size());
+    EXPECT_EQ(b0, fun->block(0));
+    EXPECT_EQ(header, fun->block(1));
+    EXPECT_EQ(end, fun->block(2));
+    EXPECT_EQ(exit, fun->block(3));
+    EXPECT_EQ(0, layout.negated_branches());
+    EXPECT_EQ(0, layout.inserted_jumps());
+    EXPECT_EQ(0, layout.cold_blocks());
+}
+
+TEST_F(X64BlockLayoutTest, ProfiledBranch) {
+    auto fun = NewFunction("profiled");
+    auto b0 = fun->NewBlock(0);
+    auto b1 = fun->NewBlock(1);
+    auto b2 = fun->NewBlock(2);
+    fun->set_entry(b0);
+    Link(b0, b1);
+    Link(b0, b2);
+    Emit(b0, X64Cmp, {}, {Reg(0), ImmediateOperand{0}});
+    Emit(b0, X64Jz, {}, {ReloactionOperand{b2}});
+    Emit(b1, ArchRet, {}, {});
+    Emit(b2, ArchRet, {}, {});
+
+    b0->set_frequency(100);
+    b1->set_frequency(10);
+    b2->set_frequency(90);
+    X64BlockLayout layout(arena());
+    layout.Run(fun);
+    EXPECT_FLOAT_EQ(0.9, layout.ProbabilityOf(b0, b2));
+    ASSERT_EQ(3, fun->blocks_size());
+    EXPECT_EQ(b2, fun->block(1));
+    EXPECT_EQ(b1, fun->block(2));
+    EXPECT_EQ(1, layout.negated_branches());
+    ASSERT_EQ(2, b0->instructions_size());
+    EXPECT_EQ(X64Jnz, b0->instruction(1)->op());
+    EXPECT_EQ(b1, b0->instruction(1)->InputAt(0)->AsReloaction()->label());
+    EXPECT_EQ(0, layout.cold_blocks());
+}
+
+TEST_F(X64BlockLayoutTest, DeferredToColdSection) {
+    auto fun = NewFunction("cold");
+    auto b0 = fun->NewBlock(0);
+    auto b1 = fun->NewBlock(1);
+    auto b2 = fun->NewBlock(2);
+    fun->set_entry(b0);
+    b1->set_deferred(true);
+    Link(b0, b1);
+    Link(b0, b2);
+    Emit(b0, X64Cmp, {}, {Reg(0), ImmediateOperand{0}});
+    Emit(b0, X64Jz, {}, {ReloactionOperand{b2}});
+    Emit(b1, ArchUnreachable, {}, {});
+    Emit(b2, ArchRet, {}, {});
+
+    X64BlockLayout layout(arena());
+    layout.Run(fun);
+    EXPECT_EQ(1, layout.cold_blocks());
+    EXPECT_TRUE(b1->cold());
+    auto expected = GenTo(fun);
+    std::string z = R"(.global cold
+cold:
+.cfi_startproc
+Lblk0:
+    cmpq $0, %rax
+    jnz Lblk1
+Lblk2:
+    retq
+.cfi_endproc
+.section )";
+    z.append(GnuAsmGenerator::kColdTextSegmentName);
+    z.append(R"(
+cold.cold:
+.cfi_startproc
+    .cfi_def_cfa %rbp, 16
+    .cfi_offset %rbp, -16
+Lblk1:
+    int3
+.cfi_endproc
+.section )");
+    z.append(GnuAsmGenerator::kTextSegmentName);
+    z.append("\n");
+    ASSERT_EQ(z, expected) << expected;
+}
+
+TEST_F(X64BlockLayoutTest, KeepJumpingToColdSection) {
+    auto fun = NewFunction("cold");
+    auto b0 = fun->NewBlock(0);
+    auto b1 = fun->NewBlock(1);
+    fun->set_entry(b0);
+    b1->set_deferred(true);
+    Link(b0, b1);
+    Emit(b0, ArchJmp, {}, {ReloactionOperand{b1}});
+    Emit(b1, ArchUnreachable, {}, {});
+
+    X64BlockLayout layout(arena());
+    layout.Run(fun);
+    EXPECT_FALSE(b0->cold());
+    EXPECT_TRUE(b1->cold());
+    ASSERT_EQ(b1, fun->block(1));
+
+    // b1 is next to b0 in order of blocks, but it is in the other text section.
+    X64PeepholeOptimizer optimizer(arena(), RegistersConfiguration::OfPosixX64());
+    optimizer.Run(fun);
+    EXPECT_EQ(0, optimizer.removed_jumps());
+    ASSERT_EQ(1, b0->instructions_size());
+    EXPECT_EQ(ArchJmp, b0->instruction(0)->op());
+    EXPECT_EQ(b1, b0->instruction(0)->InputAt(0)->AsReloaction()->label());
+}
+
+TEST_F(X64BlockLayoutTest, TableSwitchTargetsNotCold) {
+    auto fun = NewFunction("table");
+    auto b0 = fun->NewBlock(0);
+    auto b1 = fun->NewBlock(1);
+    auto b2 = fun->NewBlock(2);
+    auto b3 = fun->NewBlock(3);
+    fun->set_entry(b0);
+    b2->set_deferred(true);
+    Link(b0, b1);
+    Link(b0, b2);
+    Link(b0, b3);
+    // Keys: 10 -> b1, 12 -> b2, otherwise -> b3
+    InstructionOperand inputs[] = {
+        AllocatedOperand::Register(MachineRepresentation::kWord32, 7/*rdi*/),
+        ImmediateOperand{10},
+        ReloactionOperand{b3},
+        ReloactionOperand{b1},
+        ReloactionOperand{b3},
+        ReloactionOperand{b2},
+    };
+    InstructionOperand temps[] = {Reg(1/*rcx*/)};
+    b0->Add(Instruction::New(arena(), ArchTableSwitch, arraysize(inputs), inputs, 0, nullptr, arraysize(temps),
+                             temps));
+    Emit(b1, ArchRet, {}, {});
+    Emit(b2, ArchUnreachable, {}, {});
+    Emit(b3, ArchRet, {}, {});
+
+    X64BlockLayout layout(arena());
+    layout.Run(fun);
+    EXPECT_FALSE(b2->deferred());
+    EXPECT_EQ(0, layout.cold_blocks());
+    EXPECT_EQ(0, layout.inserted_jumps());
+    auto code = GenTo(fun);
+    static const char *kLines[] = {
+        "    movl %edi, %r13d\n",
+        "    subl $10, %r13d\n",
+        "    cmpl $2, %r13d\n",
+        "    ja Lblk3\n",
+        "    leaq Ljt0(%rip), %rcx\n",
+        "    movslq (%rcx,%r13,4), %r13\n",
+        "    addq %rcx, %r13\n",
+        "    jmp *%r13\n",
+        "Ljt0:\n"
+        "    .long Lblk1-Ljt0\n"
+        "    .long Lblk3-Ljt0\n"
+        "    .long Lblk2-Ljt0\n",
+    };
+    for (auto line : kLines) {
+        EXPECT_NE(std::string::npos, code.find(line)) << line << code;
+    }
+}
+
+} // namespace yalx::backend
@@ -0,0 +1,51 @@
+#include "backend/x64/block-layout-x64.h"
+
+namespace yalx::backend {
+
+// Negated pairs, only the ones supported by code generator.
+#define X64_NEGATABLE_BRANCHS_LIST(V) \
+    V(Ja,  Jbe) \
+    V(Jae, Jb)  \
+    V(Jb,  Jae) \
+    V(Jbe, Ja)  \
+    V(Jc,  Jae) \
+    V(Jg,  Jle) \
+    V(Jge, Jl)  \
+    V(Jl,  Jge) \
+    V(Jle, Jg)  \
+    V(Je,  Jne) \
+    V(Jne, Je)  \
+    V(Jz,  Jnz) \
+    V(Jnz, Jz)  \
+    V(Jp,  Jpo) \
+    V(Jpe, Jpo) \
+    V(Jpo, Jpe)
+
+X64BlockLayout::X64BlockLayout(base::Arena *arena)
+: BlockLayout(arena) {
+}
+
+bool X64BlockLayout::IsConditionalBranch(Instruction *instr) const {
+    switch (instr->op()) {
+#define DEFINE_CASE(name, _) case X64##name:
+        X64_NEGATABLE_BRANCHS_LIST(DEFINE_CASE)
+#undef DEFINE_CASE
+        case X64Jo:
+        case X64Js:
+            return true;
+        default:
+            return false;
+    }
+}
+
+InstructionCode X64BlockLayout::NegateCondition(InstructionCode code) const {
+    switch (code) {
+#define DEFINE_CASE(name, negated) case X64##name: return X64##negated;
+        X64_NEGATABLE_BRANCHS_LIST(DEFINE_CASE)
+#undef DEFINE_CASE
+        default:
+            return ArchNop;
+    }
+}
+
+} // namespace yalx::backend
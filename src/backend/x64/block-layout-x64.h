@@ -0,0 +1,20 @@
+#pragma once
+#ifndef YALX_BACKEND_X64_BLOCK_LAYOUT_X64_H
+#define YALX_BACKEND_X64_BLOCK_LAYOUT_X64_H
+
+#include "backend/block-layout.h"
+
+namespace yalx::backend {
+
+class X64BlockLayout final : public BlockLayout {
+public:
+    explicit X64BlockLayout(base::Arena *arena);
+
+private:
+    bool IsConditionalBranch(Instruction *instr) const override;
+    InstructionCode NegateCondition(InstructionCode code) const override;
+}; // class X64BlockLayout
+
+} // namespace yalx::backend
+
+#endif // YALX_BACKEND_X64_BLOCK_LAYOUT_X64_H
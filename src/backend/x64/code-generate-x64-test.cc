@@ -240,6 +240,38 @@ Jpt_0:
     ASSERT_EQ(z, expected) << expected;
 }
 
+// issue15_tail_call
+TEST_F(X64CodeGeneratorTest, TailCall) {
+    auto expected = GenTo("main:main", "issue15_tail_call");
+    static constexpr char z[] = R"(.global main_Zomain_Zdissue15_tail_call
+main_Zomain_Zdissue15_tail_call:
+.cfi_startproc
+Lblk0:
+    pushq %rbp
+    .cfi_def_cfa_offset 16
+    .cfi_offset %rbp, -16
+    movq %rsp, %rbp
+    .cfi_def_cfa_register %rbp
+    subq $16, %rsp
+    movl %edi, -4(%rbp)
+    movl %esi, -8(%rbp)
+    movl -8(%rbp), %edi
+    movl -4(%rbp), %esi
+    addq $16, %rsp
+    popq %rbp
+    jmp main_Zomain_Zdissue04_simple_args
+.cfi_endproc
+)";
+    ASSERT_EQ(z, expected) << expected;
+}
+
+// issue16_overflow_tail_call: Arguments overflow to stack, so it is still a call.
+TEST_F(X64CodeGeneratorTest, OverflowTailCall) {
+    auto expected = GenTo("main:main", "issue16_overflow_tail_call");
+    EXPECT_NE(std::string::npos, expected.find("callq main_Zomain_Zdissue11_overflow_args")) << expected;
+    EXPECT_EQ(std::string::npos, expected.find("jmp ")) << expected;
+}
+
 } // namespace yalx::backend
 
 
@@ -99,9 +99,10 @@ public:
         kIndirectly
     };
     
-    FunctionGenerator(X64CodeGenerator *owns, InstructionFunction *fun)
+    FunctionGenerator(X64CodeGenerator *owns, InstructionFunction *fun, base::PrintingWriter *printer)
     : owns_(owns)
-    , fun_(fun) {
+    , fun_(fun)
+    , printer_(printer) {
     }
     
     void EmitAll() {
@@ -110,7 +111,12 @@ public:
         printer()->Writeln(".cfi_startproc");
         
         position_ = 0;
+        bool cold = false;
         for (auto ib : fun_->blocks()) {
+            if (ib->cold() && !cold) {
+                EmitColdPartStart();
+                cold = true;
+            }
             printer()->Println("Lblk%d:", ib->label());
             for (auto instr : ib->instructions()) {
                 EmitParallelMove(instr->parallel_move(Instruction::kStart));
@@ -121,10 +127,25 @@ public:
         }
         
         printer()->Writeln(".cfi_endproc");
+        if (cold) {
+            printer()->Println(".section %s", GnuAsmGenerator::kTextSegmentName);
+        }
     }
 
 private:
+    // Cold blocks are in the other section, as a part of function which has its own unwinding info, and the frame
+    // has been set up in the hot part.
+    void EmitColdPartStart() {
+        printer()->Writeln(".cfi_endproc");
+        printer()->Println(".section %s", GnuAsmGenerator::kColdTextSegmentName);
+        printer()->Write(fun_->symbol()->ToSlice())->Writeln(".cold:");
+        printer()->Writeln(".cfi_startproc");
+        Incoming()->Writeln(".cfi_def_cfa %rbp, 16");
+        Incoming()->Writeln(".cfi_offset %rbp, -16");
+    }
+
     void Emit(InstructionBlock *ib, Instruction *instr);
+    void EmitTableSwitch(InstructionBlock *ib, Instruction *instr);
     void EmitParallelMove(const ParallelMove *moving);
     void EmitMove(InstructionOperand *dest, InstructionOperand *src);
     void EmitOperand(InstructionOperand *operand, X64RelocationStyle style = kDefault);
@@ -135,11 +156,12 @@ private:
     }
     
     base::PrintingWriter *Incoming() { return printer()->Indent(1); }
-    base::PrintingWriter *printer() { return owns_->printer_; }
+    base::PrintingWriter *printer() { return printer_; }
     Linkage *symbols() { return owns_->symbols_; }
     
     X64CodeGenerator *const owns_;
     InstructionFunction *fun_;
+    base::PrintingWriter *const printer_;
     int position_ = 0;
 }; // class X64CodeGenerator::FunctionGenerator
 
@@ -166,6 +188,16 @@ void X64CodeGenerator::FunctionGenerator::Emit(InstructionBlock *ib, Instruction
             printer()->Writeln();
             break;
 
+        case ArchTailCall:
+            if (auto size = FrameScopeHint::GetStackMaxSize(instr); size > 0) {
+                Incoming()->Println("addq $%d, %%rsp", size);
+            }
+            Incoming()->Writeln("popq %rbp");
+            Incoming()->Write("jmp ");
+            EmitOperand(instr->TempAt(1), kIndirectly);
+            printer()->Writeln();
+            break;
+
         case ArchCallNative:
             Incoming()->Write("callq ");
             EmitOperand(instr->InputAt(0), kIndirectly);
@@ -226,10 +258,20 @@ void X64CodeGenerator::FunctionGenerator::Emit(InstructionBlock *ib, Instruction
             
         case ArchJmp:
             Incoming()->Write("jmp ");
-            EmitOperand(instr->OutputAt(0), kIndirectly);
+            EmitOperand(instr->InputAt(0), kIndirectly);
             printer()->Writeln("");
             break;
 
+        case ArchTableSwitch:
+            EmitTableSwitch(ib, instr);
+            break;
+
+        case ArchProfileCount:
+            Incoming()->Write("incq ");
+            EmitOperand(instr->InputAt(0));
+            printer()->Writeln();
+            break;
+
         case ArchStackLoad: {
             auto field_offset = instr->InputAt(1)->AsImmediate()->word32_value();
             auto slot = instr->InputAt(0)->AsAllocated();
@@ -295,6 +337,11 @@ void X64CodeGenerator::FunctionGenerator::Emit(InstructionBlock *ib, Instruction
             EmitOperands(instr->InputAt(0), instr->InputAt(1));
             break;
 
+        case X64Test32:
+            Incoming()->Write("testl ");
+            EmitOperands(instr->InputAt(0), instr->InputAt(1));
+            break;
+
         case X64Movb:
             Incoming()->Write("movb ");
             EmitOperands(instr->OutputAt(0), instr->InputAt(0));
@@ -729,6 +776,70 @@ static const char *SelectMoveInstr(MachineRepresentation rep) {
     }
 }
 
+// The table follows the jump, entries of it are offsets of targets from the table:
+//     movzbl %al, %r13d
+//     subl $min, %r13d
+//     andl $0xff, %r13d
+//     cmpl $n-1, %r13d
+//     ja Lblk_default
+//     leaq Ljt1(%rip), %rcx
+//     movslq (%rcx,%r13,4), %r13
+//     addq %rcx, %r13
+//     jmp *%r13
+// Ljt1:
+//     .long Lblk2-Ljt1
+//     ...
+void X64CodeGenerator::FunctionGenerator::EmitTableSwitch(InstructionBlock *ib, Instruction *instr) {
+    auto selector = instr->InputAt(0)->AsAllocated();
+    DCHECK(selector->IsRegisterLocation());
+    auto lowest = instr->InputAt(1)->AsImmediate()->word32_value();
+    auto slots = instr->inputs_count() - 3;
+    auto base = kRegister64Names[instr->TempAt(0)->AsAllocated()->register_id()];
+    auto rep = selector->machine_representation();
+    auto wide = rep == MachineRepresentation::kWord64 || rep == MachineRepresentation::kPointer;
+    auto index = Scratch(wide ? MachineRepresentation::kWord64 : MachineRepresentation::kWord32);
+    auto index64 = Scratch(MachineRepresentation::kWord64);
+
+    switch (rep) {
+        case MachineRepresentation::kBit:
+        case MachineRepresentation::kWord8:
+            Incoming()->Println("movzbl %%%s, %%%s", RegisterName(rep, selector->register_id()), index);
+            break;
+        case MachineRepresentation::kWord16:
+            Incoming()->Println("movzwl %%%s, %%%s", RegisterName(rep, selector->register_id()), index);
+            break;
+        case MachineRepresentation::kWord32:
+            Incoming()->Println("movl %%%s, %%%s", RegisterName(rep, selector->register_id()), index);
+            break;
+        default:
+            DCHECK(wide);
+            Incoming()->Println("movq %%%s, %%%s", RegisterName(rep, selector->register_id()), index);
+            break;
+    }
+    if (lowest != 0) {
+        // Keys are in width of selector
+        Incoming()->Println("sub%c $%d, %%%s", wide ? 'q' : 'l', lowest, index);
+        if (rep == MachineRepresentation::kWord8 || rep == MachineRepresentation::kBit) {
+            Incoming()->Println("andl $0xff, %%%s", index);
+        } else if (rep == MachineRepresentation::kWord16) {
+            Incoming()->Println("andl $0xffff, %%%s", index);
+        }
+    }
+    Incoming()->Println("cmp%c $%d, %%%s", wide ? 'q' : 'l', slots - 1, index);
+    Incoming()->Write("ja ");
+    EmitOperand(instr->InputAt(2));
+    printer()->Writeln();
+    Incoming()->Println("leaq Ljt%d(%%rip), %%%s", ib->label(), base);
+    Incoming()->Println("movslq (%%%s,%%%s,4), %%%s", base, index64, index64);
+    Incoming()->Println("addq %%%s, %%%s", base, index64);
+    Incoming()->Println("jmp *%%%s", index64);
+    printer()->Println("Ljt%d:", ib->label());
+    for (int i = 0; i < slots; i++) {
+        auto target = instr->InputAt(3 + i)->AsReloaction();
+        Incoming()->Println(".long Lblk%d-Ljt%d", target->label()->label(), ib->label());
+    }
+}
+
 void X64CodeGenerator::FunctionGenerator::EmitParallelMove(const ParallelMove *moving) {
     if (!moving) {
         return; // Dont need emit moving
@@ -1004,12 +1115,12 @@ X64CodeGenerator::X64CodeGenerator(const base::ArenaMap<std::string_view, Instru
 
 X64CodeGenerator::~X64CodeGenerator() = default;
 
-void X64CodeGenerator::EmitFunction(InstructionFunction *fun) {
-    FunctionGenerator gen(this, fun);
+void X64CodeGenerator::EmitFunction(InstructionFunction *fun, base::PrintingWriter *printer) {
+    FunctionGenerator gen(this, fun, printer);
     gen.EmitAll();
     
     if (fun->native_handle()) {
-        FunctionGenerator g2(this, fun->native_handle());
+        FunctionGenerator g2(this, fun->native_handle(), printer);
         g2.EmitAll();
     }
 }
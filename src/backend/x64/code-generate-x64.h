@@ -24,9 +24,13 @@ public:
     ~X64CodeGenerator() override;
 
     friend class X64CodeGeneratorTest;
+    friend class X64PeepholeOptimizerTest;
+    friend class X64BlockLayoutTest;
+    friend class FunctionCompilerTest;
     DISALLOW_IMPLICIT_CONSTRUCTORS(X64CodeGenerator);
 private:
-    void EmitFunction(InstructionFunction *fun) override;
+    using GnuAsmGenerator::EmitFunction;
+    void EmitFunction(InstructionFunction *fun, base::PrintingWriter *printer) override;
 }; // class X64CodeGenerator
 
 } // namespace yalx
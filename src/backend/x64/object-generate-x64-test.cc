@@ -0,0 +1,211 @@
+#include "backend/x64/object-generate-x64.h"
+#include "backend/x64/lower-posix-x64.h"
+#include "backend/elf-object-writer.h"
+#include "backend/barrier-set.h"
+#include "backend/constants-pool.h"
+#include "backend/linkage-symbols.h"
+#include "backend/registers-configuration.h"
+#include "backend/zero-slot-allocator.h"
+#include "backend/frame.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/type.h"
+#include "ir/operator.h"
+#include "ir/utils.h"
+#include "ir/base-test.h"
+#include "base/io.h"
+
+namespace yalx::backend {
+
+class X64ObjectGeneratorTest : public ir::BaseTest {
+public:
+    X64ObjectGeneratorTest(): const_pool_(&arena_), linkage_(&arena_), all_(&arena_) {}
+
+    void SetUp() override {
+        bool ok = true;
+        IRGen("tests/32-code-lower", &all_, &ok);
+        ASSERT_TRUE(ok);
+    }
+
+    std::string GenTo(const char *pkg_name, const char *name, ElfObjectWriter *writer) {
+        auto mod = all_[pkg_name];
+        return GenTo(mod, IRLowing(mod->FindFunOrNull(name)), writer);
+    }
+
+    std::string GenTo(ir::Module *mod, InstructionFunction *fun, ElfObjectWriter *writer) {
+        base::ArenaMap<std::string_view, InstructionFunction *> funs(arena());
+        funs[fun->symbol()->ToSlice()] = fun;
+
+        X64ObjectGenerator gen(funs, RegistersConfiguration::OfPosixX64(), mod, &const_pool_, &linkage_, writer);
+        gen.EmitFunction(fun);
+        auto symbol = writer->FindSymbolOrNull(fun->symbol()->ToSlice());
+        EXPECT_TRUE(symbol != nullptr);
+        return writer->sections()[symbol->section].data.substr(symbol->offset, symbol->size);
+    }
+
+    void GenCallFramesTo(ir::Module *mod, const std::vector<InstructionFunction *> &funs, ElfObjectWriter *writer) {
+        base::ArenaMap<std::string_view, InstructionFunction *> all(arena());
+        for (auto fun : funs) {
+            all[fun->symbol()->ToSlice()] = fun;
+        }
+        X64ObjectGenerator gen(all, RegistersConfiguration::OfPosixX64(), mod, &const_pool_, &linkage_, writer);
+        for (auto fun : funs) {
+            gen.EmitFunction(fun);
+        }
+        gen.EmitCallFrames();
+    }
+
+    InstructionFunction *IRLowing(ir::Function *fun) {
+        X64PosixLower lower(&arena_, RegistersConfiguration::OfPosixX64(), &linkage_,
+                            &const_pool_, BarrierSet::OfYGCPosixX64());
+        auto lo_fun = lower.VisitFunction(fun);
+        ZeroSlotAllocator allocator{arena(), RegistersConfiguration::OfPosixX64(), lo_fun};
+        allocator.Run();
+        return lo_fun;
+    }
+
+    InstructionFunction *NewFunction(const char *name) {
+        auto prototype = new (arena()) ir::PrototypeModel(arena(), String::kEmpty, false/*vargs*/);
+        auto symbol = String::New(arena(), name);
+        auto frame = new (arena()) Frame(arena(), all_["main:main"]->NewFunction(ir::Function::kDefault, symbol,
+                                                                                  symbol, prototype));
+        return new (arena()) InstructionFunction(arena(), symbol, frame);
+    }
+
+    static std::string Hex(std::string_view bytes) {
+        std::string buf;
+        for (auto b : bytes) {
+            buf.append(base::Sprintf("%02x", static_cast<uint8_t>(b)));
+        }
+        return buf;
+    }
+
+protected:
+    Linkage linkage_;
+    ConstantsPool const_pool_;
+    base::ArenaMap<std::string_view, ir::Module *> all_;
+}; // class X64ObjectGeneratorTest
+
+TEST_F(X64ObjectGeneratorTest, Sanity) {
+    ElfObjectWriter writer(ElfObjectWriter::kX64);
+    auto code = GenTo("main:main", "issue01_returning_one", &writer);
+    // pushq %rbp
+    // movq %rsp, %rbp
+    // movl $1, 28(%rbp)
+    // popq %rbp
+    // retq
+    EXPECT_EQ("55488becc7451c010000005dc3", Hex(code));
+}
+
+TEST_F(X64ObjectGeneratorTest, CallRelocation) {
+    ElfObjectWriter writer(ElfObjectWriter::kX64);
+    GenTo("main:main", "issue07_call_non_args_fun", &writer);
+    ASSERT_EQ(1, writer.sections().size());
+    auto &relocations = writer.sections()[0].relocations;
+    ASSERT_EQ(1, relocations.size());
+    EXPECT_EQ("main_Zomain_Zdissue01_returning_one", relocations[0].symbol);
+    EXPECT_EQ(ElfObjectWriter::kX64PLT32, relocations[0].type);
+    EXPECT_EQ(-4, relocations[0].addend);
+    auto callee = writer.FindSymbolOrNull("main_Zomain_Zdissue01_returning_one");
+    ASSERT_TRUE(callee != nullptr);
+    EXPECT_EQ(-1, callee->section);
+
+    std::string obj;
+    writer.WriteTo(&obj);
+    ASSERT_GT(obj.size(), 64);
+    EXPECT_EQ(0, obj.compare(0, 4, "\x7f" "ELF"));
+    EXPECT_EQ(ElfObjectWriter::kX64, *reinterpret_cast<const uint16_t *>(obj.data() + 18));
+}
+
+TEST_F(X64ObjectGeneratorTest, TableSwitch) {
+    auto fun = NewFunction("table");
+    auto b0 = fun->NewBlock(0);
+    auto b1 = fun->NewBlock(1);
+    auto b2 = fun->NewBlock(2);
+    fun->set_entry(b0);
+    // Keys: 10 -> b1, 12 -> b2, otherwise -> b1
+    InstructionOperand inputs[] = {
+        AllocatedOperand::Register(MachineRepresentation::kWord32, 7/*rdi*/),
+        ImmediateOperand{10},
+        ReloactionOperand{b1},
+        ReloactionOperand{b1},
+        ReloactionOperand{b1},
+        ReloactionOperand{b2},
+    };
+    InstructionOperand temps[] = {AllocatedOperand::Register(MachineRepresentation::kWord64, 1/*rcx*/)};
+    b0->Add(Instruction::New(arena(), ArchTableSwitch, arraysize(inputs), inputs, 0, nullptr, arraysize(temps),
+                             temps));
+    b1->Add(Instruction::New(arena(), ArchRet, 0, nullptr, 0, nullptr, 0, nullptr));
+    b2->Add(Instruction::New(arena(), ArchUnreachable, 0, nullptr, 0, nullptr, 0, nullptr));
+
+    ElfObjectWriter writer(ElfObjectWriter::kX64);
+    auto code = GenTo(all_["main:main"], fun, &writer);
+
+    // leaq table(%rip), %rcx: REX 8d 0d disp32
+    auto lea = code.find("\x8d\x0d");
+    ASSERT_NE(std::string::npos, lea);
+    // jmp *%r13
+    auto jmp = code.find("\x41\xff\xe5");
+    ASSERT_NE(std::string::npos, jmp);
+    const auto table = static_cast<int32_t>(jmp + 3);
+    int32_t disp = 0;
+    ::memcpy(&disp, &code[lea + 2], sizeof(disp));
+    EXPECT_EQ(table, static_cast<int32_t>(lea + 6) + disp);
+
+    const char targets[] = {'\xc3'/*retq*/, '\xc3', '\xcc'/*int3*/};
+    for (int i = 0; i < 3; i++) {
+        int32_t offset = 0;
+        ::memcpy(&offset, &code[table + i * 4], sizeof(offset));
+        ASSERT_GT(table + offset, 0);
+        ASSERT_LT(table + offset, code.size());
+        EXPECT_EQ(targets[i], code[table + offset]) << i;
+    }
+}
+
+TEST_F(X64ObjectGeneratorTest, TailCallRelocation) {
+    ElfObjectWriter writer(ElfObjectWriter::kX64);
+    auto code = GenTo("main:main", "issue15_tail_call", &writer);
+    auto &relocations = writer.sections()[0].relocations;
+    ASSERT_EQ(1, relocations.size());
+    EXPECT_EQ("main_Zomain_Zdissue04_simple_args", relocations[0].symbol);
+    EXPECT_EQ(ElfObjectWriter::kX64PLT32, relocations[0].type);
+    // popq %rbp; jmp rel32
+    EXPECT_EQ("5de900000000", Hex(code.substr(code.size() - 6)));
+}
+
+TEST_F(X64ObjectGeneratorTest, CallFrames) {
+    ElfObjectWriter writer(ElfObjectWriter::kX64);
+    auto mod = all_["main:main"];
+    auto one = IRLowing(mod->FindFunOrNull("issue01_returning_one"));
+    auto call = IRLowing(mod->FindFunOrNull("issue07_call_non_args_fun"));
+    GenCallFramesTo(mod, {one, call}, &writer);
+
+    ASSERT_EQ(2, writer.sections().size());
+    auto &eh = writer.sections()[1];
+    EXPECT_EQ(".eh_frame", eh.name);
+    EXPECT_EQ(ElfObjectWriter::kUnwind, eh.kind);
+    // CIE: version 1, "zR", code alignment 1, data alignment -8, return address rip, pcrel|sdata4
+    //      def_cfa rsp+8, rip at cfa-8
+    EXPECT_EQ("14000000" "00000000" "01" "7a5200" "01" "78" "10" "01" "1b" "0c0708" "9001" "0000",
+              Hex(eh.data.substr(0, 24)));
+    // FDE of issue01_returning_one: pushq %rbp; movq %rsp, %rbp
+    //      advance 1, def_cfa_offset 16, rbp at cfa-16, advance 3, def_cfa_register rbp
+    EXPECT_EQ("1c000000" "1c000000" "00000000" "0d000000" "00" "41" "0e10" "8602" "43" "0d06" "00000000000000",
+              Hex(eh.data.substr(24, 32)));
+    ASSERT_EQ(56 + 32, eh.data.size());
+
+    // pc_begin of FDEs are relative to the start of functions.
+    ASSERT_EQ(2, eh.relocations.size());
+    auto text = writer.FindSymbolOrNull(eh.relocations[0].symbol);
+    ASSERT_TRUE(text != nullptr);
+    EXPECT_EQ(0, text->section);
+    EXPECT_EQ(0, text->offset);
+    EXPECT_FALSE(text->global);
+    EXPECT_EQ(32, eh.relocations[0].offset);
+    EXPECT_EQ(ElfObjectWriter::kX64PC32, eh.relocations[0].type);
+    EXPECT_EQ(writer.FindSymbolOrNull(one->symbol()->ToSlice())->offset, eh.relocations[0].addend);
+    EXPECT_EQ(64, eh.relocations[1].offset);
+    EXPECT_EQ(writer.FindSymbolOrNull(call->symbol()->ToSlice())->offset, eh.relocations[1].addend);
+}
+
+} // namespace yalx::backend
@@ -0,0 +1,887 @@
+#include "backend/x64/object-generate-x64.h"
+#include "backend/elf-object-writer.h"
+#include "backend/registers-configuration.h"
+#include "backend/linkage-symbols.h"
+#include "backend/constants-pool.h"
+#include "backend/instruction.h"
+#include "x64/asm-x64.h"
+#include "base/format.h"
+#include <type_traits>
+#include <map>
+#include <string.h>
+
+namespace yalx::backend {
+
+// DWARF call frame information, see: https://refspecs.linuxfoundation.org/LSB_5.0.0/LSB-Core-generic/LSB-Core-generic/ehframechpt.html
+static constexpr uint8_t DW_CFA_nop = 0x0;
+static constexpr uint8_t DW_CFA_advance_loc = 0x40;
+static constexpr uint8_t DW_CFA_advance_loc1 = 0x02;
+static constexpr uint8_t DW_CFA_advance_loc2 = 0x03;
+static constexpr uint8_t DW_CFA_advance_loc4 = 0x04;
+static constexpr uint8_t DW_CFA_offset = 0x80;
+static constexpr uint8_t DW_CFA_def_cfa = 0x0c;
+static constexpr uint8_t DW_CFA_def_cfa_register = 0x0d;
+static constexpr uint8_t DW_CFA_def_cfa_offset = 0x0e;
+static constexpr uint8_t DW_EH_PE_pcrel_sdata4 = 0x1b;
+// DWARF numbers of registers
+static constexpr uint8_t kDwarfRbp = 6;
+static constexpr uint8_t kDwarfRsp = 7;
+static constexpr uint8_t kDwarfRip = 16; // Return address
+
+static x64::Cond ConditionOf(Instruction::Code code) {
+    switch (code) {
+        case X64Ja:
+        case X64Seta:
+            return x64::Above;
+        case X64Jae:
+        case X64Setae:
+            return x64::AboveEqual;
+        case X64Jb:
+        case X64Jc:
+        case X64Setb:
+        case X64Setc:
+            return x64::Below;
+        case X64Jbe:
+        case X64Setbe:
+            return x64::BelowEqual;
+        case X64Jl:
+        case X64Setl:
+            return x64::Less;
+        case X64Jle:
+        case X64Setle:
+            return x64::LessEqual;
+        case X64Jg:
+        case X64Setg:
+            return x64::Greater;
+        case X64Jge:
+        case X64Setge:
+            return x64::GreaterEqual;
+        case X64Je:
+        case X64Jz:
+        case X64Sete:
+        case X64Setz:
+            return x64::Equal;
+        case X64Jne:
+        case X64Jnz:
+        case X64Setne:
+            return x64::NotEqual;
+        case X64Jp:
+        case X64Jpe:
+        case X64Setp:
+        case X64Setpe:
+            return x64::ParityEven;
+        case X64Jpo:
+        case X64Setpo:
+            return x64::ParityOdd;
+        case X64Jo:
+        case X64Seto:
+            return x64::Overflow;
+        case X64Js:
+        case X64Sets:
+            return x64::Negative;
+        default:
+            UNREACHABLE();
+            return x64::NoCond;
+    }
+}
+
+class X64ObjectGenerator::FunctionGenerator {
+public:
+    // Size of immediate of arithmetic instructions: imm8 or imm32
+    static constexpr int kArithImmediate = -1;
+
+    FunctionGenerator(X64ObjectGenerator *owns, InstructionFunction *fun)
+    : owns_(owns)
+    , fun_(fun) {
+    }
+
+    void EmitAll() {
+        for (auto ib : fun_->blocks()) {
+            for (auto instr : ib->instructions()) {
+                if (instr->is_jumping_dest()) {
+                    jumping_positions_[base::Sprintf("Jpt_%d", ib->JumpingPosition(instr).value())];
+                }
+            }
+        }
+
+        for (auto ib : fun_->blocks()) {
+            asm_.Bind(&blocks_[ib->label()]);
+            for (auto instr : ib->instructions()) {
+                EmitParallelMove(instr->parallel_move(Instruction::kStart));
+                Emit(instr);
+                EmitParallelMove(instr->parallel_move(Instruction::kEnd));
+                if (instr->is_jumping_dest()) {
+                    asm_.Bind(&jumping_positions_[base::Sprintf("Jpt_%d", ib->JumpingPosition(instr).value())]);
+                }
+            }
+        }
+
+        auto writer = owns_->writer_;
+        auto text = owns_->text();
+        auto start = writer->section_size(text);
+        writer->mutable_data(text)->append(asm_.buf());
+        writer->DefineSymbol(fun_->symbol()->ToSlice(), text, start, true/*global*/, true/*function*/,
+                             asm_.buf().size());
+        owns_->call_frames_.push_back({start, asm_.buf().size(), frame_pushed_, frame_established_});
+        for (const auto &fixup : fixups_) {
+            writer->AddRelocation(text, start + fixup.position, fixup.symbol, fixup.type, fixup.addend);
+        }
+        // All blocks have been bound, so the offsets are known.
+        auto data = writer->mutable_data(text);
+        for (const auto &table : jump_tables_) {
+            PatchDW(data, start + table.lea_disp, table.position - (table.lea_disp + 4));
+            for (size_t i = 0; i < table.labels.size(); i++) {
+                PatchDW(data, start + table.position + i * 4, blocks_[table.labels[i]].pos() - table.position);
+            }
+        }
+    }
+
+private:
+    struct Fixup {
+        int position;
+        std::string symbol;
+        uint32_t type;
+        int64_t addend;
+    }; // struct Fixup
+
+    // Entries of table are offsets of targets from the table.
+    struct JumpTable {
+        int lea_disp; // Position of disp32 of `leaq table(%rip)'
+        int position;
+        std::vector<int> labels;
+    }; // struct JumpTable
+
+    static void PatchDW(std::string *data, size_t position, int32_t value) {
+        ::memcpy(&(*data)[position], &value, sizeof(value));
+    }
+
+    void Emit(Instruction *instr);
+    void EmitTableSwitch(Instruction *instr);
+    void EmitParallelMove(const ParallelMove *moving);
+    void EmitMove(InstructionOperand *dest, InstructionOperand *src);
+    void EmitPush(InstructionOperand *operand);
+    void EmitCall(InstructionOperand *target);
+    void EmitJump(x64::Cond cond, InstructionOperand *target);
+
+    template<class R = x64::Register, class F>
+    void EmitBinary(InstructionOperand *dst, InstructionOperand *src, F &&emit, int imm_size = kArithImmediate) {
+        int trailing = 0;
+        if (IsRegister(dst)) {
+            if (IsRegister(src)) {
+                Invoke(emit, ToRegister<R>(dst), ToRegister<R>(src));
+            } else if (src->IsImmediate()) {
+                Invoke(emit, ToRegister<R>(dst), ToImmediate(src));
+            } else {
+                Invoke(emit, ToRegister<R>(dst), ToOperand(src));
+            }
+        } else {
+            auto opd = ToOperand(dst);
+            if (IsRegister(src)) {
+                Invoke(emit, opd, ToRegister<R>(src));
+            } else {
+                DCHECK(src->IsImmediate());
+                auto imm = ToImmediate(src);
+                Invoke(emit, opd, imm);
+                trailing = imm_size != kArithImmediate ? imm_size : (x64::IsIntN(imm, 8) ? 1 : 4);
+            }
+        }
+        Relocate(trailing);
+    }
+
+    template<class F, class L, class R>
+    static void Invoke(F &&emit, L lhs, R rhs) {
+        if constexpr (std::is_invocable_v<F, L, R>) {
+            emit(lhs, rhs);
+        } else {
+            UNREACHABLE();
+        }
+    }
+
+    static bool IsRegister(InstructionOperand *operand) {
+        return operand->IsAllocated() && operand->AsAllocated()->IsRegisterLocation();
+    }
+
+    template<class R>
+    static R ToRegister(InstructionOperand *operand) {
+        DCHECK(IsRegister(operand));
+        return R(operand->AsAllocated()->register_id());
+    }
+
+    static int32_t ToImmediate(InstructionOperand *operand) {
+        auto opd = operand->AsImmediate();
+        switch (opd->machine_representation()) {
+            case MachineRepresentation::kWord8:
+                return opd->word8_value();
+            case MachineRepresentation::kWord16:
+                return opd->word16_value();
+            case MachineRepresentation::kWord32:
+                return opd->word32_value();
+            case MachineRepresentation::kWord64:
+                DCHECK(x64::IsIntN(opd->word64_value(), 32));
+                return static_cast<int32_t>(opd->word64_value());
+            default:
+                UNREACHABLE();
+                return 0;
+        }
+    }
+
+    // The symbol of a rip-relative operand is relocated after the instruction has been emitted.
+    x64::Operand ToOperand(InstructionOperand *operand) {
+        switch (operand->kind()) {
+            case InstructionOperand::kAllocated: {
+                auto opd = operand->AsAllocated();
+                DCHECK(opd->IsMemoryLocation());
+                return x64::Operand(x64::Register(opd->register_id()), opd->index());
+            }
+            case InstructionOperand::kConstant: {
+                auto opd = operand->AsConstant();
+                pending_symbol_ = base::Sprintf(opd->type() == ConstantOperand::kString ? "Kstr.%d" : "Knnn.%d",
+                                                opd->symbol_id());
+                pending_offset_ = 0;
+                return x64::Operand(x64::rip, 0);
+            }
+            case InstructionOperand::kReloaction: {
+                auto opd = operand->AsReloaction();
+                DCHECK(opd->is_symbol());
+                pending_symbol_ = opd->symbol_name()->ToString();
+                pending_offset_ = opd->offset();
+                return x64::Operand(x64::rip, 0);
+            }
+            default:
+                UNREACHABLE();
+                return x64::Operand(x64::rip, 0);
+        }
+    }
+
+    // disp32 of rip-relative operand is followed by `trailing' bytes of immediate
+    void Relocate(int trailing = 0) {
+        if (pending_symbol_.empty()) {
+            return;
+        }
+        const int position = asm_.pc() - 4 - trailing;
+        fixups_.push_back({position, pending_symbol_, ElfObjectWriter::kX64PC32, pending_offset_ - 4 - trailing});
+        pending_symbol_.clear();
+    }
+
+    x64::Register Scratch() const { return x64::Register(owns_->profile()->scratch0()); }
+
+    X64ObjectGenerator *const owns_;
+    InstructionFunction *fun_;
+    x64::Assembler asm_;
+    std::map<int, x64::Label> blocks_;
+    std::map<std::string, x64::Label> jumping_positions_;
+    std::vector<Fixup> fixups_;
+    std::vector<JumpTable> jump_tables_;
+    std::string pending_symbol_;
+    int64_t pending_offset_ = 0;
+    int frame_pushed_ = -1;
+    int frame_established_ = -1;
+}; // class X64ObjectGenerator::FunctionGenerator
+
+#define ASM(name) [this](auto lhs, auto rhs) -> decltype(std::declval<x64::Assembler &>().name(lhs, rhs)) { \
+    asm_.name(lhs, rhs); \
+}
+
+void X64ObjectGenerator::FunctionGenerator::Emit(Instruction *instr) {
+    switch (instr->op()) {
+        case ArchNop:
+            asm_.nop();
+            break;
+
+        case ArchDebugBreak:
+        case ArchUnreachable:
+            asm_.int3();
+            break;
+
+        case ArchRet:
+            asm_.ret(0);
+            break;
+
+        case ArchCall:
+            EmitCall(instr->TempAt(0));
+            break;
+
+        case ArchCallNative:
+            EmitCall(instr->InputAt(0));
+            break;
+
+        case ArchTailCall: {
+            if (auto size = FrameScopeHint::GetStackMaxSize(instr); size > 0) {
+                asm_.addq(x64::rsp, size);
+            }
+            asm_.popq(x64::rbp);
+            auto opd = instr->TempAt(1)->AsReloaction();
+            DCHECK(opd->is_symbol());
+            asm_.jmp_rel32(0);
+            fixups_.push_back({asm_.pc() - 4, opd->symbol_name()->ToString(), ElfObjectWriter::kX64PLT32,
+                               opd->offset() - 4});
+        } break;
+
+        case ArchBeforeCall: {
+            for (int i = 0; i < instr->inputs_count(); i++) {
+                EmitPush(instr->InputAt(i));
+            }
+            if (instr->temps_count() > 2 && PrepareCallHint::GetAdjustStackSize(instr) > 0) {
+                asm_.addq(x64::rsp, ToImmediate(instr->TempAt(0)));
+            }
+        } break;
+
+        case ArchAfterCall:
+            if (instr->temps_count() > 2 && PrepareCallHint::GetAdjustStackSize(instr) > 0) {
+                asm_.subq(x64::rsp, ToImmediate(instr->TempAt(0)));
+            }
+            for (int i = instr->inputs_count() - 1; i >= 0; i--) {
+                EmitPush(instr->InputAt(i));
+            }
+            break;
+
+        case ArchStackAlloc:
+            // Ignore
+            break;
+
+        case ArchProfileCount:
+            asm_.incq(ToOperand(instr->InputAt(0)));
+            Relocate();
+            break;
+
+        case ArchFrameEnter:
+            asm_.pushq(x64::rbp);
+            frame_pushed_ = asm_.pc();
+            asm_.movq(x64::rbp, x64::rsp);
+            frame_established_ = asm_.pc();
+            if (auto size = FrameScopeHint::GetStackMaxSize(instr); size > 0) {
+                asm_.subq(x64::rsp, size);
+            }
+            break;
+
+        case ArchFrameExit:
+            if (auto size = FrameScopeHint::GetStackMaxSize(instr); size > 0) {
+                asm_.addq(x64::rsp, size);
+            }
+            asm_.popq(x64::rbp);
+            asm_.ret(0);
+            break;
+
+        case ArchJmp:
+            EmitJump(x64::Always, instr->InputAt(0));
+            break;
+
+        case ArchTableSwitch:
+            EmitTableSwitch(instr);
+            break;
+
+        case ArchStackLoad: {
+            auto field_offset = instr->InputAt(1)->AsImmediate()->word32_value();
+            auto slot = instr->InputAt(0)->AsAllocated();
+            auto out = instr->OutputAt(0)->AsAllocated();
+            x64::Operand src(x64::rbp, slot->index() + field_offset);
+            switch (out->machine_representation()) {
+                case MachineRepresentation::kWord8:
+                    asm_.movb(x64::Register(out->register_id()), src);
+                    break;
+                case MachineRepresentation::kWord16:
+                    asm_.movw(x64::Register(out->register_id()), src);
+                    break;
+                case MachineRepresentation::kWord32:
+                    asm_.movl(x64::Register(out->register_id()), src);
+                    break;
+                case MachineRepresentation::kFloat32:
+                    asm_.movss(x64::XMMRegister(out->register_id()), src);
+                    break;
+                case MachineRepresentation::kFloat64:
+                    asm_.movsd(x64::XMMRegister(out->register_id()), src);
+                    break;
+                default:
+                    asm_.movq(x64::Register(out->register_id()), src);
+                    break;
+            }
+        } break;
+
+        case X64Add8:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(addb));
+            break;
+
+        case X64Add16:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(addw));
+            break;
+
+        case X64Add32:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(addl));
+            break;
+
+        case X64Add:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(addq));
+            break;
+
+        case X64Sub8:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(subb));
+            break;
+
+        case X64Sub16:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(subw));
+            break;
+
+        case X64Sub32:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(subl));
+            break;
+
+        case X64Sub:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(subq));
+            break;
+
+        case X64And32:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(andl));
+            break;
+
+        case X64And:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(andq));
+            break;
+
+        case X64Test:
+            // Commutative: the register operand first.
+            if (IsRegister(instr->InputAt(0))) {
+                EmitBinary(instr->InputAt(1), instr->InputAt(0), ASM(testq), 4);
+            } else {
+                EmitBinary(instr->InputAt(0), instr->InputAt(1), ASM(testq), 4);
+            }
+            break;
+
+        case X64Test32:
+            if (IsRegister(instr->InputAt(0))) {
+                EmitBinary(instr->InputAt(1), instr->InputAt(0), ASM(testl), 4);
+            } else {
+                EmitBinary(instr->InputAt(0), instr->InputAt(1), ASM(testl), 4);
+            }
+            break;
+
+        case X64Movb:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(movb), 1);
+            break;
+
+        case X64Movw:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(movw), 2);
+            break;
+
+        case X64Movl:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(movl), 4);
+            break;
+
+        case X64Movq:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(movq), 4);
+            break;
+
+        // The 16-bits extending writes the whole 32-bits register.
+        case X64Movsxbw:
+        case X64Movsxbl:
+        case X64Movsxbq:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(movsxb));
+            break;
+
+        case X64Movzxbw:
+        case X64Movzxbl:
+        case X64Movzxbq:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(movzxb));
+            break;
+
+        case X64Movsxlq:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(movsxd));
+            break;
+
+        case X64Movsxwb:
+        case X64Movsxwl:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(movsxw));
+            break;
+
+        case X64Movsxwq: {
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(movsxw));
+            auto dst = ToRegister<x64::Register>(instr->OutputAt(0));
+            asm_.movsxd(dst, dst);
+        } break;
+
+        case X64Movzxwb:
+        case X64Movzxwl:
+        case X64Movzxwq:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(movzxw));
+            break;
+
+        case X64Movss:
+            EmitBinary<x64::XMMRegister>(instr->OutputAt(0), instr->InputAt(0), ASM(movss));
+            break;
+
+        case X64Movsd:
+            EmitBinary<x64::XMMRegister>(instr->OutputAt(0), instr->InputAt(0), ASM(movsd));
+            break;
+
+        case X64Lea32:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(leal));
+            break;
+
+        case X64Lea:
+            EmitBinary(instr->OutputAt(0), instr->InputAt(0), ASM(leaq));
+            break;
+
+        case X64Push:
+            EmitPush(instr->InputAt(0));
+            break;
+
+        case X64Pop:
+            if (IsRegister(instr->OutputAt(0))) {
+                asm_.popq(ToRegister<x64::Register>(instr->OutputAt(0)));
+            } else {
+                asm_.popq(ToOperand(instr->OutputAt(0)));
+                Relocate();
+            }
+            break;
+
+        case X64Cmp8:
+            EmitBinary(instr->InputAt(0), instr->InputAt(1), ASM(cmpb));
+            break;
+
+        case X64Cmp16:
+            EmitBinary(instr->InputAt(0), instr->InputAt(1), ASM(cmpw));
+            break;
+
+        case X64Cmp32:
+            EmitBinary(instr->InputAt(0), instr->InputAt(1), ASM(cmpl));
+            break;
+
+        case X64Cmp:
+            EmitBinary(instr->InputAt(0), instr->InputAt(1), ASM(cmpq));
+            break;
+
+        case X64Ja:
+        case X64Jae:
+        case X64Jb:
+        case X64Jbe:
+        case X64Jl:
+        case X64Jle:
+        case X64Jg:
+        case X64Jge:
+        case X64Je:
+        case X64Jne:
+        case X64Jp:
+        case X64Jpe:
+        case X64Jpo:
+        case X64Jc:
+        case X64Jo:
+        case X64Js:
+        case X64Jz:
+        case X64Jnz:
+            EmitJump(ConditionOf(instr->op()), instr->InputAt(0));
+            break;
+
+        case X64Seta:
+        case X64Setae:
+        case X64Setb:
+        case X64Setbe:
+        case X64Setl:
+        case X64Setle:
+        case X64Setg:
+        case X64Setge:
+        case X64Sete:
+        case X64Setne:
+        case X64Setp:
+        case X64Setpe:
+        case X64Setpo:
+        case X64Setc:
+        case X64Seto:
+        case X64Sets:
+        case X64Setz:
+            if (IsRegister(instr->OutputAt(0))) {
+                asm_.set(ConditionOf(instr->op()), ToRegister<x64::Register>(instr->OutputAt(0)));
+            } else {
+                asm_.set(ConditionOf(instr->op()), ToOperand(instr->OutputAt(0)));
+                Relocate();
+            }
+            break;
+
+            // SSE:
+
+        case SSEFloat32Cmp:
+            EmitBinary<x64::XMMRegister>(instr->InputAt(1), instr->InputAt(0), ASM(ucomiss));
+            break;
+
+        case SSEFloat64Cmp:
+            EmitBinary<x64::XMMRegister>(instr->InputAt(1), instr->InputAt(0), ASM(ucomisd));
+            break;
+
+        case SSEFloat32Add:
+            EmitBinary<x64::XMMRegister>(instr->OutputAt(0), instr->InputAt(0), ASM(addss));
+            break;
+
+        case SSEFloat64Add:
+            EmitBinary<x64::XMMRegister>(instr->OutputAt(0), instr->InputAt(0), ASM(addsd));
+            break;
+
+        default:
+            DCHECK(instr->op() < kMaxInstructionCodes);
+            DCHECK(0).Hint("Unexpected instruction code: %s", kInstrCodeNames[instr->op()]);
+            break;
+    }
+}
+
+void X64ObjectGenerator::FunctionGenerator::EmitPush(InstructionOperand *operand) {
+    if (IsRegister(operand)) {
+        asm_.pushq(ToRegister<x64::Register>(operand));
+    } else if (operand->IsImmediate()) {
+        asm_.pushq(ToImmediate(operand));
+    } else {
+        asm_.pushq(ToOperand(operand));
+        Relocate();
+    }
+}
+
+void X64ObjectGenerator::FunctionGenerator::EmitCall(InstructionOperand *target) {
+    switch (target->kind()) {
+        case InstructionOperand::kReloaction: {
+            auto opd = target->AsReloaction();
+            DCHECK(opd->is_symbol());
+            asm_.call_rel32(0);
+            fixups_.push_back({asm_.pc() - 4, opd->symbol_name()->ToString(), ElfObjectWriter::kX64PLT32,
+                               opd->offset() - 4});
+        } break;
+        case InstructionOperand::kAllocated:
+            if (IsRegister(target)) {
+                asm_.call(ToRegister<x64::Register>(target));
+            } else {
+                asm_.call(ToOperand(target));
+            }
+            break;
+        default:
+            UNREACHABLE();
+            break;
+    }
+}
+
+void X64ObjectGenerator::FunctionGenerator::EmitJump(x64::Cond cond, InstructionOperand *target) {
+    auto opd = target->AsReloaction();
+    x64::Label *label = nullptr;
+    if (opd->is_label()) {
+        label = &blocks_[opd->label()->label()];
+    } else if (auto iter = jumping_positions_.find(opd->symbol_name()->ToString());
+               iter != jumping_positions_.end()) {
+        label = &iter->second;
+    }
+    if (label) {
+        asm_.j(cond, label);
+        return;
+    }
+    // Jump to a symbol out of this function
+    if (cond == x64::Always) {
+        asm_.jmp_rel32(0);
+    } else {
+        asm_.j_rel32(cond, 0);
+    }
+    fixups_.push_back({asm_.pc() - 4, opd->symbol_name()->ToString(), ElfObjectWriter::kX64PC32,
+                       opd->offset() - 4});
+}
+
+// See `X64CodeGenerator::FunctionGenerator::EmitTableSwitch'
+void X64ObjectGenerator::FunctionGenerator::EmitTableSwitch(Instruction *instr) {
+    auto selector = instr->InputAt(0)->AsAllocated();
+    DCHECK(selector->IsRegisterLocation());
+    auto lowest = instr->InputAt(1)->AsImmediate()->word32_value();
+    auto slots = instr->inputs_count() - 3;
+    x64::Register value(selector->register_id());
+    x64::Register base(instr->TempAt(0)->AsAllocated()->register_id());
+    auto index = Scratch();
+
+    switch (selector->machine_representation()) {
+        case MachineRepresentation::kBit:
+        case MachineRepresentation::kWord8:
+            asm_.movzxb(index, value);
+            if (lowest != 0) {
+                asm_.subl(index, lowest);
+                asm_.andl(index, 0xff);
+            }
+            asm_.cmpl(index, slots - 1);
+            break;
+        case MachineRepresentation::kWord16:
+            asm_.movzxw(index, value);
+            if (lowest != 0) {
+                asm_.subl(index, lowest);
+                asm_.andl(index, 0xffff);
+            }
+            asm_.cmpl(index, slots - 1);
+            break;
+        case MachineRepresentation::kWord32:
+            asm_.movl(index, value);
+            if (lowest != 0) {
+                asm_.subl(index, lowest);
+            }
+            asm_.cmpl(index, slots - 1);
+            break;
+        default:
+            asm_.movq(index, value);
+            if (lowest != 0) {
+                asm_.subq(index, lowest);
+            }
+            asm_.cmpq(index, slots - 1);
+            break;
+    }
+    EmitJump(x64::Above, instr->InputAt(2));
+    asm_.leaq(base, x64::Operand(x64::rip, 0));
+    JumpTable table;
+    table.lea_disp = asm_.pc() - 4;
+    asm_.movsxd(index, x64::Operand(base, index, x64::times_4, 0));
+    asm_.addq(index, base);
+    asm_.jmp(index);
+    table.position = asm_.pc();
+    for (int i = 0; i < slots; i++) {
+        table.labels.push_back(instr->InputAt(3 + i)->AsReloaction()->label()->label());
+        asm_.dc32(0);
+    }
+    jump_tables_.push_back(std::move(table));
+}
+
+void X64ObjectGenerator::FunctionGenerator::EmitParallelMove(const ParallelMove *moving) {
+    if (!moving) {
+        return; // Dont need emit moving
+    }
+
+    for (auto pair : moving->moves()) {
+        if (pair->should_load_address()) {
+            EmitBinary(pair->mutable_dest(), pair->mutable_src(), ASM(leaq));
+        } else {
+            EmitMove(pair->mutable_dest(), pair->mutable_src());
+        }
+    }
+}
+
+void X64ObjectGenerator::FunctionGenerator::EmitMove(InstructionOperand *dest, InstructionOperand *src) {
+    MachineRepresentation rep = MachineRepresentation::kWord64;
+    if (dest->IsAllocated()) {
+        rep = dest->AsAllocated()->machine_representation();
+    } else if (src->IsImmediate()) {
+        rep = src->AsImmediate()->machine_representation();
+    }
+
+    // mem <- mem: through the scratch register
+    if (!IsRegister(dest) && !IsRegister(src) && !src->IsImmediate()) {
+        auto scratch = AllocatedOperand::Register(rep, Scratch().code());
+        EmitMove(&scratch, src);
+        EmitMove(dest, &scratch);
+        return;
+    }
+
+    switch (rep) {
+        case MachineRepresentation::kWord8:
+            EmitBinary(dest, src, ASM(movb), 1);
+            break;
+        case MachineRepresentation::kWord16:
+            EmitBinary(dest, src, ASM(movw), 2);
+            break;
+        case MachineRepresentation::kWord32:
+            EmitBinary(dest, src, ASM(movl), 4);
+            break;
+        case MachineRepresentation::kFloat32:
+            EmitBinary<x64::XMMRegister>(dest, src, ASM(movss));
+            break;
+        case MachineRepresentation::kFloat64:
+            EmitBinary<x64::XMMRegister>(dest, src, ASM(movsd));
+            break;
+        default:
+            if (IsRegister(dest) && src->IsImmediate() &&
+                !x64::IsIntN(src->AsImmediate()->word64_value(), 32)) {
+                asm_.movq(ToRegister<x64::Register>(dest), src->AsImmediate()->word64_value());
+                break;
+            }
+            EmitBinary(dest, src, ASM(movq), 4);
+            break;
+    }
+}
+
+#undef ASM
+
+X64ObjectGenerator::X64ObjectGenerator(const base::ArenaMap<std::string_view, InstructionFunction *> &funs,
+                                       const RegistersConfiguration *profile,
+                                       ir::Module *module,
+                                       ConstantsPool *const_pool,
+                                       Linkage *symbols,
+                                       ElfObjectWriter *writer)
+: ObjectFileGenerator(funs, profile, module, const_pool, symbols, writer) {
+}
+
+X64ObjectGenerator::~X64ObjectGenerator() = default;
+
+void X64ObjectGenerator::EmitFunction(InstructionFunction *fun) {
+    FunctionGenerator gen(this, fun);
+    gen.EmitAll();
+
+    if (fun->native_handle()) {
+        FunctionGenerator g2(this, fun->native_handle());
+        g2.EmitAll();
+    }
+}
+
+static void AdvanceLoc(std::string *buf, uint32_t delta) {
+    if (delta < 0x40) {
+        buf->push_back(static_cast<char>(DW_CFA_advance_loc | delta));
+    } else if (delta <= UINT8_MAX) {
+        buf->push_back(DW_CFA_advance_loc1);
+        buf->push_back(static_cast<char>(delta));
+    } else if (delta <= UINT16_MAX) {
+        buf->push_back(DW_CFA_advance_loc2);
+        auto value = static_cast<uint16_t>(delta);
+        buf->append(reinterpret_cast<const char *>(&value), sizeof(value));
+    } else {
+        buf->push_back(DW_CFA_advance_loc4);
+        buf->append(reinterpret_cast<const char *>(&delta), sizeof(delta));
+    }
+}
+
+// Pad the entry to the pointer size by nops, then fill the length of it.
+static void FinishCallFrameEntry(std::string *buf, size_t start) {
+    while ((buf->size() - start) % 8) {
+        buf->push_back(DW_CFA_nop);
+    }
+    auto length = static_cast<uint32_t>(buf->size() - start - 4);
+    ::memcpy(&(*buf)[start], &length, sizeof(length));
+}
+
+// Same rules as the .cfi directives of `X64CodeGenerator': one CIE, and one FDE per function:
+// CFA = rsp + 8 at entry, rsp + 16 after `pushq %rbp', rbp + 16 after `movq %rsp, %rbp'.
+void X64ObjectGenerator::EmitCallFrames() {
+    if (call_frames_.empty()) {
+        return;
+    }
+    static constexpr char kTextStart[] = "Ltext.eh";
+    writer_->DefineSymbol(kTextStart, text(), 0, false/*global*/);
+    auto eh = writer_->FindOrInsertSection(kEhFrameSectionName, ElfObjectWriter::kUnwind, 8);
+    auto buf = writer_->mutable_data(eh);
+
+    const auto cie = buf->size();
+    writer_->Append<uint32_t>(eh, 0); // length
+    writer_->Append<uint32_t>(eh, 0); // CIE id
+    buf->push_back(1); // version
+    buf->append("zR", 3); // augmentation
+    buf->push_back(1); // code alignment factor
+    buf->push_back(0x78); // data alignment factor: -8
+    buf->push_back(kDwarfRip); // return address register
+    buf->push_back(1); // augmentation data length
+    buf->push_back(DW_EH_PE_pcrel_sdata4); // encoding of pc_begin in FDEs
+    buf->append({static_cast<char>(DW_CFA_def_cfa), kDwarfRsp, 8});
+    buf->append({static_cast<char>(DW_CFA_offset | kDwarfRip), 1});
+    FinishCallFrameEntry(buf, cie);
+
+    for (const auto &frame : call_frames_) {
+        const auto fde = buf->size();
+        writer_->Append<uint32_t>(eh, 0); // length
+        writer_->Append<uint32_t>(eh, static_cast<uint32_t>(buf->size() - cie)); // CIE pointer
+        writer_->AddRelocation(eh, buf->size(), kTextStart, ElfObjectWriter::kX64PC32,
+                               static_cast<int64_t>(frame.start));
+        writer_->Append<int32_t>(eh, 0); // pc_begin
+        writer_->Append<uint32_t>(eh, static_cast<uint32_t>(frame.size)); // pc_range
+        buf->push_back(0); // augmentation data length
+        if (frame.frame_pushed >= 0) {
+            AdvanceLoc(buf, frame.frame_pushed);
+            buf->append({DW_CFA_def_cfa_offset, 16});
+            buf->append({static_cast<char>(DW_CFA_offset | kDwarfRbp), 2});
+            AdvanceLoc(buf, frame.frame_established - frame.frame_pushed);
+            buf->append({DW_CFA_def_cfa_register, kDwarfRbp});
+        }
+        FinishCallFrameEntry(buf, fde);
+    }
+}
+
+} // namespace yalx::backend
@@ -0,0 +1,47 @@
+#pragma once
+#ifndef YALX_BACKEND_X64_OBJECT_GENERATE_X64_H_
+#define YALX_BACKEND_X64_OBJECT_GENERATE_X64_H_
+
+#include "backend/object-file-generator.h"
+#include "base/arena-utils.h"
+#include <vector>
+
+namespace yalx::backend {
+
+class ConstantsPool;
+class Linkage;
+class InstructionFunction;
+
+// Encode `InstructionFunction's by `x64::Assembler', same instructions as `X64CodeGenerator' prints.
+class X64ObjectGenerator final : public ObjectFileGenerator {
+public:
+    class FunctionGenerator;
+
+    X64ObjectGenerator(const base::ArenaMap<std::string_view, InstructionFunction *> &funs,
+                       const RegistersConfiguration *profile,
+                       ir::Module *module,
+                       ConstantsPool *const_pool,
+                       Linkage *symbols,
+                       ElfObjectWriter *writer);
+    ~X64ObjectGenerator() override;
+
+    friend class X64ObjectGeneratorTest;
+    DISALLOW_IMPLICIT_CONSTRUCTORS(X64ObjectGenerator);
+private:
+    // Offsets are from the start of function, -1: function has no frame.
+    struct CallFrame {
+        uint64_t start; // Offset in the text section
+        uint64_t size;
+        int frame_pushed; // After `pushq %rbp'
+        int frame_established; // After `movq %rsp, %rbp'
+    }; // struct CallFrame
+
+    void EmitFunction(InstructionFunction *fun) override;
+    void EmitCallFrames() override;
+
+    std::vector<CallFrame> call_frames_;
+}; // class X64ObjectGenerator
+
+} // namespace yalx
+
+#endif // YALX_BACKEND_X64_OBJECT_GENERATE_X64_H_
@@ -0,0 +1,269 @@
+#include "backend/x64/peephole-optimize-x64.h"
+#include "backend/x64/code-generate-x64.h"
+#include "backend/x64/lower-posix-x64.h"
+#include "backend/barrier-set.h"
+#include "backend/constants-pool.h"
+#include "backend/linkage-symbols.h"
+#include "backend/registers-configuration.h"
+#include "backend/zero-slot-allocator.h"
+#include "backend/frame.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/type.h"
+#include "ir/operator.h"
+#include "ir/utils.h"
+#include "ir/base-test.h"
+#include "base/io.h"
+
+namespace yalx::backend {
+
+class X64PeepholeOptimizerTest : public ir::BaseTest {
+public:
+    X64PeepholeOptimizerTest(): const_pool_(&arena_), linkage_(&arena_), all_(&arena_) {}
+
+    void SetUp() override {
+        bool ok = true;
+        IRGen("tests/32-code-lower", &all_, &ok);
+        ASSERT_TRUE(ok);
+    }
+
+    std::string GenTo(const char *pkg_name, const char *name) {
+        auto mod = FindModuleOrNull(pkg_name);
+        auto ir_fun = mod->FindFunOrNull(name);
+        X64PosixLower lower(&arena_, RegistersConfiguration::OfPosixX64(), &linkage_,
+                            &const_pool_, BarrierSet::OfYGCPosixX64());
+        auto fun = lower.VisitFunction(ir_fun);
+        ZeroSlotAllocator allocator{arena(), RegistersConfiguration::OfPosixX64(), fun};
+        allocator.Run();
+        X64PeepholeOptimizer optimizer(arena(), RegistersConfiguration::OfPosixX64());
+        optimizer.Run(fun);
+        return GenTo(mod, fun);
+    }
+
+    std::string GenTo(ir::Module *root, InstructionFunction *fun) {
+        base::ArenaMap<std::string_view, InstructionFunction *> funs(arena());
+        funs[fun->symbol()->ToSlice()] = fun;
+
+        std::string buf;
+        auto file = base::NewMemoryWritableFile(&buf);
+        base::PrintingWriter printer{file, true};
+        X64CodeGenerator gen(funs, RegistersConfiguration::OfPosixX64(), root, &const_pool_, &linkage_, &printer);
+        gen.EmitFunction(fun);
+        return buf;
+    }
+
+    InstructionFunction *NewFunction(const char *name) {
+        auto module = FindModuleOrNull("main:main");
+        auto prototype = new (arena()) ir::PrototypeModel(arena(), String::kEmpty, false/*vargs*/);
+        auto symbol = String::New(arena(), name);
+        auto frame = new (arena()) Frame(arena(), module->NewFunction(ir::Function::kDefault, symbol, symbol,
+                                                                       prototype));
+        return new (arena()) InstructionFunction(arena(), symbol, frame);
+    }
+
+    Instruction *Emit(InstructionBlock *block, InstructionCode op, std::vector<InstructionOperand> outputs,
+                      std::vector<InstructionOperand> inputs) {
+        auto instr = Instruction::New(arena(), op, inputs.size(), inputs.data(), outputs.size(), outputs.data(), 0,
+                                      nullptr);
+        block->Add(instr);
+        return instr;
+    }
+
+    static AllocatedOperand Reg(int id) { return AllocatedOperand::Register(MachineRepresentation::kWord64, id); }
+
+    ir::Module *FindModuleOrNull(std::string_view full_name) const {
+        if (auto iter = all_.find(full_name); iter != all_.end()) {
+            return iter->second;
+        } else {
+            return nullptr;
+        }
+    }
+
+protected:
+    Linkage linkage_;
+    ConstantsPool const_pool_;
+    base::ArenaMap<std::string_view, ir::Module *> all_;
+}; // class X64PeepholeOptimizerTest
+
+TEST_F(X64PeepholeOptimizerTest, ForwardStoredValue) {
+    auto expected = GenTo("main:main", "issue02_simple_add");
+    static constexpr char z[] = R"(.global main_Zomain_Zdissue02_simple_add
+main_Zomain_Zdissue02_simple_add:
+.cfi_startproc
+Lblk0:
+    pushq %rbp
+    .cfi_def_cfa_offset 16
+    .cfi_offset %rbp, -16
+    movq %rsp, %rbp
+    .cfi_def_cfa_register %rbp
+    subq $16, %rsp
+    movl $1, %eax
+    addl $2, %eax
+    movl %eax, -4(%rbp)
+    movl %eax, 28(%rbp)
+    addq $16, %rsp
+    popq %rbp
+    retq
+.cfi_endproc
+)";
+    ASSERT_EQ(z, expected) << expected;
+}
+
+TEST_F(X64PeepholeOptimizerTest, GetValFields) {
+    auto expected = GenTo("main:main", "issue10_get_fields");
+    static constexpr char z[] = R"(.global main_Zomain_Zdissue10_get_fields
+main_Zomain_Zdissue10_get_fields:
+.cfi_startproc
+Lblk0:
+    pushq %rbp
+    .cfi_def_cfa_offset 16
+    .cfi_offset %rbp, -16
+    movq %rsp, %rbp
+    .cfi_def_cfa_register %rbp
+    subq $48, %rsp
+    leaq -24(%rbp), %rax
+    movq %rax, -32(%rbp)
+    addq $16, %rsp
+    movl $2, %esi
+    movl $3, %edx
+    movq -32(%rbp), %rdi
+    callq main_Zomain_ZdVertx2_ZdVertx2_Z4constructor
+    subq $16, %rsp
+    movl -8(%rbp), %eax
+    movl %eax, -36(%rbp)
+    movl -4(%rbp), %eax
+    movl %eax, -40(%rbp)
+    movl -36(%rbp), %eax
+    addl -40(%rbp), %eax
+    movl %eax, -44(%rbp)
+    movl %eax, 28(%rbp)
+    addq $48, %rsp
+    popq %rbp
+    retq
+.cfi_endproc
+)";
+    ASSERT_EQ(z, expected) << expected;
+}
+
+TEST_F(X64PeepholeOptimizerTest, CombineLeaAndAdd) {
+    auto expected = GenTo("main:main", "issue13_simple_load_barrier");
+    static constexpr char z[] = R"(.global main_Zomain_Zdissue13_simple_load_barrier
+main_Zomain_Zdissue13_simple_load_barrier:
+.cfi_startproc
+Lblk0:
+    pushq %rbp
+    .cfi_def_cfa_offset 16
+    .cfi_offset %rbp, -16
+    movq %rsp, %rbp
+    .cfi_def_cfa_register %rbp
+    subq $64, %rsp
+    leaq -32(%rbp), %rax
+    movq %rax, -40(%rbp)
+    addq $16, %rsp
+    movq Kstr.0(%rip), %rsi
+    movq Kstr.1(%rip), %rdx
+    movl $0, %ecx
+    movq -40(%rbp), %rdi
+    callq main_Zomain_ZdIdent2_ZdIdent2_Z4constructor
+    subq $16, %rsp
+    movq -16(%rbp), %rax
+    movq %rax, -56(%rbp)
+    movq YGC_ADDRESS_BAD_MASK(%rip), %r13
+    testq -56(%rbp), %r13
+    jz Jpt_0
+    pushq %rax
+    pushq %rdi
+    pushq %rsi
+    pushq %r15
+    leaq -16(%rbp), %rdi
+    callq ygc_barrier_load_on_field
+    movq %rax, -56(%rbp)
+    pushq %r15
+    pushq %rsi
+    pushq %rdi
+    pushq %rax
+Jpt_0:
+    movq -56(%rbp), %r13
+    movq %r13, 24(%rbp)
+    addq $64, %rsp
+    popq %rbp
+    retq
+.cfi_endproc
+)";
+    ASSERT_EQ(z, expected) << expected;
+}
+
+TEST_F(X64PeepholeOptimizerTest, JumpingToNextBlock) {
+    auto fun = NewFunction("jumping");
+    auto b0 = fun->NewBlock(0);
+    auto b1 = fun->NewBlock(1);
+    auto b2 = fun->NewBlock(2);
+    // b0: jump to b1 with moves before jumping
+    Emit(b0, X64Add, {Reg(0)}, {ImmediateOperand{1}});
+    auto jmp = Emit(b0, ArchJmp, {}, {ReloactionOperand{b1}});
+    jmp->GetOrNewParallelMove(Instruction::kStart, arena())->AddMove(Reg(1), Reg(0), arena());
+    // b1: jump to b0 is not removable
+    Emit(b1, ArchJmp, {}, {ReloactionOperand{b0}});
+    // b2: the last block
+    Emit(b2, ArchJmp, {}, {ReloactionOperand{b0}});
+
+    X64PeepholeOptimizer optimizer(arena(), RegistersConfiguration::OfPosixX64());
+    optimizer.Run(fun);
+    EXPECT_EQ(1, optimizer.removed_jumps());
+    ASSERT_EQ(1, b0->instructions_size());
+    auto moves = b0->instruction(0)->parallel_move(Instruction::kEnd);
+    ASSERT_NE(nullptr, moves);
+    ASSERT_EQ(1, moves->moves_size());
+    auto reg1 = Reg(1);
+    EXPECT_TRUE(moves->move(0)->dest().Equals(&reg1));
+    EXPECT_EQ(1, b1->instructions_size());
+    EXPECT_EQ(1, b2->instructions_size());
+}
+
+TEST_F(X64PeepholeOptimizerTest, RedundantMoves) {
+    auto fun = NewFunction("moves");
+    auto b0 = fun->NewBlock(0);
+    auto fp = RegistersConfiguration::OfPosixX64()->fp();
+    auto slot = AllocatedOperand::Slot(MachineRepresentation::kWord64, fp, -8);
+    auto instr = Emit(b0, X64Add, {Reg(0)}, {ImmediateOperand{1}});
+    auto moves = instr->GetOrNewParallelMove(Instruction::kEnd, arena());
+    moves->AddMove(slot, Reg(0), arena());
+    moves->AddMove(Reg(1), slot, arena()); // => Reg(1) <- Reg(0)
+    moves->AddMove(Reg(0), Reg(1), arena()); // Reg(0) already holds the value: removed
+    moves->AddMove(slot, Reg(1), arena()); // slot already holds the value: removed
+    // Calling clobbers everything.
+    auto call = Emit(b0, ArchCall, {}, {ReloactionOperand{String::New(arena(), "foo")}});
+    call->GetOrNewParallelMove(Instruction::kEnd, arena())->AddMove(Reg(2), slot, arena());
+
+    X64PeepholeOptimizer optimizer(arena(), RegistersConfiguration::OfPosixX64());
+    optimizer.Run(fun);
+    EXPECT_EQ(2, optimizer.removed_moves());
+    EXPECT_EQ(1, optimizer.forwarded_moves());
+    ASSERT_EQ(2, moves->moves_size());
+    auto reg0 = Reg(0);
+    EXPECT_TRUE(moves->move(1)->src().Equals(&reg0));
+    EXPECT_TRUE(call->parallel_move(Instruction::kEnd)->move(0)->src().Equals(&slot));
+}
+
+TEST_F(X64PeepholeOptimizerTest, CombineMoveAndAdd) {
+    auto fun = NewFunction("lea");
+    auto b0 = fun->NewBlock(0);
+    auto add = Emit(b0, X64Add, {Reg(0)}, {ImmediateOperand{8}});
+    add->GetOrNewParallelMove(Instruction::kStart, arena())->AddMove(Reg(0), Reg(3), arena());
+    // Compare with zero
+    Emit(b0, X64Cmp, {}, {Reg(0), ImmediateOperand{0}});
+    Emit(b0, X64Jz, {}, {ReloactionOperand{b0}});
+
+    X64PeepholeOptimizer optimizer(arena(), RegistersConfiguration::OfPosixX64());
+    optimizer.Run(fun);
+    EXPECT_EQ(2, optimizer.combined_instructions());
+    ASSERT_EQ(3, b0->instructions_size());
+    EXPECT_EQ(X64Lea, b0->instruction(0)->op());
+    auto before = b0->instruction(0)->parallel_move(Instruction::kStart);
+    EXPECT_TRUE(!before || before->moves().empty());
+    EXPECT_EQ(8, b0->instruction(0)->InputAt(0)->AsAllocated()->index());
+    EXPECT_EQ(3, b0->instruction(0)->InputAt(0)->AsAllocated()->register_id());
+    EXPECT_EQ(X64Test, b0->instruction(1)->op());
+}
+
+} // namespace yalx::backend
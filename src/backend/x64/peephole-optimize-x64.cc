@@ -0,0 +1,164 @@
+#include "backend/x64/peephole-optimize-x64.h"
+#include "backend/registers-configuration.h"
+#include <cstdint>
+
+namespace yalx::backend {
+
+#define X64_READING_FLAGS_LIST(V) \
+    V(Ja)   V(Jae)   V(Jb)   V(Jbe)   V(Jc)   V(Je)   V(Jz)   V(Jg)   V(Jge)   V(Jl)   V(Jle)   V(Jna)   \
+    V(Jnae) V(Jnb)   V(Jnbe) V(Jnc)   V(Jne)  V(Jng)  V(Jnge) V(Jnl)  V(Jnle)  V(Jno)  V(Jnp)   V(Jns)   \
+    V(Jnz)  V(Jo)    V(Jp)   V(Jpe)   V(Jpo)  V(Js)                                                     \
+    V(Seta) V(Setae) V(Setb) V(Setbe) V(Setc) V(Sete) V(Setz) V(Setg) V(Setge) V(Setl) V(Setle) V(Setna) \
+    V(Setnae) V(Setnb) V(Setnbe) V(Setnc) V(Setne) V(Setng) V(Setnge) V(Setnl) V(Setnle) V(Setno)     \
+    V(Setnp) V(Setns) V(Setnz) V(Seto) V(Setp) V(Setpe) V(Setpo) V(Sets)
+
+#define X64_WRITING_FLAGS_LIST(V) \
+    V(Add)  V(Add8) V(Add16) V(Add32) V(Sub)  V(Sub8) V(Sub16) V(Sub32) V(And) V(And32) V(Or) V(Or32) \
+    V(Xor)  V(Xor32) V(Cmp)  V(Cmp32) V(Cmp16) V(Cmp8) V(Test) V(Test32) V(Test16) V(Test8)           \
+    V(Inc32) V(Dec32) V(Neg) V(Neg32) V(Shl) V(Shl32) V(Shr) V(Shr32) V(Sar) V(Sar32)
+
+#define X64_WRITING_OUTPUTS_ONLY_LIST(V) \
+    X64_WRITING_FLAGS_LIST(V) \
+    V(Not) V(Not32) V(Lea) V(Lea32) V(Movb) V(Movw) V(Movl) V(Movq) V(Movss) V(Movsd)          \
+    V(Movsxbw) V(Movzxbw) V(Movsxbl) V(Movzxbl) V(Movsxbq) V(Movzxbq) V(Movsxwb) V(Movzxwb)    \
+    V(Movsxwl) V(Movzxwl) V(Movsxwq) V(Movzxwq) V(Movsxlq)
+
+#define DEFINE_CASE(name) case X64##name:
+
+X64PeepholeOptimizer::X64PeepholeOptimizer(base::Arena *arena, const RegistersConfiguration *regconf)
+: PeepholeOptimizer(arena, regconf) {
+}
+
+bool X64PeepholeOptimizer::Combine(InstructionBlock *block, size_t position) {
+    return CombineLeaAndArith(block, position) ||
+           CombineMoveAndAdd(block, position) ||
+           SimplifyCmpWithZero(block, position);
+}
+
+bool X64PeepholeOptimizer::IsWritingOutputsOnly(Instruction *instr) const {
+    switch (instr->op()) {
+        X64_READING_FLAGS_LIST(DEFINE_CASE)
+        X64_WRITING_OUTPUTS_ONLY_LIST(DEFINE_CASE)
+            return true;
+        default:
+            return PeepholeOptimizer::IsWritingOutputsOnly(instr);
+    }
+}
+
+// {ptr $0} = X64Lea {none fp-32}
+// {ptr $0} = X64Add #16
+// ----------------------------
+// {ptr $0} = X64Lea {none fp-16}
+bool X64PeepholeOptimizer::CombineLeaAndArith(InstructionBlock *block, size_t position) {
+    auto lea = InstructionAt(block, position);
+    auto arith = InstructionAt(block, position + 1);
+    if (!lea || (lea->op() != X64Lea && lea->op() != X64Lea32) || !IsAdjacent(lea, arith)) {
+        return false;
+    }
+    int sign = 0;
+    if (arith->op() == (lea->op() == X64Lea ? X64Add : X64Add32)) {
+        sign = 1;
+    } else if (arith->op() == (lea->op() == X64Lea ? X64Sub : X64Sub32)) {
+        sign = -1;
+    } else {
+        return false;
+    }
+    int32_t imm = 0;
+    if (!arith->OutputAt(0)->Equals(lea->OutputAt(0)) || !GetImmediate32(arith->InputAt(0), &imm)) {
+        return false;
+    }
+    auto address = lea->InputAt(0)->AsAllocated();
+    if (!address || !address->IsMemoryLocation() || IsFlagsLive(block, position + 2)) {
+        return false;
+    }
+    auto offset = static_cast<int64_t>(address->index()) + sign * static_cast<int64_t>(imm);
+    if (offset < INT32_MIN || offset > INT32_MAX) {
+        return false;
+    }
+
+    InstructionOperand output = *lea->OutputAt(0);
+    InstructionOperand input = address->IsSlot()
+            ? AllocatedOperand::Slot(address->machine_representation(), address->register_id(),
+                                     static_cast<int>(offset))
+            : AllocatedOperand::Location(address->machine_representation(), address->register_id(),
+                                         static_cast<int>(offset));
+    Replace(block, position, 2, NewInstruction(lea->op(), 1, &output, 1, &input));
+    return true;
+}
+
+// Move {qword $0} <- {qword $3}
+// {qword $0} = X64Add #8
+// ----------------------------
+// {qword $0} = X64Lea {none $3+8}
+bool X64PeepholeOptimizer::CombineMoveAndAdd(InstructionBlock *block, size_t position) {
+    auto add = InstructionAt(block, position);
+    if (!add || (add->op() != X64Add && add->op() != X64Add32) || add->is_jumping_dest()) {
+        return false;
+    }
+    auto moves = add->mutable_parallel_move(Instruction::kStart);
+    if (!moves || moves->moves().empty()) {
+        return false;
+    }
+    auto move = moves->moves().back();
+    auto output = add->OutputAt(0)->AsAllocated();
+    auto dest = move->dest().AsAllocated();
+    auto src = move->src().AsAllocated();
+    if (!output || !output->IsRegisterLocation() || !dest || !dest->Equals(output) || move->should_load_address() ||
+        !src || !src->IsRegisterLocation() || src->machine_representation() != output->machine_representation()) {
+        return false;
+    }
+    int32_t imm = 0;
+    if (!GetImmediate32(add->InputAt(0), &imm) || IsFlagsLive(block, position + 1)) {
+        return false;
+    }
+
+    moves->mutable_moves()->pop_back();
+    InstructionOperand out = *output;
+    InstructionOperand input = AllocatedOperand::Location(MachineRepresentation::kNone, src->register_id(), imm);
+    Replace(block, position, 1, NewInstruction(add->op() == X64Add ? X64Lea : X64Lea32, 1, &out, 1, &input));
+    return true;
+}
+
+// X64Cmp {qword $0}, #0
+// ----------------------------
+// X64Test {qword $0}, {qword $0}
+// `test' has the same flags as `cmp' with zero: ZF, SF and PF of the value, CF = OF = 0, but is shorter.
+bool X64PeepholeOptimizer::SimplifyCmpWithZero(InstructionBlock *block, size_t position) {
+    auto cmp = InstructionAt(block, position);
+    if (!cmp || (cmp->op() != X64Cmp && cmp->op() != X64Cmp32) || cmp->is_jumping_dest()) {
+        return false;
+    }
+    int32_t imm = -1;
+    if (!AllocatedOpdOperator::IsRegister(cmp->InputAt(0)) || !GetImmediate32(cmp->InputAt(1), &imm) || imm != 0) {
+        return false;
+    }
+    InstructionOperand inputs[] = {*cmp->InputAt(0), *cmp->InputAt(0)};
+    Replace(block, position, 1, NewInstruction(cmp->op() == X64Cmp ? X64Test : X64Test32, 0, nullptr, 2, inputs));
+    return true;
+}
+
+bool X64PeepholeOptimizer::IsFlagsLive(InstructionBlock *block, size_t position) {
+    for (size_t i = position; i < block->instructions_size(); i++) {
+        switch (block->instruction(i)->op()) {
+            X64_READING_FLAGS_LIST(DEFINE_CASE)
+                return true;
+            X64_WRITING_FLAGS_LIST(DEFINE_CASE)
+            case ArchJmp:
+            case ArchTableSwitch:
+            case ArchRet:
+            case ArchCall:
+            case ArchTailCall:
+            case ArchCallNative:
+            case ArchBeforeCall:
+            case ArchFrameExit:
+                return false;
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+#undef DEFINE_CASE
+
+} // namespace yalx::backend
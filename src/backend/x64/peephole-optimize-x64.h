@@ -0,0 +1,31 @@
+#pragma once
+#ifndef YALX_BACKEND_X64_PEEPHOLE_OPTIMIZE_X64_H
+#define YALX_BACKEND_X64_PEEPHOLE_OPTIMIZE_X64_H
+
+#include "backend/peephole-optimizer.h"
+
+namespace yalx::backend {
+
+// x64 combinations:
+// * lea + add/sub immediate into one lea: `leaq -32(%rbp), %rax; addq $16, %rax' => `leaq -16(%rbp), %rax'
+// * move + add immediate into a three operands lea: `movq %rbx, %rax; addq $8, %rax' => `leaq 8(%rbx), %rax'
+// * compare with zero into test: `cmpq $0, %rax; jz L' => `testq %rax, %rax; jz L'
+class X64PeepholeOptimizer final : public PeepholeOptimizer {
+public:
+    X64PeepholeOptimizer(base::Arena *arena, const RegistersConfiguration *regconf);
+
+private:
+    bool Combine(InstructionBlock *block, size_t position) override;
+    bool IsWritingOutputsOnly(Instruction *instr) const override;
+
+    bool CombineLeaAndArith(InstructionBlock *block, size_t position);
+    bool CombineMoveAndAdd(InstructionBlock *block, size_t position);
+    bool SimplifyCmpWithZero(InstructionBlock *block, size_t position);
+
+    // The flags be read by instructions start at `position' before be written again?
+    static bool IsFlagsLive(InstructionBlock *block, size_t position);
+}; // class X64PeepholeOptimizer
+
+} // namespace yalx::backend
+
+#endif // YALX_BACKEND_X64_PEEPHOLE_OPTIMIZE_X64_H
@@ -191,6 +191,7 @@ void ZeroSlotAllocator::VisitBlock(InstructionBlock *block) {
                 break;
 
             case ArchFrameExit:
+            case ArchTailCall: // Also tears down the frame
                 frame_exit_.push_back(instr);
                 break;
 
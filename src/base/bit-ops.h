@@ -123,8 +123,7 @@ struct Bits {
 
 /*static*/ inline int Bits::CountTrailingZeros64(uint64_t x) {
     if ((x & 0x00000000FFFFFFFFULL) == 0) {
-        x = (x & 0x00000000FFFFFFFFULL) << 32;
-        return 32 + CountTrailingZeros32(static_cast<uint32_t>(x));
+        return 32 + CountTrailingZeros32(static_cast<uint32_t>(x >> 32));
     } else {
         return CountTrailingZeros32(static_cast<uint32_t>(x));
     }
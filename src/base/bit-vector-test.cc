@@ -0,0 +1,47 @@
+#include "base/bit-vector.h"
+#include <gtest/gtest.h>
+
+namespace yalx::base {
+
+TEST(BitVectorTest, Sanity) {
+    BitVector bits(130);
+    EXPECT_EQ(130, bits.length());
+    EXPECT_EQ(0, bits.Count());
+    bits.Add(0);
+    bits.Add(63);
+    bits.Add(64);
+    bits.Add(129);
+    EXPECT_TRUE(bits.Contains(63));
+    EXPECT_TRUE(bits.Contains(64));
+    EXPECT_FALSE(bits.Contains(65));
+    EXPECT_EQ(4, bits.Count());
+    bits.Remove(63);
+    EXPECT_FALSE(bits.Contains(63));
+
+    std::vector<int> indices;
+    bits.ForEach([&indices](int i) { indices.push_back(i); });
+    EXPECT_EQ((std::vector<int>{0, 64, 129}), indices);
+}
+
+TEST(BitVectorTest, SetOperations) {
+    BitVector a(100), b(100);
+    a.Add(1);
+    a.Add(70);
+    b.Add(70);
+    b.Add(99);
+    EXPECT_TRUE(a.Union(b));
+    EXPECT_FALSE(a.Union(b));
+    EXPECT_EQ(3, a.Count());
+
+    a.Subtract(b);
+    EXPECT_EQ(1, a.Count());
+    EXPECT_TRUE(a.Contains(1));
+
+    BitVector c(100);
+    c.Add(1);
+    EXPECT_TRUE(a.Equals(c));
+    c.Reset(100);
+    EXPECT_EQ(0, c.Count());
+}
+
+} // namespace yalx::base
@@ -0,0 +1,96 @@
+#pragma once
+#ifndef YALX_BASE_BIT_VECTOR_H_
+#define YALX_BASE_BIT_VECTOR_H_
+
+#include "base/bit-ops.h"
+#include "base/checking.h"
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+namespace yalx::base {
+
+// Fixed length dense bit set, set operations work on whole 64 bits words.
+class BitVector final {
+public:
+    static constexpr size_t kBitsPerWord = 64;
+
+    BitVector() = default;
+    explicit BitVector(size_t length): length_(length), words_(WordsOf(length), 0) {}
+
+    size_t length() const { return length_; }
+
+    // Resize and clear all bits
+    void Reset(size_t length) {
+        length_ = length;
+        words_.assign(WordsOf(length), 0);
+    }
+
+    void Clear() { std::fill(words_.begin(), words_.end(), 0); }
+
+    bool Contains(size_t i) const {
+        DCHECK(i < length_);
+        return (words_[i / kBitsPerWord] & Bit(i)) != 0;
+    }
+
+    void Add(size_t i) {
+        DCHECK(i < length_);
+        words_[i / kBitsPerWord] |= Bit(i);
+    }
+
+    void Remove(size_t i) {
+        DCHECK(i < length_);
+        words_[i / kBitsPerWord] &= ~Bit(i);
+    }
+
+    // this = this | other, returns true if any bit has been changed.
+    bool Union(const BitVector &other) {
+        DCHECK(length_ == other.length_);
+        uint64_t changed = 0;
+        for (size_t i = 0; i < words_.size(); i++) {
+            auto word = words_[i] | other.words_[i];
+            changed |= word ^ words_[i];
+            words_[i] = word;
+        }
+        return changed != 0;
+    }
+
+    // this = this & ~other
+    void Subtract(const BitVector &other) {
+        DCHECK(length_ == other.length_);
+        for (size_t i = 0; i < words_.size(); i++) {
+            words_[i] &= ~other.words_[i];
+        }
+    }
+
+    bool Equals(const BitVector &other) const { return length_ == other.length_ && words_ == other.words_; }
+
+    size_t Count() const {
+        size_t n = 0;
+        for (auto word : words_) {
+            n += Bits::CountOne32(static_cast<uint32_t>(word)) + Bits::CountOne32(static_cast<uint32_t>(word >> 32));
+        }
+        return n;
+    }
+
+    // Call `callback' with every index of bits setted, in ascending order.
+    template<class Callback>
+    void ForEach(Callback &&callback) const {
+        for (size_t i = 0; i < words_.size(); i++) {
+            for (auto word = words_[i]; word != 0; word &= word - 1) {
+                callback(static_cast<int>(i * kBitsPerWord + Bits::CountTrailingZeros64(word)));
+            }
+        }
+    }
+
+private:
+    static size_t WordsOf(size_t length) { return (length + kBitsPerWord - 1) / kBitsPerWord; }
+    static uint64_t Bit(size_t i) { return uint64_t{1} << (i % kBitsPerWord); }
+
+    size_t length_ = 0;
+    std::vector<uint64_t> words_;
+}; // class BitVector
+
+} // namespace yalx::base
+
+#endif // YALX_BASE_BIT_VECTOR_H_
@@ -0,0 +1,55 @@
+#include "base/thread-pool.h"
+#include "gtest/gtest.h"
+#include <atomic>
+
+namespace yalx::base {
+
+TEST(ThreadPoolTest, Sanity) {
+    ThreadPool pool(4);
+    EXPECT_EQ(4, pool.workers());
+    EXPECT_EQ(4, pool.slots());
+
+    std::atomic<int> sum = 0;
+    std::vector<int> workers(100, -1);
+    for (int i = 0; i < 100; i++) {
+        pool.Post([&sum, &workers, i] (int worker) {
+            sum += i;
+            workers[i] = worker;
+        });
+    }
+    pool.Wait();
+    EXPECT_EQ(4950, sum.load());
+    for (auto worker : workers) {
+        EXPECT_LE(0, worker);
+        EXPECT_GT(4, worker);
+    }
+
+    // Reusing after waiting
+    pool.Post([&sum] (int) { sum = 0; });
+    pool.Wait();
+    EXPECT_EQ(0, sum.load());
+}
+
+TEST(ThreadPoolTest, NoWorkers) {
+    ThreadPool pool(0);
+    EXPECT_EQ(0, pool.workers());
+    EXPECT_EQ(1, pool.slots());
+
+    std::vector<int> order;
+    for (int i = 0; i < 3; i++) {
+        pool.Post([&order, i] (int worker) {
+            EXPECT_EQ(0, worker);
+            order.push_back(i);
+        });
+    }
+    pool.Wait();
+    EXPECT_EQ((std::vector<int>{0, 1, 2}), order);
+}
+
+TEST(ThreadPoolTest, WaitWithoutTasks) {
+    ThreadPool pool(2);
+    pool.Wait();
+    EXPECT_LE(1, ThreadPool::HardwareConcurrency());
+}
+
+} // namespace yalx::base
@@ -0,0 +1,68 @@
+#include "base/thread-pool.h"
+
+namespace yalx::base {
+
+ThreadPool::ThreadPool(int workers)
+: workers_(workers > 0 ? workers : 0) {
+    for (int i = 0; i < workers_; i++) {
+        threads_.emplace_back(&ThreadPool::Work, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutting_down_ = true;
+    }
+    has_task_.notify_all();
+    for (auto &thread : threads_) {
+        thread.join();
+    }
+}
+
+void ThreadPool::Post(Task &&task) {
+    if (workers_ == 0) {
+        task(0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+        pending_++;
+    }
+    has_task_.notify_one();
+}
+
+void ThreadPool::Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    all_done_.wait(lock, [this] { return pending_ == 0; });
+}
+
+int ThreadPool::HardwareConcurrency() {
+    auto n = static_cast<int>(std::thread::hardware_concurrency());
+    return n > 0 ? n : 1;
+}
+
+void ThreadPool::Work(int worker) {
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            has_task_.wait(lock, [this] { return shutting_down_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return; // Shutting down
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task(worker);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--pending_ == 0) {
+                all_done_.notify_all();
+            }
+        }
+    }
+}
+
+} // namespace yalx::base
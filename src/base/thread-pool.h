@@ -0,0 +1,54 @@
+#pragma once
+#ifndef YALX_BASE_THREAD_POOL_H_
+#define YALX_BASE_THREAD_POOL_H_
+
+#include "base/base.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <deque>
+#include <thread>
+#include <vector>
+
+namespace yalx::base {
+
+// Fixed number of worker threads run posted tasks in posting order.
+// A task gets the index of worker which runs it, so it can use states owned by the worker, e.g. an arena, without
+// any locking. No worker thread if `workers' is 0: tasks run in the posting thread as worker 0.
+class ThreadPool final {
+public:
+    using Task = std::function<void (int worker)>;
+
+    explicit ThreadPool(int workers);
+    ~ThreadPool();
+
+    DEF_VAL_GETTER(int, workers);
+
+    // Number of states which are indexed by worker, at least 1.
+    int slots() const { return workers_ > 0 ? workers_ : 1; }
+
+    void Post(Task &&task);
+
+    // Wait for all posted tasks done.
+    void Wait();
+
+    // Number of hardware threads, at least 1.
+    static int HardwareConcurrency();
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(ThreadPool);
+private:
+    void Work(int worker);
+
+    const int workers_;
+    std::vector<std::thread> threads_;
+    std::deque<Task> tasks_;
+    std::mutex mutex_;
+    std::condition_variable has_task_;
+    std::condition_variable all_done_;
+    int pending_ = 0;
+    bool shutting_down_ = false;
+}; // class ThreadPool
+
+} // namespace yalx::base
+
+#endif // YALX_BASE_THREAD_POOL_H_
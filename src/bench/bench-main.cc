@@ -0,0 +1,33 @@
+#include "bench/bench.h"
+#include "base/env.h"
+#include "base/at-exit.h"
+#include <cstdio>
+#include <cstring>
+
+namespace yalx::bench {
+
+void Report(const char *name, const char *which, size_t ops, std::chrono::nanoseconds cost) {
+    ::printf("[%s] %-12s %8zd ops, %8.2f ns/op\n", name, which, ops,
+             static_cast<double>(cost.count()) / static_cast<double>(ops));
+}
+
+} // namespace yalx::bench
+
+// Usage: yalx-bench [name-filter]
+int main(int argc, char *argv[]) {
+    using namespace yalx::bench;
+    yalx::base::Env::Init();
+    yalx::base::AtExit at_exit(yalx::base::AtExit::INITIALIZER);
+
+    static const Benchmark kAll[] = {
+        {"HashTable", HashTableBenchmark},
+        {"RegisterAllocator", RegisterAllocatorBenchmark},
+    };
+    const char *filter = argc > 1 ? argv[1] : "";
+    for (const auto &bench : kAll) {
+        if (::strstr(bench.name, filter)) {
+            bench.run();
+        }
+    }
+    return 0;
+}
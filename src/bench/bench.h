@@ -0,0 +1,34 @@
+#pragma once
+#ifndef YALX_BENCH_BENCH_H_
+#define YALX_BENCH_BENCH_H_
+
+#include <chrono>
+#include <cstddef>
+
+namespace yalx::bench {
+
+// Benchmarks are plain functions out of gtest: timing is never a pass/fail condition, run them by yalx-bench.
+struct Benchmark {
+    const char *name;
+    void (*run)();
+};
+
+void HashTableBenchmark();
+void RegisterAllocatorBenchmark();
+
+class Stopwatch {
+public:
+    Stopwatch(): jiffy_(std::chrono::steady_clock::now()) {}
+
+    std::chrono::nanoseconds Elapsed() const { return std::chrono::steady_clock::now() - jiffy_; }
+
+private:
+    std::chrono::steady_clock::time_point jiffy_;
+}; // class Stopwatch
+
+// Print a line: [name] case: n ops, ns/op
+void Report(const char *name, const char *which, size_t ops, std::chrono::nanoseconds cost);
+
+} // namespace yalx::bench
+
+#endif // YALX_BENCH_BENCH_H_
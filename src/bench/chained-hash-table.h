@@ -0,0 +1,41 @@
+#pragma once
+#ifndef YALX_BENCH_CHAINED_HASH_TABLE_H_
+#define YALX_BENCH_CHAINED_HASH_TABLE_H_
+
+#include "runtime/hash-table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The former chained hash table of runtime, only for comparing with the Swiss table in benchmarks.
+
+struct chained_hash_table_slot {
+    struct chained_hash_table_slot *prev;
+    struct chained_hash_table_slot *next;
+    uint32_t hash_code;
+    int key_size;
+    int value_size;
+    char key[1];
+};
+
+struct chained_hash_table {
+    int size;     // size of key-pairs
+    int capacity_shift; // capacity of slots
+    float rehash_factor;
+    struct chained_hash_table_slot *slots;
+};
+
+void chained_init_hash_table(struct chained_hash_table *map, float rehash_factor);
+void chained_free_hash_table(struct chained_hash_table *map);
+
+hash_table_value_span_t chained_hash_table_put(struct chained_hash_table *map, const void *key, size_t key_size,
+                                               size_t value_size);
+hash_table_value_span_t chained_hash_table_get(struct chained_hash_table *map, const void *key, size_t len);
+void chained_hash_table_remove(struct chained_hash_table *map, const void *key, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // YALX_BENCH_CHAINED_HASH_TABLE_H_
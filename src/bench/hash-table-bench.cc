@@ -0,0 +1,108 @@
+#include "bench/bench.h"
+#include "bench/chained-hash-table.h"
+#include "runtime/hash-table.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace yalx::bench {
+
+namespace {
+
+struct ChainedTable {
+    static constexpr const char kName[] = "ChainedHashTable";
+
+    ChainedTable() { chained_init_hash_table(&map, 0); }
+    ~ChainedTable() { chained_free_hash_table(&map); }
+
+    void *Put(const std::string &key, size_t size) {
+        return chained_hash_table_put(&map, key.data(), key.size(), size).value;
+    }
+    void *Get(const std::string &key) { return chained_hash_table_get(&map, key.data(), key.size()).value; }
+    void Remove(const std::string &key) { chained_hash_table_remove(&map, key.data(), key.size()); }
+
+    chained_hash_table map;
+}; // struct ChainedTable
+
+struct SwissTable {
+    static constexpr const char kName[] = "SwissHashTable";
+
+    SwissTable() { yalx_init_hash_table(&map, 0); }
+    ~SwissTable() { yalx_free_hash_table(&map); }
+
+    void *Put(const std::string &key, size_t size) {
+        return yalx_hash_table_put(&map, key.data(), key.size(), size).value;
+    }
+    void *Get(const std::string &key) { return yalx_hash_table_get(&map, key.data(), key.size()).value; }
+    void Remove(const std::string &key) { yalx_hash_table_remove(&map, key.data(), key.size()); }
+
+    hash_table map;
+}; // struct SwissTable
+
+// Keys look like symbols of runtime: half short ones, half long ones out of the inline key.
+std::vector<std::string> MakeKeys(int n, const char *prefix) {
+    std::vector<std::string> keys;
+    char buf[64];
+    for (int i = 0; i < n; i++) {
+        ::snprintf(buf, sizeof(buf), i % 2 ? "%sk.%d" : "%syalx/lang:lang.long-key.%d", prefix, i);
+        keys.emplace_back(buf);
+    }
+    return keys;
+}
+
+template<class Table>
+void RunWorkload(const std::vector<std::string> &keys, const std::vector<std::string> &misses) {
+    static constexpr int kRounds = 5;
+    std::chrono::nanoseconds put = std::chrono::nanoseconds::max(), get = put, miss = put, remove = put;
+    size_t checksum = 0;
+    for (int round = 0; round < kRounds; round++) {
+        Table table;
+        Stopwatch put_watch;
+        for (size_t i = 0; i < keys.size(); i++) {
+            *static_cast<size_t *>(table.Put(keys[i], sizeof(size_t))) = i;
+        }
+        put = std::min(put, put_watch.Elapsed());
+
+        Stopwatch get_watch;
+        for (const auto &key : keys) {
+            checksum += *static_cast<size_t *>(table.Get(key));
+        }
+        get = std::min(get, get_watch.Elapsed());
+
+        Stopwatch miss_watch;
+        for (const auto &key : misses) {
+            checksum += table.Get(key) != nullptr;
+        }
+        miss = std::min(miss, miss_watch.Elapsed());
+
+        Stopwatch remove_watch;
+        for (const auto &key : keys) {
+            table.Remove(key);
+        }
+        remove = std::min(remove, remove_watch.Elapsed());
+    }
+    Report(Table::kName, "put", keys.size(), put);
+    Report(Table::kName, "get", keys.size(), get);
+    Report(Table::kName, "get(miss)", misses.size(), miss);
+    Report(Table::kName, "remove", keys.size(), remove);
+    // Keep the lookups alive.
+    if (checksum == 0) {
+        ::puts("unexpected checksum");
+    }
+}
+
+} // namespace
+
+void HashTableBenchmark() {
+    for (int n : {1000, 100000}) {
+        auto keys = MakeKeys(n, "");
+        auto misses = MakeKeys(n, "miss.");
+        ::printf("-- %d keys, best of 5 rounds\n", n);
+        RunWorkload<ChainedTable>(keys, misses);
+        RunWorkload<SwissTable>(keys, misses);
+    }
+}
+
+} // namespace yalx::bench
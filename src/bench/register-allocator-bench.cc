@@ -0,0 +1,123 @@
+#include "bench/bench.h"
+#include "backend/register-allocator.h"
+#include "backend/registers-configuration.h"
+#include "backend/instruction.h"
+#include "backend/frame.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/operators-factory.h"
+#include <cstdio>
+#include <vector>
+
+namespace yalx::bench {
+
+namespace {
+
+using namespace backend;
+
+// Same synthetic function as RegisterAllocatorTest: chain of diamonds, every block computes `n' values from the
+// previous two and few long-living values of entry block.
+class DiamondsBuilder {
+public:
+    static constexpr int kLongLiving = 4;
+
+    DiamondsBuilder(base::Arena *arena, ir::OperatorsFactory *ops): arena_(arena), ops_(ops) {}
+
+    InstructionFunction *Build(int diamonds, int n) {
+        auto name = String::New(arena_, "main");
+        auto module = new (arena_) ir::Module(arena_, name, String::New(arena_, "main:main"), name,
+                                              String::New(arena_, "project/src/main"));
+        auto prototype = new (arena_) ir::PrototypeModel(arena_, String::kEmpty, false/*vargs*/);
+        auto frame = new (arena_) Frame(arena_, module->NewFunction(ir::Function::kDefault, name,
+                                                                    String::New(arena_, "main:main.main"),
+                                                                    prototype));
+        auto fun = new (arena_) InstructionFunction(arena_, String::New(arena_, "foo"), frame);
+        int label = 0;
+        auto entry = fun->NewBlock(label++);
+        fun->set_entry(entry);
+
+        std::vector<int> longs;
+        for (int i = 0; i < kLongLiving; i++) {
+            longs.push_back(NewVR(frame));
+            UnallocatedOperand output(UnallocatedOperand::kRegisterOrSlot, longs.back());
+            entry->Add(Instruction::New(arena_, ArchNop, 0, nullptr, 1, &output, 0, nullptr));
+        }
+        int a = longs[0], b = longs[1];
+        auto prev = entry;
+        for (int i = 0; i < diamonds; i++) {
+            auto head = fun->NewBlock(label++);
+            auto left = fun->NewBlock(label++);
+            auto right = fun->NewBlock(label++);
+            auto join = fun->NewBlock(label++);
+            Link(prev, head);
+            Link(head, left);
+            Link(head, right);
+            Link(left, join);
+            Link(right, join);
+
+            EmitValues(frame, head, longs, n, &a, &b);
+            int la = a, lb = b;
+            EmitValues(frame, left, longs, n, &la, &lb);
+            la = a, lb = b;
+            EmitValues(frame, right, longs, n, &la, &lb);
+            EmitValues(frame, join, longs, n, &a, &b);
+            prev = join;
+        }
+        for (auto vr : longs) {
+            UnallocatedOperand input(UnallocatedOperand::kRegisterOrSlot, vr);
+            prev->Add(Instruction::New(arena_, ArchNop, 1, &input, 0, nullptr, 0, nullptr));
+        }
+        return fun;
+    }
+
+private:
+    void EmitValues(Frame *frame, InstructionBlock *block, const std::vector<int> &longs, int n, int *a, int *b) {
+        for (int i = 0; i < n; i++) {
+            InstructionOperand inputs[2];
+            inputs[0] = UnallocatedOperand(UnallocatedOperand::kMustHaveRegister, *a);
+            inputs[1] = UnallocatedOperand(UnallocatedOperand::kRegisterOrSlot,
+                                           i % 8 == 0 ? longs[(i / 8) % longs.size()] : *b);
+            UnallocatedOperand output(UnallocatedOperand::kMustHaveRegister, NewVR(frame));
+            block->Add(Instruction::New(arena_, ArchNop, 2, inputs, 1, &output, 0, nullptr));
+            *b = *a;
+            *a = output.virtual_register();
+        }
+    }
+
+    int NewVR(Frame *frame) {
+        auto value = ir::Value::New(arena_, ir::SourcePosition::Unknown(), ir::Types::Int32, ops_->Argument(0));
+        return frame->GetVirtualRegister(value);
+    }
+
+    static void Link(InstructionBlock *from, InstructionBlock *to) {
+        from->AddSuccessor(to);
+        to->AddPredecessors(from);
+    }
+
+    base::Arena *const arena_;
+    ir::OperatorsFactory *const ops_;
+}; // class DiamondsBuilder
+
+size_t CountInstructions(InstructionFunction *fun) {
+    size_t n = 0;
+    for (auto block : fun->blocks()) { n += block->instructions_size(); }
+    return n;
+}
+
+} // namespace
+
+void RegisterAllocatorBenchmark() {
+    for (int size : {10, 50}) {
+        base::Arena arena;
+        ir::OperatorsFactory ops(&arena);
+        auto fun = DiamondsBuilder(&arena, &ops).Build(size/*diamonds*/, size/*values*/);
+        ::printf("-- %d diamonds, %zd instructions, %zd blocks\n", size, CountInstructions(fun),
+                 fun->blocks_size());
+        Stopwatch watch;
+        RegisterAllocator allocator(&arena, RegistersConfiguration::OfPosixX64(), fun);
+        allocator.Run();
+        Report("RegisterAllocator", "run", CountInstructions(fun), watch.Elapsed());
+    }
+}
+
+} // namespace yalx::bench
@@ -0,0 +1,185 @@
+#include "compiler/build-cache.h"
+#include "compiler/compiler.h"
+#include "compiler/syntax-feedback.h"
+#include "compiler/source-position.h"
+#include "compiler/ast.h"
+#include "base/arena.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+namespace yalx::cpl {
+
+class BuildCacheTest : public ::testing::Test {
+public:
+    class MockErrorFeedback : public SyntaxFeedback {
+    public:
+        void DidFeedback(const SourcePosition &location, const char *z, size_t n) override {
+            ::printf("[%s:(%d,%d)-(%d,%d)] %s\n", file_name().data(), location.begin_line(),
+                     location.begin_column(),
+                     location.end_line(), location.end_column(), z);
+        }
+
+        void DidFeedback(const char *z) override {
+            ::puts(z);
+        }
+    }; // class MockErrorFeedback
+
+    void SetUp() override {
+        root_ = std::filesystem::temp_directory_path() / ("yalx-build-cache-test-" + std::to_string(::getpid()));
+        std::filesystem::remove_all(root_);
+        std::filesystem::create_directories(root_);
+        std::filesystem::copy("tests/02-import-2-pkg", root_ / "project", std::filesystem::copy_options::recursive);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(root_);
+    }
+
+    // Parse the project again, as a new build.
+    Package *Parse(base::Arena *arena) {
+        auto project_dir = (root_ / "project").string();
+        Package *pkg = nullptr;
+        auto rs = Compiler::FindAndParseMainSourceFiles(project_dir, arena, &feedback_, &pkg);
+        EXPECT_TRUE(rs.ok()) << rs.ToString();
+        if (rs.fail()) {
+            return nullptr;
+        }
+        std::vector<std::string> search_paths{project_dir + "/src", project_dir + "/pkg", "libs"};
+        base::ArenaMap<std::string_view, Package *> all(arena);
+        rs = Compiler::FindAndParseAllDependenciesSourceFiles(search_paths, arena, &feedback_, pkg, &all);
+        EXPECT_TRUE(rs.ok()) << rs.ToString();
+        EXPECT_EQ(4, all.size());
+        return rs.ok() ? pkg : nullptr;
+    }
+
+    static std::vector<std::string> PathsOf(const std::vector<Package *> &pkgs) {
+        std::vector<std::string> paths;
+        for (auto pkg : pkgs) {
+            paths.push_back(pkg->path()->ToString());
+        }
+        return paths;
+    }
+
+    // Build all of stale packages, the artifact is the path of package.
+    static void StoreAll(BuildCache *cache, const std::vector<Package *> &stale) {
+        for (auto pkg : stale) {
+            auto rs = cache->Store(pkg, {{"s", pkg->path()->ToString()}});
+            ASSERT_TRUE(rs.ok()) << rs.ToString();
+        }
+    }
+
+    std::string cache_dir() const { return (root_ / "cache").string(); }
+
+protected:
+    std::filesystem::path root_;
+    MockErrorFeedback feedback_;
+}; // class BuildCacheTest
+
+TEST_F(BuildCacheTest, Sanity) {
+    base::Arena arena;
+    auto pkg = Parse(&arena);
+    ASSERT_NE(nullptr, pkg);
+
+    BuildCache cache(cache_dir(), BuildCache::FlagsOf(1, false, ""));
+    ASSERT_TRUE(cache.KeyOf(pkg).empty());
+    auto rs = cache.ComputeKeys(pkg);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    EXPECT_EQ(64, cache.KeyOf(pkg).size());
+
+    std::vector<Package *> stale;
+    cache.FindStale(pkg, &stale);
+    ASSERT_EQ(5, stale.size());
+    EXPECT_EQ(pkg, stale.back());
+    std::string artifact;
+    EXPECT_TRUE(cache.Load(pkg, "s", &artifact).IsNotFound());
+    StoreAll(&cache, stale);
+
+    EXPECT_TRUE(cache.IsHit(pkg));
+    rs = cache.Load(pkg, "s", &artifact);
+    ASSERT_TRUE(rs.ok()) << rs.ToString();
+    EXPECT_EQ("main", artifact);
+    EXPECT_TRUE(cache.Store(pkg, {{BuildCache::kKeyKind, ""}}).IsInvalidArgument());
+    EXPECT_FALSE(cache.IsHit(pkg));
+}
+
+TEST_F(BuildCacheTest, HitAfterRebuilding) {
+    std::string key;
+    {
+        base::Arena arena;
+        auto pkg = Parse(&arena);
+        ASSERT_NE(nullptr, pkg);
+        BuildCache cache(cache_dir(), BuildCache::FlagsOf(1, false, ""));
+        ASSERT_TRUE(cache.ComputeKeys(pkg).ok());
+        std::vector<Package *> stale;
+        cache.FindStale(pkg, &stale);
+        StoreAll(&cache, stale);
+        key = cache.KeyOf(pkg);
+    }
+
+    base::Arena arena;
+    auto pkg = Parse(&arena);
+    ASSERT_NE(nullptr, pkg);
+    BuildCache cache(cache_dir(), BuildCache::FlagsOf(1, false, ""));
+    ASSERT_TRUE(cache.ComputeKeys(pkg).ok());
+    EXPECT_EQ(key, cache.KeyOf(pkg));
+    std::vector<Package *> stale;
+    cache.FindStale(pkg, &stale);
+    EXPECT_TRUE(stale.empty());
+
+    std::string artifact;
+    ASSERT_TRUE(cache.Load(pkg->dependence(0), "s", &artifact).ok());
+    EXPECT_EQ(pkg->dependence(0)->path()->ToString(), artifact);
+}
+
+TEST_F(BuildCacheTest, InvalidateDependents) {
+    {
+        base::Arena arena;
+        auto pkg = Parse(&arena);
+        ASSERT_NE(nullptr, pkg);
+        BuildCache cache(cache_dir(), BuildCache::FlagsOf(1, false, ""));
+        ASSERT_TRUE(cache.ComputeKeys(pkg).ok());
+        std::vector<Package *> stale;
+        cache.FindStale(pkg, &stale);
+        StoreAll(&cache, stale);
+    }
+
+    // main -> bar -> demo
+    std::ofstream(root_ / "project/pkg/github.com/emptyland/demo/demo.yalx", std::ios::app) << "\n// changed\n";
+
+    base::Arena arena;
+    auto pkg = Parse(&arena);
+    ASSERT_NE(nullptr, pkg);
+    BuildCache cache(cache_dir(), BuildCache::FlagsOf(1, false, ""));
+    ASSERT_TRUE(cache.ComputeKeys(pkg).ok());
+    std::vector<Package *> stale;
+    cache.FindStale(pkg, &stale);
+    EXPECT_EQ((std::vector<std::string>{"github.com/emptyland/demo", "bar", "main"}), PathsOf(stale));
+    for (auto dep : pkg->dependences()) {
+        if (dep->path()->ToSlice() == "foo" || dep->path()->ToSlice() == Compiler::kDefaultImport) {
+            EXPECT_TRUE(cache.IsHit(dep)) << dep->path()->ToSlice();
+        }
+    }
+}
+
+TEST_F(BuildCacheTest, InvalidateByFlags) {
+    base::Arena arena;
+    auto pkg = Parse(&arena);
+    ASSERT_NE(nullptr, pkg);
+    {
+        BuildCache cache(cache_dir(), BuildCache::FlagsOf(0, false, ""));
+        ASSERT_TRUE(cache.ComputeKeys(pkg).ok());
+        std::vector<Package *> stale;
+        cache.FindStale(pkg, &stale);
+        StoreAll(&cache, stale);
+    }
+
+    BuildCache cache(cache_dir(), BuildCache::FlagsOf(1, false, ""));
+    ASSERT_TRUE(cache.ComputeKeys(pkg).ok());
+    std::vector<Package *> stale;
+    cache.FindStale(pkg, &stale);
+    EXPECT_EQ(5, stale.size());
+}
+
+} // namespace yalx::cpl
@@ -0,0 +1,219 @@
+#include "compiler/build-cache.h"
+#include "compiler/compiler.h"
+#include "compiler/ast.h"
+#include "base/env.h"
+#include "base/io.h"
+#include "base/format.h"
+extern "C" {
+#include "base/sha256.h"
+}
+#include <algorithm>
+#include <filesystem>
+
+namespace yalx::cpl {
+
+    namespace {
+
+        class Hasher final {
+        public:
+            Hasher() { ::sha256_init(&ctx_); }
+
+            // Length-prefixed, so the boundaries of fields are a part of the key
+            void Update(std::string_view data) {
+                uint8_t len[8];
+                for (int i = 0; i < 8; i++) {
+                    len[i] = static_cast<uint8_t>(static_cast<uint64_t>(data.size()) >> (i * 8));
+                }
+                ::sha256_update(&ctx_, len, sizeof(len));
+                ::sha256_update(&ctx_, reinterpret_cast<const BYTE *>(data.data()), data.size());
+            }
+
+            std::string Final() {
+                static const char hex[] = "0123456789abcdef";
+                BYTE hash[SHA256_BLOCK_SIZE];
+                ::sha256_final(&ctx_, hash);
+                std::string key;
+                for (auto b : hash) {
+                    key.append(1, hex[b >> 4]).append(1, hex[b & 0xf]);
+                }
+                return key;
+            }
+
+            DISALLOW_IMPLICIT_CONSTRUCTORS(Hasher);
+        private:
+            SHA256_CTX ctx_;
+        }; // class Hasher
+
+        std::string HashOf(std::string_view data) {
+            Hasher hasher;
+            hasher.Update(data);
+            return hasher.Final();
+        }
+
+    } // namespace
+
+    BuildCache::BuildCache(std::string dir, std::string flags)
+        : dir_(std::move(dir))
+        , flags_(std::move(flags)) {
+    }
+
+    base::Status BuildCache::ComputeKeys(Package *entry) {
+        std::map<const Package *, bool> computing;
+        return ComputeKey(entry, &computing);
+    }
+
+    std::string_view BuildCache::KeyOf(const Package *pkg) const {
+        if (auto iter = keys_.find(pkg); iter != keys_.end()) {
+            return iter->second;
+        }
+        return "";
+    }
+
+    bool BuildCache::IsHit(const Package *pkg) const {
+        auto key = KeyOf(pkg);
+        if (key.empty()) {
+            return false;
+        }
+        std::string stored;
+        return ReadFile(FileOf(pkg, kKeyKind), &stored).ok() && stored == key;
+    }
+
+    void BuildCache::FindStale(Package *entry, std::vector<Package *> *stale) const {
+        std::map<const Package *, bool> visited;
+        FindStale(entry, &visited, stale);
+    }
+
+    base::Status BuildCache::Load(const Package *pkg, std::string_view kind, std::string *artifact) const {
+        if (!IsHit(pkg)) {
+            return ERR_NOT_FOUND();
+        }
+        return ReadFile(FileOf(pkg, kind), artifact);
+    }
+
+    base::Status BuildCache::Store(const Package *pkg, const std::map<std::string, std::string> &artifacts) {
+        auto key = KeyOf(pkg);
+        if (key.empty()) {
+            return ERR_INVALID_ARGUMENT("Key of package has not been computed");
+        }
+        std::error_code ec;
+        std::filesystem::create_directories(dir_, ec);
+        if (ec) {
+            return ERR_CORRUPTION(ec.message());
+        }
+        // Drop the key first, so artifacts written partially will never be a hit.
+        std::filesystem::remove(FileOf(pkg, kKeyKind), ec);
+        for (const auto &[kind, artifact] : artifacts) {
+            if (kind.compare(kKeyKind) == 0) {
+                return ERR_INVALID_ARGUMENT("Artifact kind is reserved");
+            }
+            if (auto rs = WriteFile(FileOf(pkg, kind), artifact); rs.fail()) {
+                return rs;
+            }
+        }
+        return WriteFile(FileOf(pkg, kKeyKind), key);
+    }
+
+    std::string BuildCache::FlagsOf(int optimization, bool profile_generate, const std::string &profile_use) {
+        auto flags = base::Sprintf("O%d;profile-generate=%d;profile-use=", optimization, profile_generate);
+        if (!profile_use.empty()) {
+            // The profile is an input of optimizing, so key with its contents.
+            std::string profile;
+            if (ReadFile(profile_use, &profile).ok()) {
+                flags.append(HashOf(profile));
+            } else {
+                flags.append(profile_use);
+            }
+        }
+        return flags;
+    }
+
+    base::Status BuildCache::ComputeKey(Package *pkg, std::map<const Package *, bool> *computing) {
+        if (keys_.find(pkg) != keys_.end()) {
+            return base::Status::OK();
+        }
+        if (auto iter = computing->find(pkg); iter != computing->end()) {
+            return ERR_CORRUPTION("Import ring");
+        }
+        (*computing)[pkg] = true;
+        for (auto dep : pkg->dependences()) {
+            if (auto rs = ComputeKey(dep, computing); rs.fail()) {
+                return rs;
+            }
+        }
+
+        Hasher hasher;
+        hasher.Update(Compiler::kVersion);
+        hasher.Update(flags_);
+        hasher.Update(pkg->path()->ToSlice());
+
+        std::vector<const FileUnit *> files(pkg->source_files().begin(), pkg->source_files().end());
+        std::sort(files.begin(), files.end(), [](const FileUnit *a, const FileUnit *b) {
+            return a->file_full_path()->ToSlice() < b->file_full_path()->ToSlice();
+        });
+        for (auto file : files) {
+            std::string content;
+            if (auto rs = ReadFile(file->file_full_path()->ToString(), &content); rs.fail()) {
+                return rs;
+            }
+            hasher.Update(file->file_full_path()->ToSlice());
+            hasher.Update(content);
+        }
+
+        // Keys of dependencies in order of importing, any change of them is a change of this package.
+        for (auto dep : pkg->dependences()) {
+            hasher.Update(keys_[dep]);
+        }
+        keys_[pkg] = hasher.Final();
+        computing->erase(pkg);
+        return base::Status::OK();
+    }
+
+    void BuildCache::FindStale(Package *pkg, std::map<const Package *, bool> *visited,
+                               std::vector<Package *> *stale) const {
+        if (visited->find(pkg) != visited->end()) {
+            return;
+        }
+        (*visited)[pkg] = true;
+        for (auto dep : pkg->dependences()) {
+            FindStale(dep, visited, stale);
+        }
+        if (!IsHit(pkg)) {
+            stale->push_back(pkg);
+        }
+    }
+
+    std::string BuildCache::FileOf(const Package *pkg, std::string_view kind) const {
+        // Names of packages are not unique, hash of the full path tells them apart.
+        auto path_hash = HashOf(pkg->full_path()->ToSlice()).substr(0, 16);
+        std::string name(dir_);
+        name.append("/").append(pkg->name()->ToSlice()).append("-").append(path_hash);
+        return name.append(".").append(kind);
+    }
+
+    base::Status BuildCache::ReadFile(const std::string &name, std::string *content) {
+        std::unique_ptr<base::SequentialFile> file;
+        if (auto rs = base::Env::NewSequentialFile(name, &file); rs.fail()) {
+            return rs;
+        }
+        size_t size = 0;
+        if (auto rs = file->Available(&size); rs.fail()) {
+            return rs;
+        }
+        std::string_view text;
+        std::string scratch;
+        if (auto rs = file->Read(size, &text, &scratch); rs.fail()) {
+            return rs;
+        }
+        content->assign(text.data(), text.size());
+        return base::Status::OK();
+    }
+
+    base::Status BuildCache::WriteFile(const std::string &name, std::string_view content) {
+        std::unique_ptr<base::WritableFile> file;
+        if (auto rs = base::Env::NewWritableFile(name, false/*append*/, &file); rs.fail()) {
+            return rs;
+        }
+        return file->Append(content);
+    }
+
+} // namespace yalx::cpl
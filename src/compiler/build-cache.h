@@ -0,0 +1,67 @@
+#pragma once
+#ifndef YALX_COMPILER_BUILD_CACHE_H_
+#define YALX_COMPILER_BUILD_CACHE_H_
+
+#include "base/status.h"
+#include "base/base.h"
+#include <string_view>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace yalx::cpl {
+
+    class Package;
+
+    // Persistent cache of artifacts of packages (e.g. the emitted assembly), for rebuilding changed packages only.
+    // Files in the cache directory, per package:
+    //   <name>-<hash of full path>.key     key of the package when its artifacts were stored
+    //   <name>-<hash of full path>.<kind>  artifacts
+    // Key of a package is the SHA-256 of compiler version, build flags, paths and contents of its source files, and
+    // keys of packages it imports. So a changed package invalidates all of packages which reach it through the import
+    // graph, and a package is a hit only if its sources and all of its dependencies are unchanged.
+    class BuildCache final {
+    public:
+        BuildCache(std::string dir, std::string flags);
+
+        DEF_VAL_GETTER(std::string, dir);
+
+        // Compute keys of `entry' and all of packages reached by it.
+        base::Status ComputeKeys(Package *entry);
+
+        // Hex key of package, empty if it has not been computed.
+        std::string_view KeyOf(const Package *pkg) const;
+
+        // Are the stored artifacts of package built from the same key?
+        bool IsHit(const Package *pkg) const;
+
+        // Packages reached by `entry' which must be rebuilt, dependencies go first.
+        void FindStale(Package *entry, std::vector<Package *> *stale) const;
+
+        base::Status Load(const Package *pkg, std::string_view kind, std::string *artifact) const;
+
+        // Replace all of stored artifacts of package, then record its key.
+        base::Status Store(const Package *pkg, const std::map<std::string, std::string> &artifacts);
+
+        // Options which change the output of compiling.
+        static std::string FlagsOf(int optimization, bool profile_generate, const std::string &profile_use);
+
+        static constexpr char kKeyKind[] = "key";
+
+        DISALLOW_IMPLICIT_CONSTRUCTORS(BuildCache);
+    private:
+        base::Status ComputeKey(Package *pkg, std::map<const Package *, bool> *computing);
+        void FindStale(Package *pkg, std::map<const Package *, bool> *visited, std::vector<Package *> *stale) const;
+        std::string FileOf(const Package *pkg, std::string_view kind) const;
+
+        static base::Status ReadFile(const std::string &name, std::string *content);
+        static base::Status WriteFile(const std::string &name, std::string_view content);
+
+        const std::string dir_;
+        const std::string flags_;
+        std::map<const Package *, std::string> keys_;
+    }; // class BuildCache
+
+} // namespace yalx::cpl
+
+#endif // YALX_COMPILER_BUILD_CACHE_H_
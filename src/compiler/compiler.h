@@ -140,6 +140,7 @@ public:
     static constexpr char kPackageDirName[] = "pkg";
     static constexpr char kMainPkgName[] = "main";
     static constexpr char kDefaultImport[] = "yalx/lang";
+    static constexpr char kVersion[] = "yalx-lang v0.0.0";
 
     DISALLOW_ALL_CONSTRUCTORS(Compiler);
 }; // class Compiler
@@ -3,6 +3,7 @@
 #include "ir/metadata.h"
 #include "ir/node.h"
 #include "ir/operators-factory.h"
+#include "ir/utils.h"
 #include "compiler/compiler.h"
 #include "compiler/syntax-feedback.h"
 #include "compiler/source-position.h"
@@ -50,4 +51,71 @@ void BaseTest::IRGen(const char *project_dir, base::ArenaMap<std::string_view, M
     *ok = true;
 }
 
+Module *BaseTest::NewMainModule() {
+    auto name = String::New(arena(), "main");
+    auto full_name = String::New(arena(), "main:main");
+    auto path = String::New(arena(), "main");
+    auto full_path = String::New(arena(), "project/src/main");
+    return new (arena()) Module(arena(), name, full_name, path, full_path);
+}
+
+void ModuleTest::SetUp() {
+    module_ = NewMainModule();
+    modules_[module_->full_name()->ToSlice()] = module_;
+}
+
+Function *ModuleTest::NewFun(const char *name, const std::vector<Type> &params,
+                             const std::vector<Type> &returning) {
+    auto prototype = new (arena()) PrototypeModel(arena(), String::kEmpty, false/*vargs*/);
+    for (auto param : params) {
+        prototype->mutable_params()->push_back(param);
+    }
+    for (auto type : returning) {
+        prototype->mutable_return_types()->push_back(type);
+    }
+    auto fun = module_->NewFunction(Function::kDefault, String::New(arena(), name),
+                                    String::New(arena(), std::string("main:main.") + name), prototype);
+    for (size_t i = 0; i < params.size(); i++) {
+        auto param = Value::New(arena(), SourcePosition::Unknown(), params[i], ops()->Argument(i));
+        fun->mutable_paramaters()->push_back(param);
+    }
+    return fun;
+}
+
+BasicBlock *ModuleTest::NewBlock(Function *fun, const char *name) {
+    return fun->NewBlock(String::New(arena(), name));
+}
+
+Value *ModuleTest::I32(int32_t value) {
+    return Value::New(arena(), SourcePosition::Unknown(), Types::Int32, ops()->I32Constant(value));
+}
+
+void ModuleTest::Goto(BasicBlock *from, BasicBlock *to) {
+    from->NewNode(SourcePosition::Unknown(), Types::Void, ops()->Br(0/*value_in*/, 1/*control_out*/), to);
+    from->LinkTo(to);
+}
+
+void ModuleTest::Branch(BasicBlock *from, Value *cond, BasicBlock *if_true, BasicBlock *if_false) {
+    from->NewNode(SourcePosition::Unknown(), Types::Void, ops()->Br(1/*value_in*/, 2/*control_out*/), cond,
+                  if_true, if_false);
+    from->LinkTo(if_true);
+    from->LinkTo(if_false);
+}
+
+void ModuleTest::ReplacePhiInput(BasicBlock *pred, Value *phi, int i, Value *value) {
+    auto origin = phi->InputValue(i);
+    phi->Replace(arena(), i, origin, value);
+    for (auto &user : *pred->mutable_phi_node_users()) {
+        if (user.phi == phi && user.dest == origin) { user.dest = value; }
+    }
+}
+
+std::string ModuleTest::PrintFun(Function *fun) {
+    std::string buf;
+    base::PrintingWriter printer(base::NewMemoryWritableFile(&buf), true/*ownership*/);
+    PrintingContext ctx(0);
+    fun->PrintTo(&ctx, &printer);
+    return buf;
+}
+
 } // namespace yalx::ir
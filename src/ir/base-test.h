@@ -2,6 +2,7 @@
 #ifndef YALX_IR_BASE_TEST_H_
 #define YALX_IR_BASE_TEST_H_
 
+#include "ir/type.h"
 #include "compiler/syntax-feedback.h"
 #include "base/arena-utils.h"
 #include "base/base.h"
@@ -12,6 +13,9 @@ namespace ir {
 
 class OperatorsFactory;
 class Module;
+class Function;
+class BasicBlock;
+class Value;
 
 class BaseTest : public ::testing::Test {
 public:
@@ -26,6 +30,9 @@ public:
     
     void IRGen(const char *project_dir, base::ArenaMap<std::string_view, Module *> *modules, bool *ok);
     
+    // Empty module main:main at project/src/main
+    Module *NewMainModule();
+    
 protected:
     base::Arena ast_arena_;
     base::Arena arena_;
@@ -33,6 +40,29 @@ protected:
     cpl::SyntaxFeedback *feedback_;
 }; // class BaseTest
 
+// Base of tests which build functions in module main:main by hand, instead of generating them from a project.
+class ModuleTest : public BaseTest {
+public:
+    void SetUp() override;
+    
+    // fun name(params...): returning..., the parameters are arguments in order.
+    Function *NewFun(const char *name, const std::vector<Type> &params, const std::vector<Type> &returning);
+    BasicBlock *NewBlock(Function *fun, const char *name);
+    Value *I32(int32_t value);
+    
+    void Goto(BasicBlock *from, BasicBlock *to);
+    void Branch(BasicBlock *from, Value *cond, BasicBlock *if_true, BasicBlock *if_false);
+    
+    // Loop back value is unknown at creating phi, so replace it later.
+    void ReplacePhiInput(BasicBlock *pred, Value *phi, int i, Value *value);
+    
+    static std::string PrintFun(Function *fun);
+    
+protected:
+    Module *module_ = nullptr;
+    base::ArenaMap<std::string_view, Module *> modules_{arena()};
+}; // class ModuleTest
+
 } // namespace ir
 } // namespace yalx
 
@@ -64,6 +64,9 @@ struct IConditionId {
         return {code};
     }
     
+    bool operator == (const IConditionId &other) const { return value == other.value; }
+    bool operator != (const IConditionId &other) const { return !operator == (other); }
+    
     [[nodiscard]] const char *ToString() const;
     
     const Value value;
@@ -81,6 +84,9 @@ struct FConditionId {
         return {code};
     }
     
+    bool operator == (const FConditionId &other) const { return value == other.value; }
+    bool operator != (const FConditionId &other) const { return !operator == (other); }
+    
     const char *ToString() const;
     
     const Value value;
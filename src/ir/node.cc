@@ -570,6 +570,25 @@ void Value::Replace(base::Arena *arena, int position, Value *from, Value *to) {
     to->AddUser(arena, this, position);
 }
 
+void Value::ReplaceUsesWith(base::Arena *arena, Value *to) {
+    for (auto [position, user] : GetUsers()) {
+        user->Replace(arena, position, this, to);
+        if (user->Is(Operator::kPhi)) {
+            for (auto &phi_user : *user->InputControl(position)->mutable_phi_node_users()) {
+                if (phi_user.phi == user && phi_user.dest == this) { phi_user.dest = to; }
+            }
+        }
+    }
+}
+
+void Value::KillWithInputs() {
+    for (int i = 0; i < op()->value_in(); i++) {
+        auto input = InputValue(i);
+        input->RemoveUser(DCHECK_NOTNULL(input->FindUser(this, i)));
+    }
+    Kill();
+}
+
 void Value::PrintTo(PrintingContext *ctx, base::PrintingWriter *printer) const {
     DCHECK(op()->value() >= 0);
     DCHECK(op()->value() < Operator::kMaxValues);
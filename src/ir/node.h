@@ -83,6 +83,9 @@ public:
     DEF_PTR_GETTER(PrototypeModel, prototype);
     DEF_VAL_GETTER(Decoration, decoration);
     DEF_PTR_PROP_RW(const String, native_stub_name);
+    // Number of execution counters and virtual call sites instrumented for profiling.
+    DEF_VAL_PROP_RW(int, profile_counters);
+    DEF_VAL_PROP_RW(int, profile_sites);
     DEF_ARENA_VECTOR_GETTER(Value *, paramater);
     DEF_ARENA_VECTOR_GETTER(BasicBlock *, block);
     
@@ -131,6 +134,8 @@ private:
     Decoration const decoration_;
     uint32_t properties_ = 0;
     const String *native_stub_name_ = nullptr;
+    int profile_counters_ = 0;
+    int profile_sites_ = 0;
     BasicBlock *entry_ = nullptr;
     base::ArenaVector<Value *> paramaters_;
     base::ArenaVector<BasicBlock *> blocks_;
@@ -239,6 +244,8 @@ public:
     //DEF_ARENA_VECTOR_GETTER(Value *, persistent);
     DEF_ARENA_VECTOR_GETTER(BasicBlock *, input);
     DEF_ARENA_VECTOR_GETTER(BasicBlock *, output);
+    // Execution count from the profile, -1 if unknown.
+    DEF_VAL_PROP_RW(int64_t, frequency);
     
     void LinkTo(BasicBlock *output) {
         if (output->FindInput(this) < 0) { output->inputs_.push_back(this); }
@@ -286,6 +293,7 @@ private:
     const String *const name_;
     base::Arena *const arena_;
     int id_ = -1;
+    int64_t frequency_ = -1;
     base::ArenaVector<Value *> instructions_;
     base::ArenaVector<BasicBlock *> inputs_;
     base::ArenaVector<BasicBlock *> outputs_;
@@ -349,6 +357,11 @@ public:
         return DCHECK_NOTNULL(io_[control_in_offset() + i]->AsBasicBlock());
     }
     
+    void SetInputControl(int i, BasicBlock *node) {
+        assert(i >= 0 && i < op()->control_in());
+        io_[control_in_offset() + i] = DCHECK_NOTNULL(node);
+    }
+
     BasicBlock *OutputControl(int i) const {
         assert(i >= 0 && i < op()->control_out());
         return DCHECK_NOTNULL(io_[control_out_offset() + i]->AsBasicBlock());
@@ -370,6 +383,12 @@ public:
     
     void Replace(base::Arena *arena, int position, Value *from, Value *to);
     
+    // Replace all uses of this value by `to', include the phi moving of predecessors.
+    void ReplaceUsesWith(base::Arena *arena, Value *to);
+    
+    // Kill this value and remove it from users of inputs.
+    void KillWithInputs();
+    
     struct User {
         User  *prev;
         User  *next;
@@ -26,6 +26,7 @@ namespace ir {
     V(FrameState) \
     V(Phi) \
     V(Br) \
+    V(Switch) \
     V(Argument) \
     V(Parameter) \
     V(HeapAlloc) \
@@ -36,6 +37,8 @@ namespace ir {
     V(Concat) \
     V(Unreachable) \
     V(Unwind) \
+    V(ProfileCount) \
+    V(ProfileReceiver) \
     V(Ret)
 
 #define DECLARE_IR_GLOBALS(V) \
@@ -134,6 +137,8 @@ namespace ir {
 #define DECL_OPERATORS_WITH_DATA(V) \
     V(Argument,         int) \
     V(ReturningVal,     int) \
+    V(ProfileCount,     int) \
+    V(ProfileReceiver,  int) \
     V(Closure,          Model const *) \
     V(HeapAlloc,        Model const *) \
     V(StackAlloc,       Model const *) \
@@ -203,7 +208,7 @@ public:
     
     bool IsConstant() const;
     
-    bool IsTerminator() const { return value() == kBr || value() == kRet; }
+    bool IsTerminator() const { return value() == kBr || value() == kSwitch || value() == kRet; }
     
     friend class OperatorsFactory;
 protected:
@@ -39,6 +39,12 @@ public:
                                      control_out/*control_out*/);
     }
     
+    // Switch value, key1, key2, ... out [case1, case2, ..., default]
+    Operator *Switch(int cases) {
+        return new (arena_) Operator(Operator::kSwitch, 0, 1 + cases/*value_in*/, 0/*control_in*/, 1/*value_out*/,
+                                     cases + 1/*control_out*/);
+    }
+    
     Operator *Closure(const StructureModel *clazz, int value_in) {
         return new (arena_) OperatorWith<const StructureModel *>(Operator::kClosure, 0, value_in/*value_in*/,
                                                                  0/*control_in*/, 1/*value_out*/, 0/*control_out*/,
@@ -59,6 +65,18 @@ public:
                                      0/*control_out*/);
     }
     
+    // Increase the `index'th execution counter of the function.
+    Operator *ProfileCount(int index) {
+        return new (arena_) OperatorWith<int>(Operator::kProfileCount, 0, 0/*value_in*/, 0/*control_in*/,
+                                              0/*value_out*/, 0/*control_out*/, index);
+    }
+    
+    // Record class of the receiver at the `index'th virtual call site of the function.
+    Operator *ProfileReceiver(int index) {
+        return new (arena_) OperatorWith<int>(Operator::kProfileReceiver, 0, 1/*value_in*/, 0/*control_in*/,
+                                              0/*value_out*/, 0/*control_out*/, index);
+    }
+    
     Operator *HeapAlloc(const StructureModel *model) {
         return new (arena_) OperatorWith<const StructureModel *>(Operator::kHeapAlloc, 0, 0/*value_in*/,
                                                                  0/*control_in*/, 1/*value_out*/, 0/*control_out*/,
@@ -125,6 +143,12 @@ public:
                                                              0/*control_in*/, 1/*value_out*/, 0/*control_out*/, type);
     }
     
+    // Same as `ArrayAt' but the indices are proven in bounds.
+    Operator *ArrayUncheckedAt(const ArrayModel *type, int value_in) {
+        return new (arena_) OperatorWith<const ArrayModel *>(Operator::kArrayUncheckedAt, 0, value_in/*value_in*/,
+                                                             0/*control_in*/, 1/*value_out*/, 0/*control_out*/, type);
+    }
+    
     Operator *ArraySet(const ArrayModel *type, int value_in) {
         return new (arena_) OperatorWith<const ArrayModel *>(Operator::kArraySet, 0, value_in, 0/*control_in*/,
                                                              1/*value_out*/, 0/*control_out*/, type);
@@ -0,0 +1,299 @@
+#include "ir/pass/analysis.h"
+#include "ir/pass/boxing-elimination.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/operators-factory.h"
+#include "ir/utils.h"
+#include "ir/base-test.h"
+#include "base/io.h"
+#include <gtest/gtest.h>
+
+namespace yalx {
+
+namespace ir {
+
+class AnalysisManagerTest : public ModuleTest {
+public:
+    Function *NewFun(const char *name) {
+        return ModuleTest::NewFun(name, {Types::Int32, Types::Int32, Types::Word8}, {Types::Int32});
+    }
+}; // class AnalysisManagerTest
+
+TEST_F(AnalysisManagerTest, DominatorsAndLoops) {
+    // entry -> h1 -> body1 -> h2 -> body2 -> h2
+    //           \               \-> latch1 -> h1
+    //            \-> exit
+    auto fun = NewFun("nested");
+    auto entry = NewBlock(fun, "entry");
+    auto h1 = NewBlock(fun, "h1");
+    auto body1 = NewBlock(fun, "body1");
+    auto h2 = NewBlock(fun, "h2");
+    auto body2 = NewBlock(fun, "body2");
+    auto latch1 = NewBlock(fun, "latch1");
+    auto exit = NewBlock(fun, "exit");
+    auto unreachable = NewBlock(fun, "unreachable");
+    auto cond = fun->paramater(2);
+    Goto(entry, h1);
+    Branch(h1, cond, body1, exit);
+    Goto(body1, h2);
+    Branch(h2, cond, body2, latch1);
+    Goto(body2, h2);
+    Goto(latch1, h1);
+    exit->NewNode(SourcePosition::Unknown(), Types::Void, ops()->Ret(0));
+    Goto(unreachable, h2);
+
+    AnalysisManager analyses(arena(), ops());
+    auto order = analyses.BlockOrderOf(fun);
+    ASSERT_EQ(7, order->size());
+    EXPECT_EQ(entry, order->block(0));
+    EXPECT_EQ(h1, order->block(1));
+    EXPECT_FALSE(order->IsReachable(unreachable));
+    for (auto blk : order->rpo()) {
+        auto index = order->IndexOf(blk);
+        for (auto pred : blk->inputs()) {
+            // All forward edges go from front to back, except back edges
+            if (order->IsReachable(pred) && pred != latch1 && pred != body2) {
+                EXPECT_LT(order->IndexOf(pred), index);
+            }
+        }
+    }
+
+    auto dom = analyses.DominatorTreeOf(fun);
+    EXPECT_EQ(nullptr, dom->ImmediateDominator(entry));
+    EXPECT_EQ(entry, dom->ImmediateDominator(h1));
+    EXPECT_EQ(h1, dom->ImmediateDominator(body1));
+    EXPECT_EQ(body1, dom->ImmediateDominator(h2));
+    EXPECT_EQ(h2, dom->ImmediateDominator(body2));
+    EXPECT_EQ(h2, dom->ImmediateDominator(latch1));
+    EXPECT_EQ(h1, dom->ImmediateDominator(exit));
+    EXPECT_TRUE(dom->Dominates(h1, body2));
+    EXPECT_TRUE(dom->Dominates(h2, h2));
+    EXPECT_FALSE(dom->StrictlyDominates(h2, h2));
+    EXPECT_FALSE(dom->Dominates(body2, latch1));
+    EXPECT_FALSE(dom->Dominates(exit, h1));
+    EXPECT_EQ(4, dom->DepthOf(body2));
+
+    EXPECT_EQ(std::vector<BasicBlock *>{h2}, dom->FrontierOf(body2));
+    EXPECT_EQ(std::vector<BasicBlock *>{h1}, dom->FrontierOf(latch1));
+    EXPECT_EQ(std::vector<BasicBlock *>{h1}, dom->FrontierOf(body1));
+    EXPECT_EQ(std::vector<BasicBlock *>{h1}, dom->FrontierOf(h1));
+    EXPECT_EQ(2, dom->FrontierOf(h2).size());
+    EXPECT_TRUE(dom->FrontierOf(exit).empty());
+
+    auto loops = analyses.LoopNestOf(fun);
+    ASSERT_EQ(2, loops->loops_size());
+    auto outer = loops->loops()[0];
+    auto inner = loops->loops()[1];
+    EXPECT_EQ(h1, outer->header());
+    EXPECT_EQ(entry, outer->preheader());
+    EXPECT_EQ(nullptr, outer->parent());
+    EXPECT_EQ(1, outer->depth());
+    EXPECT_EQ(5, outer->blocks().size());
+    EXPECT_EQ(std::vector<BasicBlock *>{latch1}, outer->latches());
+    EXPECT_EQ(h2, inner->header());
+    EXPECT_EQ(body1, inner->preheader());
+    EXPECT_EQ(outer, inner->parent());
+    EXPECT_EQ(2, inner->depth());
+    EXPECT_EQ(2, inner->blocks().size());
+    EXPECT_TRUE(outer->Contains(inner));
+    EXPECT_FALSE(inner->Contains(outer));
+    EXPECT_TRUE(outer->Contains(latch1));
+    EXPECT_FALSE(inner->Contains(latch1));
+
+    EXPECT_EQ(inner, loops->LoopOf(body2));
+    EXPECT_EQ(outer, loops->LoopOf(latch1));
+    EXPECT_EQ(nullptr, loops->LoopOf(exit));
+    EXPECT_EQ(2, loops->DepthOf(h2));
+    EXPECT_EQ(0, loops->DepthOf(entry));
+    EXPECT_TRUE(loops->IsHeader(h1));
+    EXPECT_FALSE(loops->IsHeader(body1));
+}
+
+TEST_F(AnalysisManagerTest, Liveness) {
+    // entry:  br h
+    // h:      %i = phi(%0 entry, %inc latch); br cond, body, exit
+    // body:   %t = add %i, %1; br latch
+    // latch:  %inc = add %t, %0; br h
+    // exit:   ret %i
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto fun = NewFun("sum");
+    auto entry = NewBlock(fun, "entry");
+    auto h = NewBlock(fun, "h");
+    auto body = NewBlock(fun, "body");
+    auto latch = NewBlock(fun, "latch");
+    auto exit = NewBlock(fun, "exit");
+    auto p0 = fun->paramater(0), p1 = fun->paramater(1), cond = fun->paramater(2);
+    Goto(entry, h);
+    auto i = h->NewNodeWithNodes(nullptr, ss, Types::Int32, ops()->Phi(2, 2),
+                                 std::vector<Node *>{p0, p0, entry, latch});
+    Branch(h, cond, body, exit);
+    auto t = body->NewNode(ss, Types::Int32, ops()->Add(), i, p1);
+    Goto(body, latch);
+    auto inc = latch->NewNode(ss, Types::Int32, ops()->Add(), t, p0);
+    Goto(latch, h);
+    exit->NewNode(ss, Types::Void, ops()->Ret(1), i);
+    ReplacePhiInput(latch, i, 1, inc);
+
+    AnalysisManager analyses(arena(), ops());
+    auto live = analyses.LivenessOf(fun);
+    EXPECT_EQ(6, live->values_size());
+    EXPECT_EQ(-1, live->IdOf(h->instructions().back())); // Br is void
+
+    EXPECT_TRUE(live->IsLiveOut(entry, p0));
+    EXPECT_TRUE(live->IsLiveOut(entry, p1));
+    EXPECT_TRUE(live->IsLiveIn(h, p0));
+    EXPECT_FALSE(live->IsLiveIn(h, i));
+    EXPECT_TRUE(live->IsLiveOut(h, i));
+    EXPECT_TRUE(live->IsLiveIn(body, i));
+    EXPECT_FALSE(live->IsLiveOut(body, i));
+    EXPECT_TRUE(live->IsLiveOut(body, t));
+    EXPECT_FALSE(live->IsLiveIn(latch, inc));
+    EXPECT_TRUE(live->IsLiveOut(latch, inc));
+    EXPECT_FALSE(live->IsLiveIn(h, inc));
+    EXPECT_TRUE(live->IsLiveIn(exit, i));
+    EXPECT_FALSE(live->IsLiveIn(exit, p0));
+    EXPECT_EQ((std::vector<Value *>{p0, p1, cond, inc}), live->LiveOutOf(latch));
+    EXPECT_EQ((std::vector<Value *>{p0, p1, cond}), live->LiveInOf(h));
+}
+
+TEST_F(AnalysisManagerTest, BarrierElision) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto foo = module_->NewClassModel(String::New(arena(), "Foo"), String::New(arena(), "main:main.Foo"), nullptr);
+    auto ref = Type::Ref(foo);
+    auto next = foo->InsertField({String::New(arena(), "next"), kPublic, 0, ref, false});
+    auto prototype = new (arena()) PrototypeModel(arena(), String::kEmpty, false/*vargs*/);
+    prototype->mutable_params()->push_back(ref);
+    auto name = String::New(arena(), "foo");
+    auto fun = module_->NewFunction(Function::kDefault, name, name, prototype);
+    fun->mutable_paramaters()->push_back(Value::New(arena(), ss, ref, ops()->Argument(0)));
+    auto arg = fun->paramater(0);
+
+    auto entry = NewBlock(fun, "entry");
+    auto object = entry->NewNode(ss, ref, ops()->HeapAlloc(foo));
+    auto s1 = entry->NewNode(ss, ref, ops()->StoreEffectField(next), object, arg);
+    auto l1 = entry->NewNode(ss, ref, ops()->LoadEffectField(next), object);
+    auto l2 = entry->NewNode(ss, ref, ops()->LoadEffectField(next), arg);
+    auto l3 = entry->NewNode(ss, ref, ops()->LoadEffectField(next), arg);
+    entry->NewNode(ss, Types::Void, ops()->CallRuntime(0/*value_out*/, 0/*value_in*/, 0/*control_out*/,
+                                                       RuntimeLib::PkgInitOnce));
+    auto l4 = entry->NewNode(ss, ref, ops()->LoadEffectField(next), arg);
+    auto s2 = entry->NewNode(ss, ref, ops()->StoreEffectField(next), object, l4);
+    entry->NewNode(ss, Types::Void, ops()->Ret(1), l1);
+
+    AnalysisManager analyses(arena(), ops());
+    auto elision = analyses.BarrierElisionOf(fun);
+    EXPECT_EQ(3, elision->barrier_free_size());
+    EXPECT_TRUE(elision->IsBarrierFree(s1)); // Fresh object
+    EXPECT_TRUE(elision->IsBarrierFree(l1));
+    EXPECT_FALSE(elision->IsBarrierFree(l2));
+    EXPECT_TRUE(elision->IsBarrierFree(l3)); // Healed by l2
+    EXPECT_FALSE(elision->IsBarrierFree(l4)); // After safepoint
+    EXPECT_FALSE(elision->IsBarrierFree(s2));
+    EXPECT_TRUE(BarrierElision::IsSafepoint(object));
+}
+
+TEST_F(AnalysisManagerTest, CachingAndInvalidation) {
+    auto fun = NewFun("foo");
+    auto entry = NewBlock(fun, "entry");
+    auto exit = NewBlock(fun, "exit");
+    Goto(entry, exit);
+    exit->NewNode(SourcePosition::Unknown(), Types::Void, ops()->Ret(1), fun->paramater(0));
+
+    AnalysisManager analyses(arena(), ops());
+    auto dom = analyses.DominatorTreeOf(fun);
+    analyses.LivenessOf(fun);
+    EXPECT_EQ(3, analyses.computed());
+    EXPECT_EQ(dom, analyses.DominatorTreeOf(fun));
+    analyses.LoopNestOf(fun);
+    EXPECT_EQ(4, analyses.computed());
+
+    analyses.Invalidate(fun, AnalysisManager::kCfgAnalyses);
+    EXPECT_EQ(dom, analyses.DominatorTreeOf(fun));
+    analyses.LivenessOf(fun);
+    EXPECT_EQ(5, analyses.computed());
+
+    analyses.Invalidate(fun, AnalysisManager::kBlockOrder | AnalysisManager::kLiveness);
+    analyses.LivenessOf(fun);
+    EXPECT_EQ(7, analyses.computed());
+
+    // Passes invalidate analyses of the functions they ran on.
+    base::ArenaMap<std::string_view, Module *> modules(arena());
+    modules["main:main"] = module_;
+    BoxingEliminationPass pass(arena(), ops(), &modules, feedback());
+    pass.set_analyses(&analyses);
+    analyses.DominatorTreeOf(fun);
+    EXPECT_EQ(8, analyses.computed());
+    pass.Run();
+    analyses.DominatorTreeOf(fun);
+    EXPECT_EQ(8, analyses.computed());
+    analyses.LivenessOf(fun);
+    EXPECT_EQ(9, analyses.computed());
+}
+
+TEST_F(AnalysisManagerTest, InsertPreheaders) {
+    // entry: br cond, a, b
+    // a:     br h
+    // b:     br h
+    // h:     %v = phi(%0 a, %1 b, %n h); %n = add %v, %0; br cond, h, exit
+    // exit:  ret %v
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto fun = NewFun("bar");
+    auto entry = NewBlock(fun, "entry");
+    auto a = NewBlock(fun, "a");
+    auto b = NewBlock(fun, "b");
+    auto h = NewBlock(fun, "h");
+    auto exit = NewBlock(fun, "exit");
+    auto p0 = fun->paramater(0), p1 = fun->paramater(1), cond = fun->paramater(2);
+    Branch(entry, cond, a, b);
+    Goto(a, h);
+    Goto(b, h);
+    auto v = h->NewNodeWithNodes(nullptr, ss, Types::Int32, ops()->Phi(3, 3),
+                                 std::vector<Node *>{p0, p1, p0, a, b, h});
+    auto n = h->NewNode(ss, Types::Int32, ops()->Add(), v, p0);
+    Branch(h, cond, h, exit);
+    exit->NewNode(ss, Types::Void, ops()->Ret(1), v);
+    ReplacePhiInput(h, v, 2, n);
+
+    AnalysisManager analyses(arena(), ops());
+    ASSERT_EQ(1, analyses.LoopNestOf(fun)->loops_size());
+    EXPECT_EQ(nullptr, analyses.LoopNestOf(fun)->loops()[0]->preheader());
+
+    EXPECT_EQ(1, analyses.InsertPreheaders(fun));
+    auto loop = analyses.LoopNestOf(fun)->loops()[0];
+    ASSERT_NE(nullptr, loop->preheader());
+    EXPECT_EQ(h, loop->header());
+    EXPECT_EQ(0, analyses.InsertPreheaders(fun));
+    EXPECT_EQ(loop->preheader(), analyses.DominatorTreeOf(fun)->ImmediateDominator(h));
+
+    auto preheader = loop->preheader();
+    ASSERT_EQ(1, preheader->phi_node_users_size());
+    EXPECT_TRUE(preheader->phi_node_user(0).dest->Is(Operator::kPhi));
+    ASSERT_EQ(1, a->phi_node_users_size());
+    EXPECT_EQ(p0, a->phi_node_user(0).dest);
+    ASSERT_EQ(1, h->phi_node_users_size());
+    EXPECT_EQ(n, h->phi_node_user(0).dest);
+
+    constexpr static const char z[] = R"(fun bar(%0: i32, %1: i32, %2: byte): i32 {
+entry:
+    Br void byte %2 out [a:, b:]
+a:
+    Br void out [L3:]
+b:
+    Br void out [L3:]
+L3:
+    %3 = Phi i32 i32 %0, i32 %1 in [a:, b:]
+    Br void out [h:]
+h:
+    %4 = Phi i32 i32 %3, i32 %5 in [L3:, h:]
+    %5 = Add i32 i32 %4, i32 %0
+    Br void byte %2 out [h:, exit:]
+exit:
+    Ret void i32 %4
+} // main:main.bar
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+}
+
+} // namespace ir
+
+} // namespace yalx
@@ -0,0 +1,601 @@
+#include "ir/pass/analysis.h"
+#include "ir/operators-factory.h"
+#include "ir/type.h"
+
+namespace yalx::ir {
+
+BlockOrder::BlockOrder(Function *fun)
+: fun_(DCHECK_NOTNULL(fun)) {
+    if (!fun->entry()) {
+        return;
+    }
+
+    std::vector<BasicBlock *> post_order;
+    std::vector<std::tuple<BasicBlock *, size_t>> stack;
+    std::unordered_map<const BasicBlock *, bool> visited;
+    stack.push_back(std::make_tuple(fun->entry(), 0));
+    visited[fun->entry()] = true;
+    while (!stack.empty()) {
+        auto &[block, next] = stack.back();
+        if (next < block->outputs_size()) {
+            auto succ = block->output(next++);
+            if (!visited[succ]) {
+                visited[succ] = true;
+                stack.push_back(std::make_tuple(succ, 0));
+            }
+            continue;
+        }
+        post_order.push_back(block);
+        stack.pop_back();
+    }
+
+    rpo_.assign(post_order.rbegin(), post_order.rend());
+    for (int i = 0; i < static_cast<int>(rpo_.size()); i++) {
+        index_[rpo_[i]] = i;
+    }
+}
+
+DominatorTree::DominatorTree(const BlockOrder *order)
+: order_(DCHECK_NOTNULL(order))
+, idoms_(order->size(), -1)
+, depths_(order->size(), 0)
+, enter_(order->size(), 0)
+, exit_(order->size(), 0)
+, children_(order->size())
+, frontiers_(order->size()) {
+    const auto n = static_cast<int>(order->size());
+    if (n == 0) {
+        return;
+    }
+
+    idoms_[0] = 0;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int i = 1; i < n; i++) {
+            int new_idom = -1;
+            for (auto pred : order->block(i)->inputs()) {
+                auto j = order->IndexOf(pred);
+                if (j < 0 || idoms_[j] < 0) {
+                    continue;
+                }
+                new_idom = new_idom < 0 ? j : Intersect(j, new_idom);
+            }
+            if (idoms_[i] != new_idom) {
+                idoms_[i] = new_idom;
+                changed = true;
+            }
+        }
+    }
+
+    for (int i = 1; i < n; i++) {
+        children_[idoms_[i]].push_back(order->block(i));
+        depths_[i] = depths_[idoms_[i]] + 1; // idom is always in front of block in reverse post-order
+    }
+    Numbering();
+
+    for (int i = 0; i < n; i++) {
+        auto block = order->block(i);
+        if (block->inputs_size() < 2) {
+            continue;
+        }
+        for (auto pred : block->inputs()) {
+            auto runner = order->IndexOf(pred);
+            if (runner < 0) {
+                continue;
+            }
+            while (runner != idoms_[i]) {
+                auto &frontier = frontiers_[runner];
+                if (std::find(frontier.begin(), frontier.end(), block) == frontier.end()) {
+                    frontier.push_back(block);
+                }
+                if (runner == 0) {
+                    break;
+                }
+                runner = idoms_[runner];
+            }
+        }
+    }
+}
+
+int DominatorTree::Intersect(int b1, int b2) const {
+    while (b1 != b2) {
+        while (b1 > b2) { b1 = idoms_[b1]; }
+        while (b2 > b1) { b2 = idoms_[b2]; }
+    }
+    return b1;
+}
+
+void DominatorTree::Numbering() {
+    int number = 0;
+    std::vector<std::tuple<int, size_t>> stack;
+    stack.push_back(std::make_tuple(0, 0));
+    enter_[0] = number++;
+    while (!stack.empty()) {
+        auto &[index, next] = stack.back();
+        if (next < children_[index].size()) {
+            auto child = order_->IndexOf(children_[index][next++]);
+            enter_[child] = number++;
+            stack.push_back(std::make_tuple(child, 0));
+            continue;
+        }
+        exit_[index] = number++;
+        stack.pop_back();
+    }
+}
+
+LoopNest::LoopNest(const BlockOrder *order, const DominatorTree *dom)
+: order_(DCHECK_NOTNULL(order))
+, innermost_(order->size(), nullptr) {
+    const auto n = static_cast<int>(order->size());
+    std::vector<std::vector<bool>> bodies;
+
+    // Headers are visited in reverse post-order, so outer loops will be found before inner loops.
+    for (int h = 0; h < n; h++) {
+        auto header = order->block(h);
+        std::vector<BasicBlock *> latches;
+        for (auto pred : header->inputs()) {
+            if (dom->Dominates(header, pred)) {
+                latches.push_back(pred);
+            }
+        }
+        if (latches.empty()) {
+            continue;
+        }
+
+        std::vector<bool> body(n, false);
+        body[h] = true;
+        std::vector<BasicBlock *> worklist(latches);
+        while (!worklist.empty()) {
+            auto block = worklist.back();
+            worklist.pop_back();
+            auto index = order->IndexOf(block);
+            if (index < 0 || body[index]) {
+                continue;
+            }
+            body[index] = true;
+            for (auto pred : block->inputs()) {
+                worklist.push_back(pred);
+            }
+        }
+
+        auto loop = new Loop(header);
+        owned_loops_.emplace_back(loop);
+        loop->latches_ = std::move(latches);
+        for (int i = 0; i < n; i++) {
+            if (body[i]) {
+                loop->blocks_.push_back(order->block(i));
+            }
+        }
+
+        // The last found loop that contains header is the innermost enclosing loop.
+        for (int i = static_cast<int>(loops_.size()) - 1; i >= 0; i--) {
+            if (bodies[i][h]) {
+                loop->parent_ = loops_[i];
+                loop->depth_ = loops_[i]->depth() + 1;
+                loops_[i]->children_.push_back(loop);
+                break;
+            }
+        }
+
+        std::vector<BasicBlock *> entries;
+        for (auto pred : header->inputs()) {
+            if (order->IsReachable(pred) && !body[order->IndexOf(pred)]) {
+                entries.push_back(pred);
+            }
+        }
+        if (entries.size() == 1 && entries[0]->outputs_size() == 1) {
+            loop->preheader_ = entries[0];
+        }
+
+        loops_.push_back(loop);
+        bodies.push_back(std::move(body));
+    }
+
+    for (size_t i = 0; i < loops_.size(); i++) {
+        for (int j = 0; j < n; j++) {
+            if (bodies[i][j]) {
+                innermost_[j] = loops_[i];
+            }
+        }
+    }
+}
+
+Liveness::Liveness(const BlockOrder *order)
+: order_(DCHECK_NOTNULL(order))
+, live_in_(order->size())
+, live_out_(order->size()) {
+    const auto n = static_cast<int>(order->size());
+    if (n == 0) {
+        return;
+    }
+
+    for (auto param : order->fun()->paramaters()) {
+        Track(param);
+    }
+    for (auto block : order->rpo()) {
+        for (auto instr : block->instructions()) {
+            if (instr->IsAlive() && instr->type().kind() != Type::kVoid) {
+                Track(instr);
+            }
+        }
+    }
+
+    const auto m = values_.size();
+    std::vector<std::vector<bool>> gen(n, std::vector<bool>(m, false));
+    std::vector<std::vector<bool>> kill(n, std::vector<bool>(m, false));
+    std::vector<std::vector<bool>> phi_uses(n, std::vector<bool>(m, false));
+    for (auto param : order->fun()->paramaters()) {
+        kill[0][IdOf(param)] = true;
+    }
+    for (int i = 0; i < n; i++) {
+        for (auto instr : order->block(i)->instructions()) {
+            if (instr->IsDead()) {
+                continue;
+            }
+            if (instr->Is(Operator::kPhi)) {
+                for (int j = 0; j < instr->op()->control_in(); j++) {
+                    auto pred = order->IndexOf(instr->InputControl(j));
+                    auto id = IdOf(instr->InputValue(j));
+                    if (pred >= 0 && id >= 0) {
+                        phi_uses[pred][id] = true;
+                    }
+                }
+            } else {
+                for (int j = 0; j < instr->op()->value_in(); j++) {
+                    auto id = IdOf(instr->InputValue(j));
+                    if (id >= 0 && !kill[i][id]) {
+                        gen[i][id] = true;
+                    }
+                }
+            }
+            if (auto id = IdOf(instr); id >= 0) {
+                kill[i][id] = true;
+            }
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        live_in_[i].resize(m, false);
+        live_out_[i].resize(m, false);
+    }
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int i = n - 1; i >= 0; i--) {
+            std::vector<bool> out(phi_uses[i]);
+            for (auto succ : order->block(i)->outputs()) {
+                auto j = order->IndexOf(succ);
+                for (size_t k = 0; k < m; k++) {
+                    if (live_in_[j][k]) { out[k] = true; }
+                }
+            }
+            std::vector<bool> in(gen[i]);
+            for (size_t k = 0; k < m; k++) {
+                if (out[k] && !kill[i][k]) { in[k] = true; }
+            }
+            if (in != live_in_[i] || out != live_out_[i]) {
+                live_in_[i] = std::move(in);
+                live_out_[i] = std::move(out);
+                changed = true;
+            }
+        }
+    }
+}
+
+int Liveness::Track(Value *value) {
+    if (auto iter = ids_.find(value); iter != ids_.end()) {
+        return iter->second;
+    }
+    auto id = static_cast<int>(values_.size());
+    values_.push_back(value);
+    ids_[value] = id;
+    return id;
+}
+
+bool Liveness::DoesIn(const std::vector<std::vector<bool>> &sets, const BasicBlock *block,
+                      const Value *value) const {
+    auto index = order_->IndexOf(block);
+    auto id = IdOf(value);
+    return index >= 0 && id >= 0 && sets[index][id];
+}
+
+std::vector<Value *> Liveness::Collect(const std::vector<std::vector<bool>> &sets, const BasicBlock *block) const {
+    std::vector<Value *> values;
+    auto index = order_->IndexOf(block);
+    if (index < 0) {
+        return values;
+    }
+    for (size_t i = 0; i < values_.size(); i++) {
+        if (sets[index][i]) {
+            values.push_back(values_[i]);
+        }
+    }
+    return values;
+}
+
+BarrierElision::BarrierElision(Function *fun) {
+    for (auto block : fun->blocks()) {
+        AnalyzeBlock(block);
+    }
+}
+
+void BarrierElision::AnalyzeBlock(BasicBlock *block) {
+    // Objects allocated after the last safepoint, and the fields already loaded or stored.
+    std::unordered_set<const Value *> fresh;
+    std::set<std::tuple<const Value *, const Handle *>> healed;
+    for (auto instr : block->instructions()) {
+        if (instr->IsDead()) {
+            continue;
+        }
+        if (IsSafepoint(instr)) {
+            fresh.clear();
+            healed.clear();
+        }
+
+        switch (instr->op()->value()) {
+            case Operator::kHeapAlloc:
+            case Operator::kStackAlloc:
+                fresh.insert(instr);
+                break;
+
+            case Operator::kLoadInlineField:
+            case Operator::kLoadAccessField:
+            case Operator::kLoadEffectField: {
+                auto key = std::make_tuple(instr->InputValue(0), OperatorWith<const Handle *>::Data(instr));
+                if (instr->type().IsGeneralizedReference() &&
+                    (fresh.find(instr->InputValue(0)) != fresh.end() || healed.find(key) != healed.end())) {
+                    barrier_free_.insert(instr);
+                }
+                healed.insert(key);
+            } break;
+
+            case Operator::kStoreInlineField:
+            case Operator::kStoreAccessField:
+            case Operator::kStoreEffectField: {
+                auto object = instr->InputValue(0);
+                auto handle = OperatorWith<const Handle *>::Data(instr);
+                if (instr->InputValue(1)->type().IsGeneralizedReference() && fresh.find(object) != fresh.end()) {
+                    barrier_free_.insert(instr);
+                }
+                healed.insert(std::make_tuple(object, handle));
+                if (instr->Is(Operator::kStoreInlineField)) {
+                    // Storing inline field makes a new value, it's fresh if the origin one is.
+                    if (fresh.find(object) != fresh.end()) { fresh.insert(instr); }
+                    healed.insert(std::make_tuple(instr, handle));
+                }
+            } break;
+
+            default:
+                break;
+        }
+    }
+}
+
+bool BarrierElision::IsSafepoint(const Value *instr) {
+    switch (instr->op()->value()) {
+        case Operator::kCallHandle:
+        case Operator::kCallVirtual:
+        case Operator::kCallAbstract:
+        case Operator::kCallDirectly:
+        case Operator::kCallIndirectly:
+        case Operator::kCallRuntime:
+        case Operator::kHeapAlloc:
+        case Operator::kArrayAlloc:
+        case Operator::kArrayFill:
+        case Operator::kClosure:
+        case Operator::kConcat:
+        case Operator::kBoxingTo:
+        case Operator::kLazyLoad:
+        case Operator::kCatch:
+        case Operator::kUnwind:
+            return true;
+        default:
+            return false;
+    }
+}
+
+AnalysisManager::AnalysisManager(base::Arena *arena, OperatorsFactory *ops)
+: arena_(DCHECK_NOTNULL(arena))
+, ops_(DCHECK_NOTNULL(ops)) {
+}
+
+AnalysisManager::~AnalysisManager() = default;
+
+BlockOrder *AnalysisManager::BlockOrderOf(Function *fun) {
+    auto &analyses = cache_[fun];
+    if (!analyses.order) {
+        analyses.order = std::make_unique<BlockOrder>(fun);
+        computed_++;
+    }
+    return analyses.order.get();
+}
+
+DominatorTree *AnalysisManager::DominatorTreeOf(Function *fun) {
+    auto order = BlockOrderOf(fun);
+    auto &analyses = cache_[fun];
+    if (!analyses.dom) {
+        analyses.dom = std::make_unique<DominatorTree>(order);
+        computed_++;
+    }
+    return analyses.dom.get();
+}
+
+LoopNest *AnalysisManager::LoopNestOf(Function *fun) {
+    auto dom = DominatorTreeOf(fun);
+    auto &analyses = cache_[fun];
+    if (!analyses.loops) {
+        analyses.loops = std::make_unique<LoopNest>(analyses.order.get(), dom);
+        computed_++;
+    }
+    return analyses.loops.get();
+}
+
+Liveness *AnalysisManager::LivenessOf(Function *fun) {
+    auto order = BlockOrderOf(fun);
+    auto &analyses = cache_[fun];
+    if (!analyses.liveness) {
+        analyses.liveness = std::make_unique<Liveness>(order);
+        computed_++;
+    }
+    return analyses.liveness.get();
+}
+
+BarrierElision *AnalysisManager::BarrierElisionOf(Function *fun) {
+    auto &analyses = cache_[fun];
+    if (!analyses.barrier_elision) {
+        analyses.barrier_elision = std::make_unique<BarrierElision>(fun);
+        computed_++;
+    }
+    return analyses.barrier_elision.get();
+}
+
+void AnalysisManager::Invalidate(Function *fun, uint32_t preserved) {
+    auto iter = cache_.find(fun);
+    if (iter == cache_.end()) {
+        return;
+    }
+    if ((preserved & kCfgAnalyses) != kCfgAnalyses) {
+        cache_.erase(iter);
+        return;
+    }
+    if (!(preserved & kLiveness)) {
+        iter->second.liveness.reset();
+    }
+    if (!(preserved & kBarrierElision)) {
+        iter->second.barrier_elision.reset();
+    }
+}
+
+int AnalysisManager::InsertPreheaders(Function *fun) {
+    auto order = BlockOrderOf(fun);
+    auto loops = LoopNestOf(fun);
+    int inserted = 0;
+    for (auto loop : loops->loops()) {
+        if (loop->preheader()) {
+            continue;
+        }
+        std::vector<BasicBlock *> entries;
+        for (auto pred : loop->header()->inputs()) {
+            if (order->IsReachable(pred) && !loop->Contains(pred)) {
+                entries.push_back(pred);
+            }
+        }
+        if (entries.empty()) {
+            continue; // Loop header is the entry of function
+        }
+        InsertPreheader(fun, loop, entries);
+        inserted++;
+    }
+    if (inserted > 0) {
+        fun->UpdateIdsOfBlocks();
+        Invalidate(fun);
+    }
+    return inserted;
+}
+
+BasicBlock *AnalysisManager::InsertPreheader(Function *fun, Loop *loop, const std::vector<BasicBlock *> &entries) {
+    const auto ss = SourcePosition::Unknown();
+    auto header = loop->header();
+    auto preheader = fun->NewBlock(nullptr);
+    auto blocks = fun->mutable_blocks();
+    blocks->pop_back();
+    blocks->insert(std::find(blocks->begin(), blocks->end(), header), preheader);
+
+    std::vector<Value *> phis;
+    for (auto instr : header->instructions()) {
+        if (instr->IsAlive() && instr->Is(Operator::kPhi)) {
+            phis.push_back(instr);
+        }
+    }
+
+    auto is_entry = [&entries](BasicBlock *block) {
+        return std::find(entries.begin(), entries.end(), block) != entries.end();
+    };
+
+    // Redirect edges: entries -> preheader
+    for (auto entry : entries) {
+        auto terminator = entry->instructions().back();
+        DCHECK(terminator->op()->IsTerminator());
+        for (int i = 0; i < terminator->op()->control_out(); i++) {
+            if (terminator->OutputControl(i) == header) {
+                terminator->SetOutputControl(i, preheader);
+            }
+        }
+        auto outputs = entry->mutable_outputs();
+        *std::find(outputs->begin(), outputs->end(), header) = preheader;
+        auto inputs = header->mutable_inputs();
+        inputs->erase(std::find(inputs->begin(), inputs->end(), entry));
+        preheader->mutable_inputs()->push_back(entry);
+    }
+
+    if (entries.size() == 1) {
+        // Only one incoming edge: just move the phi inputs from entry to preheader.
+        auto entry = entries[0];
+        for (auto phi : phis) {
+            for (int i = 0; i < phi->op()->control_in(); i++) {
+                if (phi->InputControl(i) == entry) {
+                    phi->SetInputControl(i, preheader);
+                }
+            }
+        }
+        auto users = entry->mutable_phi_node_users();
+        for (auto iter = users->begin(); iter != users->end();) {
+            if (std::find(phis.begin(), phis.end(), iter->phi) != phis.end()) {
+                preheader->mutable_phi_node_users()->push_back(*iter);
+                iter = users->erase(iter);
+            } else {
+                iter++;
+            }
+        }
+    } else {
+        // Many incoming edges: merge incoming values in preheader, and rebuild the phis of header.
+        std::vector<Value *> new_phis;
+        for (auto phi : phis) {
+            std::vector<Node *> outer_values, outer_blocks, inner_values, inner_blocks;
+            for (int i = 0; i < phi->op()->control_in(); i++) {
+                if (is_entry(phi->InputControl(i))) {
+                    outer_values.push_back(phi->InputValue(i));
+                    outer_blocks.push_back(phi->InputControl(i));
+                } else {
+                    inner_values.push_back(phi->InputValue(i));
+                    inner_blocks.push_back(phi->InputControl(i));
+                }
+            }
+
+            Node *outer = outer_values[0];
+            if (std::count(outer_values.begin(), outer_values.end(), outer) != static_cast<ptrdiff_t>(outer_values.size())) {
+                const auto k = static_cast<int>(outer_values.size());
+                outer_values.insert(outer_values.end(), outer_blocks.begin(), outer_blocks.end());
+                outer = preheader->NewNodeWithNodes(nullptr, ss, phi->type(), ops()->Phi(k, k), outer_values);
+            }
+
+            const auto k = static_cast<int>(inner_values.size() + 1);
+            std::vector<Node *> nodes{outer};
+            nodes.insert(nodes.end(), inner_values.begin(), inner_values.end());
+            nodes.push_back(preheader);
+            nodes.insert(nodes.end(), inner_blocks.begin(), inner_blocks.end());
+            auto new_phi = header->NewNodeWithNodes(phi->name(), phi->source_position(), phi->type(),
+                                                    ops()->Phi(k, k), nodes);
+            new_phis.push_back(new_phi);
+
+            phi->KillWithInputs();
+            phi->ReplaceUsesWith(arena(), new_phi);
+        }
+
+        header->RemoveDeads();
+        for (auto iter = new_phis.rbegin(); iter != new_phis.rend(); iter++) {
+            header->MoveToFront(*iter);
+        }
+        for (auto entry : entries) {
+            entry->RemovePhiUsersOfDeads();
+        }
+        for (auto pred : header->inputs()) {
+            pred->RemovePhiUsersOfDeads();
+        }
+    }
+
+    preheader->NewNode(ss, Types::Void, ops()->Br(0/*value_in*/, 1/*control_out*/), header);
+    preheader->LinkTo(header);
+    return preheader;
+}
+
+} // namespace yalx::ir
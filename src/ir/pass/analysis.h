@@ -0,0 +1,297 @@
+#pragma once
+#ifndef YALX_IR_PASS_ANALYSIS_H_
+#define YALX_IR_PASS_ANALYSIS_H_
+
+#include "ir/node.h"
+#include "base/base.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <vector>
+#include <set>
+
+namespace yalx {
+namespace base {
+class Arena;
+} // namespace base
+namespace ir {
+
+class OperatorsFactory;
+
+// Reverse post-order of the reachable blocks of function.
+class BlockOrder {
+public:
+    explicit BlockOrder(Function *fun);
+
+    DEF_PTR_GETTER(Function, fun);
+
+    [[nodiscard]] const std::vector<BasicBlock *> &rpo() const { return rpo_; }
+    [[nodiscard]] size_t size() const { return rpo_.size(); }
+    [[nodiscard]] BasicBlock *block(int index) const { return rpo_[index]; }
+
+    // Index of block in reverse post-order, -1 if block is unreachable.
+    [[nodiscard]] int IndexOf(const BasicBlock *block) const {
+        auto iter = index_.find(block);
+        return iter == index_.end() ? -1 : iter->second;
+    }
+
+    [[nodiscard]] bool IsReachable(const BasicBlock *block) const { return IndexOf(block) >= 0; }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(BlockOrder);
+private:
+    Function *const fun_;
+    std::vector<BasicBlock *> rpo_;
+    std::unordered_map<const BasicBlock *, int> index_;
+}; // class BlockOrder
+
+
+// Dominator tree and dominance frontiers, by the Cooper-Harvey-Kennedy algorithm.
+class DominatorTree {
+public:
+    explicit DominatorTree(const BlockOrder *order);
+
+    // Immediate dominator of block, the entry and unreachable blocks has no one.
+    [[nodiscard]] BasicBlock *ImmediateDominator(const BasicBlock *block) const {
+        auto index = order_->IndexOf(block);
+        return index <= 0 ? nullptr : order_->block(idoms_[index]);
+    }
+
+    // Does `a' dominates `b'? A block always dominates itself.
+    [[nodiscard]] bool Dominates(const BasicBlock *a, const BasicBlock *b) const {
+        auto i = order_->IndexOf(a), j = order_->IndexOf(b);
+        if (i < 0 || j < 0) {
+            return false;
+        }
+        return enter_[i] <= enter_[j] && exit_[j] <= exit_[i];
+    }
+
+    [[nodiscard]] bool StrictlyDominates(const BasicBlock *a, const BasicBlock *b) const {
+        return a != b && Dominates(a, b);
+    }
+
+    // Depth in dominator tree, the entry's depth is 0.
+    [[nodiscard]] int DepthOf(const BasicBlock *block) const { return depths_[order_->IndexOf(block)]; }
+
+    [[nodiscard]] const std::vector<BasicBlock *> &ChildrenOf(const BasicBlock *block) const {
+        return children_[order_->IndexOf(block)];
+    }
+
+    [[nodiscard]] const std::vector<BasicBlock *> &FrontierOf(const BasicBlock *block) const {
+        return frontiers_[order_->IndexOf(block)];
+    }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(DominatorTree);
+private:
+    int Intersect(int b1, int b2) const;
+    void Numbering();
+
+    const BlockOrder *const order_;
+    std::vector<int> idoms_;
+    std::vector<int> depths_;
+    std::vector<int> enter_;
+    std::vector<int> exit_;
+    std::vector<std::vector<BasicBlock *>> children_;
+    std::vector<std::vector<BasicBlock *>> frontiers_;
+}; // class DominatorTree
+
+
+// Natural loop: a header dominates all blocks of loop, and there are some back edges from latches to the header.
+class Loop {
+public:
+    Loop(BasicBlock *header): header_(header) {}
+
+    DEF_PTR_GETTER(BasicBlock, header);
+    DEF_PTR_GETTER(BasicBlock, preheader);
+    DEF_PTR_GETTER(Loop, parent);
+    DEF_VAL_GETTER(int, depth);
+    DEF_VAL_GETTER(std::vector<BasicBlock *>, blocks);
+    DEF_VAL_GETTER(std::vector<BasicBlock *>, latches);
+    DEF_VAL_GETTER(std::vector<Loop *>, children);
+
+    [[nodiscard]] bool Contains(const BasicBlock *block) const {
+        return std::find(blocks_.begin(), blocks_.end(), block) != blocks_.end();
+    }
+
+    [[nodiscard]] bool Contains(const Loop *loop) const {
+        for (auto p = loop; p != nullptr; p = p->parent()) {
+            if (p == this) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    friend class LoopNest;
+    DISALLOW_IMPLICIT_CONSTRUCTORS(Loop);
+private:
+    BasicBlock *const header_;
+    BasicBlock *preheader_ = nullptr;
+    Loop *parent_ = nullptr;
+    int depth_ = 1;
+    std::vector<BasicBlock *> blocks_; // blocks in reverse post-order, blocks_[0] is the header
+    std::vector<BasicBlock *> latches_;
+    std::vector<Loop *> children_;
+}; // class Loop
+
+
+// Natural loops forest of function. Irreducible loops are not recognized.
+class LoopNest {
+public:
+    LoopNest(const BlockOrder *order, const DominatorTree *dom);
+
+    // All loops, outer loops are in front of inner loops.
+    [[nodiscard]] const std::vector<Loop *> &loops() const { return loops_; }
+    [[nodiscard]] size_t loops_size() const { return loops_.size(); }
+
+    // The innermost loop that contains block, nullptr if block is not in any loops.
+    [[nodiscard]] Loop *LoopOf(const BasicBlock *block) const {
+        auto index = order_->IndexOf(block);
+        return index < 0 ? nullptr : innermost_[index];
+    }
+
+    [[nodiscard]] int DepthOf(const BasicBlock *block) const {
+        auto loop = LoopOf(block);
+        return !loop ? 0 : loop->depth();
+    }
+
+    [[nodiscard]] bool IsHeader(const BasicBlock *block) const {
+        auto loop = LoopOf(block);
+        return loop != nullptr && loop->header() == block;
+    }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(LoopNest);
+private:
+    const BlockOrder *const order_;
+    std::vector<std::unique_ptr<Loop>> owned_loops_;
+    std::vector<Loop *> loops_;
+    std::vector<Loop *> innermost_;
+}; // class LoopNest
+
+
+// Liveness of SSA values at boundaries of blocks. Only instructions and parameters are tracked, the constants and
+// globals are always available.
+// The inputs of phi are live-out of the corresponding predecessor, not live-in of the phi's block.
+class Liveness {
+public:
+    explicit Liveness(const BlockOrder *order);
+
+    [[nodiscard]] size_t values_size() const { return values_.size(); }
+
+    // Tracked value id, -1 if value is not tracked.
+    [[nodiscard]] int IdOf(const Value *value) const {
+        auto iter = ids_.find(value);
+        return iter == ids_.end() ? -1 : iter->second;
+    }
+
+    [[nodiscard]] bool IsLiveIn(const BasicBlock *block, const Value *value) const {
+        return DoesIn(live_in_, block, value);
+    }
+
+    [[nodiscard]] bool IsLiveOut(const BasicBlock *block, const Value *value) const {
+        return DoesIn(live_out_, block, value);
+    }
+
+    [[nodiscard]] std::vector<Value *> LiveInOf(const BasicBlock *block) const { return Collect(live_in_, block); }
+    [[nodiscard]] std::vector<Value *> LiveOutOf(const BasicBlock *block) const { return Collect(live_out_, block); }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(Liveness);
+private:
+    int Track(Value *value);
+    bool DoesIn(const std::vector<std::vector<bool>> &sets, const BasicBlock *block, const Value *value) const;
+    std::vector<Value *> Collect(const std::vector<std::vector<bool>> &sets, const BasicBlock *block) const;
+
+    const BlockOrder *const order_;
+    std::vector<Value *> values_;
+    std::unordered_map<const Value *, int> ids_;
+    std::vector<std::vector<bool>> live_in_;
+    std::vector<std::vector<bool>> live_out_;
+}; // class Liveness
+
+
+// Loads and stores of references which need no GC barrier. Objects can only be relocated or recolored by GC at
+// safepoints (calls and allocations), so in the instructions between two safepoints of a block:
+//   - Stores into an object allocated after the last safepoint need no store barrier;
+//   - Loads from a fresh object, or a field already loaded (healed by the load barrier) or stored, need no load
+//     barrier.
+class BarrierElision {
+public:
+    explicit BarrierElision(Function *fun);
+
+    [[nodiscard]] size_t barrier_free_size() const { return barrier_free_.size(); }
+
+    [[nodiscard]] bool IsBarrierFree(const Value *instr) const {
+        return barrier_free_.find(instr) != barrier_free_.end();
+    }
+
+    static bool IsSafepoint(const Value *instr);
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(BarrierElision);
+private:
+    void AnalyzeBlock(BasicBlock *block);
+
+    std::unordered_set<const Value *> barrier_free_;
+}; // class BarrierElision
+
+
+// Cache of analyses per function. Passes ask the manager for analyses, and invalidate them after changing function:
+// Changing CFG drops all analyses of function, changing instructions only drops liveness and barrier elision.
+class AnalysisManager {
+public:
+    enum Kind : uint32_t {
+        kBlockOrder     = 1u,
+        kDominatorTree  = 1u << 1,
+        kLoopNest       = 1u << 2,
+        kLiveness       = 1u << 3,
+        kBarrierElision = 1u << 4,
+    };
+
+    constexpr static const uint32_t kNone = 0;
+    constexpr static const uint32_t kCfgAnalyses = kBlockOrder | kDominatorTree | kLoopNest;
+    constexpr static const uint32_t kAllAnalyses = kCfgAnalyses | kLiveness | kBarrierElision;
+
+    AnalysisManager(base::Arena *arena, OperatorsFactory *ops);
+    ~AnalysisManager();
+
+    DEF_PTR_GETTER(base::Arena, arena);
+    DEF_PTR_GETTER(OperatorsFactory, ops);
+    // Number of computing analyses, for testing and statistics
+    DEF_VAL_GETTER(int, computed);
+
+    BlockOrder *BlockOrderOf(Function *fun);
+    DominatorTree *DominatorTreeOf(Function *fun);
+    LoopNest *LoopNestOf(Function *fun);
+    Liveness *LivenessOf(Function *fun);
+    BarrierElision *BarrierElisionOf(Function *fun);
+
+    // Insert a preheader block for every loop without preheader, returns number of inserted blocks.
+    // If any block is inserted, the CFG analyses of function will be invalidated.
+    int InsertPreheaders(Function *fun);
+
+    // Drop the analyses of function which are not in preserved. All analyses depend on the CFG, so if any CFG
+    // analysis is not preserved, drop them all.
+    void Invalidate(Function *fun, uint32_t preserved = kNone);
+    void InvalidateAll() { cache_.clear(); }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(AnalysisManager);
+private:
+    struct Analyses {
+        std::unique_ptr<BlockOrder> order;
+        std::unique_ptr<DominatorTree> dom;
+        std::unique_ptr<LoopNest> loops;
+        std::unique_ptr<Liveness> liveness;
+        std::unique_ptr<BarrierElision> barrier_elision;
+    }; // struct Analyses
+
+    BasicBlock *InsertPreheader(Function *fun, Loop *loop, const std::vector<BasicBlock *> &entries);
+
+    base::Arena *const arena_;
+    OperatorsFactory *const ops_;
+    std::unordered_map<const Function *, Analyses> cache_;
+    int computed_ = 0;
+}; // class AnalysisManager
+
+} // namespace ir
+
+} // namespace yalx
+
+#endif // YALX_IR_PASS_ANALYSIS_H_
@@ -0,0 +1,162 @@
+#include "ir/pass/bounds-check-elimination.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/operators-factory.h"
+#include "ir/utils.h"
+#include "ir/base-test.h"
+#include "base/io.h"
+#include <gtest/gtest.h>
+
+namespace yalx {
+
+namespace ir {
+
+class BoundsCheckEliminationPassTest : public ModuleTest {
+public:
+    void SetUp() override {
+        ModuleTest::SetUp();
+        auto ar_name = String::New(arena(), "i32[]");
+        ar_ = new (arena()) ArrayModel(arena(), ar_name, ar_name, 1/*dimension_count*/, Types::Int32);
+        size_ = Handle::Field(arena(), ar_, String::New(arena(), "size"), 0);
+    }
+
+    // fun sum(a: i32[], n: i32)
+    Function *NewFun(const char *name) {
+        return ModuleTest::NewFun(name, {Type::Ref(ar_), Types::Int32}, {Types::Int32});
+    }
+
+    // var s = 0; for (i = 0; i < bound; i++) { s += a[i] }; return s
+    Function *NewSum(const char *name, bool bound_is_size) {
+        const SourcePosition ss = SourcePosition::Unknown();
+        auto fun = NewFun(name);
+        auto entry = NewBlock(fun, "entry");
+        auto header = NewBlock(fun, "header");
+        auto body = NewBlock(fun, "body");
+        auto exit = NewBlock(fun, "exit");
+        auto a = fun->paramater(0);
+        auto size = entry->NewNode(ss, Types::Int32, ops()->LoadEffectField(size_), a);
+        auto bound = bound_is_size ? size : fun->paramater(1);
+        Goto(entry, header);
+        auto zero = I32(0);
+        auto i = header->NewNodeWithNodes(nullptr, ss, Types::Int32, ops()->Phi(2, 2),
+                                          std::vector<Node *>{zero, zero, entry, body});
+        auto s = header->NewNodeWithNodes(nullptr, ss, Types::Int32, ops()->Phi(2, 2),
+                                          std::vector<Node *>{zero, zero, entry, body});
+        auto cond = header->NewNode(ss, Types::Word8, ops()->ICmp(ICondition::slt), i, bound);
+        Branch(header, cond, body, exit);
+        auto e = body->NewNode(ss, Types::Int32, ops()->ArrayAt(ar_, 2), a, i);
+        auto t = body->NewNode(ss, Types::Int32, ops()->Add(), s, e);
+        auto next = body->NewNode(ss, Types::Int32, ops()->Add(), i, I32(1));
+        Goto(body, header);
+        exit->NewNode(ss, Types::Void, ops()->Ret(1), s);
+        ReplacePhiInput(body, i, 1, next);
+        ReplacePhiInput(body, s, 1, t);
+        return fun;
+    }
+
+protected:
+    ArrayModel *ar_ = nullptr;
+    Handle *size_ = nullptr;
+}; // class BoundsCheckEliminationPassTest
+
+TEST_F(BoundsCheckEliminationPassTest, BoundIsSize) {
+    auto fun = NewSum("sum", true/*bound_is_size*/);
+    BoundsCheckEliminationPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(1, pass.eliminated());
+    EXPECT_EQ(0, pass.versioned());
+
+    constexpr static const char z[] = R"(fun sum(%0: ref[i32[]], %1: i32): i32 {
+entry:
+    %2 = LoadEffectField i32 ref[i32[]] %0 <i32[]::size>
+    Br void out [header:]
+header:
+    %3 = Phi i32 i32 0, i32 %4 in [entry:, body:]
+    %5 = Phi i32 i32 0, i32 %6 in [entry:, body:]
+    %7 = ICmp byte i32 %3, i32 %2 <slt>
+    Br void byte %7 out [body:, exit:]
+body:
+    %8 = ArrayUncheckedAt i32 ref[i32[]] %0, i32 %3 <i32[]>
+    %6 = Add i32 i32 %5, i32 %8
+    %4 = Add i32 i32 %3, i32 1
+    Br void out [header:]
+exit:
+    Ret void i32 %5
+} // main:main.sum
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+}
+
+TEST_F(BoundsCheckEliminationPassTest, LoopVersioning) {
+    auto fun = NewSum("sum", false/*bound_is_size*/);
+    BoundsCheckEliminationPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(1, pass.eliminated());
+    EXPECT_EQ(1, pass.versioned());
+
+    constexpr static const char z[] = R"(fun sum(%0: ref[i32[]], %1: i32): i32 {
+entry:
+    %2 = LoadEffectField i32 ref[i32[]] %0 <i32[]::size>
+    %3 = ICmp byte i32 %1, i32 %2 <sle>
+    Br void byte %3 out [L1:, header:]
+L1:
+    %4 = Phi i32 i32 0, i32 %5 in [entry:, L2:]
+    %6 = Phi i32 i32 0, i32 %7 in [entry:, L2:]
+    %8 = ICmp byte i32 %4, i32 %1 <slt>
+    Br void byte %8 out [L2:, exit:]
+L2:
+    %9 = ArrayUncheckedAt i32 ref[i32[]] %0, i32 %4 <i32[]>
+    %7 = Add i32 i32 %6, i32 %9
+    %5 = Add i32 i32 %4, i32 1
+    Br void out [L1:]
+header:
+    %10 = Phi i32 i32 0, i32 %11 in [entry:, body:]
+    %12 = Phi i32 i32 0, i32 %13 in [entry:, body:]
+    %14 = ICmp byte i32 %10, i32 %1 <slt>
+    Br void byte %14 out [body:, exit:]
+body:
+    %15 = ArrayAt i32 ref[i32[]] %0, i32 %10 <i32[]>
+    %13 = Add i32 i32 %12, i32 %15
+    %11 = Add i32 i32 %10, i32 1
+    Br void out [header:]
+exit:
+    %16 = Phi i32 i32 %12, i32 %6 in [header:, L1:]
+    Ret void i32 %16
+} // main:main.sum
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+}
+
+TEST_F(BoundsCheckEliminationPassTest, NotInductionVariable) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto fun = NewFun("foo");
+    auto entry = NewBlock(fun, "entry");
+    auto header = NewBlock(fun, "header");
+    auto body = NewBlock(fun, "body");
+    auto exit = NewBlock(fun, "exit");
+    auto a = fun->paramater(0);
+    auto size = entry->NewNode(ss, Types::Int32, ops()->LoadEffectField(size_), a);
+    Goto(entry, header);
+    auto zero = I32(0);
+    auto i = header->NewNodeWithNodes(nullptr, ss, Types::Int32, ops()->Phi(2, 2),
+                                      std::vector<Node *>{zero, zero, entry, body});
+    auto cond = header->NewNode(ss, Types::Word8, ops()->ICmp(ICondition::slt), i, size);
+    Branch(header, cond, body, exit);
+    // Step is 2: i + 2 may overflow
+    body->NewNode(ss, Types::Int32, ops()->ArrayAt(ar_, 2), a, i);
+    auto next = body->NewNode(ss, Types::Int32, ops()->Add(), i, I32(2));
+    Goto(body, header);
+    // Not guarded by loop condition
+    exit->NewNode(ss, Types::Int32, ops()->ArrayAt(ar_, 2), a, i);
+    exit->NewNode(ss, Types::Void, ops()->Ret(1), i);
+    ReplacePhiInput(body, i, 1, next);
+
+    BoundsCheckEliminationPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(0, pass.eliminated());
+    EXPECT_EQ(0, pass.versioned());
+}
+
+} // namespace ir
+
+} // namespace yalx
@@ -0,0 +1,364 @@
+#include "ir/pass/bounds-check-elimination.h"
+#include "ir/operators-factory.h"
+#include "ir/condition.h"
+#include "ir/metadata.h"
+#include <algorithm>
+
+namespace yalx::ir {
+
+BoundsCheckEliminationPass::BoundsCheckEliminationPass(base::Arena *arena, OperatorsFactory *ops,
+                                                       ModulesMap *modules, cpl::SyntaxFeedback *feedback)
+: Pass<BoundsCheckEliminationPass>(arena, ops, modules, feedback) {
+}
+
+void BoundsCheckEliminationPass::RunModule(Module *module) {
+    ForeachUdt(module);
+    ForeachFunction(module);
+}
+
+void BoundsCheckEliminationPass::RunFun(Function *fun) {
+    if (!fun->entry()) {
+        return;
+    }
+
+    versioned_headers_.clear();
+    analyses()->InsertPreheaders(fun);
+    const auto versioned = versioned_;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        owners_.clear();
+        for (auto blk : fun->blocks()) {
+            for (auto instr : blk->instructions()) { owners_[instr] = blk; }
+        }
+
+        // Inner loops first, the CFG is changed after versioning a loop, so analyze again.
+        auto loops = analyses()->LoopNestOf(fun)->loops();
+        for (auto iter = loops.rbegin(); iter != loops.rend(); iter++) {
+            if (versioned_headers_.find((*iter)->header()) != versioned_headers_.end()) {
+                continue;
+            }
+            if (RunLoop(fun, *iter)) {
+                analyses()->Invalidate(fun);
+                changed = true;
+                break;
+            }
+        }
+    }
+    owners_.clear();
+
+    if (versioned_ != versioned) {
+        fun->UpdateIdsOfBlocks();
+    }
+}
+
+static bool ConstantOf(Value *value, int64_t *constant) {
+    switch (value->op()->value()) {
+        case Operator::kI8Constant:
+            *constant = OperatorWith<int8_t>::Data(value);
+            return true;
+        case Operator::kI16Constant:
+            *constant = OperatorWith<int16_t>::Data(value);
+            return true;
+        case Operator::kI32Constant:
+            *constant = OperatorWith<int32_t>::Data(value);
+            return true;
+        case Operator::kI64Constant:
+            *constant = OperatorWith<int64_t>::Data(value);
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool IsSizeOf(Value *value, Value *array) {
+    if (value->IsNot(Operator::kLoadEffectField) || value->InputValue(0) != array) {
+        return false;
+    }
+    auto handle = OperatorWith<const Handle *>::Data(value);
+    return handle->owns()->declaration() == Model::kArray && handle->name()->ToSlice() == "size";
+}
+
+bool BoundsCheckEliminationPass::RunLoop(Function *fun, Loop *loop) {
+    if (!loop->preheader() || loop->latches().size() != 1) {
+        return false;
+    }
+
+    std::vector<Value *> accesses;
+    for (auto blk : loop->blocks()) {
+        for (auto instr : blk->instructions()) {
+            if (instr->IsAlive() && instr->Is(Operator::kArrayAt) && instr->op()->value_in() == 2 &&
+                OperatorWith<const ArrayModel *>::Data(instr)->dimension_count() == 1) {
+                accesses.push_back(instr);
+            }
+        }
+    }
+    if (accesses.empty()) {
+        return false;
+    }
+
+    auto dom = analyses()->DominatorTreeOf(fun);
+    InductionVariable versioning_iv{nullptr, nullptr, nullptr};
+    std::vector<Value *> versioning;
+    for (auto phi : loop->header()->instructions()) {
+        InductionVariable iv;
+        if (phi->IsDead() || !FindInductionVariable(loop, phi, &iv)) {
+            continue;
+        }
+        for (auto access : accesses) {
+            if (access->IsNot(Operator::kArrayAt) || access->InputValue(1) != phi ||
+                !dom->Dominates(iv.body, owners_[access])) {
+                continue;
+            }
+            auto array = access->InputValue(0);
+            if (IsSizeOf(iv.bound, array)) {
+                auto model = OperatorWith<const ArrayModel *>::Data(access);
+                access->set_op(ops()->ArrayUncheckedAt(model, 2/*value_in*/));
+                eliminated_++;
+                continue;
+            }
+            if (IsInvariant(loop, array) && IsInvariant(loop, iv.bound) &&
+                (!versioning_iv.phi || versioning_iv.phi == phi)) {
+                versioning_iv = iv;
+                versioning.push_back(access);
+            }
+        }
+    }
+    if (versioning.empty()) {
+        return false;
+    }
+
+    // Only loops exit from header can be versioned: values of loop used out of loop are defined in header.
+    auto header = loop->header();
+    for (auto blk : loop->blocks()) {
+        for (auto succ : blk->outputs()) {
+            if (!loop->Contains(succ) && (blk != header || succ->inputs_size() != 1)) {
+                return false;
+            }
+        }
+    }
+    auto term = loop->preheader()->instructions().back();
+    if (term->IsNot(Operator::kBr) || term->op()->control_out() != 1 || term->OutputControl(0) != header) {
+        return false;
+    }
+    VersionLoop(fun, loop, versioning_iv, versioning);
+    return true;
+}
+
+bool BoundsCheckEliminationPass::FindInductionVariable(Loop *loop, Value *phi, InductionVariable *iv) {
+    if (phi->IsNot(Operator::kPhi) || phi->op()->value_in() != 2) {
+        return false;
+    }
+    const int inside = loop->Contains(phi->InputControl(0)) ? 0 : 1;
+    if (!loop->Contains(phi->InputControl(inside)) || loop->Contains(phi->InputControl(1 - inside))) {
+        return false;
+    }
+
+    // init >= 0, and i + 1 never overflows because i < bound.
+    int64_t init = 0, step = 0;
+    if (!ConstantOf(phi->InputValue(1 - inside), &init) || init < 0) {
+        return false;
+    }
+    auto next = phi->InputValue(inside);
+    if (next->IsNot(Operator::kAdd)) {
+        return false;
+    }
+    auto incoming = next->InputValue(0) == phi ? next->InputValue(1) : next->InputValue(0);
+    if ((next->InputValue(0) != phi && next->InputValue(1) != phi) || !ConstantOf(incoming, &step) || step != 1) {
+        return false;
+    }
+
+    auto header = loop->header();
+    auto br = header->instructions().back();
+    if (br->IsNot(Operator::kBr) || br->op()->value_in() != 1 || br->op()->control_out() != 2) {
+        return false;
+    }
+    auto cond = br->InputValue(0);
+    if (cond->IsNot(Operator::kICmp)) {
+        return false;
+    }
+    // Which edge is taken if `i < bound'
+    int edge = -1;
+    const auto op = OperatorWith<IConditionId>::Data(cond);
+    if (cond->InputValue(0) == phi) {
+        iv->bound = cond->InputValue(1);
+        edge = op == ICondition::slt ? 0 : (op == ICondition::sge ? 1 : -1);
+    } else if (cond->InputValue(1) == phi) {
+        iv->bound = cond->InputValue(0);
+        edge = op == ICondition::sgt ? 0 : (op == ICondition::sle ? 1 : -1);
+    }
+    if (edge < 0) {
+        return false;
+    }
+    iv->phi = phi;
+    iv->body = br->OutputControl(edge);
+    return loop->Contains(iv->body) && !loop->Contains(br->OutputControl(1 - edge)) && iv->body->inputs_size() == 1;
+}
+
+Value *BoundsCheckEliminationPass::SizeOfArray(Function *fun, BasicBlock *block, Value *array) {
+    auto dom = analyses()->DominatorTreeOf(fun);
+    for (auto [position, user] : array->GetUsers()) {
+        if (IsSizeOf(user, array) && owners_.find(user) != owners_.end() && dom->Dominates(owners_[user], block)) {
+            return user;
+        }
+    }
+    auto model = down_cast<ArrayModel>(array->type().model());
+    auto handle = DCHECK_NOTNULL(model->FindMemberOrNull("size"));
+    return block->NewNode(array->source_position(), Types::Int32, ops()->LoadEffectField(handle), array);
+}
+
+void BoundsCheckEliminationPass::VersionLoop(Function *fun, Loop *loop, const InductionVariable &iv,
+                                             const std::vector<Value *> &accesses) {
+    const auto ss = iv.phi->source_position();
+    auto preheader = loop->preheader();
+    auto header = loop->header();
+    auto br = header->instructions().back();
+    auto exit = loop->Contains(br->OutputControl(0)) ? br->OutputControl(1) : br->OutputControl(0);
+
+    // The guard: bound <= a.size for all arrays
+    auto term = preheader->instructions().back();
+    term->KillWithInputs();
+    preheader->RemoveDeads();
+    std::vector<Value *> arrays;
+    for (auto access : accesses) {
+        if (std::find(arrays.begin(), arrays.end(), access->InputValue(0)) == arrays.end()) {
+            arrays.push_back(access->InputValue(0));
+        }
+    }
+    Value *guard = nullptr;
+    for (auto array : arrays) {
+        auto size = SizeOfArray(fun, preheader, array);
+        auto cmp = preheader->NewNode(ss, Types::Word8, ops()->ICmp(ICondition::sle), iv.bound, size);
+        guard = !guard ? cmp : preheader->NewNode(ss, Types::Word8, ops()->And(), guard, cmp);
+    }
+
+    // Copy blocks of loop as the fast version
+    std::unordered_map<const BasicBlock *, BasicBlock *> blocks;
+    auto prev = preheader;
+    for (auto blk : fun->blocks()) {
+        if (!loop->Contains(blk)) {
+            continue;
+        }
+        auto copied = fun->NewBlock(nullptr);
+        fun->MoveToAfterOf(prev, copied);
+        blocks[blk] = copied;
+        prev = copied;
+    }
+    auto MapBlock = [&blocks](BasicBlock *blk) {
+        auto iter = blocks.find(blk);
+        return iter == blocks.end() ? blk : iter->second;
+    };
+
+    std::unordered_map<const Value *, Value *> values;
+    auto MapValue = [&values](Value *value) {
+        auto iter = values.find(value);
+        return iter == values.end() ? value : iter->second;
+    };
+    struct Fixup {
+        Value *instr;
+        int position;
+        Value *origin;
+    };
+    std::vector<Fixup> fixups;
+    for (auto blk : loop->blocks()) {
+        auto copied = blocks[blk];
+        for (auto instr : blk->instructions()) {
+            if (instr->IsDead()) {
+                continue;
+            }
+            auto offset = instr->op()->value_in() + std::max(instr->op()->value_out() - 1, 0);
+            std::vector<Node *> inputs(offset + instr->op()->control_in() + instr->op()->control_out());
+            std::vector<int> pending;
+            for (int i = 0; i < instr->op()->value_in(); i++) {
+                auto input = instr->InputValue(i);
+                inputs[i] = MapValue(input);
+                if (inputs[i] == input && !IsInvariant(loop, input)) {
+                    pending.push_back(i); // Back edges of phis, fixed after all blocks copied
+                }
+            }
+            for (int i = 0; i < instr->op()->control_in(); i++) {
+                inputs[offset++] = MapBlock(instr->InputControl(i));
+            }
+            for (int i = 0; i < instr->op()->control_out(); i++) {
+                inputs[offset++] = MapBlock(instr->OutputControl(i));
+            }
+            auto copied_instr = copied->NewNodeWithNodes(nullptr, instr->source_position(), instr->type(),
+                                                         instr->op(), inputs);
+            values[instr] = copied_instr;
+            for (auto i : pending) {
+                fixups.push_back({copied_instr, i, instr->InputValue(i)});
+            }
+        }
+        for (auto pred : blk->inputs()) {
+            MapBlock(pred)->LinkTo(copied);
+        }
+        for (auto succ : blk->outputs()) {
+            if (!loop->Contains(succ)) { copied->LinkTo(succ); }
+        }
+    }
+    for (const auto &fixup : fixups) {
+        auto to = values[fixup.origin];
+        fixup.instr->Replace(arena(), fixup.position, fixup.origin, to);
+        if (fixup.instr->Is(Operator::kPhi)) {
+            for (auto &user : *fixup.instr->InputControl(fixup.position)->mutable_phi_node_users()) {
+                if (user.phi == fixup.instr && user.dest == fixup.origin) { user.dest = to; }
+            }
+        }
+    }
+    preheader->NewNode(ss, Types::Void, ops()->Br(1/*value_in*/, 2/*control_out*/), guard, blocks[header], header);
+
+    // Merge values of two versions in exit block.
+    auto copied_header = blocks[header];
+    std::vector<Value *> merged;
+    auto Merge = [&](Value *value, Type type) {
+        auto phi = exit->NewNode(ss, type, ops()->Phi(2, 2), value, MapValue(value), header, copied_header);
+        exit->MoveToFront(phi);
+        merged.push_back(phi);
+        return phi;
+    };
+    std::vector<Value *> exit_phis;
+    for (auto instr : exit->instructions()) {
+        if (instr->IsAlive() && instr->Is(Operator::kPhi)) { exit_phis.push_back(instr); }
+    }
+    for (auto instr : exit_phis) {
+        DCHECK(instr->op()->value_in() == 1);
+        auto phi = Merge(instr->InputValue(0), instr->type());
+        instr->ReplaceUsesWith(arena(), phi);
+        instr->KillWithInputs();
+    }
+    for (auto instr : header->instructions()) {
+        if (instr->IsDead() || instr->type().kind() == Type::kVoid) {
+            continue;
+        }
+        Value *phi = nullptr;
+        for (auto [position, user] : instr->GetUsers()) {
+            auto owner = owners_.find(user);
+            if (owner == owners_.end() || loop->Contains(owner->second) ||
+                std::find(merged.begin(), merged.end(), user) != merged.end()) {
+                continue; // In loop or the copied loop
+            }
+            if (!phi) {
+                phi = Merge(instr, instr->type());
+            }
+            user->Replace(arena(), position, instr, phi);
+            if (user->Is(Operator::kPhi)) {
+                for (auto &phi_user : *user->InputControl(position)->mutable_phi_node_users()) {
+                    if (phi_user.phi == user && phi_user.dest == instr) { phi_user.dest = phi; }
+                }
+            }
+        }
+    }
+    header->RemovePhiUsersOfDeads();
+    exit->RemoveDeads();
+
+    for (auto access : accesses) {
+        auto model = OperatorWith<const ArrayModel *>::Data(access);
+        values[access]->set_op(ops()->ArrayUncheckedAt(model, 2/*value_in*/));
+        eliminated_++;
+    }
+    versioned_headers_.insert(header);
+    versioned_headers_.insert(copied_header);
+    versioned_++;
+}
+
+} // namespace yalx::ir
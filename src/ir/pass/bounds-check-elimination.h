@@ -0,0 +1,66 @@
+#pragma once
+#ifndef YALX_IR_PASS_BOUNDS_CHECK_ELIMINATION_H_
+#define YALX_IR_PASS_BOUNDS_CHECK_ELIMINATION_H_
+
+#include "ir/pass/pass.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace yalx {
+
+namespace ir {
+
+// Eliminate bounds checks of arrays indexed by induction variables of loops:
+//   for (i = c; i < n; i++) { ... a[i] ... }, where c >= 0
+// In the blocks guarded by the loop condition, 0 <= i < n is proven, so:
+//   - If n is the size of array a, `ArrayAt' is replaced by `ArrayUncheckedAt';
+//   - If array a and n are loop invariants, the loop is versioned by a single guard `n <= a.size' in preheader:
+//     the fast version without checks is taken if guard is passed, otherwise the origin version with checks.
+class BoundsCheckEliminationPass : public Pass<BoundsCheckEliminationPass> {
+public:
+    constexpr static const char kPassName[] = "bounds-check-elimination";
+    constexpr static const int kPassLevel = 1;
+
+    BoundsCheckEliminationPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules,
+                               cpl::SyntaxFeedback *feedback);
+
+    DEF_VAL_GETTER(int, eliminated);
+    DEF_VAL_GETTER(int, versioned);
+
+    void RunModule(Module *module);
+    void RunFun(Function *fun);
+    void RunUdt(StructureModel *udt) { ForeachMethod(udt); }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(BoundsCheckEliminationPass);
+private:
+    // Induction variable i in [init, bound) of loop, it's increased by 1 in every iteration.
+    struct InductionVariable {
+        Value *phi;
+        Value *bound;
+        BasicBlock *body; // The first block in loop guarded by `i < bound'
+    }; // struct InductionVariable
+
+    // Returns true if the CFG of function is changed.
+    bool RunLoop(Function *fun, Loop *loop);
+    bool FindInductionVariable(Loop *loop, Value *phi, InductionVariable *iv);
+    void VersionLoop(Function *fun, Loop *loop, const InductionVariable &iv, const std::vector<Value *> &accesses);
+    Value *SizeOfArray(Function *fun, BasicBlock *block, Value *array);
+
+    bool IsInvariant(Loop *loop, Value *value) const {
+        auto iter = owners_.find(value);
+        return iter == owners_.end() || !loop->Contains(iter->second);
+    }
+
+    // Blocks of instructions in current function
+    std::unordered_map<const Value *, BasicBlock *> owners_;
+    std::unordered_set<const BasicBlock *> versioned_headers_;
+    int eliminated_ = 0;
+    int versioned_ = 0;
+}; // class BoundsCheckEliminationPass
+
+} // namespace ir
+
+} // namespace yalx
+
+#endif // YALX_IR_PASS_BOUNDS_CHECK_ELIMINATION_H_
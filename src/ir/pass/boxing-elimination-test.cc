@@ -0,0 +1,108 @@
+#include "ir/pass/boxing-elimination.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/operators-factory.h"
+#include "ir/base-test.h"
+#include "base/io.h"
+#include <gtest/gtest.h>
+
+namespace yalx {
+
+namespace ir {
+
+class BoxingEliminationPassTest : public ModuleTest {
+public:
+    void SetUp() override {
+        ModuleTest::SetUp();
+        any_ = module_->NewClassModel(String::New(arena(), "Any"), String::New(arena(), "main:main.Any"), nullptr);
+    }
+    
+    Function *NewFun(const char *name, Type param, Type ret) {
+        auto fun = ModuleTest::NewFun(name, {param}, {ret});
+        NewBlock(fun, "entry");
+        return fun;
+    }
+    
+    void RunPass(BoxingEliminationPass::ModulesMap *modules, int *boxing, int *unboxing) {
+        BoxingEliminationPass pass(arena(), ops(), modules, feedback());
+        pass.Run();
+        *boxing = pass.eliminated_boxing();
+        *unboxing = pass.eliminated_unboxing();
+    }
+    
+    Type AnyTy() const { return Type::Ref(any_); }
+    
+protected:
+    StructureModel *any_ = nullptr;
+}; // class BoxingEliminationPassTest
+
+TEST_F(BoxingEliminationPassTest, Sanity) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    // Not escaped: fully eliminated
+    auto fun = NewFun("issue1", Types::Int32, Types::Int32);
+    auto bb = fun->entry();
+    auto box = bb->NewNode(ss, AnyTy(), ops()->BoxingTo(), fun->paramater(0));
+    auto val = bb->NewNode(ss, Types::Int32, ops()->UnboxingTo(), box);
+    bb->NewNode(ss, Types::Void, ops()->Ret(1), val);
+    
+    // Escaped by returning: only unboxing eliminated
+    fun = NewFun("issue2", Types::Int32, AnyTy());
+    bb = fun->entry();
+    box = bb->NewNode(ss, AnyTy(), ops()->BoxingTo(), fun->paramater(0));
+    val = bb->NewNode(ss, Types::Int32, ops()->UnboxingTo(), box);
+    val = bb->NewNode(ss, Types::Int32, ops()->Add(), val, val);
+    bb->NewNode(ss, Types::Void, ops()->Ret(1), box);
+    
+    // Different types: keep all
+    fun = NewFun("issue3", Types::Int32, Types::Int64);
+    bb = fun->entry();
+    box = bb->NewNode(ss, AnyTy(), ops()->BoxingTo(), fun->paramater(0));
+    val = bb->NewNode(ss, Types::Int64, ops()->UnboxingTo(), box);
+    bb->NewNode(ss, Types::Void, ops()->Ret(1), val);
+    
+    base::ArenaMap<std::string_view, Module *> modules(arena());
+    modules["main:main"] = module_;
+    int boxing = 0, unboxing = 0;
+    RunPass(&modules, &boxing, &unboxing);
+    EXPECT_EQ(1, boxing);
+    EXPECT_EQ(2, unboxing);
+    
+    std::string buf;
+    base::PrintingWriter printer(base::NewMemoryWritableFile(&buf), true/*ownership*/);
+    module_->PrintTo(&printer);
+    
+    constexpr static const char z[] = R"(module main @main:main {
+source-files:
+
+structures:
+    class Any @main:main.Any {
+    } // main:main.Any
+
+functions:
+    fun issue1(%0: i32): i32 {
+    entry:
+        Ret void i32 %0
+    } // main:main.issue1
+
+    fun issue2(%0: i32): ref[main:main.Any] {
+    entry:
+        %1 = BoxingTo ref[main:main.Any] i32 %0
+        %2 = Add i32 i32 %0, i32 %0
+        Ret void ref[main:main.Any] %1
+    } // main:main.issue2
+
+    fun issue3(%0: i32): i64 {
+    entry:
+        %1 = BoxingTo ref[main:main.Any] i32 %0
+        %2 = UnboxingTo i64 ref[main:main.Any] %1
+        Ret void i64 %2
+    } // main:main.issue3
+
+} // @main:main
+)";
+    EXPECT_EQ(z, buf);
+}
+
+} // namespace ir
+
+} // namespace yalx
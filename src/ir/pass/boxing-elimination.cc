@@ -0,0 +1,51 @@
+#include "ir/pass/boxing-elimination.h"
+#include "ir/operators-factory.h"
+
+namespace yalx::ir {
+
+BoxingEliminationPass::BoxingEliminationPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules,
+                                             cpl::SyntaxFeedback *feedback)
+: Pass<BoxingEliminationPass>(arena, ops, modules, feedback) {
+}
+
+void BoxingEliminationPass::RunModule(Module *module) {
+    ForeachUdt(module);
+    ForeachFunction(module);
+}
+
+void BoxingEliminationPass::RunFun(Function *fun) {
+    ForeachBasicBlock(fun);
+    
+    // Boxing values without any users never escape, remove them.
+    for (auto blk : fun->blocks()) {
+        for (auto instr : blk->instructions()) {
+            if (instr->IsAlive() && instr->Is(Operator::kBoxingTo) && instr->users().size() == 0) {
+                instr->KillWithInputs();
+                eliminated_boxing_++;
+            }
+        }
+        blk->RemoveDeads();
+    }
+}
+
+void BoxingEliminationPass::RunBasicBlock(BasicBlock *block) {
+    for (auto instr : block->instructions()) {
+        if (instr->IsDead() || instr->IsNot(Operator::kUnboxingTo)) {
+            continue;
+        }
+        auto boxing = instr->InputValue(0);
+        if (boxing->IsNot(Operator::kBoxingTo)) {
+            continue;
+        }
+        auto origin = boxing->InputValue(0);
+        if (origin->type().kind() != instr->type().kind() || origin->type().model() != instr->type().model()) {
+            continue;
+        }
+        
+        instr->ReplaceUsesWith(arena(), origin);
+        instr->KillWithInputs();
+        eliminated_unboxing_++;
+    }
+}
+
+} // namespace yalx::ir
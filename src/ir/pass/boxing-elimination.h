@@ -0,0 +1,40 @@
+#pragma once
+#ifndef YALX_IR_PASS_BOXING_ELIMINATION_H_
+#define YALX_IR_PASS_BOXING_ELIMINATION_H_
+
+#include "ir/pass/pass.h"
+
+namespace yalx {
+
+namespace ir {
+
+// Eliminate the boxing numbers which do not escape:
+// `UnboxingTo(BoxingTo(x))' will be replaced by `x', and then a `BoxingTo' without any users will be removed.
+class BoxingEliminationPass : public Pass<BoxingEliminationPass> {
+public:
+    constexpr static const char kPassName[] = "boxing-elimination";
+    constexpr static const int kPassLevel = 1;
+    constexpr static const uint32_t kPreservedAnalyses = AnalysisManager::kCfgAnalyses;
+    
+    BoxingEliminationPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules,
+                          cpl::SyntaxFeedback *feedback);
+    
+    DEF_VAL_GETTER(int, eliminated_boxing);
+    DEF_VAL_GETTER(int, eliminated_unboxing);
+    
+    void RunModule(Module *module);
+    void RunFun(Function *fun);
+    void RunUdt(StructureModel *udt) { ForeachMethod(udt); }
+    void RunBasicBlock(BasicBlock *block);
+    
+    DISALLOW_IMPLICIT_CONSTRUCTORS(BoxingEliminationPass);
+private:
+    int eliminated_boxing_ = 0;
+    int eliminated_unboxing_ = 0;
+}; // class BoxingEliminationPass
+
+} // namespace ir
+
+} // namespace yalx
+
+#endif // YALX_IR_PASS_BOXING_ELIMINATION_H_
@@ -481,6 +481,16 @@ static NumberTyIndex ToIndex(const Type &ty) {
     }
 }
 
+Value *ConstantsFoldingPass::FoldBinary(base::Arena *arena, OperatorsFactory *ops, Operator *op, Value *lhs,
+                                        Value *rhs) {
+    auto op_index = ToIndex(op);
+    auto ty_index = ToIndex(lhs->type());
+    if (op_index == kOp_Index_Max || ty_index == kTy_Index_Max) {
+        return nullptr;
+    }
+    return kFoldingOperators[op_index][ty_index](arena, op, lhs, rhs, ops);
+}
+
 Value *ConstantsFoldingPass::FoldValueIfNeeded(Value *input, bool *folded) {
     for (auto i = 0; i < input->op()->value_in(); i++) {
         if (!input->InputValue(i)->op()->IsConstant()) {
@@ -495,13 +505,7 @@ Value *ConstantsFoldingPass::FoldValueIfNeeded(Value *input, bool *folded) {
         DECLARE_IR_COMPARISON(DEFINE_CASE)
 #undef  DEFINE_CASE
         {
-            auto op_index = ToIndex(input->op());
-            auto ty_index = ToIndex(input->InputValue(0)->type());
-            if (op_index == kOp_Index_Max || ty_index == kTy_Index_Max) {
-                goto not_match;
-            }
-            auto val = kFoldingOperators[op_index][ty_index](arena(), input->op(), input->InputValue(0),
-                                                             input->InputValue(1), ops());
+            auto val = FoldBinary(arena(), ops(), input->op(), input->InputValue(0), input->InputValue(1));
             if (!val) {
                 goto not_match;
             }
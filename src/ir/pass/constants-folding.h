@@ -12,6 +12,7 @@ class ConstantsFoldingPass : public Pass<ConstantsFoldingPass> {
 public:
     constexpr static const char kPassName[] = "constants-folding";
     constexpr static const int kPassLevel = 1;
+    constexpr static const uint32_t kPreservedAnalyses = AnalysisManager::kCfgAnalyses;
     
     ConstantsFoldingPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules, cpl::SyntaxFeedback *feedback);
     
@@ -20,6 +21,9 @@ public:
     void RunUdt(StructureModel *udt) { ForeachMethod(udt); }
     void RunBasicBlock(BasicBlock *block);
     
+    // Fold binary or comparison operator with constant operands, returns nullptr if it can not be folded.
+    static Value *FoldBinary(base::Arena *arena, OperatorsFactory *ops, Operator *op, Value *lhs, Value *rhs);
+    
     DISALLOW_IMPLICIT_CONSTRUCTORS(ConstantsFoldingPass);
 private:
     Value *FoldGlobalValue(Value *value);
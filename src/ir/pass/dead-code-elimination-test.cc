@@ -0,0 +1,143 @@
+#include "ir/pass/dead-code-elimination.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/operators-factory.h"
+#include "ir/utils.h"
+#include "ir/base-test.h"
+#include "base/io.h"
+#include <gtest/gtest.h>
+
+namespace yalx {
+
+namespace ir {
+
+class DeadCodeEliminationPassTest : public ModuleTest {
+public:
+    void SetUp() override {
+        ModuleTest::SetUp();
+        foo_ = module_->NewStructModel(String::New(arena(), "Foo"), String::New(arena(), "main:main.Foo"), nullptr);
+        x_ = foo_->InsertField({String::New(arena(), "x"), kPublic, 0, Types::Int32, false});
+        y_ = foo_->InsertField({String::New(arena(), "y"), kPublic, 0, Types::Int32, false});
+    }
+
+    // fun foo(a: i32, b: T): i32
+    Function *NewFun(Type type) { return ModuleTest::NewFun("foo", {Types::Int32, type}, {Types::Int32}); }
+
+protected:
+    StructureModel *foo_ = nullptr;
+    Handle *x_ = nullptr;
+    Handle *y_ = nullptr;
+}; // class DeadCodeEliminationPassTest
+
+TEST_F(DeadCodeEliminationPassTest, UnusedValues) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto fun = NewFun(Types::Int32);
+    auto entry = NewBlock(fun, "entry");
+    auto a = fun->paramater(0);
+    auto b = fun->paramater(1);
+    auto t = entry->NewNode(ss, Types::Int32, ops()->Add(), a, I32(1));
+    entry->NewNode(ss, Types::Int32, ops()->Mul(), t, I32(2));
+    entry->NewNode(ss, Types::Int32, ops()->SDiv(), a, I32(2));
+    entry->NewNode(ss, Types::Int32, ops()->SDiv(), a, b); // Might trap
+    entry->NewNode(ss, Type::Ref(foo_), ops()->HeapAlloc(foo_));
+    auto rv = entry->NewNode(ss, Types::Int32, ops()->Sub(), a, b);
+    entry->NewNode(ss, Types::Void, ops()->Ret(1), rv);
+
+    DeadCodeEliminationPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(4, pass.eliminated());
+
+    constexpr static const char z[] = R"(fun foo(%0: i32, %1: i32): i32 {
+entry:
+    %2 = SDiv i32 i32 %0, i32 %1
+    %3 = Sub i32 i32 %0, i32 %1
+    Ret void i32 %3
+} // main:main.foo
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+}
+
+TEST_F(DeadCodeEliminationPassTest, DeadLoopValues) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto fun = NewFun(Types::Int32);
+    auto entry = NewBlock(fun, "entry");
+    auto header = NewBlock(fun, "header");
+    auto exit = NewBlock(fun, "exit");
+    Goto(entry, header);
+    auto i = header->NewNodeWithNodes(nullptr, ss, Types::Int32, ops()->Phi(2, 2),
+                                      std::vector<Node *>{I32(0), I32(0), entry, header});
+    auto next = header->NewNode(ss, Types::Int32, ops()->Add(), i, I32(1));
+    Branch(header, fun->paramater(0), header, exit);
+    exit->NewNode(ss, Types::Void, ops()->Ret(1), fun->paramater(1));
+    ReplacePhiInput(header, i, 1, next);
+
+    DeadCodeEliminationPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(2, pass.eliminated());
+    EXPECT_TRUE(header->phi_node_users().empty());
+    EXPECT_EQ(1, header->instructions_size());
+}
+
+TEST_F(DeadCodeEliminationPassTest, DeadStores) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto ptr = Type::Val(foo_, true/*pointer*/);
+    auto fun = NewFun(ptr);
+    auto entry = NewBlock(fun, "entry");
+    auto a = fun->paramater(0);
+    auto p = fun->paramater(1);
+    auto val = Type::Val(foo_);
+    entry->NewNode(ss, val, ops()->StoreAccessField(x_), p, I32(1)); // Overwritten
+    entry->NewNode(ss, val, ops()->StoreAccessField(y_), p, I32(2));
+    entry->NewNode(ss, val, ops()->StoreAccessField(x_), p, a);
+    auto x = entry->NewNode(ss, Types::Int32, ops()->LoadAccessField(x_), p);
+    entry->NewNode(ss, val, ops()->StoreAccessField(x_), p, I32(3)); // Read before overwriting
+    entry->NewNode(ss, val, ops()->StoreAccessField(x_), p, I32(4));
+    entry->NewNode(ss, Types::Void, ops()->Ret(1), x);
+
+    DeadCodeEliminationPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(2, pass.stores_eliminated());
+    EXPECT_EQ(0, pass.eliminated());
+
+    constexpr static const char z[] = R"(fun foo(%0: i32, %1: val[main:main.Foo]*): i32 {
+entry:
+    %2 = StoreAccessField val[main:main.Foo] val[main:main.Foo]* %1, i32 2 <main:main.Foo::y>
+    %3 = StoreAccessField val[main:main.Foo] val[main:main.Foo]* %1, i32 %0 <main:main.Foo::x>
+    %4 = LoadAccessField i32 val[main:main.Foo]* %1 <main:main.Foo::x>
+    %5 = StoreAccessField val[main:main.Foo] val[main:main.Foo]* %1, i32 4 <main:main.Foo::x>
+    Ret void i32 %4
+} // main:main.foo
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+}
+
+TEST_F(DeadCodeEliminationPassTest, InlineStores) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto val = Type::Val(foo_);
+    auto fun = NewFun(val);
+    auto entry = NewBlock(fun, "entry");
+    auto a = fun->paramater(0);
+    auto s1 = entry->NewNode(ss, val, ops()->StoreInlineField(x_), fun->paramater(1), I32(1));
+    auto s2 = entry->NewNode(ss, val, ops()->StoreInlineField(y_), s1, I32(2));
+    auto s3 = entry->NewNode(ss, val, ops()->StoreInlineField(x_), s2, a);
+    auto rv = entry->NewNode(ss, Types::Int32, ops()->LoadInlineField(x_), s3);
+    entry->NewNode(ss, Types::Void, ops()->Ret(1), rv);
+
+    DeadCodeEliminationPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(1, pass.stores_eliminated());
+
+    constexpr static const char z[] = R"(fun foo(%0: i32, %1: val[main:main.Foo]): i32 {
+entry:
+    %2 = StoreInlineField val[main:main.Foo] val[main:main.Foo] %1, i32 2 <main:main.Foo::y>
+    %3 = StoreInlineField val[main:main.Foo] val[main:main.Foo] %2, i32 %0 <main:main.Foo::x>
+    %4 = LoadInlineField i32 val[main:main.Foo] %3 <main:main.Foo::x>
+    Ret void i32 %4
+} // main:main.foo
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+}
+
+} // namespace ir
+
+} // namespace yalx
@@ -0,0 +1,218 @@
+#include "ir/pass/dead-code-elimination.h"
+#include "ir/pass/global-value-numbering.h"
+#include "ir/operators-factory.h"
+#include "ir/metadata.h"
+#include <algorithm>
+#include <set>
+
+namespace yalx::ir {
+
+DeadCodeEliminationPass::DeadCodeEliminationPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules,
+                                                 cpl::SyntaxFeedback *feedback)
+: Pass<DeadCodeEliminationPass>(arena, ops, modules, feedback) {
+}
+
+void DeadCodeEliminationPass::RunModule(Module *module) {
+    ForeachUdt(module);
+    ForeachFunction(module);
+}
+
+void DeadCodeEliminationPass::RunFun(Function *fun) {
+    if (!fun->entry()) {
+        return;
+    }
+
+    for (auto blk : fun->blocks()) {
+        EliminateInlineStores(blk);
+        EliminateDeadStores(blk);
+    }
+    MarkSweep(fun);
+
+    for (auto blk : fun->blocks()) {
+        blk->RemovePhiUsersOfDeads();
+        blk->RemoveDeads();
+    }
+}
+
+static bool IsNonZeroConstant(Value *value) {
+    switch (value->op()->value()) {
+    #define DEFINE_CASE(name, type) \
+        case Operator::k##name##Constant: \
+            return OperatorWith<type>::Data(value) != 0;
+        DEFINE_CASE(Word8, uint8_t)
+        DEFINE_CASE(Word16, uint16_t)
+        DEFINE_CASE(Word32, uint32_t)
+        DEFINE_CASE(Word64, uint64_t)
+        DEFINE_CASE(I8, int8_t)
+        DEFINE_CASE(I16, int16_t)
+        DEFINE_CASE(I32, int32_t)
+        DEFINE_CASE(I64, int64_t)
+        DEFINE_CASE(U8, uint8_t)
+        DEFINE_CASE(U16, uint16_t)
+        DEFINE_CASE(U32, uint32_t)
+        DEFINE_CASE(U64, uint64_t)
+    #undef DEFINE_CASE
+        default:
+            return false;
+    }
+}
+
+bool DeadCodeEliminationPass::IsRemovable(Value *instr) {
+    if (instr->type().kind() == Type::kVoid || instr->op()->control_out() > 0) {
+        return false;
+    }
+
+    switch (instr->op()->value()) {
+        // Might trap: removing them changes the behavior of the program.
+        case Operator::kSDiv:
+        case Operator::kSRem:
+        case Operator::kUDiv:
+        case Operator::kURem:
+            return IsNonZeroConstant(instr->InputValue(1));
+        case Operator::kUnboxingTo:
+        case Operator::kArrayAt:
+        case Operator::kRefAssertedTo:
+            return false;
+        case Operator::kLoadEffectField:
+            return !instr->InputValue(0)->type().IsNullable();
+
+        // No effects, or make a new object: no finalizer in yalx, an unused object is never observed.
+    #define DEFINE_CASE(name) case Operator::k##name:
+        DECLARE_IR_CONSTANT(DEFINE_CASE)
+    #undef DEFINE_CASE
+        case Operator::kPhi:
+        case Operator::kHeapAlloc:
+        case Operator::kStackAlloc:
+        case Operator::kArrayAlloc:
+        case Operator::kArrayFill:
+        case Operator::kClosure:
+        case Operator::kConcat:
+        case Operator::kBoxingTo:
+        case Operator::kLoadAddress:
+        case Operator::kLoadEffectAddress:
+        case Operator::kDeref:
+        case Operator::kGlobalValue:
+        case Operator::kLazyValue:
+        case Operator::kReturningVal:
+            return true;
+
+        default:
+            break;
+    }
+
+    GlobalValueNumberingPass::AliasClass klass;
+    switch (GlobalValueNumberingPass::EffectOf(instr, &klass)) {
+        case GlobalValueNumberingPass::kPure:
+        case GlobalValueNumberingPass::kLoad:
+            return true;
+        case GlobalValueNumberingPass::kNoEffect:
+            return instr->Is(Operator::kLoadGlobal);
+        default:
+            return false;
+    }
+}
+
+// Before:
+//   %1 = StoreInlineField %0, x <f>
+//   %2 = StoreInlineField %1, y <g>
+//   %3 = StoreInlineField %2, z <f>
+// After:
+//   %2 = StoreInlineField %0, y <g>
+//   %3 = StoreInlineField %2, z <f>
+void DeadCodeEliminationPass::EliminateInlineStores(BasicBlock *block) {
+    for (auto instr : block->instructions()) {
+        if (instr->IsDead() || instr->IsNot(Operator::kStoreInlineField)) {
+            continue;
+        }
+        auto handle = OperatorWith<const Handle *>::Data(instr);
+        auto user = instr;
+        auto prev = instr->InputValue(0);
+        // Only the stores used by the chain: the values stored are never read.
+        while (prev->Is(Operator::kStoreInlineField) && prev->users().size() == 1) {
+            if (OperatorWith<const Handle *>::Data(prev) == handle) {
+                auto origin = prev->InputValue(0);
+                user->Replace(arena(), 0, prev, origin);
+                prev->KillWithInputs();
+                stores_eliminated_++;
+                prev = origin;
+                continue;
+            }
+            user = prev;
+            prev = prev->InputValue(0);
+        }
+    }
+}
+
+// Scan backward, a store is dead if the same field of the same object will be stored again before any read.
+void DeadCodeEliminationPass::EliminateDeadStores(BasicBlock *block) {
+    std::set<std::tuple<Value *, const Handle *>> overwritten;
+    for (auto iter = block->instructions().rbegin(); iter != block->instructions().rend(); iter++) {
+        auto instr = *iter;
+        if (instr->IsDead()) {
+            continue;
+        }
+        GlobalValueNumberingPass::AliasClass klass;
+        switch (GlobalValueNumberingPass::EffectOf(instr, &klass)) {
+            case GlobalValueNumberingPass::kStore: {
+                if (instr->IsNot(Operator::kStoreAccessField) && instr->IsNot(Operator::kStoreEffectField)) {
+                    break;
+                }
+                auto key = std::make_tuple(instr->InputValue(0), OperatorWith<const Handle *>::Data(instr));
+                if (overwritten.find(key) != overwritten.end() && instr->users().size() == 0) {
+                    instr->KillWithInputs();
+                    stores_eliminated_++;
+                    break;
+                }
+                overwritten.insert(key);
+            } break;
+            case GlobalValueNumberingPass::kLoad:
+                // May be read by any alias of the object.
+                for (auto it = overwritten.begin(); it != overwritten.end();) {
+                    if (klass.kind == GlobalValueNumberingPass::AliasClass::kField &&
+                        std::get<1>(*it)->name()->ToSlice() != klass.name) {
+                        it++;
+                    } else {
+                        it = overwritten.erase(it);
+                    }
+                }
+                break;
+            case GlobalValueNumberingPass::kBarrier:
+                overwritten.clear();
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void DeadCodeEliminationPass::MarkSweep(Function *fun) {
+    std::unordered_set<Value *> live;
+    std::vector<Value *> worklist;
+    for (auto blk : fun->blocks()) {
+        for (auto instr : blk->instructions()) {
+            if (instr->IsAlive() && !IsRemovable(instr)) {
+                live.insert(instr);
+                worklist.push_back(instr);
+            }
+        }
+    }
+
+    while (!worklist.empty()) {
+        auto instr = worklist.back();
+        worklist.pop_back();
+        for (int i = 0; i < instr->op()->value_in(); i++) {
+            if (live.insert(instr->InputValue(i)).second) { worklist.push_back(instr->InputValue(i)); }
+        }
+    }
+
+    for (auto blk : fun->blocks()) {
+        for (auto instr : blk->instructions()) {
+            if (instr->IsAlive() && live.find(instr) == live.end()) {
+                instr->KillWithInputs();
+                eliminated_++;
+            }
+        }
+    }
+}
+
+} // namespace yalx::ir
@@ -0,0 +1,52 @@
+#pragma once
+#ifndef YALX_IR_PASS_DEAD_CODE_ELIMINATION_H_
+#define YALX_IR_PASS_DEAD_CODE_ELIMINATION_H_
+
+#include "ir/pass/pass.h"
+#include <unordered_set>
+#include <vector>
+
+namespace yalx {
+
+namespace ir {
+
+// Aggressive dead code elimination:
+//   - Dead stores: a store to the same field of the same object overwritten later before any read is removed, the
+//     GC barriers of the store are not emitted either. `StoreInlineField' makes a new value, so a store in the
+//     chain of inline field stores is bypassed if the field is stored again.
+//   - Mark-sweep over the SSA use graph: the instructions with side effects (stores, calls, terminators, ...) are
+//     the roots, all instructions not reachable from the roots are removed. Arithmetic, loads and allocations are
+//     removable unless they might trap.
+class DeadCodeEliminationPass : public Pass<DeadCodeEliminationPass> {
+public:
+    constexpr static const char kPassName[] = "dead-code-elimination";
+    constexpr static const int kPassLevel = 1;
+    constexpr static const uint32_t kPreservedAnalyses = AnalysisManager::kCfgAnalyses;
+
+    DeadCodeEliminationPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules,
+                            cpl::SyntaxFeedback *feedback);
+
+    DEF_VAL_GETTER(int, eliminated);
+    DEF_VAL_GETTER(int, stores_eliminated);
+
+    void RunModule(Module *module);
+    void RunFun(Function *fun);
+    void RunUdt(StructureModel *udt) { ForeachMethod(udt); }
+
+    static bool IsRemovable(Value *instr);
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(DeadCodeEliminationPass);
+private:
+    void EliminateInlineStores(BasicBlock *block);
+    void EliminateDeadStores(BasicBlock *block);
+    void MarkSweep(Function *fun);
+
+    int eliminated_ = 0;
+    int stores_eliminated_ = 0;
+}; // class DeadCodeEliminationPass
+
+} // namespace ir
+
+} // namespace yalx
+
+#endif // YALX_IR_PASS_DEAD_CODE_ELIMINATION_H_
@@ -0,0 +1,181 @@
+#include "ir/pass/devirtualization.h"
+#include "ir/profile.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/operators-factory.h"
+#include "ir/utils.h"
+#include "ir/base-test.h"
+#include "base/io.h"
+#include <gtest/gtest.h>
+
+namespace yalx {
+
+namespace ir {
+
+class DevirtualizationPassTest : public ModuleTest {
+public:
+    StructureModel *NewClass(const char *name, StructureModel *base_of) {
+        std::string full_name("main:main.");
+        full_name.append(name);
+        return module_->NewClassModel(String::New(arena(), name), String::New(arena(), full_name), base_of);
+    }
+
+    PrototypeModel *NewPrototype(Type self) {
+        auto prototype = new (arena()) PrototypeModel(arena(), String::kEmpty, false/*vargs*/);
+        prototype->mutable_params()->push_back(self);
+        prototype->mutable_return_types()->push_back(Types::Int32);
+        return prototype;
+    }
+
+    // fun get(): i32
+    Handle *NewMethod(StructureModel *clazz, Function::Decoration decoration) {
+        auto name = String::New(arena(), "get");
+        auto fun = module_->NewFunction(decoration, name, clazz, NewPrototype(Type::Ref(clazz)));
+        return clazz->InsertMethod({fun, kPublic, 0, 0, 0});
+    }
+
+    // fun caller(self): i32 = self.get()
+    Function *NewCaller(Type self, Operator *op) {
+        const SourcePosition ss = SourcePosition::Unknown();
+        auto fun = NewFun("caller", {self}, {Types::Int32});
+        auto entry = NewBlock(fun, "entry");
+        auto rv = entry->NewNode(ss, Types::Int32, op, fun->paramater(0));
+        entry->NewNode(ss, Types::Void, ops()->Ret(1), rv);
+        return fun;
+    }
+}; // class DevirtualizationPassTest
+
+TEST_F(DevirtualizationPassTest, Monomorphic) {
+    auto foo = NewClass("Foo", nullptr);
+    auto get = NewMethod(foo, Function::kDefault);
+    NewClass("Bar", foo);
+    auto fun = NewCaller(Type::Ref(foo), ops()->CallVirtual(get, 1/*value_out*/, 1/*value_in*/, 0/*control_out*/));
+
+    DevirtualizationPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(1, pass.devirtualized());
+    EXPECT_EQ(0, pass.guarded());
+
+    constexpr static const char z[] = R"(fun caller(%0: ref[main:main.Foo]): i32 {
+entry:
+    %1 = CallDirectly i32 ref[main:main.Foo] %0 <fun main:main.Foo.get>
+    Ret void i32 %1
+} // main:main.caller
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+}
+
+TEST_F(DevirtualizationPassTest, Interface) {
+    auto iface = module_->NewInterfaceModel(String::New(arena(), "Getter"), String::New(arena(), "main:main.Getter"));
+    auto name = String::New(arena(), "get");
+    auto abstract = module_->NewStandaloneFunction(Function::kAbstract, name, name, NewPrototype(Type::Val(iface)));
+    auto get = iface->InsertMethod(abstract);
+    auto foo = NewClass("Foo", nullptr);
+    foo->mutable_interfaces()->push_back(iface);
+    NewMethod(foo, Function::kDefault);
+    auto fun = NewCaller(Type::Val(iface), ops()->CallAbstract(get, 1/*value_out*/, 1/*value_in*/, 0/*control_out*/));
+
+    DevirtualizationPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(1, pass.devirtualized());
+    EXPECT_EQ(0, pass.guarded());
+
+    constexpr static const char z[] = R"(fun caller(%0: val[main:main.Getter]): i32 {
+entry:
+    %1 = IfaceToRef ref[main:main.Foo] val[main:main.Getter] %0
+    %2 = CallDirectly i32 ref[main:main.Foo] %1 <fun main:main.Foo.get>
+    Ret void i32 %2
+} // main:main.caller
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+}
+
+TEST_F(DevirtualizationPassTest, Bimorphic) {
+    auto foo = NewClass("Foo", nullptr);
+    auto get = NewMethod(foo, Function::kDefault);
+    auto bar = NewClass("Bar", foo);
+    NewMethod(bar, Function::kOverride);
+    NewClass("Baz", bar);
+    auto fun = NewCaller(Type::Ref(foo), ops()->CallVirtual(get, 1/*value_out*/, 1/*value_in*/, 0/*control_out*/));
+
+    DevirtualizationPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(0, pass.devirtualized());
+    EXPECT_EQ(1, pass.guarded());
+
+    constexpr static const char z[] = R"(fun caller(%0: ref[main:main.Foo]): i32 {
+entry:
+    %1 = IsInstanceOf u8 ref[main:main.Foo] %0 <Bar>
+    Br void u8 %1 out [L1:, L2:]
+L1:
+    %2 = CallDirectly i32 ref[main:main.Foo] %0 <fun main:main.Bar.get>
+    Br void out [L3:]
+L2:
+    %3 = CallVirtual i32 ref[main:main.Foo] %0 <main:main.Foo::get>
+    Br void out [L3:]
+L3:
+    %4 = Phi i32 i32 %2, i32 %3 in [L1:, L2:]
+    Ret void i32 %4
+} // main:main.caller
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+}
+
+TEST_F(DevirtualizationPassTest, Megamorphic) {
+    auto foo = NewClass("Foo", nullptr);
+    auto get = NewMethod(foo, Function::kDefault);
+    NewMethod(NewClass("Bar", foo), Function::kOverride);
+    NewMethod(NewClass("Baz", foo), Function::kOverride);
+    NewCaller(Type::Ref(foo), ops()->CallVirtual(get, 1/*value_out*/, 1/*value_in*/, 0/*control_out*/));
+
+    DevirtualizationPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(0, pass.devirtualized());
+    EXPECT_EQ(0, pass.guarded());
+}
+
+TEST_F(DevirtualizationPassTest, ProfiledMegamorphic) {
+    auto foo = NewClass("Foo", nullptr);
+    auto get = NewMethod(foo, Function::kDefault);
+    NewMethod(NewClass("Bar", foo), Function::kOverride);
+    NewMethod(NewClass("Baz", foo), Function::kOverride);
+    auto fun = NewCaller(Type::Ref(foo), ops()->CallVirtual(get, 1/*value_out*/, 1/*value_in*/,
+                                                            0/*control_out*/));
+    Profile profile;
+    ASSERT_TRUE(profile.Parse("fun main:main.caller\n"
+                              "blocks 100\n"
+                              "site 0 main:main.Baz 95 main:main.Bar 5\n").ok());
+    ASSERT_EQ(1, profile.Annotate(modules_));
+
+    DevirtualizationPass pass(arena(), ops(), &modules_, feedback());
+    pass.set_profile(&profile);
+    pass.Run();
+    EXPECT_EQ(1, pass.guarded());
+    EXPECT_EQ(1, pass.profile_guarded());
+    ASSERT_EQ(4, fun->blocks_size());
+    EXPECT_EQ(95, fun->block(1)->frequency());
+    EXPECT_EQ(5, fun->block(2)->frequency());
+    auto test = fun->entry()->instruction(0);
+    ASSERT_TRUE(test->Is(Operator::kIsInstanceOf));
+    EXPECT_EQ("main:main.Baz", OperatorWith<const Model *>::Data(test)->full_name()->ToString());
+}
+
+TEST_F(DevirtualizationPassTest, ProfiledColdSite) {
+    auto foo = NewClass("Foo", nullptr);
+    auto get = NewMethod(foo, Function::kDefault);
+    NewMethod(NewClass("Bar", foo), Function::kOverride);
+    NewCaller(Type::Ref(foo), ops()->CallVirtual(get, 1/*value_out*/, 1/*value_in*/, 0/*control_out*/));
+    Profile profile;
+    ASSERT_TRUE(profile.Parse("fun main:main.caller\nblocks 0\n").ok());
+    ASSERT_EQ(1, profile.Annotate(modules_));
+
+    // Bimorphic but never executed.
+    DevirtualizationPass pass(arena(), ops(), &modules_, feedback());
+    pass.set_profile(&profile);
+    pass.Run();
+    EXPECT_EQ(0, pass.guarded());
+}
+
+} // namespace ir
+
+} // namespace yalx
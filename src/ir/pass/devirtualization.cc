@@ -0,0 +1,285 @@
+#include "ir/pass/devirtualization.h"
+#include "ir/pass/inlining.h"
+#include "ir/operators-factory.h"
+#include "ir/metadata.h"
+#include <algorithm>
+
+namespace yalx::ir {
+
+DevirtualizationPass::DevirtualizationPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules,
+                                           cpl::SyntaxFeedback *feedback)
+: Pass<DevirtualizationPass>(arena, ops, modules, feedback) {
+}
+
+void DevirtualizationPass::RunModule(Module *module) {
+    if (!hierarchy_built_) {
+        BuildHierarchy();
+    }
+    ForeachUdt(module);
+    ForeachFunction(module);
+}
+
+void DevirtualizationPass::BuildHierarchy() {
+    hierarchy_built_ = true;
+    for (auto [name, module] : *modules()) {
+        for (auto udt : module->structures()) { classes_.push_back(udt); }
+    }
+}
+
+void DevirtualizationPass::RunFun(Function *fun) {
+    if (!fun->entry()) {
+        return;
+    }
+
+    std::vector<std::tuple<BasicBlock *, Value *>> calls;
+    for (auto blk : fun->blocks()) {
+        for (auto instr : blk->instructions()) {
+            if (instr->IsAlive() && (instr->Is(Operator::kCallVirtual) || instr->Is(Operator::kCallAbstract))) {
+                calls.push_back(std::make_tuple(blk, instr));
+            }
+        }
+    }
+
+    bool changed = false;
+    // In reverse order: splitting block at the guarded call does not move the former calls.
+    for (auto iter = calls.rbegin(); iter != calls.rend(); iter++) {
+        auto [block, call] = *iter;
+        auto impls = ImplementationsOf(call);
+        if (impls.size() == 1) {
+            Devirtualize(block, call, impls[0]);
+            continue;
+        }
+        // Calls in try blocks have a control edge to the landing block, and the multi-returning values are
+        // picked by `ReturningVal', only simple calls are guarded.
+        auto proto = FunctionOf(OperatorWith<const Handle *>::Data(call))->prototype();
+        if (call->op()->control_out() > 0 || proto->return_types_size() > 1) {
+            continue;
+        }
+        if (fun->entry()->frequency() >= 0 && block->frequency() == 0) {
+            continue; // Never executed in profile
+        }
+        if (auto impl = DominantImplementationOf(call)) {
+            GuardDevirtualize(fun, block, call, impl);
+            profile_guarded_++;
+            changed = true;
+            continue;
+        }
+        if (impls.size() != 2) {
+            continue;
+        }
+        for (auto impl : impls) {
+            if (IsExactlyTestable(call, impl)) {
+                GuardDevirtualize(fun, block, call, impl);
+                changed = true;
+                break;
+            }
+        }
+    }
+
+    if (changed) {
+        fun->UpdateIdsOfBlocks();
+    }
+}
+
+Function *DevirtualizationPass::FunctionOf(const Handle *handle) {
+    auto member = handle->owns()->GetMember(handle);
+    if (!std::holds_alternative<const Model::Method *>(member)) {
+        return nullptr;
+    }
+    return std::get<const Model::Method *>(member)->fun;
+}
+
+const std::vector<StructureModel *> &DevirtualizationPass::ReceiversOf(const Model *model) {
+    if (auto iter = receivers_.find(model); iter != receivers_.end()) {
+        return iter->second;
+    }
+    auto receivers = &receivers_[model];
+    for (auto clazz : classes_) {
+        if (model->declaration() != Model::kInterface) {
+            if (clazz->IsBaseOf(model)) { receivers->push_back(clazz); }
+            continue;
+        }
+        for (auto it = clazz; it != nullptr; it = it->base_of()) {
+            auto &ifaces = it->interfaces();
+            if (std::find(ifaces.begin(), ifaces.end(), model) != ifaces.end()) {
+                receivers->push_back(clazz);
+                break;
+            }
+        }
+    }
+    return *receivers;
+}
+
+const Handle *DevirtualizationPass::ResolveMethod(const StructureModel *receiver, const Handle *handle) const {
+    auto resolved = receiver->FindMemberOrNull(handle->name()->ToSlice());
+    return resolved && resolved->IsMethod() ? resolved : nullptr;
+}
+
+std::vector<const Handle *> DevirtualizationPass::ImplementationsOf(Value *call) {
+    if (!hierarchy_built_) {
+        BuildHierarchy();
+    }
+
+    auto handle = OperatorWith<const Handle *>::Data(call);
+    std::vector<const StructureModel *> receivers;
+    auto self = call->InputValue(0)->type();
+    if (call->Is(Operator::kCallVirtual) && self.kind() == Type::kValue && self.model() &&
+        self.model()->IsStructure()) {
+        // Type of value is exact.
+        receivers.push_back(down_cast<const StructureModel>(self.model()));
+    } else {
+        auto model = handle->owns();
+        if (call->Is(Operator::kCallVirtual) && self.IsReference() && self.model() && self.model()->IsStructure()) {
+            model = self.model(); // Static type of receiver may be narrower than owner of the method.
+        }
+        for (auto clazz : ReceiversOf(model)) { receivers.push_back(clazz); }
+    }
+
+    std::vector<const Handle *> impls;
+    for (auto receiver : receivers) {
+        auto impl = ResolveMethod(receiver, handle);
+        if (!impl) {
+            return {};
+        }
+        auto fun = FunctionOf(impl);
+        if (!fun || fun->decoration() == Function::kAbstract) {
+            continue; // Abstract class has no instance.
+        }
+        if (std::find(impls.begin(), impls.end(), impl) == impls.end()) {
+            impls.push_back(impl);
+        }
+    }
+    return impls;
+}
+
+bool DevirtualizationPass::IsExactlyTestable(Value *call, const Handle *impl) {
+    if (impl->owns()->declaration() != Model::kClass) {
+        return false;
+    }
+    // All subclasses of the owner must be resolved to the same implementation.
+    auto handle = OperatorWith<const Handle *>::Data(call);
+    for (auto clazz : ReceiversOf(impl->owns())) {
+        auto resolved = ResolveMethod(clazz, handle);
+        if (resolved != impl && (!resolved || FunctionOf(resolved)->decoration() != Function::kAbstract)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const Handle *DevirtualizationPass::DominantImplementationOf(Value *call) {
+    auto site = profile_ ? profile_->ReceiversOf(call) : nullptr;
+    auto dominant = site ? site->dominant() : nullptr;
+    if (!dominant || dominant->count < site->total() * kDominantRatio) {
+        return nullptr;
+    }
+    auto receiver = FindClassOrNull(dominant->clazz);
+    if (!receiver) {
+        return nullptr;
+    }
+    auto impl = ResolveMethod(receiver, OperatorWith<const Handle *>::Data(call));
+    if (!impl || !FunctionOf(impl) || !IsExactlyTestable(call, impl)) {
+        return nullptr;
+    }
+    return impl;
+}
+
+StructureModel *DevirtualizationPass::FindClassOrNull(std::string_view full_name) const {
+    for (auto clazz : classes_) {
+        if (clazz->full_name()->ToSlice() == full_name) {
+            return clazz;
+        }
+    }
+    return nullptr;
+}
+
+Value *DevirtualizationPass::ReceiverOf(Value *call, const Handle *impl) {
+    auto self = call->InputValue(0);
+    if (call->IsNot(Operator::kCallAbstract)) {
+        return self;
+    }
+    auto type = Type::Ref(const_cast<Model *>(impl->owns()));
+    return Value::New(arena(), call->source_position(), type, ops()->IfaceToRef(), self);
+}
+
+void DevirtualizationPass::Devirtualize(BasicBlock *block, Value *call, const Handle *impl) {
+    auto self = call->InputValue(0);
+    auto receiver = ReceiverOf(call, impl);
+    if (receiver != self) {
+        auto instrs = block->mutable_instructions();
+        instrs->insert(instrs->begin() + block->FindInstruction(call), receiver);
+        call->Replace(arena(), 0, self, receiver);
+    }
+    auto op = call->op();
+    call->set_op(ops()->CallDirectly(FunctionOf(impl), op->value_out(), op->value_in(), op->control_out()));
+    devirtualized_++;
+}
+
+// Before:
+//   block: ...; call; rest
+// After:
+//   block: ...; test = IsInstanceOf self; Br test [fast, slow]
+//   fast:  direct = CallDirectly self; Br cont
+//   slow:  call; Br cont
+//   cont:  phi = Phi direct, call; rest
+void DevirtualizationPass::GuardDevirtualize(Function *fun, BasicBlock *block, Value *call, const Handle *impl) {
+    const auto ss = call->source_position();
+    auto cont = InliningPass::SplitBlock(fun, block, call);
+    DCHECK(block->instructions().back() == call);
+    block->mutable_instructions()->pop_back();
+
+    auto fast = fun->NewBlock(nullptr);
+    fun->MoveToAfterOf(block, fast);
+    auto slow = fun->NewBlock(nullptr);
+    fun->MoveToAfterOf(fast, slow);
+    if (auto site = profile_ ? profile_->ReceiversOf(call) : nullptr; site && block->frequency() >= 0) {
+        uint64_t hits = 0;
+        for (const auto &receiver : site->receivers) {
+            auto clazz = FindClassOrNull(receiver.clazz);
+            if (clazz && clazz->IsBaseOf(impl->owns())) { hits += receiver.count; }
+        }
+        fast->set_frequency(static_cast<int64_t>(hits));
+        slow->set_frequency(static_cast<int64_t>(site->total() - hits));
+    }
+
+    auto self = call->InputValue(0);
+    auto test = block->NewNode(ss, Types::UInt8, ops()->IsInstanceOf(impl->owns()), self);
+    block->NewNode(ss, Types::Void, ops()->Br(1/*value_in*/, 2/*control_out*/), test, fast, slow);
+    block->LinkTo(fast);
+    block->LinkTo(slow);
+
+    std::vector<Value *> args;
+    auto receiver = ReceiverOf(call, impl);
+    if (receiver != self) {
+        fast->mutable_instructions()->push_back(receiver);
+    }
+    args.push_back(receiver);
+    for (int i = 1; i < call->op()->value_in(); i++) {
+        args.push_back(call->InputValue(i));
+    }
+    auto op = ops()->CallDirectly(FunctionOf(impl), call->op()->value_out(), call->op()->value_in(),
+                                  0/*control_out*/);
+    auto direct = fast->NewNodeWithValues(nullptr, ss, call->type(), op, args);
+    fast->NewNode(ss, Types::Void, ops()->Br(0/*value_in*/, 1/*control_out*/), cont);
+    fast->LinkTo(cont);
+
+    slow->mutable_instructions()->push_back(call);
+    slow->NewNode(ss, Types::Void, ops()->Br(0/*value_in*/, 1/*control_out*/), cont);
+    slow->LinkTo(cont);
+
+    auto users = call->GetUsers();
+    if (!users.empty()) {
+        auto phi = cont->NewNodeWithNodes(nullptr, ss, call->type(), ops()->Phi(2, 2),
+                                          std::vector<Node *>{direct, call, fast, slow});
+        cont->MoveToFront(phi);
+        for (auto [position, user] : users) {
+            user->Replace(arena(), position, call, phi);
+        }
+        for (auto &user : *cont->mutable_phi_node_users()) {
+            if (user.dest == call) { user.dest = phi; }
+        }
+    }
+    guarded_++;
+}
+
+} // namespace yalx::ir
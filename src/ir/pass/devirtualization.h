@@ -0,0 +1,74 @@
+#pragma once
+#ifndef YALX_IR_PASS_DEVIRTUALIZATION_H_
+#define YALX_IR_PASS_DEVIRTUALIZATION_H_
+
+#include "ir/pass/pass.h"
+#include "ir/profile.h"
+#include <unordered_map>
+#include <vector>
+
+namespace yalx {
+
+namespace ir {
+
+// Class hierarchy analysis (CHA) based devirtualization of `CallVirtual' and `CallAbstract':
+// The whole program is compiled from sources, so all of classes that could be receivers of a call site are known.
+//   - Monomorphic: only one implementation for all receivers, the call is replaced by `CallDirectly';
+//   - Bimorphic: two implementations, one of them can be selected by `IsInstanceOf' exactly, the call is guarded by
+//     the type test, the direct call is the fast path and the origin call is kept in slow path.
+// With a profile (see `Profile'), the dominant receiver class of a polymorphic call site is guarded in the same way,
+// and the call sites never executed are not guarded.
+class DevirtualizationPass : public Pass<DevirtualizationPass> {
+public:
+    constexpr static const char kPassName[] = "devirtualization";
+    constexpr static const int kPassLevel = 1;
+
+    DevirtualizationPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules,
+                         cpl::SyntaxFeedback *feedback);
+
+    // Ratio of calls on the dominant receiver for guarding it
+    constexpr static const float kDominantRatio = 0.9;
+
+    DEF_VAL_GETTER(int, devirtualized);
+    DEF_VAL_GETTER(int, guarded);
+    DEF_VAL_GETTER(int, profile_guarded);
+    DEF_PTR_PROP_RW(const Profile, profile);
+
+    void RunModule(Module *module);
+    void RunFun(Function *fun);
+    void RunUdt(StructureModel *udt) { ForeachMethod(udt); }
+
+    // Handles of all implementations of the virtual call, empty if it's unknown.
+    std::vector<const Handle *> ImplementationsOf(Value *call);
+
+    static Function *FunctionOf(const Handle *handle);
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(DevirtualizationPass);
+private:
+    void BuildHierarchy();
+    const std::vector<StructureModel *> &ReceiversOf(const Model *model);
+    const Handle *ResolveMethod(const StructureModel *receiver, const Handle *handle) const;
+    // The implementation can be selected by `IsInstanceOf' its owner exactly.
+    bool IsExactlyTestable(Value *call, const Handle *impl);
+    // Implementation for the dominant receiver of call site in profile, nullptr if none.
+    const Handle *DominantImplementationOf(Value *call);
+    StructureModel *FindClassOrNull(std::string_view full_name) const;
+    void Devirtualize(BasicBlock *block, Value *call, const Handle *impl);
+    void GuardDevirtualize(Function *fun, BasicBlock *block, Value *call, const Handle *impl);
+    // Receiver of the direct call: the interface is converted to reference of implementation.
+    Value *ReceiverOf(Value *call, const Handle *impl);
+
+    bool hierarchy_built_ = false;
+    std::vector<StructureModel *> classes_;
+    std::unordered_map<const Model *, std::vector<StructureModel *>> receivers_;
+    const Profile *profile_ = nullptr;
+    int devirtualized_ = 0;
+    int guarded_ = 0;
+    int profile_guarded_ = 0;
+}; // class DevirtualizationPass
+
+} // namespace ir
+
+} // namespace yalx
+
+#endif // YALX_IR_PASS_DEVIRTUALIZATION_H_
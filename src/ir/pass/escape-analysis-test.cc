@@ -0,0 +1,167 @@
+#include "ir/pass/escape-analysis.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/operators-factory.h"
+#include "ir/utils.h"
+#include "ir/base-test.h"
+#include "base/io.h"
+#include <gtest/gtest.h>
+
+namespace yalx {
+
+namespace ir {
+
+class EscapeAnalysisPassTest : public ModuleTest {
+public:
+    void SetUp() override {
+        ModuleTest::SetUp();
+        foo_ = module_->NewClassModel(String::New(arena(), "Foo"), String::New(arena(), "main:main.Foo"), nullptr);
+        x_ = foo_->InsertField({String::New(arena(), "x"), kPublic, 0, Types::Int32, false});
+        y_ = foo_->InsertField({String::New(arena(), "y"), kPublic, 0, Types::Int32, false});
+    }
+
+    // ob = Foo(); ob.x = n; ob.y = n
+    Value *NewFoo(BasicBlock *block, Value *n) {
+        const SourcePosition ss = SourcePosition::Unknown();
+        auto ob = block->NewNode(ss, Type::Ref(foo_), ops()->HeapAlloc(foo_));
+        block->NewNode(ss, Type::Ref(foo_), ops()->StoreEffectField(x_), ob, n);
+        block->NewNode(ss, Type::Ref(foo_), ops()->StoreEffectField(y_), ob, n);
+        return ob;
+    }
+
+protected:
+    StructureModel *foo_ = nullptr;
+    Handle *x_ = nullptr;
+    Handle *y_ = nullptr;
+}; // class EscapeAnalysisPassTest
+
+TEST_F(EscapeAnalysisPassTest, ScalarReplacement) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto fun = NewFun("foo", {Types::Int32}, {Types::Int32});
+    auto entry = NewBlock(fun, "entry");
+    auto ob = NewFoo(entry, fun->paramater(0));
+    auto x = entry->NewNode(ss, Types::Int32, ops()->LoadEffectField(x_), ob);
+    auto y = entry->NewNode(ss, Types::Int32, ops()->LoadEffectField(y_), ob);
+    auto rv = entry->NewNode(ss, Types::Int32, ops()->Add(), x, y);
+    entry->NewNode(ss, Types::Void, ops()->Ret(1), rv);
+
+    EscapeAnalysisPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(1, pass.scalar_replaced());
+    EXPECT_EQ(0, pass.stack_allocated());
+
+    constexpr static const char z[] = R"(fun foo(%0: i32): i32 {
+entry:
+    %1 = Add i32 i32 %0, i32 %0
+    Ret void i32 %1
+} // main:main.foo
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+}
+
+TEST_F(EscapeAnalysisPassTest, StackAllocation) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto fun = NewFun("foo", {Types::Int32}, {Types::Int32});
+    auto entry = NewBlock(fun, "entry");
+    auto exit = NewBlock(fun, "exit");
+    auto ob = NewFoo(entry, fun->paramater(0));
+    Goto(entry, exit);
+    auto x = exit->NewNode(ss, Types::Int32, ops()->LoadEffectField(x_), ob);
+    exit->NewNode(ss, Types::Void, ops()->Ret(1), x);
+
+    EscapeAnalysisPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(0, pass.scalar_replaced());
+    EXPECT_EQ(1, pass.stack_allocated());
+
+    constexpr static const char z[] = R"(fun foo(%0: i32): i32 {
+entry:
+    %1 = StackAlloc val[main:main.Foo] <Foo>
+    %2 = LoadAddress val[main:main.Foo]* val[main:main.Foo] %1
+    %3 = StoreAccessField ref[main:main.Foo] val[main:main.Foo]* %2, i32 %0 <main:main.Foo::x>
+    %4 = StoreAccessField ref[main:main.Foo] val[main:main.Foo]* %2, i32 %0 <main:main.Foo::y>
+    Br void out [exit:]
+exit:
+    %5 = LoadAccessField i32 val[main:main.Foo]* %2 <main:main.Foo::x>
+    Ret void i32 %5
+} // main:main.foo
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+}
+
+TEST_F(EscapeAnalysisPassTest, Escaping) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    // Returned
+    auto fun = NewFun("foo", {Types::Int32}, {Type::Ref(foo_)});
+    auto entry = NewBlock(fun, "entry");
+    entry->NewNode(ss, Types::Void, ops()->Ret(1), NewFoo(entry, fun->paramater(0)));
+
+    // Stored into another object
+    fun = NewFun("bar", {Type::Ref(foo_), Types::Int32}, {Types::Void});
+    entry = NewBlock(fun, "entry");
+    auto ob = NewFoo(entry, fun->paramater(1));
+    entry->NewNode(ss, Type::Ref(foo_), ops()->StoreEffectField(x_), fun->paramater(0), ob);
+    entry->NewNode(ss, Types::Void, ops()->Ret(0));
+
+    // Not initialized
+    fun = NewFun("baz", {}, {Types::Int32});
+    entry = NewBlock(fun, "entry");
+    ob = entry->NewNode(ss, Type::Ref(foo_), ops()->HeapAlloc(foo_));
+    auto x = entry->NewNode(ss, Types::Int32, ops()->LoadEffectField(x_), ob);
+    entry->NewNode(ss, Types::Void, ops()->Ret(1), x);
+
+    EscapeAnalysisPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(0, pass.scalar_replaced());
+    EXPECT_EQ(0, pass.stack_allocated());
+}
+
+TEST_F(EscapeAnalysisPassTest, Interprocedural) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    // fun getX(ob: Foo) = ob.x
+    auto get_x = NewFun("getX", {Type::Ref(foo_)}, {Types::Int32});
+    auto entry = NewBlock(get_x, "entry");
+    auto x = entry->NewNode(ss, Types::Int32, ops()->LoadEffectField(x_), get_x->paramater(0));
+    entry->NewNode(ss, Types::Void, ops()->Ret(1), x);
+
+    // fun setX(ob: Foo) { ob.x = 0 }
+    auto set_x = NewFun("setX", {Type::Ref(foo_)}, {Types::Void});
+    entry = NewBlock(set_x, "entry");
+    auto zero = Value::New(arena(), ss, Types::Int32, ops()->I32Constant(0));
+    entry->NewNode(ss, Type::Ref(foo_), ops()->StoreEffectField(x_), set_x->paramater(0), zero);
+    entry->NewNode(ss, Types::Void, ops()->Ret(0));
+
+    // fun getXIndirectly(ob: Foo) = getX(ob)
+    auto get_x_indirectly = NewFun("getXIndirectly", {Type::Ref(foo_)}, {Types::Int32});
+    entry = NewBlock(get_x_indirectly, "entry");
+    x = entry->NewNode(ss, Types::Int32, ops()->CallDirectly(get_x, 1/*value_out*/, 1/*value_in*/,
+                                                             0/*control_out*/), get_x_indirectly->paramater(0));
+    entry->NewNode(ss, Types::Void, ops()->Ret(1), x);
+
+    auto fun = NewFun("foo", {Types::Int32}, {Types::Int32});
+    entry = NewBlock(fun, "entry");
+    auto ob = NewFoo(entry, fun->paramater(0));
+    x = entry->NewNode(ss, Types::Int32, ops()->CallDirectly(get_x_indirectly, 1/*value_out*/, 1/*value_in*/,
+                                                             0/*control_out*/), ob);
+    entry->NewNode(ss, Types::Void, ops()->Ret(1), x);
+
+    fun = NewFun("bar", {Types::Int32}, {Types::Void});
+    entry = NewBlock(fun, "entry");
+    ob = NewFoo(entry, fun->paramater(0));
+    entry->NewNode(ss, Types::Void, ops()->CallDirectly(set_x, 1/*value_out*/, 1/*value_in*/, 0/*control_out*/),
+                   ob);
+    entry->NewNode(ss, Types::Void, ops()->Ret(0));
+
+    EscapeAnalysisPass pass(arena(), ops(), &modules_, feedback());
+    EXPECT_FALSE(pass.IsParameterEscaped(get_x, 0));
+    EXPECT_FALSE(pass.IsParameterEscaped(get_x_indirectly, 0));
+    EXPECT_TRUE(pass.IsParameterEscaped(set_x, 0));
+
+    pass.Run();
+    EXPECT_EQ(0, pass.scalar_replaced());
+    EXPECT_EQ(1, pass.stack_allocated());
+}
+
+} // namespace ir
+
+} // namespace yalx
@@ -0,0 +1,275 @@
+#include "ir/pass/escape-analysis.h"
+#include "ir/operators-factory.h"
+#include "ir/metadata.h"
+#include <algorithm>
+#include <string_view>
+
+namespace yalx::ir {
+
+EscapeAnalysisPass::EscapeAnalysisPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules,
+                                       cpl::SyntaxFeedback *feedback)
+: Pass<EscapeAnalysisPass>(arena, ops, modules, feedback) {
+}
+
+void EscapeAnalysisPass::RunModule(Module *module) {
+    if (!params_analyzed_) {
+        AnalyzeParameters();
+    }
+    ForeachUdt(module);
+    ForeachFunction(module);
+}
+
+static Function *DirectCalleeOf(Value *call) {
+    if (call->Is(Operator::kCallDirectly)) {
+        return OperatorWith<Function *>::Data(call);
+    }
+    if (call->Is(Operator::kCallHandle)) {
+        auto handle = OperatorWith<const Handle *>::Data(call);
+        auto member = handle->owns()->GetMember(handle);
+        if (std::holds_alternative<const Model::Method *>(member)) {
+            return std::get<const Model::Method *>(member)->fun;
+        }
+    }
+    return nullptr;
+}
+
+static std::string_view FieldNameOf(Value *instr) {
+    return OperatorWith<const Handle *>::Data(instr)->name()->ToSlice();
+}
+
+void EscapeAnalysisPass::RunFun(Function *fun) {
+    if (!fun->entry()) {
+        return;
+    }
+
+    positions_.clear();
+    std::vector<Value *> allocs;
+    for (auto blk : fun->blocks()) {
+        UpdatePositions(blk);
+        for (auto instr : blk->instructions()) {
+            if (instr->IsAlive() && instr->Is(Operator::kHeapAlloc)) { allocs.push_back(instr); }
+        }
+    }
+
+    for (auto alloc : allocs) {
+        ObjectUses uses;
+        const auto state = AnalyzeObject(alloc, &uses);
+        if (state == kGlobalEscape || !IsInitialized(alloc, uses)) {
+            continue;
+        }
+
+        auto block = std::get<0>(positions_[alloc]);
+        bool local = state == kNoEscape && !uses.compared;
+        for (auto instr : uses.loads) { local = local && std::get<0>(positions_[instr]) == block; }
+        for (auto instr : uses.stores) { local = local && std::get<0>(positions_[instr]) == block; }
+        if (local) {
+            ScalarReplace(alloc, uses);
+        } else {
+            AllocateInStack(alloc, uses);
+            UpdatePositions(block);
+        }
+    }
+
+    for (auto blk : fun->blocks()) {
+        blk->RemoveDeads();
+    }
+    positions_.clear();
+}
+
+void EscapeAnalysisPass::UpdatePositions(BasicBlock *block) {
+    for (int i = 0; i < static_cast<int>(block->instructions_size()); i++) {
+        positions_[block->instruction(i)] = std::make_tuple(block, i);
+    }
+}
+
+bool EscapeAnalysisPass::IsParameterEscaped(Function *fun, int index) {
+    if (!params_analyzed_) {
+        AnalyzeParameters();
+    }
+    auto iter = escaped_params_.find(fun);
+    if (iter == escaped_params_.end() || index >= static_cast<int>(iter->second.size())) {
+        return true;
+    }
+    return iter->second[index];
+}
+
+EscapeAnalysisPass::EscapeState EscapeAnalysisPass::AnalyzeObject(Value *object, ObjectUses *uses) {
+    auto state = kNoEscape;
+    uses->aliases.push_back(object);
+    for (size_t i = 0; i < uses->aliases.size(); i++) {
+        for (auto [position, user] : uses->aliases[i]->GetUsers()) {
+            switch (user->op()->value()) {
+                case Operator::kLoadEffectField:
+                case Operator::kLoadAccessField:
+                    uses->loads.push_back(user);
+                    break;
+
+                case Operator::kStoreEffectField:
+                case Operator::kStoreAccessField:
+                    if (position != 0) {
+                        return kGlobalEscape; // Stored into another object
+                    }
+                    uses->stores.push_back(user);
+                    uses->aliases.push_back(user);
+                    break;
+
+                case Operator::kICmp:
+                    uses->compared = true;
+                    break;
+
+                case Operator::kCallDirectly:
+                case Operator::kCallHandle: {
+                    auto callee = DirectCalleeOf(user);
+                    if (!callee || user->op()->control_out() > 0 || IsParameterEscaped(callee, position)) {
+                        return kGlobalEscape;
+                    }
+                    uses->calls.push_back(user);
+                    state = kArgEscape;
+                } break;
+
+                default:
+                    // Returned, stored, merged by phi, converted, ...
+                    return kGlobalEscape;
+            }
+        }
+    }
+    return state;
+}
+
+void EscapeAnalysisPass::AnalyzeParameters() {
+    params_analyzed_ = true;
+
+    // Optimistic: all parameters are not escaping at the beginning, iterate until no more escaping parameters found.
+    std::vector<Function *> funs;
+    for (auto [name, module] : *modules()) {
+        for (auto udt : module->structures()) {
+            for (auto method : udt->methods()) { funs.push_back(method.fun); }
+        }
+        for (auto fun : module->funs()) { funs.push_back(fun); }
+    }
+    for (auto fun : funs) {
+        if (fun->entry() && fun->decoration() != Function::kNative && fun->decoration() != Function::kAbstract) {
+            escaped_params_[fun] = std::vector<bool>(fun->paramaters_size(), false);
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto fun : funs) {
+            if (escaped_params_.find(fun) != escaped_params_.end()) {
+                changed |= AnalyzeParameters(fun);
+            }
+        }
+    }
+}
+
+bool EscapeAnalysisPass::AnalyzeParameters(Function *fun) {
+    auto &escaped = escaped_params_[fun];
+    bool changed = false;
+    for (size_t i = 0; i < fun->paramaters_size(); i++) {
+        if (escaped[i]) {
+            continue;
+        }
+        ObjectUses uses;
+        // Objects in stack have no header, they can not be written by callee with barriers.
+        if (AnalyzeObject(fun->paramater(i), &uses) == kGlobalEscape || !uses.stores.empty()) {
+            escaped[i] = true;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// The stack object is not zero-initialized, so the fields must be initialized in the allocating block before reading.
+bool EscapeAnalysisPass::IsInitialized(Value *alloc, const ObjectUses &uses) {
+    auto block = std::get<0>(positions_[alloc]);
+    auto alloc_position = std::get<1>(positions_[alloc]);
+    auto IsStoredBefore = [&](std::string_view name, BasicBlock *blk, int position) {
+        for (auto store : uses.stores) {
+            auto [store_block, store_position] = positions_[store];
+            if (store_block != block || store_position < alloc_position || FieldNameOf(store) != name) {
+                continue;
+            }
+            if (blk != block || store_position < position) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    for (auto load : uses.loads) {
+        auto [blk, position] = positions_[load];
+        if (!IsStoredBefore(FieldNameOf(load), blk, position)) {
+            return false;
+        }
+    }
+    if (uses.calls.empty()) {
+        return true;
+    }
+    // Callees may read any fields.
+    auto clazz = OperatorWith<const StructureModel *>::Data(alloc);
+    for (auto call : uses.calls) {
+        auto [blk, position] = positions_[call];
+        for (const auto &field : clazz->fields()) {
+            if (!IsStoredBefore(field.name->ToSlice(), blk, position)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void EscapeAnalysisPass::ScalarReplace(Value *alloc, const ObjectUses &uses) {
+    auto block = std::get<0>(positions_[alloc]);
+    std::unordered_map<std::string_view, Value *> fields;
+    std::vector<Value *> stores;
+    for (auto instr : block->instructions()) {
+        if (instr->IsDead()) {
+            continue;
+        }
+        if (std::find(uses.stores.begin(), uses.stores.end(), instr) != uses.stores.end()) {
+            fields[FieldNameOf(instr)] = instr->InputValue(1);
+            stores.push_back(instr);
+        } else if (std::find(uses.loads.begin(), uses.loads.end(), instr) != uses.loads.end()) {
+            instr->ReplaceUsesWith(arena(), DCHECK_NOTNULL(fields[FieldNameOf(instr)]));
+            instr->KillWithInputs();
+        }
+    }
+    // The later stores are using the former ones.
+    for (auto iter = stores.rbegin(); iter != stores.rend(); iter++) {
+        (*iter)->KillWithInputs();
+    }
+    alloc->KillWithInputs();
+    scalar_replaced_++;
+}
+
+void EscapeAnalysisPass::AllocateInStack(Value *alloc, const ObjectUses &uses) {
+    auto [block, position] = positions_[alloc];
+    auto clazz = const_cast<StructureModel *>(OperatorWith<const StructureModel *>::Data(alloc));
+    auto object = Value::New(arena(), alloc->source_position(), Type::Val(clazz), ops()->StackAlloc(clazz));
+    auto address = Value::New(arena(), alloc->source_position(), Type::Val(clazz, true/*pointer*/),
+                              ops()->LoadAddress(), object);
+    auto instrs = block->mutable_instructions();
+    instrs->insert(instrs->begin() + position + 1, address);
+    instrs->insert(instrs->begin() + position + 1, object);
+
+    // Access fields by address without barriers.
+    for (auto instr : uses.loads) {
+        if (instr->Is(Operator::kLoadEffectField)) {
+            instr->set_op(ops()->LoadAccessField(OperatorWith<const Handle *>::Data(instr)));
+        }
+    }
+    for (auto instr : uses.stores) {
+        if (instr->Is(Operator::kStoreEffectField)) {
+            instr->set_op(ops()->StoreAccessField(OperatorWith<const Handle *>::Data(instr)));
+        }
+    }
+    for (auto iter = uses.aliases.rbegin(); iter != uses.aliases.rend(); iter++) {
+        (*iter)->ReplaceUsesWith(arena(), address);
+    }
+    alloc->KillWithInputs();
+    stack_allocated_++;
+}
+
+} // namespace yalx::ir
@@ -0,0 +1,76 @@
+#pragma once
+#ifndef YALX_IR_PASS_ESCAPE_ANALYSIS_H_
+#define YALX_IR_PASS_ESCAPE_ANALYSIS_H_
+
+#include "ir/pass/pass.h"
+#include <unordered_map>
+#include <vector>
+
+namespace yalx {
+
+namespace ir {
+
+// Escape analysis for `HeapAlloc' objects, the non-escaping objects will not be allocated in GC heap:
+//   - An object only accessed by field loads and stores in its block will be scalar replaced: the loads are replaced
+//     by stored values, the allocation and stores are removed;
+//   - Otherwise the object will be allocated in stack, the effect field accessing (with write barriers) will be
+//     replaced by access field accessing.
+//
+// It's interprocedural: an object passed to a parameter which is only read by the callee does not escape.
+// Runs after inlining is better, the inlined constructors initialize objects in the allocating blocks.
+class EscapeAnalysisPass : public Pass<EscapeAnalysisPass> {
+public:
+    constexpr static const char kPassName[] = "escape-analysis";
+    constexpr static const int kPassLevel = 1;
+    constexpr static const uint32_t kPreservedAnalyses = AnalysisManager::kCfgAnalyses;
+
+    enum EscapeState {
+        kNoEscape,     // Only accessed in the allocating function
+        kArgEscape,    // Passed to callees but not escaping from them
+        kGlobalEscape, // Escaping from the allocating function: stored, returned, ...
+    };
+
+    EscapeAnalysisPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules, cpl::SyntaxFeedback *feedback);
+
+    DEF_VAL_GETTER(int, scalar_replaced);
+    DEF_VAL_GETTER(int, stack_allocated);
+
+    void RunModule(Module *module);
+    void RunFun(Function *fun);
+    void RunUdt(StructureModel *udt) { ForeachMethod(udt); }
+
+    // Is the parameter of function escaping or written by the function?
+    bool IsParameterEscaped(Function *fun, int index);
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(EscapeAnalysisPass);
+private:
+    struct ObjectUses {
+        std::vector<Value *> aliases; // The object and results of stores to it
+        std::vector<Value *> loads;
+        std::vector<Value *> stores;
+        std::vector<Value *> calls;
+        bool compared = false;
+    }; // struct ObjectUses
+
+    EscapeState AnalyzeObject(Value *object, ObjectUses *uses);
+    void AnalyzeParameters();
+    bool AnalyzeParameters(Function *fun);
+    void UpdatePositions(BasicBlock *block);
+    bool IsInitialized(Value *alloc, const ObjectUses &uses);
+    void ScalarReplace(Value *alloc, const ObjectUses &uses);
+    void AllocateInStack(Value *alloc, const ObjectUses &uses);
+
+    // Escaping state of parameters, functions out of map are unknown: all parameters are escaping.
+    std::unordered_map<const Function *, std::vector<bool>> escaped_params_;
+    bool params_analyzed_ = false;
+    // Position of instructions in current function
+    std::unordered_map<const Value *, std::tuple<BasicBlock *, int>> positions_;
+    int scalar_replaced_ = 0;
+    int stack_allocated_ = 0;
+}; // class EscapeAnalysisPass
+
+} // namespace ir
+
+} // namespace yalx
+
+#endif // YALX_IR_PASS_ESCAPE_ANALYSIS_H_
@@ -0,0 +1,100 @@
+#include "ir/pass/global-value-numbering.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/operators-factory.h"
+#include "ir/utils.h"
+#include "ir/base-test.h"
+#include "base/io.h"
+#include <gtest/gtest.h>
+
+namespace yalx {
+
+namespace ir {
+
+class GlobalValueNumberingPassTest : public ModuleTest {
+public:
+    void SetUp() override {
+        ModuleTest::SetUp();
+        foo_ = module_->NewClassModel(String::New(arena(), "Foo"), String::New(arena(), "main:main.Foo"), nullptr);
+        x_ = foo_->InsertField({String::New(arena(), "x"), kPublic, 0, Types::Int32, false});
+        y_ = foo_->InsertField({String::New(arena(), "y"), kPublic, 0, Types::Int32, false});
+    }
+
+    Function *NewFun(const char *name) {
+        return ModuleTest::NewFun(name, {Type::Ref(foo_), Types::Int32, Types::Word8}, {Types::Int32});
+    }
+
+protected:
+    StructureModel *foo_ = nullptr;
+    Handle *x_ = nullptr;
+    Handle *y_ = nullptr;
+}; // class GlobalValueNumberingPassTest
+
+TEST_F(GlobalValueNumberingPassTest, Sanity) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto fun = NewFun("foo");
+    auto entry = NewBlock(fun, "entry");
+    auto then = NewBlock(fun, "then");
+    auto otherwise = NewBlock(fun, "else");
+    auto merge = NewBlock(fun, "merge");
+    auto obj = fun->paramater(0), n = fun->paramater(1), cond = fun->paramater(2);
+
+    auto a = entry->NewNode(ss, Types::Int32, ops()->Add(), n, n);
+    auto b = entry->NewNode(ss, Types::Int32, ops()->Add(), n, n);
+    auto c = entry->NewNode(ss, Types::Int32, ops()->Mul(), a, n);
+    entry->NewNode(ss, Types::Int32, ops()->Mul(), n, b); // Commutative
+    entry->NewNode(ss, Types::Int32, ops()->LoadEffectField(x_), obj);
+    entry->NewNode(ss, Types::Int32, ops()->LoadEffectField(x_), obj);
+    entry->NewNode(ss, Type::Ref(foo_), ops()->StoreEffectField(y_), obj, c); // Not alias to x
+    entry->NewNode(ss, Types::Int32, ops()->LoadEffectField(x_), obj);
+    entry->NewNode(ss, Type::Ref(foo_), ops()->StoreEffectField(x_), obj, c);
+    entry->NewNode(ss, Types::Int32, ops()->LoadEffectField(x_), obj);
+    Branch(entry, cond, then, otherwise);
+
+    then->NewNode(ss, Types::Int32, ops()->Add(), n, n);
+    then->NewNode(ss, Types::Int32, ops()->LoadEffectField(x_), obj);
+    then->NewNode(ss, Types::Void, ops()->CallDirectly(fun, 0/*value_out*/, 0/*value_in*/, 0/*control_out*/));
+    then->NewNode(ss, Types::Int32, ops()->LoadEffectField(x_), obj);
+    Goto(then, merge);
+
+    otherwise->NewNode(ss, Types::Int32, ops()->LoadEffectField(x_), obj);
+    Goto(otherwise, merge);
+
+    auto f = merge->NewNode(ss, Types::Int32, ops()->Add(), n, n);
+    auto x = merge->NewNode(ss, Types::Int32, ops()->LoadEffectField(x_), obj);
+    auto g = merge->NewNode(ss, Types::Int32, ops()->Add(), x, f);
+    merge->NewNode(ss, Types::Void, ops()->Ret(1), g);
+
+    base::ArenaMap<std::string_view, Module *> modules(arena());
+    modules["main:main"] = module_;
+    GlobalValueNumberingPass pass(arena(), ops(), &modules, feedback());
+    pass.Run();
+    EXPECT_EQ(8, pass.eliminated());
+
+    constexpr static const char z[] = R"(fun foo(%0: ref[main:main.Foo], %1: i32, %2: byte): i32 {
+entry:
+    %3 = Add i32 i32 %1, i32 %1
+    %4 = Mul i32 i32 %3, i32 %1
+    %5 = LoadEffectField i32 ref[main:main.Foo] %0 <main:main.Foo::x>
+    %6 = StoreEffectField ref[main:main.Foo] ref[main:main.Foo] %0, i32 %4 <main:main.Foo::y>
+    %7 = StoreEffectField ref[main:main.Foo] ref[main:main.Foo] %0, i32 %4 <main:main.Foo::x>
+    %8 = LoadEffectField i32 ref[main:main.Foo] %0 <main:main.Foo::x>
+    Br void byte %2 out [then:, else:]
+then:
+    CallDirectly void <fun main:main.foo>
+    %9 = LoadEffectField i32 ref[main:main.Foo] %0 <main:main.Foo::x>
+    Br void out [merge:]
+else:
+    Br void out [merge:]
+merge:
+    %10 = LoadEffectField i32 ref[main:main.Foo] %0 <main:main.Foo::x>
+    %11 = Add i32 i32 %10, i32 %3
+    Ret void i32 %11
+} // main:main.foo
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+}
+
+} // namespace ir
+
+} // namespace yalx
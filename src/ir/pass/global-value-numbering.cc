@@ -0,0 +1,270 @@
+#include "ir/pass/global-value-numbering.h"
+#include "ir/operators-factory.h"
+#include "ir/metadata.h"
+
+namespace yalx::ir {
+
+GlobalValueNumberingPass::GlobalValueNumberingPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules,
+                                                   cpl::SyntaxFeedback *feedback)
+: Pass<GlobalValueNumberingPass>(arena, ops, modules, feedback) {
+}
+
+void GlobalValueNumberingPass::RunModule(Module *module) {
+    ForeachUdt(module);
+    ForeachFunction(module);
+}
+
+void GlobalValueNumberingPass::RunFun(Function *fun) {
+    if (!fun->entry()) {
+        return;
+    }
+    auto order = analyses()->BlockOrderOf(fun);
+    auto dom = analyses()->DominatorTreeOf(fun);
+
+    // Walk dominator tree in pre-order, the memory state at end of block will be restored for its children.
+    std::vector<std::tuple<BasicBlock *, size_t, int>> stack;
+    memory_ = ++next_generation_;
+    EnterScope();
+    RunBasicBlock(order->block(0));
+    stack.push_back(std::make_tuple(order->block(0), 0, memory_));
+    while (!stack.empty()) {
+        auto &[block, next, memory] = stack.back();
+        if (next >= dom->ChildrenOf(block).size()) {
+            ExitScope();
+            stack.pop_back();
+            continue;
+        }
+        auto child = dom->ChildrenOf(block)[next++];
+        // The only predecessor is the immediate dominator, so memory state is not changed.
+        memory_ = child->inputs_size() == 1 ? memory : ++next_generation_;
+        EnterScope();
+        RunBasicBlock(child);
+        stack.push_back(std::make_tuple(child, 0, memory_));
+    }
+    DCHECK(table_log_.empty() && clobbered_log_.empty());
+
+    for (auto blk : fun->blocks()) {
+        blk->RemoveDeads();
+    }
+}
+
+void GlobalValueNumberingPass::RunBasicBlock(BasicBlock *block) {
+    for (auto instr : block->instructions()) {
+        if (instr->IsDead()) {
+            continue;
+        }
+        AliasClass klass;
+        switch (EffectOf(instr, &klass)) {
+            case kNoEffect:
+                continue;
+            case kStore:
+                Clobber(klass);
+                continue;
+            case kBarrier:
+                memory_ = ++next_generation_;
+                continue;
+            case kPure:
+            case kLoad:
+                break;
+        }
+        if (instr->type().kind() == Type::kVoid) {
+            continue;
+        }
+
+        const auto memory = klass.kind == AliasClass::kNone ? 0 : memory_;
+        const auto clobbered = klass.kind == AliasClass::kNone ? 0 : ClobberedOf(klass);
+        const auto hash = HashOf(instr);
+        auto &entries = table_[hash];
+        Value *found = nullptr;
+        for (auto iter = entries.rbegin(); iter != entries.rend(); iter++) {
+            if (iter->memory == memory && iter->clobbered == clobbered && IsEquivalent(iter->value, instr)) {
+                found = iter->value;
+                break;
+            }
+        }
+        if (found) {
+            instr->ReplaceUsesWith(arena(), found);
+            instr->KillWithInputs();
+            eliminated_++;
+            continue;
+        }
+        entries.push_back({instr, memory, clobbered});
+        table_log_.push_back(hash);
+    }
+}
+
+void GlobalValueNumberingPass::Clobber(const AliasClass &klass) {
+    clobbered_log_.push_back(std::make_tuple(klass, ClobberedOf(klass)));
+    clobbered_[klass] = ++next_generation_;
+}
+
+void GlobalValueNumberingPass::EnterScope() {
+    scopes_.push_back(std::make_tuple(table_log_.size(), clobbered_log_.size()));
+}
+
+void GlobalValueNumberingPass::ExitScope() {
+    auto [table_mark, clobbered_mark] = scopes_.back();
+    scopes_.pop_back();
+    while (table_log_.size() > table_mark) {
+        table_[table_log_.back()].pop_back();
+        table_log_.pop_back();
+    }
+    while (clobbered_log_.size() > clobbered_mark) {
+        auto [klass, generation] = clobbered_log_.back();
+        clobbered_[klass] = generation;
+        clobbered_log_.pop_back();
+    }
+}
+
+GlobalValueNumberingPass::Effect GlobalValueNumberingPass::EffectOf(Value *instr, AliasClass *klass) {
+    switch (instr->op()->value()) {
+    #define DEFINE_CASE(name) case Operator::k##name:
+        DECLARE_IR_BINARY(DEFINE_CASE)
+        DECLARE_IR_COMPARISON(DEFINE_CASE)
+    #undef DEFINE_CASE
+        case Operator::kTruncTo:
+        case Operator::kZextTo:
+        case Operator::kSextTo:
+        case Operator::kFPTruncTo:
+        case Operator::kFPExtTo:
+        case Operator::kFPToUI:
+        case Operator::kFPToSI:
+        case Operator::kUIToFP:
+        case Operator::kSIToFP:
+        case Operator::kBitCastTo:
+        case Operator::kIfaceToRef:
+        case Operator::kRefToIface:
+        case Operator::kUnboxingTo:
+        case Operator::kIsInstanceOf:
+        case Operator::kLoadFunAddr:
+        // Inline fields are members of SSA values, storing makes a new value.
+        case Operator::kLoadInlineField:
+        case Operator::kStoreInlineField:
+            return kPure;
+
+        case Operator::kLoadAccessField:
+        case Operator::kLoadEffectField:
+            klass->kind = AliasClass::kField;
+            klass->name = OperatorWith<const Handle *>::Data(instr)->name()->ToSlice();
+            return kLoad;
+        case Operator::kStoreAccessField:
+        case Operator::kStoreEffectField:
+            klass->kind = AliasClass::kField;
+            klass->name = OperatorWith<const Handle *>::Data(instr)->name()->ToSlice();
+            return kStore;
+
+        case Operator::kArrayAt:
+        case Operator::kArrayUncheckedAt:
+            klass->kind = AliasClass::kArray;
+            return kLoad;
+        case Operator::kArraySet:
+            klass->kind = AliasClass::kArray;
+            return kStore;
+
+        case Operator::kLoadGlobal:
+        case Operator::kStoreGlobal: {
+            auto global = instr->InputValue(0);
+            if (global->IsNot(Operator::kGlobalValue)) {
+                return instr->Is(Operator::kLoadGlobal) ? kNoEffect : kBarrier;
+            }
+            klass->kind = AliasClass::kGlobal;
+            klass->name = OperatorWith<const String *>::Data(global)->ToSlice();
+            return instr->Is(Operator::kLoadGlobal) ? kLoad : kStore;
+        }
+
+    #define DEFINE_CASE(name) case Operator::k##name:
+        DECLARE_IR_CONSTANT(DEFINE_CASE)
+    #undef DEFINE_CASE
+        case Operator::kFrameState:
+        case Operator::kPhi:
+        case Operator::kBr:
+        case Operator::kSwitch:
+        case Operator::kArgument:
+        case Operator::kParameter:
+        case Operator::kHeapAlloc:
+        case Operator::kStackAlloc:
+        case Operator::kArrayAlloc:
+        case Operator::kArrayFill:
+        case Operator::kClosure:
+        case Operator::kConcat:
+        case Operator::kBoxingTo: // Boxing makes a new object: must keep its identity
+        case Operator::kRefAssertedTo:
+        case Operator::kLoadAddress:
+        case Operator::kLoadEffectAddress:
+        case Operator::kDeref:
+        case Operator::kGlobalValue:
+        case Operator::kLazyValue:
+        case Operator::kReturningVal:
+        case Operator::kProfileCount: // Counters are only read by runtime at exit
+        case Operator::kProfileReceiver:
+        case Operator::kUnreachable:
+        case Operator::kRet:
+            return kNoEffect;
+
+        default:
+            // Calls, lazy loading, unwinding, ...
+            return kBarrier;
+    }
+}
+
+bool GlobalValueNumberingPass::IsCommutative(Operator::Value op) {
+    switch (op) {
+        case Operator::kAdd:
+        case Operator::kMul:
+        case Operator::kUMul:
+        case Operator::kFAdd:
+        case Operator::kFMul:
+        case Operator::kAnd:
+        case Operator::kOr:
+        case Operator::kXor:
+            return true;
+        default:
+            return false;
+    }
+}
+
+size_t GlobalValueNumberingPass::HashOf(Value *instr) {
+    size_t hash = instr->op()->value() * 31 + instr->type().kind();
+    const bool commutative = IsCommutative(instr->op()->value());
+    for (int i = 0; i < instr->op()->value_in(); i++) {
+        auto input = reinterpret_cast<uintptr_t>(instr->InputValue(i));
+        hash = commutative ? hash + input : hash * 31 + input;
+    }
+    return hash;
+}
+
+static bool IsSameData(const Operator *a, const Operator *b) {
+    switch (a->value()) {
+    #define DEFINE_CASE(name, type) \
+        case Operator::k##name: return OperatorWith<type>::Data(a) == OperatorWith<type>::Data(b);
+        DECL_OPERATORS_WITH_DATA(DEFINE_CASE)
+    #undef DEFINE_CASE
+        default:
+            return true;
+    }
+}
+
+bool GlobalValueNumberingPass::IsEquivalent(Value *a, Value *b) {
+    if (a->op()->value() != b->op()->value() || a->op()->value_in() != b->op()->value_in() ||
+        !a->type().Equals(b->type()) || a->type().bits() != b->type().bits()) {
+        return false;
+    }
+    if (!IsSameData(a->op(), b->op())) {
+        return false;
+    }
+
+    bool same = true;
+    for (int i = 0; i < a->op()->value_in(); i++) {
+        if (a->InputValue(i) != b->InputValue(i)) {
+            same = false;
+            break;
+        }
+    }
+    if (same || !IsCommutative(a->op()->value())) {
+        return same;
+    }
+    DCHECK(a->op()->value_in() == 2);
+    return a->InputValue(0) == b->InputValue(1) && a->InputValue(1) == b->InputValue(0);
+}
+
+} // namespace yalx::ir
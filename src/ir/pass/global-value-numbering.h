@@ -0,0 +1,95 @@
+#pragma once
+#ifndef YALX_IR_PASS_GLOBAL_VALUE_NUMBERING_H_
+#define YALX_IR_PASS_GLOBAL_VALUE_NUMBERING_H_
+
+#include "ir/pass/pass.h"
+#include <unordered_map>
+#include <string_view>
+#include <vector>
+
+namespace yalx {
+
+namespace ir {
+
+// Dominator-based global value numbering: an instruction will be replaced by an equivalent one in its dominators.
+// Pure instructions are numbered freely, loads are numbered with the memory state:
+//   - A store only clobbers the loads in the same alias class (same field name, arrays or same global);
+//   - Calls and unknown effects clobber all loads;
+//   - A merge block starts with a unknown memory state.
+class GlobalValueNumberingPass : public Pass<GlobalValueNumberingPass> {
+public:
+    constexpr static const char kPassName[] = "global-value-numbering";
+    constexpr static const int kPassLevel = 1;
+    constexpr static const uint32_t kPreservedAnalyses = AnalysisManager::kCfgAnalyses;
+
+    GlobalValueNumberingPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules,
+                             cpl::SyntaxFeedback *feedback);
+
+    DEF_VAL_GETTER(int, eliminated);
+
+    void RunModule(Module *module);
+    void RunFun(Function *fun);
+    void RunUdt(StructureModel *udt) { ForeachMethod(udt); }
+    void RunBasicBlock(BasicBlock *block);
+
+    enum Effect {
+        kNoEffect,
+        kPure,
+        kLoad,
+        kStore,
+        kBarrier,
+    };
+
+    struct AliasClass {
+        enum Kind { kNone, kField, kArray, kGlobal } kind = kNone;
+        std::string_view name;
+
+        bool operator == (const AliasClass &other) const { return kind == other.kind && name == other.name; }
+    }; // struct AliasClass
+
+    struct AliasClassHash {
+        size_t operator () (const AliasClass &klass) const {
+            return std::hash<std::string_view>{}(klass.name) * 31 + klass.kind;
+        }
+    }; // struct AliasClassHash
+
+    // Memory effect of instruction, the alias class of loads and stores is put into `klass'.
+    static Effect EffectOf(Value *instr, AliasClass *klass);
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(GlobalValueNumberingPass);
+private:
+    struct Entry {
+        Value *value;
+        int memory;
+        int clobbered;
+    }; // struct Entry
+
+    static size_t HashOf(Value *instr);
+    static bool IsEquivalent(Value *a, Value *b);
+    static bool IsCommutative(Operator::Value op);
+
+    int ClobberedOf(const AliasClass &klass) const {
+        auto iter = clobbered_.find(klass);
+        return iter == clobbered_.end() ? 0 : iter->second;
+    }
+
+    void Clobber(const AliasClass &klass);
+    void EnterScope();
+    void ExitScope();
+
+    // Scoped tables, the changes are recorded in logs and undone at exiting the dominator tree node.
+    std::unordered_map<size_t, std::vector<Entry>> table_;
+    std::unordered_map<AliasClass, int, AliasClassHash> clobbered_;
+    std::vector<size_t> table_log_;
+    std::vector<std::tuple<AliasClass, int>> clobbered_log_;
+    std::vector<std::tuple<size_t, size_t>> scopes_;
+    int memory_ = 0;
+    int next_generation_ = 0;
+    int eliminated_ = 0;
+}; // class GlobalValueNumberingPass
+
+} // namespace ir
+
+} // namespace yalx
+
+#endif // YALX_IR_PASS_GLOBAL_VALUE_NUMBERING_H_
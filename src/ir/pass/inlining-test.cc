@@ -0,0 +1,192 @@
+#include "ir/pass/inlining.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/operators-factory.h"
+#include "ir/utils.h"
+#include "ir/base-test.h"
+#include "base/io.h"
+#include <gtest/gtest.h>
+
+namespace yalx {
+
+namespace ir {
+
+class InliningPassTest : public ModuleTest {
+public:
+    Function *NewFun(const char *name, int params) {
+        return ModuleTest::NewFun(name, std::vector<Type>(params, Types::Int32), {Types::Int32});
+    }
+
+    // fun add1(a: i32) = a + 1
+    Function *NewAdd1() {
+        const SourcePosition ss = SourcePosition::Unknown();
+        auto fun = NewFun("add1", 1);
+        auto entry = NewBlock(fun, "entry");
+        auto rv = entry->NewNode(ss, Types::Int32, ops()->Add(), fun->paramater(0), I32(1));
+        entry->NewNode(ss, Types::Void, ops()->Ret(1), rv);
+        return fun;
+    }
+
+    // fun max(a: i32, b: i32) = if (a > b) a else b
+    Function *NewMax() {
+        const SourcePosition ss = SourcePosition::Unknown();
+        auto fun = NewFun("max", 2);
+        auto entry = NewBlock(fun, "entry");
+        auto l = NewBlock(fun, "l");
+        auto r = NewBlock(fun, "r");
+        auto a = fun->paramater(0), b = fun->paramater(1);
+        auto cond = entry->NewNode(ss, Types::Word8, ops()->ICmp(ICondition::sgt), a, b);
+        Branch(entry, cond, l, r);
+        l->NewNode(ss, Types::Void, ops()->Ret(1), a);
+        r->NewNode(ss, Types::Void, ops()->Ret(1), b);
+        return fun;
+    }
+
+    // fun big(a: i32) = a * 1 * 2 * ... * n
+    Function *NewBig(int n, const char *name = "big") {
+        const SourcePosition ss = SourcePosition::Unknown();
+        auto fun = NewFun(name, 1);
+        auto entry = NewBlock(fun, "entry");
+        Value *rv = fun->paramater(0);
+        for (int i = 0; i < n; i++) {
+            rv = entry->NewNode(ss, Types::Int32, ops()->Mul(), rv, I32(i + 1));
+        }
+        entry->NewNode(ss, Types::Void, ops()->Ret(1), rv);
+        return fun;
+    }
+}; // class InliningPassTest
+
+TEST_F(InliningPassTest, Sanity) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto add1 = NewAdd1();
+    auto max = NewMax();
+    auto fun = NewFun("foo", 2);
+    auto entry = NewBlock(fun, "entry");
+    auto x = fun->paramater(0), y = fun->paramater(1);
+    auto a = entry->NewNode(ss, Types::Int32, ops()->CallDirectly(add1, 1/*value_out*/, 1/*value_in*/,
+                                                                   0/*control_out*/), x);
+    auto b = entry->NewNode(ss, Types::Int32, ops()->CallDirectly(max, 1/*value_out*/, 2/*value_in*/,
+                                                                   0/*control_out*/), a, y);
+    auto c = entry->NewNode(ss, Types::Int32, ops()->Add(), b, a);
+    entry->NewNode(ss, Types::Void, ops()->Ret(1), c);
+
+    InliningPass pass(arena(), ops(), &modules_, feedback());
+    pass.RunFun(fun);
+    EXPECT_EQ(2, pass.inlined());
+
+    constexpr static const char z[] = R"(fun foo(%0: i32, %1: i32): i32 {
+entry:
+    Br void out [L1:]
+L1:
+    %2 = Add i32 i32 %0, i32 1
+    Br void out [L2:]
+L2:
+    Br void out [L3:]
+L3:
+    %3 = ICmp byte i32 %2, i32 %1 <sgt>
+    Br void byte %3 out [L4:, L5:]
+L4:
+    Br void out [L6:]
+L5:
+    Br void out [L6:]
+L6:
+    %4 = Phi i32 i32 %1, i32 %2 in [L5:, L4:]
+    %5 = Add i32 i32 %4, i32 %2
+    Ret void i32 %5
+} // main:main.foo
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+}
+
+TEST_F(InliningPassTest, RecursiveCall) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto fun = NewFun("fact", 1);
+    auto entry = NewBlock(fun, "entry");
+    auto n = fun->paramater(0);
+    auto m = entry->NewNode(ss, Types::Int32, ops()->Sub(), n, I32(1));
+    auto rv = entry->NewNode(ss, Types::Int32, ops()->CallDirectly(fun, 1/*value_out*/, 1/*value_in*/,
+                                                                    0/*control_out*/), m);
+    entry->NewNode(ss, Types::Void, ops()->Ret(1), rv);
+
+    auto caller = NewFun("bar", 1);
+    auto bar = NewBlock(caller, "entry");
+    rv = bar->NewNode(ss, Types::Int32, ops()->CallDirectly(fun, 1/*value_out*/, 1/*value_in*/,
+                                                            0/*control_out*/), caller->paramater(0));
+    bar->NewNode(ss, Types::Void, ops()->Ret(1), rv);
+
+    InliningPass pass(arena(), ops(), &modules_, feedback());
+    pass.RunFun(fun);
+    EXPECT_EQ(0, pass.inlined());
+
+    // Only the first level can be inlined.
+    pass.RunFun(caller);
+    EXPECT_EQ(1, pass.inlined());
+    int calls = 0;
+    for (auto blk : caller->blocks()) {
+        for (auto instr : blk->instructions()) {
+            if (instr->Is(Operator::kCallDirectly)) { calls++; }
+        }
+    }
+    EXPECT_EQ(1, calls);
+}
+
+TEST_F(InliningPassTest, Budget) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto big = NewBig(InliningPass::kBaseBudget + 10);
+    auto fun = NewFun("foo", 1);
+    auto entry = NewBlock(fun, "entry");
+    auto rv = entry->NewNode(ss, Types::Int32, ops()->CallDirectly(big, 1/*value_out*/, 1/*value_in*/,
+                                                                    0/*control_out*/), fun->paramater(0));
+    entry->NewNode(ss, Types::Void, ops()->Ret(1), rv);
+
+    InliningPass pass(arena(), ops(), &modules_, feedback());
+    EXPECT_EQ(InliningPass::kBaseBudget + 11, pass.InlineSizeOf(big));
+    pass.RunFun(fun);
+    EXPECT_EQ(0, pass.inlined());
+
+    // Call site in a loop has more budget.
+    auto loop = NewFun("loop", 1);
+    auto head = NewBlock(loop, "entry");
+    auto body = NewBlock(loop, "body");
+    auto exit = NewBlock(loop, "exit");
+    Goto(head, body);
+    rv = body->NewNode(ss, Types::Int32, ops()->CallDirectly(big, 1/*value_out*/, 1/*value_in*/,
+                                                              0/*control_out*/), loop->paramater(0));
+    auto cond = body->NewNode(ss, Types::Word8, ops()->ICmp(ICondition::sgt), rv, I32(0));
+    Branch(body, cond, body, exit);
+    exit->NewNode(ss, Types::Void, ops()->Ret(1), rv);
+
+    pass.RunFun(loop);
+    EXPECT_EQ(1, pass.inlined());
+}
+
+TEST_F(InliningPassTest, ProfiledCallSite) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto big = NewBig(InliningPass::kBaseBudget + 10);
+    auto medium = NewBig(InliningPass::kTinyFunctionSize * 2, "medium");
+    auto fun = NewFun("foo", 1);
+    auto entry = NewBlock(fun, "entry");
+    auto hot = NewBlock(fun, "hot");
+    auto cold = NewBlock(fun, "cold");
+    auto cond = entry->NewNode(ss, Types::Word8, ops()->ICmp(ICondition::sgt), fun->paramater(0), I32(0));
+    Branch(entry, cond, hot, cold);
+    auto rv = hot->NewNode(ss, Types::Int32, ops()->CallDirectly(big, 1/*value_out*/, 1/*value_in*/,
+                                                                  0/*control_out*/), fun->paramater(0));
+    hot->NewNode(ss, Types::Void, ops()->Ret(1), rv);
+    rv = cold->NewNode(ss, Types::Int32, ops()->CallDirectly(medium, 1/*value_out*/, 1/*value_in*/,
+                                                              0/*control_out*/), fun->paramater(0));
+    cold->NewNode(ss, Types::Void, ops()->Ret(1), rv);
+    entry->set_frequency(10);
+    hot->set_frequency(10 * InliningPass::kHotCallSiteRatio);
+    cold->set_frequency(0);
+
+    // The hot call site gets the bonus budget, and the never executed one is not inlined.
+    InliningPass pass(arena(), ops(), &modules_, feedback());
+    pass.RunFun(fun);
+    EXPECT_EQ(1, pass.inlined());
+    EXPECT_EQ(0, cold->FindInstruction(rv));
+}
+
+} // namespace ir
+
+} // namespace yalx
@@ -0,0 +1,380 @@
+#include "ir/pass/inlining.h"
+#include "ir/operators-factory.h"
+#include "ir/metadata.h"
+#include <algorithm>
+
+namespace yalx::ir {
+
+InliningPass::InliningPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules,
+                           cpl::SyntaxFeedback *feedback)
+: Pass<InliningPass>(arena, ops, modules, feedback) {
+}
+
+void InliningPass::RunModule(Module *module) {
+    ForeachUdt(module);
+    ForeachFunction(module);
+}
+
+static int SizeOfFunction(Function *fun) {
+    int size = 0;
+    for (auto blk : fun->blocks()) {
+        for (auto instr : blk->instructions()) {
+            if (instr->IsAlive()) { size++; }
+        }
+    }
+    return size;
+}
+
+void InliningPass::RunFun(Function *fun) {
+    if (!fun->entry()) {
+        return;
+    }
+
+    std::vector<CallSite> sites;
+    for (auto blk : fun->blocks()) {
+        for (auto instr : blk->instructions()) {
+            if (instr->IsAlive() && CalleeOf(instr)) {
+                sites.push_back({instr, {fun}});
+            }
+        }
+    }
+
+    bool changed = false;
+    // Process call sites in program order, the calls in inlined code will be processed after them.
+    std::reverse(sites.begin(), sites.end());
+    while (!sites.empty()) {
+        auto site = std::move(sites.back());
+        sites.pop_back();
+        if (site.call->IsDead()) {
+            continue;
+        }
+
+        BasicBlock *block = nullptr;
+        for (auto blk : fun->blocks()) {
+            if (blk->FindInstruction(site.call) >= 0) {
+                block = blk;
+                break;
+            }
+        }
+        auto callee = CalleeOf(site.call);
+        if (!block || !ShouldInline(fun, block, site, callee)) {
+            continue;
+        }
+
+        std::vector<Value *> new_calls;
+        if (!Inline(fun, block, site.call, &new_calls)) {
+            continue;
+        }
+        changed = true;
+        for (auto iter = new_calls.rbegin(); iter != new_calls.rend(); iter++) {
+            CallSite inner{*iter, site.inlined};
+            inner.inlined.push_back(callee);
+            sites.push_back(std::move(inner));
+        }
+    }
+
+    if (changed) {
+        sizes_.erase(fun);
+        fun->UpdateIdsOfBlocks();
+    }
+}
+
+Function *InliningPass::CalleeOf(Value *call) {
+    Function *callee = nullptr;
+    if (call->Is(Operator::kCallDirectly)) {
+        callee = OperatorWith<Function *>::Data(call);
+    } else if (call->Is(Operator::kCallHandle)) {
+        auto handle = OperatorWith<const Handle *>::Data(call);
+        auto member = handle->owns()->GetMember(handle);
+        if (!std::holds_alternative<const Model::Method *>(member)) {
+            return nullptr;
+        }
+        callee = std::get<const Model::Method *>(member)->fun;
+    } else {
+        return nullptr;
+    }
+
+    // Calls in try blocks have a control edge to the landing block, keep them.
+    if (!callee || call->op()->control_out() > 0 || call->op()->value_out() > 1) {
+        return nullptr;
+    }
+    if (callee->decoration() == Function::kNative || callee->decoration() == Function::kAbstract ||
+        !callee->entry() || call->op()->value_in() != static_cast<int>(callee->paramaters_size())) {
+        return nullptr;
+    }
+    return callee;
+}
+
+int InliningPass::InlineSizeOf(Function *fun) {
+    if (auto iter = sizes_.find(fun); iter != sizes_.end()) {
+        return iter->second;
+    }
+
+    if (fun->profile_counters() > 0) {
+        sizes_[fun] = -1; // Counters of the instrumented function must be kept in itself.
+        return -1;
+    }
+
+    int size = 0;
+    int rets = 0;
+    size_t returning = 0;
+    for (auto type : fun->prototype()->return_types()) {
+        if (type.kind() != Type::kVoid) { returning++; }
+    }
+    BlockOrder order(fun);
+    for (auto blk : order.rpo()) {
+        bool terminated = false;
+        for (auto instr : blk->instructions()) {
+            if (instr->IsDead()) {
+                continue;
+            }
+            if (instr->Is(Operator::kCatch) || instr->Is(Operator::kUnwind) || instr->op()->value_out() > 1) {
+                size = -1;
+                break;
+            }
+            for (int i = 0; i < instr->op()->control_in(); i++) {
+                if (!order.IsReachable(instr->InputControl(i))) { size = -1; }
+            }
+            if (instr->Is(Operator::kRet)) {
+                rets++;
+                if (instr->op()->value_in() < static_cast<int>(returning)) { size = -1; }
+            }
+            size++;
+            if (instr->op()->IsTerminator() || instr->Is(Operator::kUnreachable)) {
+                terminated = true;
+                break;
+            }
+        }
+        if (size < 0 || !terminated) {
+            size = -1;
+            break;
+        }
+    }
+    if (rets == 0) {
+        size = -1;
+    }
+    sizes_[fun] = size;
+    return size;
+}
+
+bool InliningPass::ShouldInline(Function *caller, BasicBlock *block, const CallSite &site, Function *callee) {
+    if (std::find(site.inlined.begin(), site.inlined.end(), callee) != site.inlined.end()) {
+        return false; // Recursive
+    }
+    const int size = InlineSizeOf(callee);
+    if (size < 0) {
+        return false;
+    }
+    if (size <= kTinyFunctionSize) {
+        return true;
+    }
+
+    const auto entry_frequency = caller->entry()->frequency();
+    const auto frequency = block->frequency();
+    if (entry_frequency >= 0 && frequency == 0) {
+        return false; // Never executed in profile
+    }
+    const int depth = static_cast<int>(site.inlined.size()) - 1;
+    if (depth >= kMaxInliningDepth || SizeOfFunction(caller) + size > kMaxCallerSize) {
+        return false;
+    }
+    const int loop_depth = std::min(analyses()->LoopNestOf(caller)->DepthOf(block), kMaxLoopDepthBonus);
+    int budget = kBaseBudget + loop_depth * kLoopDepthBonus;
+    if (entry_frequency > 0 && frequency >= entry_frequency * kHotCallSiteRatio) {
+        budget += kHotCallSiteBonus;
+    }
+    return size <= (budget >> depth);
+}
+
+BasicBlock *InliningPass::SplitBlock(Function *fun, BasicBlock *block, Value *call) {
+    auto cont = fun->NewBlock(nullptr);
+    fun->MoveToAfterOf(block, cont);
+    cont->set_frequency(block->frequency());
+
+    const auto position = block->FindInstruction(call);
+    DCHECK(position >= 0);
+    auto instrs = block->mutable_instructions();
+    for (auto iter = instrs->begin() + position + 1; iter != instrs->end(); iter++) {
+        cont->mutable_instructions()->push_back(*iter);
+    }
+    instrs->erase(instrs->begin() + position + 1, instrs->end());
+
+    for (auto succ : block->outputs()) {
+        for (auto instr : succ->instructions()) {
+            if (instr->IsDead() || instr->IsNot(Operator::kPhi)) {
+                continue;
+            }
+            for (int i = 0; i < instr->op()->control_in(); i++) {
+                if (instr->InputControl(i) == block) { instr->SetInputControl(i, cont); }
+            }
+        }
+        std::replace(succ->mutable_inputs()->begin(), succ->mutable_inputs()->end(), block, cont);
+        cont->mutable_outputs()->push_back(succ);
+    }
+    block->mutable_outputs()->clear();
+    *cont->mutable_phi_node_users() = block->phi_node_users();
+    block->mutable_phi_node_users()->clear();
+    return cont;
+}
+
+bool InliningPass::Inline(Function *caller, BasicBlock *block, Value *call, std::vector<Value *> *new_calls) {
+    auto callee = CalleeOf(call);
+    if (!callee || callee == caller || InlineSizeOf(callee) < 0) {
+        return false;
+    }
+
+    BlockOrder order(callee);
+    auto cont = SplitBlock(caller, block, call);
+
+    std::unordered_map<const BasicBlock *, BasicBlock *> blocks;
+    auto prev = block;
+    // Keep the layout of callee.
+    for (auto blk : callee->blocks()) {
+        if (!order.IsReachable(blk)) {
+            continue;
+        }
+        auto copied = caller->NewBlock(nullptr);
+        caller->MoveToAfterOf(prev, copied);
+        if (blk->frequency() >= 0 && block->frequency() >= 0 && callee->entry()->frequency() > 0) {
+            // Scale profile of callee to the call site.
+            copied->set_frequency(blk->frequency() * block->frequency() / callee->entry()->frequency());
+        }
+        blocks[blk] = copied;
+        prev = copied;
+    }
+    caller->MoveToAfterOf(prev, cont);
+
+    std::unordered_map<const Value *, Value *> values;
+    for (size_t i = 0; i < callee->paramaters_size(); i++) {
+        values[callee->paramater(i)] = call->InputValue(static_cast<int>(i));
+    }
+    auto MapValue = [&values](Value *value) {
+        auto iter = values.find(value);
+        return iter == values.end() ? value : iter->second;
+    };
+
+    struct Fixup {
+        Value *instr;
+        int position;
+        Value *origin;
+    };
+    std::vector<Fixup> fixups;
+    std::vector<std::tuple<BasicBlock *, Value *>> rets;
+    for (auto blk : order.rpo()) {
+        auto copied = blocks[blk];
+        for (auto instr : blk->instructions()) {
+            if (instr->IsDead()) {
+                continue;
+            }
+            if (instr->Is(Operator::kRet)) {
+                rets.push_back(std::make_tuple(copied, instr));
+                copied->NewNode(instr->source_position(), Types::Void, ops()->Br(0/*value_in*/, 1/*control_out*/),
+                                cont);
+                copied->LinkTo(cont);
+                break;
+            }
+
+            auto offset = instr->op()->value_in() + std::max(instr->op()->value_out() - 1, 0);
+            std::vector<Node *> inputs(offset + instr->op()->control_in() + instr->op()->control_out());
+            std::vector<std::tuple<int, Value *>> pending;
+            for (int i = 0; i < instr->op()->value_in(); i++) {
+                auto input = instr->InputValue(i);
+                if (auto iter = values.find(input); iter != values.end()) {
+                    inputs[i] = iter->second;
+                } else {
+                    // Forward reference from phis of loop headers, it's fixed after all blocks copied.
+                    inputs[i] = input;
+                    if (input->IsNot(Operator::kArgument) && !input->op()->IsConstant()) {
+                        pending.push_back(std::make_tuple(i, input));
+                    }
+                }
+            }
+            for (int i = 0; i < instr->op()->control_in(); i++) {
+                inputs[offset++] = blocks[instr->InputControl(i)];
+            }
+            for (int i = 0; i < instr->op()->control_out(); i++) {
+                inputs[offset++] = blocks[instr->OutputControl(i)];
+            }
+            auto copied_instr = copied->NewNodeWithNodes(nullptr, instr->source_position(), instr->type(),
+                                                         instr->op(), inputs);
+            values[instr] = copied_instr;
+            for (auto [position, origin] : pending) {
+                fixups.push_back({copied_instr, position, origin});
+            }
+            if (new_calls && CalleeOf(copied_instr)) {
+                new_calls->push_back(copied_instr);
+            }
+            if (instr->op()->IsTerminator() || instr->Is(Operator::kUnreachable)) {
+                break;
+            }
+        }
+        for (auto pred : blk->inputs()) {
+            if (order.IsReachable(pred)) { blocks[pred]->LinkTo(copied); }
+        }
+    }
+
+    for (const auto &fixup : fixups) {
+        auto iter = values.find(fixup.origin);
+        if (iter == values.end()) {
+            continue; // Defined out of function: globals, ...
+        }
+        fixup.instr->Replace(arena(), fixup.position, fixup.origin, iter->second);
+        if (fixup.instr->Is(Operator::kPhi)) {
+            for (auto &user : *fixup.instr->InputControl(fixup.position)->mutable_phi_node_users()) {
+                if (user.phi == fixup.instr && user.dest == fixup.origin) { user.dest = iter->second; }
+            }
+        }
+    }
+
+    // Merge the returning values in the continuation block.
+    std::vector<Value *> results;
+    int returning = std::get<1>(rets.front())->op()->value_in();
+    for (auto [copied, ret] : rets) {
+        returning = std::min(returning, ret->op()->value_in());
+    }
+    for (int i = 0; i < returning; i++) {
+        if (rets.size() == 1) {
+            results.push_back(MapValue(std::get<1>(rets.front())->InputValue(i)));
+            continue;
+        }
+        std::vector<Node *> inputs;
+        for (auto [copied, ret] : rets) {
+            inputs.push_back(MapValue(ret->InputValue(i)));
+        }
+        for (auto [copied, ret] : rets) {
+            inputs.push_back(copied);
+        }
+        auto n = static_cast<int>(rets.size());
+        auto type = callee->prototype()->return_type(i);
+        auto phi = cont->NewNodeWithNodes(nullptr, call->source_position(), type, ops()->Phi(n, n), inputs);
+        cont->MoveToFront(phi);
+        results.push_back(phi);
+    }
+
+    for (auto [position, user] : call->GetUsers()) {
+        if (user->Is(Operator::kReturningVal)) {
+            auto index = OperatorWith<int>::Data(user);
+            DCHECK(index < static_cast<int>(results.size()));
+            user->ReplaceUsesWith(arena(), results[index]);
+            user->KillWithInputs();
+        }
+    }
+    if (!call->GetUsers().empty()) {
+        DCHECK(!results.empty());
+        call->ReplaceUsesWith(arena(), results[0]);
+    }
+    call->KillWithInputs();
+    block->RemoveDeads();
+    cont->RemoveDeads();
+
+    block->NewNode(call->source_position(), Types::Void, ops()->Br(0/*value_in*/, 1/*control_out*/),
+                   blocks[order.block(0)]);
+    block->LinkTo(blocks[order.block(0)]);
+
+    analyses()->Invalidate(caller);
+    sizes_.erase(caller);
+    inlined_++;
+    return true;
+}
+
+} // namespace yalx::ir
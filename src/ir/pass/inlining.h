@@ -0,0 +1,79 @@
+#pragma once
+#ifndef YALX_IR_PASS_INLINING_H_
+#define YALX_IR_PASS_INLINING_H_
+
+#include "ir/pass/pass.h"
+#include <unordered_map>
+#include <vector>
+
+namespace yalx {
+
+namespace ir {
+
+// Inline the direct calls (`CallDirectly' and `CallHandle') into callers:
+// The calling block is split at the call, the blocks of callee are cloned between them, and the `Ret's of callee
+// jump to the continuation block, where the returning values are merged by phis.
+//
+// Heuristics: tiny callees are always inlined, others are inlined only if size of callee is under the budget, the
+// budget grows with loop depth of call site and shrinks with the inlining depth. Recursive calls are never inlined.
+// With a profile (see `Profile'), only tiny callees are inlined at call sites never executed, and hot call sites get
+// a bonus budget.
+class InliningPass : public Pass<InliningPass> {
+public:
+    constexpr static const char kPassName[] = "inlining";
+    constexpr static const int kPassLevel = 1;
+
+    // Callee which size is under it always be inlined
+    constexpr static const int kTinyFunctionSize = 8;
+    // Budget of callee size for call site not in any loop
+    constexpr static const int kBaseBudget = 40;
+    // Bonus budget for every loop depth of call site
+    constexpr static const int kLoopDepthBonus = 20;
+    constexpr static const int kMaxLoopDepthBonus = 3;
+    // Max depth of inlining for calls in the inlined code
+    constexpr static const int kMaxInliningDepth = 4;
+    // Stop inlining if caller is too big
+    constexpr static const int kMaxCallerSize = 2000;
+    // Call site executed at least this many times per calling of caller is hot in profile
+    constexpr static const int kHotCallSiteRatio = 8;
+    // Bonus budget for hot call site
+    constexpr static const int kHotCallSiteBonus = 60;
+
+    InliningPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules, cpl::SyntaxFeedback *feedback);
+
+    DEF_VAL_GETTER(int, inlined);
+
+    void RunModule(Module *module);
+    void RunFun(Function *fun);
+    void RunUdt(StructureModel *udt) { ForeachMethod(udt); }
+
+    // Inline the call at `block'. Returns false if callee can not be inlined.
+    bool Inline(Function *caller, BasicBlock *block, Value *call, std::vector<Value *> *new_calls = nullptr);
+
+    // Callee of call if it's known, otherwise returns nullptr.
+    static Function *CalleeOf(Value *call);
+
+    // Size of function for inlining, -1 if function can not be inlined.
+    int InlineSizeOf(Function *fun);
+
+    // Split block after the call, the instructions after call are moved into the returned continuation block.
+    static BasicBlock *SplitBlock(Function *fun, BasicBlock *block, Value *call);
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(InliningPass);
+private:
+    struct CallSite {
+        Value *call;
+        std::vector<Function *> inlined; // inlined functions from origin caller, for detecting recursion
+    }; // struct CallSite
+
+    bool ShouldInline(Function *caller, BasicBlock *block, const CallSite &site, Function *callee);
+
+    std::unordered_map<const Function *, int> sizes_;
+    int inlined_ = 0;
+}; // class InliningPass
+
+} // namespace ir
+
+} // namespace yalx
+
+#endif // YALX_IR_PASS_INLINING_H_
@@ -0,0 +1,151 @@
+#include "ir/pass/loop-optimization.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/operators-factory.h"
+#include "ir/utils.h"
+#include "ir/base-test.h"
+#include "base/io.h"
+#include <gtest/gtest.h>
+#include <functional>
+
+namespace yalx {
+
+namespace ir {
+
+class LoopOptimizationPassTest : public ModuleTest {
+public:
+    void SetUp() override {
+        ModuleTest::SetUp();
+        auto ar_name = String::New(arena(), "i32[]");
+        ar_ = new (arena()) ArrayModel(arena(), ar_name, ar_name, 1/*dimension_count*/, Types::Int32);
+        size_ = Handle::Field(arena(), ar_, String::New(arena(), "size"), 0);
+    }
+
+    // fun sum(a: i32[], n: i32): i32 {
+    //     var s = 0
+    //     for (i = 0; i < n; i++) { s += body(a, n, i) }
+    //     return s
+    // }
+    Function *NewSum(std::function<Value *(BasicBlock *, Value *, Value *, Value *)> body_of) {
+        const SourcePosition ss = SourcePosition::Unknown();
+        auto fun = NewFun("sum", {Type::Ref(ar_), Types::Int32}, {Types::Int32});
+        auto a = fun->paramater(0);
+        auto n = fun->paramater(1);
+
+        auto entry = NewBlock(fun, "entry");
+        auto header = NewBlock(fun, "header");
+        auto body = NewBlock(fun, "body");
+        auto exit = NewBlock(fun, "exit");
+        Goto(entry, header);
+        auto zero = I32(0);
+        auto i = header->NewNodeWithNodes(nullptr, ss, Types::Int32, ops()->Phi(2, 2),
+                                          std::vector<Node *>{zero, zero, entry, body});
+        auto s = header->NewNodeWithNodes(nullptr, ss, Types::Int32, ops()->Phi(2, 2),
+                                          std::vector<Node *>{zero, zero, entry, body});
+        auto cond = header->NewNode(ss, Types::Word8, ops()->ICmp(ICondition::slt), i, n);
+        Branch(header, cond, body, exit);
+        auto t = body->NewNode(ss, Types::Int32, ops()->Add(), s, body_of(body, a, n, i));
+        auto next = body->NewNode(ss, Types::Int32, ops()->Add(), i, I32(1));
+        Goto(body, header);
+        exit->NewNode(ss, Types::Void, ops()->Ret(1), s);
+        ReplacePhiInput(body, i, 1, next);
+        ReplacePhiInput(body, s, 1, t);
+        return fun;
+    }
+
+protected:
+    ArrayModel *ar_ = nullptr;
+    Handle *size_ = nullptr;
+}; // class LoopOptimizationPassTest
+
+TEST_F(LoopOptimizationPassTest, HoistInvariants) {
+    auto fun = NewSum([this](BasicBlock *body, Value *a, Value *n, Value *i) {
+        const SourcePosition ss = SourcePosition::Unknown();
+        auto size = body->NewNode(ss, Types::Int32, ops()->LoadEffectField(size_), a);
+        auto k = body->NewNode(ss, Types::Int32, ops()->Mul(), n, I32(3));
+        auto d = body->NewNode(ss, Types::Int32, ops()->SDiv(), size, n); // Might trap, not in header
+        auto x = body->NewNode(ss, Types::Int32, ops()->Add(), size, k);
+        return body->NewNode(ss, Types::Int32, ops()->Add(), x, d);
+    });
+
+    LoopOptimizationPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(3, pass.hoisted());
+    EXPECT_EQ(0, pass.strength_reduced());
+
+    constexpr static const char z[] = R"(fun sum(%0: ref[i32[]], %1: i32): i32 {
+entry:
+    %2 = LoadEffectField i32 ref[i32[]] %0 <i32[]::size>
+    %3 = Mul i32 i32 %1, i32 3
+    %4 = Add i32 i32 %2, i32 %3
+    Br void out [header:]
+header:
+    %5 = Phi i32 i32 0, i32 %6 in [entry:, body:]
+    %7 = Phi i32 i32 0, i32 %8 in [entry:, body:]
+    %9 = ICmp byte i32 %5, i32 %1 <slt>
+    Br void byte %9 out [body:, exit:]
+body:
+    %10 = SDiv i32 i32 %2, i32 %1
+    %11 = Add i32 i32 %4, i32 %10
+    %8 = Add i32 i32 %7, i32 %11
+    %6 = Add i32 i32 %5, i32 1
+    Br void out [header:]
+exit:
+    Ret void i32 %7
+} // main:main.sum
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+}
+
+TEST_F(LoopOptimizationPassTest, ClobberedLoads) {
+    NewSum([this](BasicBlock *body, Value *a, Value *n, Value *i) {
+        const SourcePosition ss = SourcePosition::Unknown();
+        auto size = body->NewNode(ss, Types::Int32, ops()->LoadEffectField(size_), a);
+        body->NewNode(ss, Types::Void, ops()->CallRuntime(0/*value_out*/, 0/*value_in*/, 0/*control_out*/,
+                                                          RuntimeLib::PkgInitOnce));
+        return size;
+    });
+
+    LoopOptimizationPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(0, pass.hoisted());
+}
+
+TEST_F(LoopOptimizationPassTest, StrengthReduction) {
+    auto fun = NewSum([this](BasicBlock *body, Value *a, Value *n, Value *i) {
+        const SourcePosition ss = SourcePosition::Unknown();
+        auto m = body->NewNode(ss, Types::Int32, ops()->Mul(), i, I32(4));
+        auto index = body->NewNode(ss, Types::Int32, ops()->Add(), m, n);
+        return body->NewNode(ss, Types::Int32, ops()->ArrayAt(ar_, 2), a, index);
+    });
+
+    LoopOptimizationPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(0, pass.hoisted());
+    EXPECT_EQ(1, pass.strength_reduced());
+
+    constexpr static const char z[] = R"(fun sum(%0: ref[i32[]], %1: i32): i32 {
+entry:
+    Br void out [header:]
+header:
+    %2 = Phi i32 i32 %1, i32 %3 in [entry:, body:]
+    %4 = Phi i32 i32 0, i32 %5 in [entry:, body:]
+    %6 = Phi i32 i32 0, i32 %7 in [entry:, body:]
+    %8 = ICmp byte i32 %4, i32 %1 <slt>
+    Br void byte %8 out [body:, exit:]
+body:
+    %9 = ArrayAt i32 ref[i32[]] %0, i32 %2 <i32[]>
+    %7 = Add i32 i32 %6, i32 %9
+    %5 = Add i32 i32 %4, i32 1
+    %3 = Add i32 i32 %2, i32 4
+    Br void out [header:]
+exit:
+    Ret void i32 %6
+} // main:main.sum
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+}
+
+} // namespace ir
+
+} // namespace yalx
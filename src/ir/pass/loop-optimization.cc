@@ -0,0 +1,287 @@
+#include "ir/pass/loop-optimization.h"
+#include "ir/operators-factory.h"
+#include "ir/metadata.h"
+#include <algorithm>
+
+namespace yalx::ir {
+
+LoopOptimizationPass::LoopOptimizationPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules,
+                                           cpl::SyntaxFeedback *feedback)
+: Pass<LoopOptimizationPass>(arena, ops, modules, feedback) {
+}
+
+void LoopOptimizationPass::RunModule(Module *module) {
+    ForeachUdt(module);
+    ForeachFunction(module);
+}
+
+void LoopOptimizationPass::RunFun(Function *fun) {
+    if (!fun->entry()) {
+        return;
+    }
+
+    analyses()->InsertPreheaders(fun);
+    owners_.clear();
+    for (auto blk : fun->blocks()) {
+        for (auto instr : blk->instructions()) { owners_[instr] = blk; }
+    }
+
+    // Inner loops first: the instructions hoisted into preheader of inner loop may be hoisted again by outer loop.
+    auto loops = analyses()->LoopNestOf(fun)->loops();
+    for (auto iter = loops.rbegin(); iter != loops.rend(); iter++) {
+        if (!(*iter)->preheader()) {
+            continue;
+        }
+        while (HoistInvariants(*iter)) {}
+        ReduceStrength(*iter);
+    }
+    owners_.clear();
+
+    for (auto blk : fun->blocks()) {
+        blk->RemoveDeads();
+    }
+}
+
+static bool ConstantOf(Value *value, int64_t *constant) {
+    switch (value->op()->value()) {
+    #define DEFINE_CASE(name, type) \
+        case Operator::k##name##Constant: \
+            *constant = static_cast<int64_t>(OperatorWith<type>::Data(value)); \
+            return true;
+        DEFINE_CASE(I8, int8_t)
+        DEFINE_CASE(I16, int16_t)
+        DEFINE_CASE(I32, int32_t)
+        DEFINE_CASE(I64, int64_t)
+        DEFINE_CASE(U8, uint8_t)
+        DEFINE_CASE(U16, uint16_t)
+        DEFINE_CASE(U32, uint32_t)
+        DEFINE_CASE(U64, uint64_t)
+    #undef DEFINE_CASE
+        default:
+            return false;
+    }
+}
+
+// Might trap or have side effects if it's executed speculatively.
+static bool MightTrap(Value *instr) {
+    switch (instr->op()->value()) {
+        case Operator::kSDiv:
+        case Operator::kSRem:
+        case Operator::kUDiv:
+        case Operator::kURem:
+        case Operator::kUnboxingTo:
+        case Operator::kArrayAt:
+        case Operator::kArrayUncheckedAt: // Index may be proven in bounds by the conditions in loop
+        case Operator::kLazyLoad:
+            return true;
+        case Operator::kLoadEffectField:
+            return instr->InputValue(0)->type().IsNullable();
+        default:
+            return false;
+    }
+}
+
+bool LoopOptimizationPass::HoistInvariants(Loop *loop) {
+    LoopEffects effects;
+    for (auto blk : loop->blocks()) {
+        for (auto instr : blk->instructions()) {
+            AliasClass klass;
+            if (instr->IsDead()) {
+                continue;
+            }
+            switch (GlobalValueNumberingPass::EffectOf(instr, &klass)) {
+                case GlobalValueNumberingPass::kStore:
+                    effects.stored.insert(klass);
+                    break;
+                case GlobalValueNumberingPass::kBarrier:
+                    effects.barrier = true;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    bool changed = false;
+    for (auto blk : loop->blocks()) {
+        const std::vector<Value *> instrs(blk->instructions().begin(), blk->instructions().end());
+        bool side_effects_before = blk != loop->header();
+        for (auto instr : instrs) {
+            if (instr->IsDead()) {
+                continue;
+            }
+            if (ShouldHoist(loop, effects, instr, side_effects_before)) {
+                Hoist(blk, instr, loop->preheader());
+                changed = true;
+                continue;
+            }
+            AliasClass klass;
+            auto effect = GlobalValueNumberingPass::EffectOf(instr, &klass);
+            side_effects_before |= effect == GlobalValueNumberingPass::kStore ||
+                                   effect == GlobalValueNumberingPass::kBarrier || MightTrap(instr);
+        }
+    }
+    return changed;
+}
+
+bool LoopOptimizationPass::ShouldHoist(Loop *loop, const LoopEffects &effects, Value *instr,
+                                       bool side_effects_before) {
+    if (instr->type().kind() == Type::kVoid || instr->Is(Operator::kPhi) || instr->op()->IsTerminator() ||
+        instr->op()->control_out() > 0) {
+        return false;
+    }
+    for (int i = 0; i < instr->op()->value_in(); i++) {
+        if (!IsInvariant(loop, instr->InputValue(i))) {
+            return false;
+        }
+    }
+    if (MightTrap(instr) && side_effects_before) {
+        return false;
+    }
+
+    AliasClass klass;
+    switch (GlobalValueNumberingPass::EffectOf(instr, &klass)) {
+        case GlobalValueNumberingPass::kPure:
+            return true;
+        case GlobalValueNumberingPass::kLoad:
+            return !effects.barrier && effects.stored.find(klass) == effects.stored.end();
+        case GlobalValueNumberingPass::kBarrier:
+            // Lazy value is initialized only once, so the later loading has no effects.
+            return instr->Is(Operator::kLazyLoad);
+        default:
+            return false;
+    }
+}
+
+static Value *InsertBeforeTerminator(BasicBlock *block, Value *instr) {
+    auto instrs = block->mutable_instructions();
+    DCHECK(!instrs->empty() && instrs->back()->op()->IsTerminator());
+    instrs->insert(instrs->end() - 1, instr);
+    return instr;
+}
+
+void LoopOptimizationPass::Hoist(BasicBlock *block, Value *instr, BasicBlock *preheader) {
+    auto instrs = block->mutable_instructions();
+    instrs->erase(std::find(instrs->begin(), instrs->end(), instr));
+    owners_[InsertBeforeTerminator(preheader, instr)] = preheader;
+    hoisted_++;
+}
+
+void LoopOptimizationPass::ReduceStrength(Loop *loop) {
+    auto header = loop->header();
+    auto preheader = loop->preheader();
+    if (loop->latches().size() != 1 || header->inputs_size() != 2) {
+        return;
+    }
+    auto latch = loop->latches()[0];
+    const int entering = header->FindInput(preheader);
+    const int back = header->FindInput(latch);
+    if (entering < 0 || back < 0) {
+        return;
+    }
+
+    // New phis are inserted into header.
+    const std::vector<Value *> phis(header->instructions().begin(), header->instructions().end());
+    for (auto phi : phis) {
+        if (phi->IsDead() || phi->IsNot(Operator::kPhi) || !phi->type().IsNumber() || phi->type().IsFloating()) {
+            continue;
+        }
+        // Basic induction variable: i = phi(init, i + step)
+        auto init = phi->InputValue(entering);
+        auto next = phi->InputValue(back);
+        int64_t step = 0;
+        if (next->IsNot(Operator::kAdd) ||
+            !((next->InputValue(0) == phi && ConstantOf(next->InputValue(1), &step)) ||
+              (next->InputValue(1) == phi && ConstantOf(next->InputValue(0), &step)))) {
+            continue;
+        }
+
+        for (auto [position, user] : phi->GetUsers()) {
+            int64_t scale = 0;
+            if (user->IsDead() || user->IsNot(Operator::kMul) || !loop->Contains(owners_[user]) ||
+                !ConstantOf(user->InputValue(1 - position), &scale)) {
+                continue;
+            }
+            // i * c + b
+            Value *target = user;
+            Value *offset = nullptr;
+            auto users = user->GetUsers();
+            if (users.size() == 1 && std::get<1>(users[0])->Is(Operator::kAdd) &&
+                IsInvariant(loop, std::get<1>(users[0])->InputValue(1 - std::get<0>(users[0])))) {
+                target = std::get<1>(users[0]);
+                offset = target->InputValue(1 - std::get<0>(users[0]));
+            }
+
+            // Initial value in preheader: init * c + b
+            const auto ss = target->source_position();
+            const auto type = phi->type();
+            int64_t initial = 0;
+            Value *start = nullptr;
+            if (ConstantOf(init, &initial)) {
+                start = NewConstant(type, initial * scale);
+            } else {
+                start = InsertBeforeTerminator(preheader, Value::New(arena(), ss, type, ops()->Mul(), init,
+                                                                     user->InputValue(1 - position)));
+                owners_[start] = preheader;
+            }
+            if (offset && start->op()->IsConstant() && initial * scale == 0) {
+                start = offset;
+            } else if (offset) {
+                start = InsertBeforeTerminator(preheader, Value::New(arena(), ss, type, ops()->Add(), start, offset));
+                owners_[start] = preheader;
+            }
+
+            std::vector<Node *> inputs(4);
+            inputs[entering] = start;
+            inputs[back] = start;
+            inputs[2 + entering] = preheader;
+            inputs[2 + back] = latch;
+            auto iv = header->NewNodeWithNodes(nullptr, ss, type, ops()->Phi(2, 2), inputs);
+            header->MoveToFront(iv);
+            owners_[iv] = header;
+
+            // Increased by c * step in latch
+            auto increment = NewConstant(type, scale * step);
+            auto iv_next = InsertBeforeTerminator(latch, Value::New(arena(), ss, type, ops()->Add(), iv, increment));
+            owners_[iv_next] = latch;
+            iv->Replace(arena(), back, start, iv_next);
+            for (auto &phi_user : *latch->mutable_phi_node_users()) {
+                if (phi_user.phi == iv && phi_user.dest == start) { phi_user.dest = iv_next; }
+            }
+
+            target->ReplaceUsesWith(arena(), iv);
+            target->KillWithInputs();
+            if (target != user && user->GetUsers().empty()) {
+                user->KillWithInputs();
+            }
+            strength_reduced_++;
+        }
+    }
+}
+
+Value *LoopOptimizationPass::NewConstant(Type type, int64_t value) {
+    const auto ss = SourcePosition::Unknown();
+    switch (type.kind()) {
+    #define DEFINE_CASE(kind, name, type) \
+        case Type::k##kind: \
+            return Value::New(arena(), ss, Types::kind, ops()->name##Constant(static_cast<type>(value)));
+        DEFINE_CASE(Word8, Word8, uint8_t)
+        DEFINE_CASE(Word16, Word16, uint16_t)
+        DEFINE_CASE(Word32, Word32, uint32_t)
+        DEFINE_CASE(Word64, Word64, uint64_t)
+        DEFINE_CASE(Int8, I8, int8_t)
+        DEFINE_CASE(Int16, I16, int16_t)
+        DEFINE_CASE(Int32, I32, int32_t)
+        DEFINE_CASE(Int64, I64, int64_t)
+        DEFINE_CASE(UInt8, U8, uint8_t)
+        DEFINE_CASE(UInt16, U16, uint16_t)
+        DEFINE_CASE(UInt32, U32, uint32_t)
+        DEFINE_CASE(UInt64, U64, uint64_t)
+    #undef DEFINE_CASE
+        default:
+            UNREACHABLE();
+            return nullptr;
+    }
+}
+
+} // namespace yalx::ir
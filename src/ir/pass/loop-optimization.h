@@ -0,0 +1,68 @@
+#pragma once
+#ifndef YALX_IR_PASS_LOOP_OPTIMIZATION_H_
+#define YALX_IR_PASS_LOOP_OPTIMIZATION_H_
+
+#include "ir/pass/pass.h"
+#include "ir/pass/global-value-numbering.h"
+#include <unordered_map>
+#include <unordered_set>
+
+namespace yalx {
+
+namespace ir {
+
+// Optimize loops from inner to outer:
+//   - Loop-invariant code motion: the invariant pure instructions and the loads not clobbered in loop are hoisted
+//     into preheader. Instructions might trap (division, bounds checking, lazy loading, ...) are only hoisted from
+//     header before any side effects, because they are always executed once the loop is entered.
+//   - Induction variable strength reduction: for basic induction variable i (i = i + step, step is a constant),
+//     `i * c' and `i * c + b' (b is invariant) are replaced by a new induction variable increased by `c * step'.
+class LoopOptimizationPass : public Pass<LoopOptimizationPass> {
+public:
+    constexpr static const char kPassName[] = "loop-optimization";
+    constexpr static const int kPassLevel = 1;
+    constexpr static const uint32_t kPreservedAnalyses = AnalysisManager::kCfgAnalyses;
+
+    LoopOptimizationPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules,
+                         cpl::SyntaxFeedback *feedback);
+
+    DEF_VAL_GETTER(int, hoisted);
+    DEF_VAL_GETTER(int, strength_reduced);
+
+    void RunModule(Module *module);
+    void RunFun(Function *fun);
+    void RunUdt(StructureModel *udt) { ForeachMethod(udt); }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(LoopOptimizationPass);
+private:
+    using AliasClass = GlobalValueNumberingPass::AliasClass;
+    using AliasClassHash = GlobalValueNumberingPass::AliasClassHash;
+
+    // Memory effects of all instructions in loop
+    struct LoopEffects {
+        bool barrier = false;
+        std::unordered_set<AliasClass, AliasClassHash> stored;
+    }; // struct LoopEffects
+
+    bool HoistInvariants(Loop *loop);
+    bool ShouldHoist(Loop *loop, const LoopEffects &effects, Value *instr, bool side_effects_before);
+    void Hoist(BasicBlock *block, Value *instr, BasicBlock *preheader);
+    void ReduceStrength(Loop *loop);
+    Value *NewConstant(Type type, int64_t value);
+
+    bool IsInvariant(Loop *loop, Value *value) const {
+        auto iter = owners_.find(value);
+        return iter == owners_.end() || !loop->Contains(iter->second);
+    }
+
+    // Blocks of instructions in current function
+    std::unordered_map<const Value *, BasicBlock *> owners_;
+    int hoisted_ = 0;
+    int strength_reduced_ = 0;
+}; // class LoopOptimizationPass
+
+} // namespace ir
+
+} // namespace yalx
+
+#endif // YALX_IR_PASS_LOOP_OPTIMIZATION_H_
@@ -5,6 +5,7 @@
 #include "compiler/syntax-feedback.h"
 #include "ir/node.h"
 #include "ir/metadata.h"
+#include "ir/pass/analysis.h"
 #include "base/arena-utils.h"
 #include "base/base.h"
 
@@ -21,6 +22,9 @@ class Pass {
 public:
     using ModulesMap = base::ArenaMap<std::string_view, Module *>;
     
+    // Analyses still valid after the pass changed a function, passes which do not change CFG should override it.
+    constexpr static const uint32_t kPreservedAnalyses = AnalysisManager::kNone;
+    
     Pass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules, cpl::SyntaxFeedback *feedback)
     : arena_(arena)
     , ops_(ops)
@@ -35,6 +39,16 @@ public:
     DEF_PTR_GETTER(Function, current_fun);
     DEF_PTR_GETTER(BasicBlock, current_block);
     DEF_PTR_GETTER(cpl::SyntaxFeedback, feedback);
+    DEF_PTR_SETTER(AnalysisManager, analyses);
+    
+    // Analyses shared by passes, use a private one if not set.
+    AnalysisManager *analyses() {
+        if (!analyses_) {
+            owned_analyses_ = std::make_unique<AnalysisManager>(arena_, ops_);
+            analyses_ = owned_analyses_.get();
+        }
+        return analyses_;
+    }
     
     void Run() {
         for (auto [name, module] : *modules()) {
@@ -56,6 +70,7 @@ public:
         for (auto method : udt->methods()) {
             current_fun_ = method.fun;
             static_cast<T *>(this)->RunFun(method.fun);
+            if (analyses_) { analyses_->Invalidate(method.fun, T::kPreservedAnalyses); }
             current_fun_ = nullptr;
         }
     }
@@ -64,6 +79,7 @@ public:
         for (auto fun : module->funs()) {
             current_fun_ = fun;
             static_cast<T *>(this)->RunFun(fun);
+            if (analyses_) { analyses_->Invalidate(fun, T::kPreservedAnalyses); }
             current_fun_ = nullptr;
         }
     }
@@ -85,6 +101,8 @@ private:
     OperatorsFactory *const ops_;
     ModulesMap *modules_;
     cpl::SyntaxFeedback *feedback_;
+    AnalysisManager *analyses_ = nullptr;
+    std::unique_ptr<AnalysisManager> owned_analyses_;
     
     Module *current_module_ = nullptr;
     StructureModel *current_udt_ = nullptr;
@@ -0,0 +1,130 @@
+#include "ir/pass/profile-instrumentation.h"
+#include "ir/pass/inlining.h"
+#include "ir/profile.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/operators-factory.h"
+#include "ir/utils.h"
+#include "ir/base-test.h"
+#include "base/io.h"
+#include <gtest/gtest.h>
+
+namespace yalx {
+
+namespace ir {
+
+class ProfileInstrumentationPassTest : public ModuleTest {
+public:
+    void SetUp() override {
+        ModuleTest::SetUp();
+        foo_ = module_->NewClassModel(String::New(arena(), "Foo"), String::New(arena(), "main:main.Foo"), nullptr);
+        auto prototype = new (arena()) PrototypeModel(arena(), String::kEmpty, false/*vargs*/);
+        prototype->mutable_params()->push_back(Type::Ref(foo_));
+        prototype->mutable_return_types()->push_back(Types::Int32);
+        auto get = module_->NewFunction(Function::kDefault, String::New(arena(), "get"), foo_, prototype);
+        get_ = foo_->InsertMethod({get, kPublic, 0, 0, 0});
+    }
+
+    // fun foo(a: i32, self: Foo): i32 = if (a > 0) self.get() else a
+    Function *NewFun() {
+        const SourcePosition ss = SourcePosition::Unknown();
+        auto fun = ModuleTest::NewFun("foo", {Types::Int32, Type::Ref(foo_)}, {Types::Int32});
+        auto entry = NewBlock(fun, "entry");
+        auto l = NewBlock(fun, "l");
+        auto r = NewBlock(fun, "r");
+        auto cond = entry->NewNode(ss, Types::Word8, ops()->ICmp(ICondition::sgt), fun->paramater(0), I32(0));
+        Branch(entry, cond, l, r);
+        auto rv = l->NewNode(ss, Types::Int32, ops()->CallVirtual(get_, 1/*value_out*/, 1/*value_in*/,
+                                                                  0/*control_out*/), fun->paramater(1));
+        l->NewNode(ss, Types::Void, ops()->Ret(1), rv);
+        r->NewNode(ss, Types::Void, ops()->Ret(1), fun->paramater(0));
+        return fun;
+    }
+
+protected:
+    StructureModel *foo_ = nullptr;
+    Handle *get_ = nullptr;
+}; // class ProfileInstrumentationPassTest
+
+TEST_F(ProfileInstrumentationPassTest, Sanity) {
+    auto fun = NewFun();
+    ProfileInstrumentationPass pass(arena(), ops(), &modules_, feedback());
+    pass.RunFun(fun);
+    EXPECT_EQ(3, pass.counters());
+    EXPECT_EQ(1, pass.sites());
+    EXPECT_EQ(3, fun->profile_counters());
+    EXPECT_EQ(1, fun->profile_sites());
+
+    constexpr static const char z[] = R"(fun foo(%0: i32, %1: ref[main:main.Foo]): i32 {
+entry:
+    ProfileCount void <0>
+    %2 = ICmp byte i32 %0, i32 0 <sgt>
+    Br void byte %2 out [l:, r:]
+l:
+    ProfileCount void <1>
+    ProfileReceiver void ref[main:main.Foo] %1 <0>
+    %3 = CallVirtual i32 ref[main:main.Foo] %1 <main:main.Foo::get>
+    Ret void i32 %3
+r:
+    ProfileCount void <2>
+    Ret void i32 %0
+} // main:main.foo
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+
+    // Instrument only once, and the counters must be kept in the function.
+    pass.RunFun(fun);
+    EXPECT_EQ(3, pass.counters());
+    InliningPass inlining(arena(), ops(), &modules_, feedback());
+    EXPECT_EQ(-1, inlining.InlineSizeOf(fun));
+}
+
+TEST_F(ProfileInstrumentationPassTest, ParseProfile) {
+    constexpr static const char z[] = "fun main:main.foo\n"
+                                      "blocks 100 90 10\n"
+                                      "site 0 main:main.Foo 80 main:main.Bar 8 * 2\n";
+    Profile profile;
+    ASSERT_TRUE(profile.Parse(z).ok());
+    EXPECT_EQ(z, profile.ToString());
+
+    auto foo = profile.FindOrNull("main:main.foo");
+    ASSERT_NE(nullptr, foo);
+    ASSERT_EQ(3, foo->blocks.size());
+    EXPECT_EQ(90, foo->blocks[1]);
+    ASSERT_EQ(1, foo->sites.size());
+    auto &site = foo->sites.at(0);
+    EXPECT_EQ(90, site.total());
+    ASSERT_NE(nullptr, site.dominant());
+    EXPECT_EQ("main:main.Foo", site.dominant()->clazz);
+    EXPECT_EQ(nullptr, profile.FindOrNull("main:main.bar"));
+
+    EXPECT_FALSE(profile.Parse("blocks 1 2\n").ok());
+    EXPECT_FALSE(profile.Parse("fun main:main.foo\nblocks 1 x\n").ok());
+}
+
+TEST_F(ProfileInstrumentationPassTest, Annotate) {
+    auto fun = NewFun();
+    Profile profile;
+    ASSERT_TRUE(profile.Parse("fun main:main.foo\n"
+                              "blocks 100 90 10\n"
+                              "site 0 main:main.Foo 90\n").ok());
+    EXPECT_EQ(1, profile.Annotate(modules_));
+    EXPECT_EQ(100, fun->block(0)->frequency());
+    EXPECT_EQ(90, fun->block(1)->frequency());
+    EXPECT_EQ(10, fun->block(2)->frequency());
+
+    auto call = fun->block(1)->instruction(0);
+    ASSERT_TRUE(call->Is(Operator::kCallVirtual));
+    auto site = profile.ReceiversOf(call);
+    ASSERT_NE(nullptr, site);
+    EXPECT_EQ(90, site->total());
+
+    // Stale profile: blocks are not matched.
+    Profile stale;
+    ASSERT_TRUE(stale.Parse("fun main:main.foo\nblocks 100 90\n").ok());
+    EXPECT_FALSE(stale.Annotate(fun));
+}
+
+} // namespace ir
+
+} // namespace yalx
@@ -0,0 +1,50 @@
+#include "ir/pass/profile-instrumentation.h"
+#include "ir/operators-factory.h"
+#include "ir/profile.h"
+#include "ir/metadata.h"
+
+namespace yalx::ir {
+
+ProfileInstrumentationPass::ProfileInstrumentationPass(base::Arena *arena, OperatorsFactory *ops,
+                                                       ModulesMap *modules, cpl::SyntaxFeedback *feedback)
+: Pass<ProfileInstrumentationPass>(arena, ops, modules, feedback) {
+}
+
+void ProfileInstrumentationPass::RunModule(Module *module) {
+    ForeachUdt(module);
+    ForeachFunction(module);
+}
+
+void ProfileInstrumentationPass::RunFun(Function *fun) {
+    if (!fun->entry() || fun->profile_counters() > 0) {
+        return; // No body or already instrumented
+    }
+
+    int counter = 0;
+    int site = 0;
+    for (auto blk : fun->blocks()) {
+        auto instrs = blk->mutable_instructions();
+        auto iter = instrs->begin();
+        while (iter != instrs->end() && (*iter)->Is(Operator::kPhi)) {
+            iter++;
+        }
+        auto count = Value::New(arena(), SourcePosition::Unknown(), Types::Void, ops()->ProfileCount(counter++));
+        iter = instrs->insert(iter, count) + 1;
+
+        for (; iter != instrs->end(); iter++) {
+            auto instr = *iter;
+            if (!Profile::IsProfilingSite(instr)) {
+                continue;
+            }
+            auto receiver = Value::New(arena(), instr->source_position(), Types::Void,
+                                       ops()->ProfileReceiver(site++), instr->InputValue(0));
+            iter = instrs->insert(iter, receiver) + 1;
+        }
+    }
+    fun->set_profile_counters(counter);
+    fun->set_profile_sites(site);
+    counters_ += counter;
+    sites_ += site;
+}
+
+} // namespace yalx::ir
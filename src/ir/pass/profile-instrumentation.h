@@ -0,0 +1,44 @@
+#pragma once
+#ifndef YALX_IR_PASS_PROFILE_INSTRUMENTATION_H_
+#define YALX_IR_PASS_PROFILE_INSTRUMENTATION_H_
+
+#include "ir/pass/pass.h"
+
+namespace yalx {
+
+namespace ir {
+
+// Instrumentation for profile-guided optimization:
+//   - `ProfileCount' at head of every block counts executions of blocks, so edges are counted by their destination;
+//   - `ProfileReceiver' before every `CallVirtual' and `CallAbstract' records classes of receivers, it is lowered
+//     together with these calls, which are not lowered by instruction selectors yet.
+// Counters of a function are indexed by position of blocks and call sites, and written into the profile file by
+// runtime at exit (see `Profile'). It must run right after generating, the instrumented functions are never inlined
+// for keeping the counters in their own function.
+class ProfileInstrumentationPass : public Pass<ProfileInstrumentationPass> {
+public:
+    constexpr static const char kPassName[] = "profile-instrumentation";
+    constexpr static const int kPassLevel = 0;
+    constexpr static const uint32_t kPreservedAnalyses = AnalysisManager::kCfgAnalyses;
+
+    ProfileInstrumentationPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules,
+                               cpl::SyntaxFeedback *feedback);
+
+    DEF_VAL_GETTER(int, counters);
+    DEF_VAL_GETTER(int, sites);
+
+    void RunModule(Module *module);
+    void RunFun(Function *fun);
+    void RunUdt(StructureModel *udt) { ForeachMethod(udt); }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(ProfileInstrumentationPass);
+private:
+    int counters_ = 0;
+    int sites_ = 0;
+}; // class ProfileInstrumentationPass
+
+} // namespace ir
+
+} // namespace yalx
+
+#endif // YALX_IR_PASS_PROFILE_INSTRUMENTATION_H_
@@ -0,0 +1,171 @@
+#include "ir/pass/sparse-conditional-constant-propagation.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/operators-factory.h"
+#include "ir/utils.h"
+#include "ir/base-test.h"
+#include "base/io.h"
+#include <gtest/gtest.h>
+
+namespace yalx {
+
+namespace ir {
+
+class SparseConditionalConstantPropagationPassTest : public ModuleTest {
+public:
+    // fun foo(a: u8, b: u8): i32
+    Function *NewFun() { return ModuleTest::NewFun("foo", {Types::UInt8, Types::UInt8}, {Types::Int32}); }
+}; // class SparseConditionalConstantPropagationPassTest
+
+TEST_F(SparseConditionalConstantPropagationPassTest, ConstantBranch) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto fun = NewFun();
+    auto entry = NewBlock(fun, "entry");
+    auto then = NewBlock(fun, "then");
+    auto otherwise = NewBlock(fun, "else");
+    auto exit = NewBlock(fun, "exit");
+    auto x = entry->NewNode(ss, Types::Int32, ops()->Add(), I32(1), I32(2));
+    auto cond = entry->NewNode(ss, Types::UInt8, ops()->ICmp(ICondition::slt), x, I32(4));
+    Branch(entry, cond, then, otherwise);
+    auto y = then->NewNode(ss, Types::Int32, ops()->Mul(), x, I32(10));
+    Goto(then, exit);
+    auto w = otherwise->NewNode(ss, Types::Int32, ops()->Add(), x, fun->paramater(0));
+    Goto(otherwise, exit);
+    auto phi = exit->NewNodeWithNodes(nullptr, ss, Types::Int32, ops()->Phi(2, 2),
+                                      std::vector<Node *>{y, w, then, otherwise});
+    exit->NewNode(ss, Types::Void, ops()->Ret(1), phi);
+
+    SparseConditionalConstantPropagationPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(4, pass.constants());
+    EXPECT_EQ(1, pass.branches_folded());
+    EXPECT_EQ(3, pass.blocks_removed());
+
+    constexpr static const char z[] = R"(fun foo(%0: u8, %1: u8): i32 {
+entry:
+    Ret void i32 30
+} // main:main.foo
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+}
+
+TEST_F(SparseConditionalConstantPropagationPassTest, PhiOrderNotInputsOrder) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto fun = NewFun();
+    auto entry = NewBlock(fun, "entry");
+    auto p = NewBlock(fun, "p");
+    auto q = NewBlock(fun, "q");
+    auto a = NewBlock(fun, "a");
+    auto b = NewBlock(fun, "b");
+    auto exit = NewBlock(fun, "exit");
+    Branch(entry, fun->paramater(0), p, q);
+    auto cond = p->NewNode(ss, Types::UInt8, ops()->ICmp(ICondition::slt), I32(1), I32(2));
+    Branch(p, cond, a, b);
+    // Inputs of exit: [b, a, q], incoming values of phi: [a, q, b]
+    Goto(b, exit);
+    Goto(a, exit);
+    Goto(q, exit);
+    auto phi = exit->NewNodeWithNodes(nullptr, ss, Types::Int32, ops()->Phi(3, 3),
+                                      std::vector<Node *>{I32(1), I32(2), I32(3), a, q, b});
+    exit->NewNode(ss, Types::Void, ops()->Ret(1), phi);
+
+    SparseConditionalConstantPropagationPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(1, pass.branches_folded());
+
+    constexpr static const char z[] = R"(fun foo(%0: u8, %1: u8): i32 {
+entry:
+    Br void u8 %0 out [p:, q:]
+p:
+    Br void out [exit:]
+q:
+    Br void out [exit:]
+exit:
+    %2 = Phi i32 i32 1, i32 2 in [p:, q:]
+    Ret void i32 %2
+} // main:main.foo
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+}
+
+TEST_F(SparseConditionalConstantPropagationPassTest, ConstantInLoop) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto fun = NewFun();
+    auto entry = NewBlock(fun, "entry");
+    auto header = NewBlock(fun, "header");
+    auto body = NewBlock(fun, "body");
+    auto dead = NewBlock(fun, "dead");
+    auto latch = NewBlock(fun, "latch");
+    auto exit = NewBlock(fun, "exit");
+    Goto(entry, header);
+    // x = 1; while (a) { if (x != 1) { x = 2 }; x = x * 1 }
+    auto x = header->NewNodeWithNodes(nullptr, ss, Types::Int32, ops()->Phi(2, 2),
+                                      std::vector<Node *>{I32(1), I32(1), entry, latch});
+    Branch(header, fun->paramater(0), body, exit);
+    auto cond = body->NewNode(ss, Types::UInt8, ops()->ICmp(ICondition::ne), x, I32(1));
+    Branch(body, cond, dead, latch);
+    Goto(dead, latch);
+    auto y = latch->NewNodeWithNodes(nullptr, ss, Types::Int32, ops()->Phi(2, 2),
+                                     std::vector<Node *>{x, I32(2), body, dead});
+    auto next = latch->NewNode(ss, Types::Int32, ops()->Mul(), y, I32(1));
+    Goto(latch, header);
+    exit->NewNode(ss, Types::Void, ops()->Ret(1), x);
+    ReplacePhiInput(latch, x, 1, next);
+
+    SparseConditionalConstantPropagationPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(4, pass.constants());
+    EXPECT_EQ(1, pass.branches_folded());
+    EXPECT_EQ(2, pass.blocks_removed());
+
+    constexpr static const char z[] = R"(fun foo(%0: u8, %1: u8): i32 {
+entry:
+    Br void out [header:]
+header:
+    Br void u8 %0 out [body:, exit:]
+body:
+    Br void out [header:]
+exit:
+    Ret void i32 1
+} // main:main.foo
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+}
+
+TEST_F(SparseConditionalConstantPropagationPassTest, ThreadJumps) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto fun = NewFun();
+    auto entry = NewBlock(fun, "entry");
+    auto jump = NewBlock(fun, "jump");
+    auto other = NewBlock(fun, "other");
+    auto exit = NewBlock(fun, "exit");
+    auto ret = NewBlock(fun, "ret");
+    Branch(entry, fun->paramater(0), jump, other);
+    Goto(jump, exit);
+    Branch(other, fun->paramater(1), exit, ret);
+    exit->NewNode(ss, Types::Void, ops()->Ret(1), I32(1));
+    ret->NewNode(ss, Types::Void, ops()->Ret(1), I32(2));
+
+    SparseConditionalConstantPropagationPass pass(arena(), ops(), &modules_, feedback());
+    pass.Run();
+    EXPECT_EQ(0, pass.constants());
+    EXPECT_EQ(1, pass.blocks_removed());
+
+    constexpr static const char z[] = R"(fun foo(%0: u8, %1: u8): i32 {
+entry:
+    Br void u8 %0 out [exit:, other:]
+other:
+    Br void u8 %1 out [exit:, ret:]
+exit:
+    Ret void i32 1
+ret:
+    Ret void i32 2
+} // main:main.foo
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+    EXPECT_EQ(2, exit->inputs_size());
+}
+
+} // namespace ir
+
+} // namespace yalx
@@ -0,0 +1,481 @@
+#include "ir/pass/sparse-conditional-constant-propagation.h"
+#include "ir/pass/constants-folding.h"
+#include "ir/operators-factory.h"
+#include <algorithm>
+#include <string.h>
+
+namespace yalx::ir {
+
+SparseConditionalConstantPropagationPass::SparseConditionalConstantPropagationPass(base::Arena *arena,
+                                                                                   OperatorsFactory *ops,
+                                                                                   ModulesMap *modules,
+                                                                                   cpl::SyntaxFeedback *feedback)
+: Pass<SparseConditionalConstantPropagationPass>(arena, ops, modules, feedback) {
+}
+
+void SparseConditionalConstantPropagationPass::RunModule(Module *module) {
+    ForeachUdt(module);
+    ForeachFunction(module);
+}
+
+void SparseConditionalConstantPropagationPass::RunFun(Function *fun) {
+    if (!fun->entry()) {
+        return;
+    }
+
+    Propagate(fun);
+    ReplaceConstants(fun);
+    FoldBranches(fun);
+    RemoveUnreachableBlocks(fun);
+    owners_.clear();
+    lattices_.clear();
+    executable_.clear();
+    executable_edges_.clear();
+
+    while (MergeBlocks(fun) || ThreadJumps(fun)) {}
+    for (auto blk : fun->blocks()) {
+        blk->RemovePhiUsersOfDeads();
+        blk->RemoveDeads();
+    }
+    fun->UpdateIdsOfBlocks();
+}
+
+static bool ConstantOf(Value *value, int64_t *constant) {
+    switch (value->op()->value()) {
+    #define DEFINE_CASE(name, type) \
+        case Operator::k##name##Constant: \
+            *constant = static_cast<int64_t>(OperatorWith<type>::Data(value)); \
+            return true;
+        DEFINE_CASE(Word8, uint8_t)
+        DEFINE_CASE(Word16, uint16_t)
+        DEFINE_CASE(Word32, uint32_t)
+        DEFINE_CASE(Word64, uint64_t)
+        DEFINE_CASE(I8, int8_t)
+        DEFINE_CASE(I16, int16_t)
+        DEFINE_CASE(I32, int32_t)
+        DEFINE_CASE(I64, int64_t)
+        DEFINE_CASE(U8, uint8_t)
+        DEFINE_CASE(U16, uint16_t)
+        DEFINE_CASE(U32, uint32_t)
+        DEFINE_CASE(U64, uint64_t)
+    #undef DEFINE_CASE
+        case Operator::kF32Constant: {
+            auto data = OperatorWith<float>::Data(value);
+            ::memcpy(constant, &data, sizeof(data));
+        } return true;
+        case Operator::kF64Constant: {
+            auto data = OperatorWith<double>::Data(value);
+            ::memcpy(constant, &data, sizeof(data));
+        } return true;
+        default:
+            return false;
+    }
+}
+
+// Constants are created by folding again and again, so compare them by the values.
+static bool IsSameConstant(Value *lhs, Value *rhs) {
+    if (lhs == rhs) {
+        return true;
+    }
+    int64_t lval = 0, rval = 0;
+    return lhs->op()->value() == rhs->op()->value() && ConstantOf(lhs, &lval) && ConstantOf(rhs, &rval) &&
+           lval == rval;
+}
+
+void SparseConditionalConstantPropagationPass::Propagate(Function *fun) {
+    for (auto blk : fun->blocks()) {
+        for (auto instr : blk->instructions()) {
+            if (instr->IsAlive()) { owners_[instr] = blk; }
+        }
+    }
+
+    executable_.insert(fun->entry());
+    VisitBlock(fun->entry());
+    while (!flow_worklist_.empty() || !ssa_worklist_.empty()) {
+        while (!flow_worklist_.empty()) {
+            auto [from, to] = flow_worklist_.front();
+            flow_worklist_.pop_front();
+            if (executable_.insert(to).second) {
+                VisitBlock(to);
+                continue;
+            }
+            // Only the phis are changed by a new executable edge.
+            for (auto instr : to->instructions()) {
+                if (instr->IsAlive() && instr->Is(Operator::kPhi)) { Visit(instr); }
+            }
+        }
+
+        while (!ssa_worklist_.empty()) {
+            auto value = ssa_worklist_.front();
+            ssa_worklist_.pop_front();
+            for (auto edge : value->users()) {
+                auto iter = owners_.find(edge.user);
+                if (iter != owners_.end() && executable_.find(iter->second) != executable_.end()) {
+                    Visit(edge.user);
+                }
+            }
+        }
+    }
+}
+
+void SparseConditionalConstantPropagationPass::VisitBlock(BasicBlock *block) {
+    for (auto instr : block->instructions()) {
+        if (instr->IsAlive()) { Visit(instr); }
+    }
+
+    const auto &instrs = block->instructions();
+    if (!instrs.empty() && IsConditionalBranch(instrs.back())) {
+        // Exceptional edges of the calls in try blocks.
+        for (auto instr : instrs) {
+            if (instr == instrs.back() || instr->IsDead()) {
+                continue;
+            }
+            for (int i = 0; i < instr->op()->control_out(); i++) {
+                MarkEdge(block, instr->OutputControl(i));
+            }
+        }
+        return;
+    }
+    for (auto output : block->outputs()) {
+        MarkEdge(block, output);
+    }
+}
+
+void SparseConditionalConstantPropagationPass::Visit(Value *instr) {
+    if (IsConditionalBranch(instr)) {
+        VisitBranch(owners_[instr], instr);
+        return;
+    }
+    if (instr->type().kind() == Type::kVoid) {
+        return;
+    }
+
+    auto &lattice = lattices_[instr];
+    if (lattice.kind == Lattice::kOverdefined) {
+        return;
+    }
+    auto rv = Evaluate(instr);
+    if (rv.kind == lattice.kind &&
+        (rv.kind != Lattice::kConstant || IsSameConstant(rv.constant, lattice.constant))) {
+        return;
+    }
+    lattice = rv;
+    ssa_worklist_.push_back(instr);
+}
+
+void SparseConditionalConstantPropagationPass::VisitBranch(BasicBlock *block, Value *br) {
+    auto cond = LatticeOf(br->InputValue(0));
+    int64_t value = 0;
+    if (cond.kind == Lattice::kUnknown) {
+        return;
+    }
+    if (cond.kind == Lattice::kConstant && ConstantOf(cond.constant, &value)) {
+        MarkEdge(block, br->OutputControl(value ? 0 : 1));
+        return;
+    }
+    MarkEdge(block, br->OutputControl(0));
+    MarkEdge(block, br->OutputControl(1));
+}
+
+SparseConditionalConstantPropagationPass::Lattice SparseConditionalConstantPropagationPass::Evaluate(Value *instr) {
+    Lattice rv;
+    switch (instr->op()->value()) {
+        case Operator::kPhi: {
+            auto block = owners_[instr];
+            for (int i = 0; i < instr->op()->value_in(); i++) {
+                if (executable_edges_.find({instr->InputControl(i), block}) == executable_edges_.end()) {
+                    continue;
+                }
+                auto input = LatticeOf(instr->InputValue(i));
+                if (input.kind == Lattice::kUnknown) {
+                    continue;
+                }
+                if (input.kind == Lattice::kOverdefined ||
+                    (rv.kind == Lattice::kConstant && !IsSameConstant(rv.constant, input.constant))) {
+                    rv.kind = Lattice::kOverdefined;
+                    return rv;
+                }
+                rv = input;
+            }
+        } break;
+
+    #define DEFINE_CASE(name) case Operator::k##name:
+        DECLARE_IR_BINARY(DEFINE_CASE)
+        DECLARE_IR_COMPARISON(DEFINE_CASE)
+    #undef DEFINE_CASE
+        {
+            auto lhs = LatticeOf(instr->InputValue(0));
+            auto rhs = LatticeOf(instr->InputValue(1));
+            if (lhs.kind == Lattice::kOverdefined || rhs.kind == Lattice::kOverdefined) {
+                rv.kind = Lattice::kOverdefined;
+            } else if (lhs.kind == Lattice::kConstant && rhs.kind == Lattice::kConstant) {
+                rv.constant = ConstantsFoldingPass::FoldBinary(arena(), ops(), instr->op(), lhs.constant,
+                                                               rhs.constant);
+                rv.kind = rv.constant ? Lattice::kConstant : Lattice::kOverdefined;
+            }
+        } break;
+
+        default:
+            rv.kind = Lattice::kOverdefined;
+            break;
+    }
+    return rv;
+}
+
+SparseConditionalConstantPropagationPass::Lattice SparseConditionalConstantPropagationPass::LatticeOf(Value *value) {
+    if (owners_.find(value) != owners_.end()) {
+        return lattices_[value];
+    }
+    // Out of function: constants, arguments, global values, ...
+    Lattice rv;
+    if (value->op()->IsConstant()) {
+        rv.kind = Lattice::kConstant;
+        rv.constant = value;
+    } else {
+        rv.kind = Lattice::kOverdefined;
+    }
+    return rv;
+}
+
+void SparseConditionalConstantPropagationPass::MarkEdge(BasicBlock *from, BasicBlock *to) {
+    if (executable_edges_.insert({from, to}).second) {
+        flow_worklist_.push_back({from, to});
+    }
+}
+
+void SparseConditionalConstantPropagationPass::ReplaceConstants(Function *fun) {
+    for (auto blk : fun->blocks()) {
+        if (executable_.find(blk) == executable_.end()) {
+            continue;
+        }
+        for (auto instr : blk->instructions()) {
+            if (instr->IsDead() || instr->op()->IsConstant()) {
+                continue;
+            }
+            auto iter = lattices_.find(instr);
+            if (iter == lattices_.end() || iter->second.kind != Lattice::kConstant) {
+                continue;
+            }
+            instr->ReplaceUsesWith(arena(), iter->second.constant);
+            instr->KillWithInputs();
+            constants_++;
+        }
+    }
+}
+
+void SparseConditionalConstantPropagationPass::FoldBranches(Function *fun) {
+    for (auto blk : fun->blocks()) {
+        if (executable_.find(blk) == executable_.end() || blk->instructions().empty()) {
+            continue;
+        }
+        auto br = blk->instructions().back();
+        if (!IsConditionalBranch(br) || !br->InputValue(0)->op()->IsConstant()) {
+            continue;
+        }
+        int64_t value = 0;
+        if (!ConstantOf(br->InputValue(0), &value)) {
+            continue;
+        }
+        auto taken = br->OutputControl(value ? 0 : 1);
+        auto untaken = br->OutputControl(value ? 1 : 0);
+        br->KillWithInputs();
+        (*blk->mutable_instructions())[blk->instructions_size() - 1] =
+            Value::New(arena(), br->source_position(), Types::Void, ops()->Br(0/*value_in*/, 1/*control_out*/),
+                       taken);
+        if (untaken != taken) {
+            RemoveEdge(blk, untaken);
+        }
+        branches_folded_++;
+    }
+}
+
+void SparseConditionalConstantPropagationPass::RemoveUnreachableBlocks(Function *fun) {
+    std::vector<BasicBlock *> unreachable;
+    for (auto blk : fun->blocks()) {
+        if (executable_.find(blk) == executable_.end()) { unreachable.push_back(blk); }
+    }
+    for (auto blk : unreachable) {
+        const std::vector<BasicBlock *> outputs(blk->outputs().begin(), blk->outputs().end());
+        for (auto output : outputs) {
+            if (executable_.find(output) != executable_.end()) { RemoveEdge(blk, output); }
+        }
+    }
+    for (auto blk : unreachable) {
+        RemoveBlock(fun, blk);
+    }
+}
+
+// Before:
+//   block: ...; Br [succ]
+//   succ:  rest (succ has only one predecessor)
+// After:
+//   block: ...; rest
+bool SparseConditionalConstantPropagationPass::MergeBlocks(Function *fun) {
+    for (auto blk : fun->blocks()) {
+        if (blk->outputs_size() != 1 || blk->instructions().empty() || !IsJump(blk->instructions().back())) {
+            continue;
+        }
+        auto succ = blk->output(0);
+        if (succ == blk || succ == fun->entry() || succ->inputs_size() != 1) {
+            continue;
+        }
+        auto controls = std::count_if(blk->instructions().begin(), blk->instructions().end(), [](auto instr) {
+            return instr->IsAlive() && instr->op()->control_out() > 0;
+        });
+        if (controls != 1) {
+            continue;
+        }
+
+        blk->instructions().back()->Kill();
+        blk->mutable_instructions()->pop_back();
+        for (auto instr : succ->instructions()) {
+            if (instr->IsAlive() && instr->Is(Operator::kPhi)) {
+                instr->ReplaceUsesWith(arena(), instr->InputValue(0));
+                instr->KillWithInputs();
+            } else if (instr->IsAlive()) {
+                blk->mutable_instructions()->push_back(instr);
+            }
+        }
+        blk->RemovePhiUsersOfDeads();
+        for (auto user : succ->phi_node_users()) {
+            blk->mutable_phi_node_users()->push_back(user);
+        }
+
+        blk->mutable_outputs()->clear();
+        for (auto output : succ->outputs()) {
+            blk->mutable_outputs()->push_back(output);
+            std::replace(output->mutable_inputs()->begin(), output->mutable_inputs()->end(), succ, blk);
+            for (auto instr : output->instructions()) {
+                if (instr->IsDead() || instr->IsNot(Operator::kPhi)) {
+                    continue;
+                }
+                for (int i = 0; i < instr->op()->control_in(); i++) {
+                    if (instr->InputControl(i) == succ) { instr->SetInputControl(i, blk); }
+                }
+            }
+        }
+        succ->mutable_instructions()->clear();
+        succ->mutable_phi_node_users()->clear();
+        succ->mutable_inputs()->clear();
+        succ->mutable_outputs()->clear();
+        RemoveBlock(fun, succ);
+        return true;
+    }
+    return false;
+}
+
+// Before:
+//   pred:  ...; Br [..., block, ...]
+//   block: Br [target]
+// After:
+//   pred:  ...; Br [..., target, ...]
+bool SparseConditionalConstantPropagationPass::ThreadJumps(Function *fun) {
+    for (auto blk : fun->blocks()) {
+        if (blk == fun->entry() || blk->instructions_size() != 1 || !IsJump(blk->instruction(0)) ||
+            blk->inputs().empty()) {
+            continue;
+        }
+        auto target = blk->output(0);
+        if (target == blk) {
+            continue;
+        }
+        // The phis in target can not distinguish the threaded predecessors.
+        auto has_phi = std::any_of(target->instructions().begin(), target->instructions().end(), [](auto instr) {
+            return instr->IsAlive() && instr->Is(Operator::kPhi);
+        });
+        auto linked = std::any_of(blk->inputs().begin(), blk->inputs().end(), [target](auto pred) {
+            return pred->FindOutput(target) >= 0;
+        });
+        if (has_phi || linked) {
+            continue;
+        }
+
+        auto inputs = target->mutable_inputs();
+        inputs->erase(inputs->begin() + target->FindInput(blk));
+        for (auto pred : blk->inputs()) {
+            for (auto instr : pred->instructions()) {
+                for (int i = 0; instr->IsAlive() && i < instr->op()->control_out(); i++) {
+                    if (instr->OutputControl(i) == blk) { instr->SetOutputControl(i, target); }
+                }
+            }
+            std::replace(pred->mutable_outputs()->begin(), pred->mutable_outputs()->end(), blk, target);
+            if (target->FindInput(pred) < 0) { inputs->push_back(pred); }
+        }
+        blk->mutable_inputs()->clear();
+        blk->mutable_outputs()->clear();
+        RemoveBlock(fun, blk);
+        return true;
+    }
+    return false;
+}
+
+void SparseConditionalConstantPropagationPass::RemoveEdge(BasicBlock *from, BasicBlock *to) {
+    const int index = to->FindInput(from);
+    DCHECK(index >= 0);
+    const std::vector<Value *> instrs(to->instructions().begin(), to->instructions().end());
+    for (auto phi : instrs) {
+        if (phi->IsDead() || phi->IsNot(Operator::kPhi)) {
+            continue;
+        }
+        // Order of incoming values is not the order of inputs of block, find the one from `from'.
+        const int n = phi->op()->value_in();
+        int at = -1;
+        for (int i = 0; i < n; i++) {
+            if (phi->InputControl(i) == from) {
+                at = i;
+                break;
+            }
+        }
+        if (at < 0) {
+            continue;
+        }
+        if (n <= 2) {
+            // Only one incoming value left: the phi is not needed.
+            if (n == 2) { phi->ReplaceUsesWith(arena(), phi->InputValue(1 - at)); }
+            phi->KillWithInputs();
+            continue;
+        }
+
+        std::vector<Node *> inputs;
+        for (int i = 0; i < n; i++) {
+            if (i != at) { inputs.push_back(phi->InputValue(i)); }
+        }
+        for (int i = 0; i < n; i++) {
+            if (i != at) { inputs.push_back(phi->InputControl(i)); }
+        }
+        auto new_phi = to->NewNodeWithNodes(phi->name(), phi->source_position(), phi->type(), ops()->Phi(n - 1, n - 1),
+                                            inputs);
+        to->mutable_instructions()->pop_back();
+        (*to->mutable_instructions())[to->FindInstruction(phi)] = new_phi;
+        phi->ReplaceUsesWith(arena(), new_phi);
+        phi->KillWithInputs();
+    }
+    for (auto pred : to->inputs()) {
+        pred->RemovePhiUsersOfDeads();
+    }
+
+    to->mutable_inputs()->erase(to->mutable_inputs()->begin() + index);
+    auto outputs = from->mutable_outputs();
+    outputs->erase(std::find(outputs->begin(), outputs->end(), to));
+}
+
+void SparseConditionalConstantPropagationPass::RemoveBlock(Function *fun, BasicBlock *block) {
+    for (auto instr : block->instructions()) {
+        if (instr->IsAlive()) { instr->KillWithInputs(); }
+    }
+    block->mutable_instructions()->clear();
+    block->mutable_phi_node_users()->clear();
+    for (auto output : block->outputs()) {
+        auto inputs = output->mutable_inputs();
+        inputs->erase(std::remove(inputs->begin(), inputs->end(), block), inputs->end());
+    }
+    for (auto input : block->inputs()) {
+        auto outputs = input->mutable_outputs();
+        outputs->erase(std::remove(outputs->begin(), outputs->end(), block), outputs->end());
+    }
+    auto blocks = fun->mutable_blocks();
+    blocks->erase(std::find(blocks->begin(), blocks->end(), block));
+    blocks_removed_++;
+}
+
+} // namespace yalx::ir
@@ -0,0 +1,90 @@
+#pragma once
+#ifndef YALX_IR_PASS_SPARSE_CONDITIONAL_CONSTANT_PROPAGATION_H_
+#define YALX_IR_PASS_SPARSE_CONDITIONAL_CONSTANT_PROPAGATION_H_
+
+#include "ir/pass/pass.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <set>
+
+namespace yalx {
+
+namespace ir {
+
+// Sparse conditional constant propagation (Wegman & Zadeck) over the SSA graph, then clean up the CFG:
+//   - Values proven to be constant are replaced by the constants, `Phi' only merges the executable edges.
+//   - `Br' on a constant condition jumps to the taken target directly.
+//   - Blocks never executed are deleted, with their edges, phi inputs and `phi_node_users'.
+//   - A block is merged into its single predecessor if the predecessor jumps only to it, and the jumps to a block
+//     only has a `Br' are threaded to the target.
+// It should be run before instruction selection to give the smaller functions to register allocator.
+class SparseConditionalConstantPropagationPass : public Pass<SparseConditionalConstantPropagationPass> {
+public:
+    constexpr static const char kPassName[] = "sccp";
+    constexpr static const int kPassLevel = 1;
+
+    SparseConditionalConstantPropagationPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules,
+                                             cpl::SyntaxFeedback *feedback);
+
+    DEF_VAL_GETTER(int, constants);
+    DEF_VAL_GETTER(int, branches_folded);
+    DEF_VAL_GETTER(int, blocks_removed);
+
+    void RunModule(Module *module);
+    void RunFun(Function *fun);
+    void RunUdt(StructureModel *udt) { ForeachMethod(udt); }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(SparseConditionalConstantPropagationPass);
+private:
+    struct Lattice {
+        enum Kind {
+            kUnknown,
+            kConstant,
+            kOverdefined,
+        };
+        Kind kind = kUnknown;
+        Value *constant = nullptr;
+    }; // struct Lattice
+
+    using Edge = std::pair<BasicBlock *, BasicBlock *>;
+
+    void Propagate(Function *fun);
+    void VisitBlock(BasicBlock *block);
+    void Visit(Value *instr);
+    void VisitBranch(BasicBlock *block, Value *br);
+    Lattice Evaluate(Value *instr);
+    Lattice LatticeOf(Value *value);
+    void MarkEdge(BasicBlock *from, BasicBlock *to);
+
+    void ReplaceConstants(Function *fun);
+    void FoldBranches(Function *fun);
+    void RemoveUnreachableBlocks(Function *fun);
+    bool MergeBlocks(Function *fun);
+    bool ThreadJumps(Function *fun);
+    void RemoveEdge(BasicBlock *from, BasicBlock *to);
+    void RemoveBlock(Function *fun, BasicBlock *block);
+
+    static bool IsConditionalBranch(Value *instr) {
+        return instr->Is(Operator::kBr) && instr->op()->value_in() == 1 && instr->op()->control_out() == 2;
+    }
+    static bool IsJump(Value *instr) {
+        return instr->Is(Operator::kBr) && instr->op()->value_in() == 0 && instr->op()->control_out() == 1;
+    }
+
+    std::unordered_map<const Value *, BasicBlock *> owners_;
+    std::unordered_map<const Value *, Lattice> lattices_;
+    std::unordered_set<const BasicBlock *> executable_;
+    std::set<Edge> executable_edges_;
+    std::deque<Edge> flow_worklist_;
+    std::deque<Value *> ssa_worklist_;
+    int constants_ = 0;
+    int branches_folded_ = 0;
+    int blocks_removed_ = 0;
+}; // class SparseConditionalConstantPropagationPass
+
+} // namespace ir
+
+} // namespace yalx
+
+#endif // YALX_IR_PASS_SPARSE_CONDITIONAL_CONSTANT_PROPAGATION_H_
@@ -0,0 +1,230 @@
+#include "ir/pass/switch-lowering.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/operators-factory.h"
+#include "ir/runtime.h"
+#include "ir/utils.h"
+#include "ir/base-test.h"
+#include "runtime/object/yalx-string.h"
+#include "base/io.h"
+#include <gtest/gtest.h>
+
+namespace yalx {
+
+namespace ir {
+
+class SwitchLoweringPassTest : public ModuleTest {
+public:
+    Function *NewFun(Type param) { return ModuleTest::NewFun("foo", {param}, {Types::Int32}); }
+
+    // fun foo(a: i32): i32 {
+    //     when (a) { k0 -> 0 k1 -> 1 ... else -> -1 }
+    // }
+    Function *NewIntChain(const std::vector<int> &keys, bool phi = false) {
+        const SourcePosition ss = SourcePosition::Unknown();
+        auto fun = NewFun(Types::Int32);
+        auto a = fun->paramater(0);
+        std::vector<BasicBlock *> tests;
+        for (size_t i = 0; i < keys.size(); i++) {
+            tests.push_back(fun->NewBlock(String::New(arena(), "t" + std::to_string(i))));
+        }
+        auto otherwise = NewBlock(fun, "otherwise");
+        for (size_t i = 0; i < keys.size(); i++) {
+            auto target = fun->NewBlock(String::New(arena(), "c" + std::to_string(i)));
+            auto key = Value::New(arena(), ss, Types::Int32, ops()->I32Constant(keys[i]));
+            auto cond = tests[i]->NewNode(ss, Types::UInt8, ops()->ICmp(ICondition::eq), a, key);
+            auto next = i + 1 < keys.size() ? tests[i + 1] : otherwise;
+            Branch(tests[i], cond, target, next);
+            auto rv = Value::New(arena(), ss, Types::Int32, ops()->I32Constant(static_cast<int>(i)));
+            if (phi && i == 0) {
+                Goto(target, otherwise);
+            } else {
+                target->NewNode(ss, Types::Void, ops()->Ret(1), rv);
+            }
+        }
+        Value *rv = Value::New(arena(), ss, Types::Int32, ops()->I32Constant(-1));
+        if (phi) {
+            // otherwise: %rv = Phi(0 from c0, -1 from last test)
+            auto zero = Value::New(arena(), ss, Types::Int32, ops()->I32Constant(0));
+            rv = otherwise->NewNode(ss, Types::Int32, ops()->Phi(2, 2), zero, rv, otherwise->input(0),
+                                    otherwise->input(1));
+        }
+        otherwise->NewNode(ss, Types::Void, ops()->Ret(1), rv);
+        return fun;
+    }
+
+    static int CountOf(Function *fun, Operator::Value op) {
+        int n = 0;
+        for (auto blk : fun->blocks()) {
+            for (auto instr : blk->instructions()) {
+                n += instr->Is(op);
+            }
+        }
+        return n;
+    }
+}; // class SwitchLoweringPassTest
+
+TEST_F(SwitchLoweringPassTest, Sanity) {
+    auto fun = NewIntChain({3, 1, 2, 0, 4});
+    SwitchLoweringPass pass(arena(), ops(), &modules_, feedback());
+    pass.RunFun(fun);
+    EXPECT_EQ(1, pass.lowered());
+    EXPECT_EQ(1, pass.jump_tables());
+
+    constexpr static const char z[] = R"(fun foo(%0: i32): i32 {
+t0:
+    Switch void i32 %0, i32 0, i32 1, i32 2, i32 3, i32 4 out [c3:, c1:, c2:, c0:, c4:, otherwise:]
+otherwise:
+    Ret void i32 -1
+c0:
+    Ret void i32 0
+c1:
+    Ret void i32 1
+c2:
+    Ret void i32 2
+c3:
+    Ret void i32 3
+c4:
+    Ret void i32 4
+} // main:main.foo
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+    EXPECT_EQ(7, fun->blocks_size());
+    EXPECT_EQ(6, fun->entry()->outputs_size());
+    EXPECT_EQ(1, fun->block(1)->inputs_size());
+}
+
+TEST_F(SwitchLoweringPassTest, SparseCases) {
+    auto fun = NewIntChain({100, -7, 1000, 10000, 5});
+    SwitchLoweringPass pass(arena(), ops(), &modules_, feedback());
+    pass.RunFun(fun);
+    EXPECT_EQ(1, pass.lowered());
+    EXPECT_EQ(0, pass.jump_tables());
+    EXPECT_EQ(0, CountOf(fun, Operator::kSwitch));
+    // 5 leaves of `==' and 4 nodes of `<'
+    EXPECT_EQ(9, CountOf(fun, Operator::kICmp));
+    EXPECT_EQ(9, CountOf(fun, Operator::kBr));
+    for (auto blk : fun->blocks()) {
+        ASSERT_FALSE(blk->instructions().empty());
+        ASSERT_TRUE(blk->instructions().back()->op()->IsTerminator());
+    }
+    // Every case is reached by only one test
+    for (size_t i = 0; i < fun->blocks_size(); i++) {
+        auto blk = fun->block(i);
+        if (blk->name() && blk->name()->ToSlice()[0] == 'c') {
+            EXPECT_EQ(1, blk->inputs_size());
+        }
+    }
+}
+
+TEST_F(SwitchLoweringPassTest, MixedClusters) {
+    auto fun = NewIntChain({1, 2, 3, 4, 5, 500, 1000});
+    SwitchLoweringPass pass(arena(), ops(), &modules_, feedback());
+    pass.RunFun(fun);
+    EXPECT_EQ(1, pass.lowered());
+    EXPECT_EQ(1, pass.jump_tables());
+    EXPECT_EQ(1, CountOf(fun, Operator::kSwitch));
+    // 2 leaves of `==' and 2 nodes of `<'
+    EXPECT_EQ(4, CountOf(fun, Operator::kICmp));
+}
+
+TEST_F(SwitchLoweringPassTest, ShortChain) {
+    auto fun = NewIntChain({1, 2, 3});
+    auto before = PrintFun(fun);
+    SwitchLoweringPass pass(arena(), ops(), &modules_, feedback());
+    pass.RunFun(fun);
+    EXPECT_EQ(0, pass.lowered());
+    EXPECT_EQ(before, PrintFun(fun));
+}
+
+TEST_F(SwitchLoweringPassTest, OtherwiseWithPhi) {
+    auto fun = NewIntChain({0, 1, 2, 3}, true/*phi*/);
+    SwitchLoweringPass pass(arena(), ops(), &modules_, feedback());
+    pass.RunFun(fun);
+    ASSERT_EQ(1, pass.lowered());
+
+    // Landing block is placed before otherwise
+    auto otherwise = fun->block(2);
+    ASSERT_STREQ("otherwise", otherwise->name()->data());
+    ASSERT_EQ(2, otherwise->inputs_size());
+    auto phi = otherwise->instruction(0);
+    ASSERT_TRUE(phi->Is(Operator::kPhi));
+    // The edge from the last test is moved to the landing block
+    auto landing = phi->InputControl(1);
+    EXPECT_EQ(landing, otherwise->input(1));
+    EXPECT_EQ(fun->block(1), landing);
+    EXPECT_EQ(1, landing->outputs_size());
+    EXPECT_TRUE(landing->instructions().back()->Is(Operator::kBr));
+    EXPECT_EQ(1, landing->inputs_size()); // From the switch
+    EXPECT_EQ(1, landing->phi_node_users_size());
+    EXPECT_EQ(1, CountOf(fun, Operator::kSwitch));
+}
+
+TEST_F(SwitchLoweringPassTest, StringCases) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    auto fun = NewFun(Types::String);
+    auto s = fun->paramater(0);
+    static const char *kKeys[] = {"get", "put", "delete", "post", "head"};
+    constexpr auto n = arraysize(kKeys);
+    std::vector<BasicBlock *> tests;
+    for (size_t i = 0; i < n; i++) {
+        tests.push_back(fun->NewBlock(nullptr));
+    }
+    auto otherwise = fun->NewBlock(nullptr);
+    for (size_t i = 0; i < n; i++) {
+        auto target = fun->NewBlock(nullptr);
+        auto key = Value::New(arena(), ss, Types::String, ops()->StringConstant(String::New(arena(), kKeys[i])));
+        auto op = ops()->CallRuntime(1/*value_out*/, 2/*value_in*/, 0/*control_out*/, RuntimeLib::StringEQ);
+        auto cond = tests[i]->NewNode(ss, Types::UInt8, op, s, key);
+        auto next = i + 1 < n ? tests[i + 1] : otherwise;
+        Branch(tests[i], cond, target, next);
+        auto rv = Value::New(arena(), ss, Types::Int32, ops()->I32Constant(static_cast<int>(i)));
+        target->NewNode(ss, Types::Void, ops()->Ret(1), rv);
+    }
+    otherwise->NewNode(ss, Types::Void, ops()->Ret(1), Value::New(arena(), ss, Types::Int32, ops()->I32Constant(-1)));
+
+    SwitchLoweringPass pass(arena(), ops(), &modules_, feedback());
+    pass.RunFun(fun);
+    ASSERT_EQ(1, pass.lowered());
+    EXPECT_EQ(0, pass.jump_tables());
+
+    int hash_codes = 0, equals = 0;
+    for (auto blk : fun->blocks()) {
+        for (auto instr : blk->instructions()) {
+            if (!instr->Is(Operator::kCallRuntime)) {
+                continue;
+            }
+            auto id = OperatorWith<RuntimeId>::Data(instr);
+            hash_codes += (id == RuntimeLib::StringHashCode);
+            equals += (id == RuntimeLib::StringEQ);
+        }
+    }
+    EXPECT_EQ(1, hash_codes);
+    EXPECT_EQ(n, equals); // Only one comparing of strings per case
+    auto hash_code = fun->entry()->instruction(0);
+    ASSERT_TRUE(hash_code->Is(Operator::kCallRuntime));
+    EXPECT_TRUE(hash_code->type().IsUnsigned());
+    EXPECT_LE(1, otherwise->inputs_size());
+}
+
+TEST_F(SwitchLoweringPassTest, DuplicatedKey) {
+    // The second `1' is never matched, so the chain stops at it.
+    auto fun = NewIntChain({0, 1, 2, 1, 3, 4});
+    SwitchLoweringPass pass(arena(), ops(), &modules_, feedback());
+    pass.RunFun(fun);
+    EXPECT_EQ(0, pass.lowered());
+}
+
+TEST_F(SwitchLoweringPassTest, NonAsciiKeyHash) {
+    // Keys are hashed by the compiler, bytes must be unsigned as in the runtime of any target.
+    static const char kKey[] = "\xe4\xbd\xa0\xe5\xa5\xbd";
+    u32_t hash = 1315423911;
+    for (size_t i = 0; i < sizeof(kKey) - 1; i++) {
+        hash ^= ((hash << 5) + static_cast<uint8_t>(kKey[i]) + (hash >> 2));
+    }
+    EXPECT_EQ(hash, yalx_str_hash(kKey, sizeof(kKey) - 1));
+}
+
+} // namespace ir
+
+} // namespace yalx
@@ -0,0 +1,372 @@
+#include "ir/pass/switch-lowering.h"
+#include "ir/operators-factory.h"
+#include "ir/condition.h"
+#include "ir/runtime.h"
+#include "ir/metadata.h"
+#include "runtime/object/yalx-string.h"
+#include <algorithm>
+#include <map>
+#include <set>
+#include <unordered_set>
+
+namespace yalx::ir {
+
+SwitchLoweringPass::SwitchLoweringPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules,
+                                       cpl::SyntaxFeedback *feedback)
+: Pass<SwitchLoweringPass>(arena, ops, modules, feedback) {
+}
+
+void SwitchLoweringPass::RunModule(Module *module) {
+    ForeachUdt(module);
+    ForeachFunction(module);
+}
+
+void SwitchLoweringPass::RunFun(Function *fun) {
+    if (!fun->entry()) {
+        return;
+    }
+
+    const auto lowered = lowered_;
+    const std::vector<BasicBlock *> blocks(fun->blocks().begin(), fun->blocks().end());
+    std::unordered_set<BasicBlock *> removed;
+    for (auto blk : blocks) {
+        if (removed.find(blk) != removed.end() || ContinuesChain(blk)) {
+            continue;
+        }
+        Chain chain;
+        if (MatchChain(fun, blk, &chain)) {
+            removed.insert(chain.tests.begin(), chain.tests.end());
+            Lower(fun, &chain);
+            lowered_++;
+        }
+    }
+
+    if (lowered_ != lowered) {
+        fun->UpdateIdsOfBlocks();
+    }
+}
+
+bool SwitchLoweringPass::MatchChain(Function *fun, BasicBlock *head, Chain *chain) const {
+    Value *value = nullptr, *key = nullptr;
+    bool string = false;
+    if (!MatchTest(head, &value, &key, &string)) {
+        return false;
+    }
+    chain->value = value;
+    chain->string = string;
+    chain->head = head;
+
+    std::set<uint64_t> values;
+    std::set<std::string_view> strings;
+    for (auto block = head;;) {
+        auto br = block->instructions().back();
+        auto target = br->OutputControl(0);
+        auto next = br->OutputControl(1);
+        // Targets are reached only from its test, so edges of them are simply moved to the new tests.
+        if (target == next || target->inputs_size() != 1 || HasPhis(target)) {
+            break;
+        }
+        uint64_t bits = 0;
+        if (string) {
+            auto kz = OperatorWith<const String *>::Data(key)->ToSlice();
+            if (!strings.insert(kz).second) {
+                break; // Never matched
+            }
+        } else {
+            IntegralConstantOf(key, &bits);
+            if (!values.insert(bits).second) {
+                break;
+            }
+        }
+        if (block != head) {
+            chain->tests.push_back(block);
+        }
+        chain->cases.push_back({key, bits, target});
+        chain->otherwise = next;
+
+        Value *other = nullptr;
+        bool other_string = false;
+        if (next == fun->entry() || next->inputs_size() != 1 || next->instructions_size() != 2 ||
+            !MatchTest(next, &other, &key, &other_string) || other != value || other_string != string) {
+            break;
+        }
+        block = next;
+    }
+    return chain->cases.size() >= kMinCases;
+}
+
+void SwitchLoweringPass::Lower(Function *fun, Chain *chain) {
+    auto head = chain->head;
+    auto br = head->instructions().back();
+    const auto ss = br->source_position();
+    auto otherwise = NewLandingIfNeeded(fun, chain);
+
+    auto unlink = [](BasicBlock *from, BasicBlock *to) {
+        auto inputs = to->mutable_inputs();
+        inputs->erase(std::remove(inputs->begin(), inputs->end(), from), inputs->end());
+        auto outputs = from->mutable_outputs();
+        outputs->erase(std::remove(outputs->begin(), outputs->end(), to), outputs->end());
+    };
+    auto cond = br->InputValue(0);
+    unlink(head, br->OutputControl(0));
+    unlink(head, br->OutputControl(1));
+    br->KillWithInputs();
+    cond->KillWithInputs();
+    head->mutable_instructions()->pop_back();
+    head->mutable_instructions()->pop_back();
+    for (auto blk : chain->tests) {
+        const std::vector<BasicBlock *> outputs(blk->outputs().begin(), blk->outputs().end());
+        for (auto output : outputs) {
+            unlink(blk, output);
+        }
+        for (auto iter = blk->instructions().rbegin(); iter != blk->instructions().rend(); iter++) {
+            (*iter)->KillWithInputs();
+        }
+        blk->mutable_instructions()->clear();
+        auto blocks = fun->mutable_blocks();
+        blocks->erase(std::find(blocks->begin(), blocks->end(), blk));
+    }
+
+    last_ = head;
+    if (!chain->string) {
+        auto cases = chain->cases;
+        const auto is_signed = chain->value->type().IsSigned();
+        std::sort(cases.begin(), cases.end(), [is_signed](const Case &a, const Case &b) {
+            return is_signed ? static_cast<int64_t>(a.value) < static_cast<int64_t>(b.value) : a.value < b.value;
+        });
+        auto clusters = Clusterize(cases, chain->value->type().bits());
+        EmitTree(fun, head, chain->value, cases, clusters, 0, clusters.size(), otherwise);
+        return;
+    }
+
+    // Strings: dispatch on hash code, then check equality of the strings which have this hash code.
+    auto op = ops()->CallRuntime(1/*value_out*/, 1/*value_in*/, 0/*control_out*/, RuntimeLib::StringHashCode);
+    auto hash_code = head->NewNode(ss, Types::UInt32, op, chain->value);
+    std::map<uint32_t, std::vector<const Case *>> buckets;
+    for (const auto &kase : chain->cases) {
+        auto kz = OperatorWith<const String *>::Data(kase.key);
+        buckets[yalx_str_hash(kz->data(), kz->size())].push_back(&kase);
+    }
+    std::vector<Case> cases;
+    for (const auto &[hash, bucket] : buckets) {
+        auto entry = NewBlockAfter(fun);
+        auto blk = entry;
+        for (size_t i = 0; i < bucket.size(); i++) {
+            op = ops()->CallRuntime(1/*value_out*/, 2/*value_in*/, 0/*control_out*/, RuntimeLib::StringEQ);
+            auto eq = blk->NewNode(ss, Types::UInt8, op, chain->value, bucket[i]->key);
+            auto next = i + 1 < bucket.size() ? NewBlockAfter(fun) : otherwise;
+            blk->NewNode(ss, Types::Void, ops()->Br(1/*value_in*/, 2/*control_out*/), eq, bucket[i]->target, next);
+            blk->LinkTo(bucket[i]->target);
+            blk->LinkTo(next);
+            blk = next;
+        }
+        auto key = Value::New(arena(), ss, Types::UInt32, ops()->U32Constant(hash));
+        cases.push_back({key, hash, entry});
+    }
+    auto clusters = Clusterize(cases, 32);
+    EmitTree(fun, head, hash_code, cases, clusters, 0, clusters.size(), otherwise);
+}
+
+// The otherwise block is reached from all leaves of the new tests, if it has phi nodes, the edges from them are
+// merged by a landing block, so the phi nodes are kept.
+BasicBlock *SwitchLoweringPass::NewLandingIfNeeded(Function *fun, Chain *chain) {
+    auto otherwise = chain->otherwise;
+    if (!HasPhis(otherwise)) {
+        return otherwise;
+    }
+    auto last = chain->tests.empty() ? chain->head : chain->tests.back();
+    auto landing = fun->NewBlock(nullptr);
+    fun->MoveToAfterOf(last, landing);
+    landing->NewNode(last->instructions().back()->source_position(), Types::Void,
+                     ops()->Br(0/*value_in*/, 1/*control_out*/), otherwise);
+    for (auto instr : otherwise->instructions()) {
+        if (instr->IsNot(Operator::kPhi)) {
+            break;
+        }
+        for (int i = 0; i < instr->op()->control_in(); i++) {
+            if (instr->InputControl(i) == last) { instr->SetInputControl(i, landing); }
+        }
+    }
+    landing->mutable_phi_node_users()->assign(last->phi_node_users().begin(), last->phi_node_users().end());
+    last->mutable_phi_node_users()->clear();
+    auto inputs = otherwise->mutable_inputs();
+    std::replace(inputs->begin(), inputs->end(), last, landing);
+    landing->mutable_outputs()->push_back(otherwise);
+    auto outputs = last->mutable_outputs();
+    outputs->erase(std::remove(outputs->begin(), outputs->end(), otherwise), outputs->end());
+    return landing;
+}
+
+// Cases must be sorted by keys. Greedy: the longest dense run from a case is a cluster of table, otherwise the
+// case is a cluster by itself.
+std::vector<SwitchLoweringPass::Cluster> SwitchLoweringPass::Clusterize(const std::vector<Case> &cases,
+                                                                        int bits) const {
+    std::vector<Cluster> clusters;
+    for (size_t i = 0; i < cases.size();) {
+        size_t end = i + 1;
+        for (size_t j = i + kMinJumpTableCases; j <= cases.size(); j++) {
+            const auto range = cases[j - 1].value - cases[i].value;
+            if (range >= kMaxJumpTableSize) {
+                break;
+            }
+            if ((j - i) * 100 >= (range + 1) * kMinJumpTableDensity) {
+                end = j;
+            }
+        }
+        // Lowest key of table is an imm32 for backends.
+        const auto lowest = static_cast<int64_t>(cases[i].value);
+        const bool table = end - i >= kMinJumpTableCases && (bits < 64 || lowest == static_cast<int32_t>(lowest));
+        if (!table) {
+            end = i + 1;
+        }
+        clusters.push_back({i, end, table});
+        i = end;
+    }
+    return clusters;
+}
+
+// Before:
+//   block: ...
+// After:
+//   block: ...; Br (x < pivot) left, right
+//   left:  tests of clusters [lo, mid)
+//   right: tests of clusters [mid, hi)
+// A cluster is tested by `Switch x, keys...' for a table, or `Br (x == key)' for a single case.
+void SwitchLoweringPass::EmitTree(Function *fun, BasicBlock *block, Value *value, const std::vector<Case> &cases,
+                                  const std::vector<Cluster> &clusters, size_t lo, size_t hi,
+                                  BasicBlock *otherwise) {
+    DCHECK(lo < hi);
+    const auto ss = value->source_position();
+    if (hi - lo == 1) {
+        const auto &cluster = clusters[lo];
+        if (!cluster.table) {
+            const auto &kase = cases[cluster.begin];
+            auto cond = block->NewNode(ss, Types::UInt8, ops()->ICmp(ICondition::eq), value, kase.key);
+            block->NewNode(ss, Types::Void, ops()->Br(1/*value_in*/, 2/*control_out*/), cond, kase.target,
+                           otherwise);
+            block->LinkTo(kase.target);
+            block->LinkTo(otherwise);
+            return;
+        }
+
+        const auto n = static_cast<int>(cluster.end - cluster.begin);
+        std::vector<Node *> nodes{value};
+        for (auto i = cluster.begin; i < cluster.end; i++) {
+            nodes.push_back(cases[i].key);
+        }
+        for (auto i = cluster.begin; i < cluster.end; i++) {
+            nodes.push_back(cases[i].target);
+            block->LinkTo(cases[i].target);
+        }
+        nodes.push_back(otherwise);
+        block->LinkTo(otherwise);
+        block->NewNodeWithNodes(nullptr, ss, Types::Void, ops()->Switch(n), nodes);
+        jump_tables_++;
+        return;
+    }
+
+    const auto mid = lo + (hi - lo) / 2;
+    auto pivot = cases[clusters[mid].begin].key;
+    auto op = ops()->ICmp(value->type().IsSigned() ? ICondition::slt : ICondition::ult);
+    auto cond = block->NewNode(ss, Types::UInt8, op, value, pivot);
+    auto left = NewBlockAfter(fun);
+    auto right = NewBlockAfter(fun);
+    block->NewNode(ss, Types::Void, ops()->Br(1/*value_in*/, 2/*control_out*/), cond, left, right);
+    block->LinkTo(left);
+    block->LinkTo(right);
+    EmitTree(fun, left, value, cases, clusters, lo, mid, otherwise);
+    EmitTree(fun, right, value, cases, clusters, mid, hi, otherwise);
+}
+
+BasicBlock *SwitchLoweringPass::NewBlockAfter(Function *fun) {
+    auto blk = fun->NewBlock(nullptr);
+    fun->MoveToAfterOf(last_, blk);
+    last_ = blk;
+    return blk;
+}
+
+bool SwitchLoweringPass::MatchTest(BasicBlock *block, Value **value, Value **key, bool *string) {
+    const auto &instrs = block->instructions();
+    if (instrs.size() < 2) {
+        return false;
+    }
+    auto br = instrs.back();
+    auto cond = instrs[instrs.size() - 2];
+    if (br->IsNot(Operator::kBr) || br->op()->value_in() != 1 || br->op()->control_out() != 2 ||
+        br->InputValue(0) != cond || cond->users().size() != 1) {
+        return false;
+    }
+
+    if (cond->Is(Operator::kICmp)) {
+        if (OperatorWith<IConditionId>::Data(cond).value != IConditionId::k_eq) {
+            return false;
+        }
+        uint64_t bits = 0;
+        for (int i = 0; i < 2; i++) {
+            if (IntegralConstantOf(cond->InputValue(i), &bits) && !cond->InputValue(1 - i)->op()->IsConstant()) {
+                *key = cond->InputValue(i);
+                *value = cond->InputValue(1 - i);
+                *string = false;
+                return true;
+            }
+        }
+        return false;
+    }
+    if (cond->Is(Operator::kCallRuntime) && OperatorWith<RuntimeId>::Data(cond) == RuntimeLib::StringEQ &&
+        cond->op()->value_in() == 2 && cond->InputValue(1)->Is(Operator::kStringConstant) &&
+        !cond->InputValue(0)->op()->IsConstant()) {
+        *key = cond->InputValue(1);
+        *value = cond->InputValue(0);
+        *string = true;
+        return true;
+    }
+    return false;
+}
+
+bool SwitchLoweringPass::ContinuesChain(BasicBlock *block) {
+    if (block->inputs_size() != 1 || block->instructions_size() != 2) {
+        return false;
+    }
+    auto pred = block->input(0);
+    Value *value = nullptr, *key = nullptr, *other = nullptr;
+    bool string = false, other_string = false;
+    return MatchTest(block, &value, &key, &string) && MatchTest(pred, &other, &key, &other_string) &&
+           pred->instructions().back()->OutputControl(1) == block && value == other && string == other_string;
+}
+
+bool SwitchLoweringPass::IntegralConstantOf(Value *value, uint64_t *bits) {
+    switch (value->op()->value()) {
+        case Operator::kWord8Constant:
+        case Operator::kU8Constant:
+            *bits = OperatorWith<uint8_t>::Data(value);
+            return true;
+        case Operator::kWord16Constant:
+        case Operator::kU16Constant:
+            *bits = OperatorWith<uint16_t>::Data(value);
+            return true;
+        case Operator::kWord32Constant:
+        case Operator::kU32Constant:
+            *bits = OperatorWith<uint32_t>::Data(value);
+            return true;
+        case Operator::kWord64Constant:
+        case Operator::kU64Constant:
+            *bits = OperatorWith<uint64_t>::Data(value);
+            return true;
+        case Operator::kI8Constant:
+            *bits = static_cast<int64_t>(OperatorWith<int8_t>::Data(value));
+            return true;
+        case Operator::kI16Constant:
+            *bits = static_cast<int64_t>(OperatorWith<int16_t>::Data(value));
+            return true;
+        case Operator::kI32Constant:
+            *bits = static_cast<int64_t>(OperatorWith<int32_t>::Data(value));
+            return true;
+        case Operator::kI64Constant:
+            *bits = static_cast<int64_t>(OperatorWith<int64_t>::Data(value));
+            return true;
+        default:
+            return false;
+    }
+}
+
+} // namespace yalx::ir
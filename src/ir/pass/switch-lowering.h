@@ -0,0 +1,93 @@
+#pragma once
+#ifndef YALX_IR_PASS_SWITCH_LOWERING_H_
+#define YALX_IR_PASS_SWITCH_LOWERING_H_
+
+#include "ir/pass/pass.h"
+#include <vector>
+
+namespace yalx {
+
+namespace ir {
+
+// Lower the chains of equality tests on one value, generated for `when' (see `EmitEquals' of IR generator):
+//   b0: ...; Br (x == k0) t0, b1
+//   b1: Br (x == k1) t1, b2
+//   ...
+// Cases are sorted by keys and split into clusters: a dense cluster becomes a `Switch', which is lowered to a jump
+// table by backends, and a balanced tree of `<' tests picks the cluster. So a dispatch takes O(1) or O(log n) tests
+// instead of O(n).
+// Strings are dispatched on their cached hash codes by the same way, then checked by a single `StringEQ'.
+class SwitchLoweringPass : public Pass<SwitchLoweringPass> {
+public:
+    constexpr static const char kPassName[] = "switch-lowering";
+    constexpr static const int kPassLevel = 1;
+
+    // Shorter chains are cheap enough.
+    constexpr static const int kMinCases = 4;
+    // A cluster becomes a jump table if it has enough cases, and more than density percent of table are cases.
+    constexpr static const int kMinJumpTableCases = 4;
+    constexpr static const int kMinJumpTableDensity = 40;
+    // Backends take entries of a table as operands of one instruction.
+    constexpr static const int kMaxJumpTableSize = 128;
+
+    SwitchLoweringPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules,
+                       cpl::SyntaxFeedback *feedback);
+
+    DEF_VAL_GETTER(int, lowered);
+    DEF_VAL_GETTER(int, jump_tables);
+
+    void RunModule(Module *module);
+    void RunFun(Function *fun);
+    void RunUdt(StructureModel *udt) { ForeachMethod(udt); }
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(SwitchLoweringPass);
+private:
+    struct Case {
+        Value *key;
+        uint64_t value; // Bits of key, sign extended for signed types
+        BasicBlock *target;
+    }; // struct Case
+
+    // Cases in [begin, end)
+    struct Cluster {
+        size_t begin;
+        size_t end;
+        bool table;
+    }; // struct Cluster
+
+    struct Chain {
+        Value *value = nullptr;
+        bool string = false;
+        BasicBlock *head = nullptr;
+        std::vector<BasicBlock *> tests; // Blocks of tests after head
+        std::vector<Case> cases; // In order of tests
+        BasicBlock *otherwise = nullptr;
+    }; // struct Chain
+
+    bool MatchChain(Function *fun, BasicBlock *head, Chain *chain) const;
+    void Lower(Function *fun, Chain *chain);
+    BasicBlock *NewLandingIfNeeded(Function *fun, Chain *chain);
+    std::vector<Cluster> Clusterize(const std::vector<Case> &cases, int bits) const;
+    void EmitTree(Function *fun, BasicBlock *block, Value *value, const std::vector<Case> &cases,
+                  const std::vector<Cluster> &clusters, size_t lo, size_t hi, BasicBlock *otherwise);
+    BasicBlock *NewBlockAfter(Function *fun);
+
+    // Returns the value tested and the key, if the block ends with `Br (x == key)'.
+    static bool MatchTest(BasicBlock *block, Value **value, Value **key, bool *string);
+    // Is the block the false branch of a test on the same value?
+    static bool ContinuesChain(BasicBlock *block);
+    static bool IntegralConstantOf(Value *value, uint64_t *bits);
+    static bool HasPhis(BasicBlock *block) {
+        return !block->instructions().empty() && block->instructions().front()->Is(Operator::kPhi);
+    }
+
+    BasicBlock *last_ = nullptr; // New blocks are placed after it
+    int lowered_ = 0;
+    int jump_tables_ = 0;
+}; // class SwitchLoweringPass
+
+} // namespace ir
+
+} // namespace yalx
+
+#endif // YALX_IR_PASS_SWITCH_LOWERING_H_
@@ -0,0 +1,180 @@
+#include "ir/pass/tail-call-elimination.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/operators-factory.h"
+#include "ir/utils.h"
+#include "ir/base-test.h"
+#include "base/io.h"
+#include <gtest/gtest.h>
+
+namespace yalx {
+
+namespace ir {
+
+class TailCallEliminationPassTest : public ModuleTest {
+public:
+    Function *NewFun(const char *name, int params, int returns) {
+        return ModuleTest::NewFun(name, std::vector<Type>(params, Types::Int32), std::vector<Type>(returns, Types::Int32));
+    }
+
+    // fun sum(n: i32, acc: i32): i32 {
+    //     if (n == 0) { return acc }
+    //     return sum(n - 1, acc + n)
+    // }
+    Function *NewSum() {
+        const SourcePosition ss = SourcePosition::Unknown();
+        auto fun = NewFun("sum", 2, 1);
+        auto n = fun->paramater(0);
+        auto acc = fun->paramater(1);
+        auto entry = NewBlock(fun, "entry");
+        auto done = NewBlock(fun, "done");
+        auto next = NewBlock(fun, "next");
+        auto cond = entry->NewNode(ss, Types::UInt8, ops()->ICmp(ICondition::eq), n, I32(0));
+        Branch(entry, cond, done, next);
+        done->NewNode(ss, Types::Void, ops()->Ret(1), acc);
+        auto n1 = next->NewNode(ss, Types::Int32, ops()->Sub(), n, I32(1));
+        auto acc1 = next->NewNode(ss, Types::Int32, ops()->Add(), acc, n);
+        auto call = next->NewNode(ss, Types::Int32, ops()->CallDirectly(fun, 1/*value_out*/, 2/*value_in*/,
+                                                                        0/*control_out*/), n1, acc1);
+        next->NewNode(ss, Types::Void, ops()->Ret(1), call);
+        return fun;
+    }
+}; // class TailCallEliminationPassTest
+
+TEST_F(TailCallEliminationPassTest, Sanity) {
+    auto fun = NewSum();
+    ASSERT_NE(nullptr, TailCallEliminationPass::TailCallOf(fun->block(2)));
+    EXPECT_EQ(nullptr, TailCallEliminationPass::TailCallOf(fun->block(1)));
+
+    TailCallEliminationPass pass(arena(), ops(), &modules_, feedback());
+    pass.RunFun(fun);
+    EXPECT_EQ(1, pass.eliminated());
+
+    constexpr static const char z[] = R"(fun sum(%0: i32, %1: i32): i32 {
+entry:
+    Br void out [L1:]
+L1:
+    %2 = Phi i32 i32 %0, i32 %3 in [entry:, next:]
+    %4 = Phi i32 i32 %1, i32 %5 in [entry:, next:]
+    %6 = ICmp u8 i32 %2, i32 0 <eq>
+    Br void u8 %6 out [done:, next:]
+done:
+    Ret void i32 %4
+next:
+    %3 = Sub i32 i32 %2, i32 1
+    %5 = Add i32 i32 %4, i32 %2
+    Br void out [L1:]
+} // main:main.sum
+)";
+    EXPECT_EQ(z, PrintFun(fun));
+
+    auto header = fun->block(1);
+    EXPECT_EQ(2, header->inputs_size());
+    EXPECT_EQ(fun->entry(), header->input(0));
+    EXPECT_EQ(2, header->outputs_size());
+    EXPECT_EQ(1, fun->entry()->outputs_size());
+    EXPECT_EQ(2, fun->entry()->phi_node_users_size());
+    EXPECT_EQ(header, fun->block(2)->input(0));
+    EXPECT_EQ(header, fun->block(3)->input(0));
+    // Moving of arguments at the back edge
+    auto next = fun->block(3);
+    ASSERT_EQ(2, next->phi_node_users_size());
+    EXPECT_EQ(next->instruction(0), next->phi_node_user(0).dest);
+    EXPECT_EQ(next->instruction(1), next->phi_node_user(1).dest);
+    EXPECT_EQ(nullptr, TailCallEliminationPass::TailCallOf(next));
+}
+
+TEST_F(TailCallEliminationPassTest, ReturningVals) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    // fun foo(a: i32, b: i32): i32, i32 -> bar(b, a)
+    auto bar = NewFun("bar", 2, 2);
+    auto foo = NewFun("foo", 2, 2);
+    auto entry = NewBlock(foo, "entry");
+    auto call = entry->NewNode(ss, Types::Int32, ops()->CallDirectly(bar, 1/*value_out*/, 2/*value_in*/,
+                                                                     0/*control_out*/),
+                               foo->paramater(1), foo->paramater(0));
+    auto rv = entry->NewNode(ss, Types::Int32, ops()->ReturningVal(1), call);
+    auto ret = entry->NewNode(ss, Types::Void, ops()->Ret(2), call, rv);
+    EXPECT_EQ(call, TailCallEliminationPass::TailCallOf(entry));
+
+    // Not self-recursive: left to backends.
+    auto before = PrintFun(foo);
+    TailCallEliminationPass pass(arena(), ops(), &modules_, feedback());
+    pass.RunFun(foo);
+    EXPECT_EQ(0, pass.eliminated());
+    EXPECT_EQ(before, PrintFun(foo));
+
+    // Returning values are swapped: not a tail call.
+    ret->Replace(arena(), 0, call, rv);
+    ret->Replace(arena(), 1, rv, call);
+    EXPECT_EQ(nullptr, TailCallEliminationPass::TailCallOf(entry));
+}
+
+TEST_F(TailCallEliminationPassTest, NotTailCall) {
+    const SourcePosition ss = SourcePosition::Unknown();
+    // fun fact(n: i32): i32 = if (n == 0) 1 else n * fact(n - 1)
+    auto fun = NewFun("fact", 1, 1);
+    auto n = fun->paramater(0);
+    auto entry = NewBlock(fun, "entry");
+    auto done = NewBlock(fun, "done");
+    auto next = NewBlock(fun, "next");
+    auto zero = Value::New(arena(), ss, Types::Int32, ops()->I32Constant(0));
+    auto one = Value::New(arena(), ss, Types::Int32, ops()->I32Constant(1));
+    auto cond = entry->NewNode(ss, Types::UInt8, ops()->ICmp(ICondition::eq), n, zero);
+    Branch(entry, cond, done, next);
+    done->NewNode(ss, Types::Void, ops()->Ret(1), one);
+    auto n1 = next->NewNode(ss, Types::Int32, ops()->Sub(), n, one);
+    auto call = next->NewNode(ss, Types::Int32, ops()->CallDirectly(fun, 1/*value_out*/, 1/*value_in*/,
+                                                                    0/*control_out*/), n1);
+    auto mul = next->NewNode(ss, Types::Int32, ops()->Mul(), n, call);
+    next->NewNode(ss, Types::Void, ops()->Ret(1), mul);
+
+    TailCallEliminationPass pass(arena(), ops(), &modules_, feedback());
+    pass.RunFun(fun);
+    EXPECT_EQ(0, pass.eliminated());
+    EXPECT_EQ(3, fun->blocks_size());
+}
+
+// 33-ir-tail-call
+TEST_F(TailCallEliminationPassTest, FromProject) {
+    bool ok = false;
+    base::ArenaMap<std::string_view, Module *> modules(&arena_);
+    IRGen("tests/33-ir-tail-call", &modules, &ok);
+    ASSERT_TRUE(ok);
+    ASSERT_TRUE(modules.find("main:main") != modules.end());
+
+    TailCallEliminationPass pass(arena(), ops(), &modules, feedback());
+    pass.Run();
+    EXPECT_EQ(1, pass.eliminated());
+
+    auto sum = modules["main:main"]->FindFunOrNull("sum");
+    ASSERT_NE(nullptr, sum);
+    constexpr static const char z[] = R"(fun sum(%n: i32, %acc: i32): i32 {
+entry:
+    Br void out [L1:]
+L1:
+    %0 = Phi i32 i32 %n, i32 %1 in [entry:, L3:]
+    %2 = Phi i32 i32 %acc, i32 %3 in [entry:, L3:]
+    %4 = ICmp u8 i32 %0, i32 0 <eq>
+    Br void u8 %4 out [L2:, L3:]
+L2:
+    Ret void i32 %2
+    Br void out [L3:]
+L3:
+    %1 = Sub i32 i32 %0, i32 1
+    %3 = Add i32 i32 %2, i32 %0
+    Br void out [L1:]
+} // main:main.sum
+)";
+    EXPECT_EQ(z, PrintFun(sum));
+
+    // fact() is not a tail call, its calling is kept.
+    auto fact = modules["main:main"]->FindFunOrNull("fact");
+    ASSERT_NE(nullptr, fact);
+    EXPECT_EQ(3, fact->blocks_size());
+    EXPECT_TRUE(fact->block(2)->instruction(1)->Is(Operator::kCallDirectly));
+}
+
+} // namespace ir
+
+} // namespace yalx
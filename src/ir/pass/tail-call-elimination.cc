@@ -0,0 +1,182 @@
+#include "ir/pass/tail-call-elimination.h"
+#include "ir/operators-factory.h"
+#include "ir/metadata.h"
+#include <algorithm>
+
+namespace yalx::ir {
+
+TailCallEliminationPass::TailCallEliminationPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules,
+                                                 cpl::SyntaxFeedback *feedback)
+: Pass<TailCallEliminationPass>(arena, ops, modules, feedback) {
+}
+
+void TailCallEliminationPass::RunModule(Module *module) {
+    ForeachUdt(module);
+    ForeachFunction(module);
+}
+
+// Before:
+//   entry: ...
+//   b1: %0 = CallDirectly fun(%a', %b'); Ret %0
+// After:
+//   entry: Br header
+//   header: %a1 = Phi(%a, %a'); %b1 = Phi(%b, %b'); ...
+//   b1: Br header
+void TailCallEliminationPass::RunFun(Function *fun) {
+    // The entry must be the only block without predecessors, so the header is a new block.
+    if (!fun->entry() || fun->entry()->inputs_size() > 0) {
+        return;
+    }
+
+    std::vector<BasicBlock *> tails;
+    for (auto blk : fun->blocks()) {
+        auto call = TailCallOf(blk);
+        if (call && OperatorWith<Function *>::Data(call) == fun &&
+            call->op()->value_in() == static_cast<int>(fun->paramaters_size())) {
+            tails.push_back(blk);
+        }
+    }
+    if (tails.empty()) {
+        return;
+    }
+
+    auto entry = fun->entry();
+    auto header = NewLoopHeader(fun);
+    std::vector<std::vector<Value *>> args;
+    for (auto blk : tails) {
+        args.push_back(TurnToBackEdge(blk, header));
+    }
+
+    const auto n = static_cast<int>(tails.size() + 1);
+    std::vector<Value *> phis;
+    for (size_t i = 0; i < fun->paramaters_size(); i++) {
+        auto param = fun->paramater(i);
+        std::vector<Node *> nodes{param};
+        for (const auto &arg : args) {
+            nodes.push_back(arg[i]);
+        }
+        nodes.push_back(entry);
+        nodes.insert(nodes.end(), tails.begin(), tails.end());
+        auto phi = header->NewNodeWithNodes(nullptr, param->source_position(), param->type(), ops()->Phi(n, n),
+                                            nodes);
+        auto instrs = header->mutable_instructions();
+        instrs->pop_back();
+        instrs->insert(instrs->begin() + static_cast<ptrdiff_t>(i), phi);
+        phis.push_back(phi);
+    }
+
+    // All uses of parameters are replaced by the phi nodes, but the incoming ones from entry.
+    for (size_t i = 0; i < fun->paramaters_size(); i++) {
+        auto param = fun->paramater(i);
+        auto phi = phis[i];
+        for (auto [position, user] : param->GetUsers()) {
+            if (user == phi && position == 0) {
+                continue;
+            }
+            user->Replace(arena(), position, param, phi);
+            if (user->Is(Operator::kPhi)) {
+                for (auto &phi_user : *user->InputControl(position)->mutable_phi_node_users()) {
+                    if (phi_user.phi == user && phi_user.dest == param) { phi_user.dest = phi; }
+                }
+            }
+        }
+    }
+
+    eliminated_ += static_cast<int>(tails.size());
+    fun->UpdateIdsOfBlocks();
+}
+
+Value *TailCallEliminationPass::TailCallOf(BasicBlock *block) {
+    const auto &instrs = block->instructions();
+    if (instrs.empty() || instrs.back()->IsNot(Operator::kRet)) {
+        return nullptr;
+    }
+    auto ret = instrs.back();
+    auto i = instrs.size() - 1;
+    while (i > 0 && instrs[i - 1]->Is(Operator::kReturningVal)) {
+        i--;
+    }
+    if (i == 0) {
+        return nullptr;
+    }
+    auto call = instrs[i - 1];
+    // Calls in a try block are never tail calls: the landing pad must be reached.
+    if (call->IsNot(Operator::kCallDirectly) || call->op()->control_out() > 0) {
+        return nullptr;
+    }
+    for (auto j = i; j < instrs.size() - 1; j++) {
+        if (instrs[j]->InputValue(0) != call || OperatorWith<int>::Data(instrs[j]) != static_cast<int>(j - i + 1)) {
+            return nullptr;
+        }
+    }
+
+    auto prototype = OperatorWith<Function *>::Data(call)->prototype();
+    if (prototype->return_types_size() == 1 && prototype->return_type(0).kind() == Type::kVoid) {
+        const auto n = ret->op()->value_in();
+        return n == 0 || (n == 1 && ret->InputValue(0) == call) ? call : nullptr;
+    }
+    if (ret->op()->value_in() != static_cast<int>(prototype->return_types_size())) {
+        return nullptr;
+    }
+    for (int j = 0; j < ret->op()->value_in(); j++) {
+        auto expected = j == 0 ? call : instrs[i + j - 1];
+        if (ret->InputValue(j) != expected) {
+            return nullptr;
+        }
+    }
+    return call;
+}
+
+// Instructions and out edges of entry are moved to the header, then the entry just jumps to it.
+BasicBlock *TailCallEliminationPass::NewLoopHeader(Function *fun) {
+    auto entry = fun->entry();
+    auto header = fun->NewBlock(nullptr);
+    fun->MoveToAfterOf(entry, header);
+
+    header->mutable_instructions()->assign(entry->instructions().begin(), entry->instructions().end());
+    entry->mutable_instructions()->clear();
+    header->mutable_phi_node_users()->assign(entry->phi_node_users().begin(), entry->phi_node_users().end());
+    entry->mutable_phi_node_users()->clear();
+    for (auto succ : entry->outputs()) {
+        auto inputs = succ->mutable_inputs();
+        std::replace(inputs->begin(), inputs->end(), entry, header);
+        for (auto instr : succ->instructions()) {
+            if (instr->IsNot(Operator::kPhi)) {
+                break;
+            }
+            for (int i = 0; i < instr->op()->control_in(); i++) {
+                if (instr->InputControl(i) == entry) { instr->SetInputControl(i, header); }
+            }
+        }
+    }
+    header->mutable_outputs()->assign(entry->outputs().begin(), entry->outputs().end());
+    entry->mutable_outputs()->clear();
+
+    entry->NewNode(SourcePosition::Unknown(), Types::Void, ops()->Br(0/*value_in*/, 1/*control_out*/), header);
+    entry->LinkTo(header);
+    return header;
+}
+
+std::vector<Value *> TailCallEliminationPass::TurnToBackEdge(BasicBlock *block, BasicBlock *header) {
+    auto instrs = block->mutable_instructions();
+    auto ret = instrs->back();
+    const auto ss = ret->source_position();
+    ret->KillWithInputs();
+    auto i = instrs->size() - 1;
+    for (; instrs->at(i - 1)->Is(Operator::kReturningVal); i--) {
+        instrs->at(i - 1)->KillWithInputs();
+    }
+    auto call = instrs->at(i - 1);
+    std::vector<Value *> args;
+    for (int j = 0; j < call->op()->value_in(); j++) {
+        args.push_back(call->InputValue(j));
+    }
+    call->KillWithInputs();
+    block->RemoveDeads();
+
+    block->NewNode(ss, Types::Void, ops()->Br(0/*value_in*/, 1/*control_out*/), header);
+    block->LinkTo(header);
+    return args;
+}
+
+} // namespace yalx::ir
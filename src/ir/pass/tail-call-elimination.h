@@ -0,0 +1,49 @@
+#pragma once
+#ifndef YALX_IR_PASS_TAIL_CALL_ELIMINATION_H_
+#define YALX_IR_PASS_TAIL_CALL_ELIMINATION_H_
+
+#include "ir/pass/pass.h"
+#include <vector>
+
+namespace yalx {
+
+namespace ir {
+
+// A call is in tail position if its returning values are returned as they are:
+//   %0 = CallDirectly foo(...)
+//   %1 = ReturningVal %0 <1>
+//   Ret %0, %1
+// Self-recursive tail calls are rewritten to a loop: the parameters become phi nodes of a loop header, and the
+// arguments of the calls flow back to them. So a recursive walking runs in a constant stack.
+// Other tail calls are emitted as jumps by backends if the frames allow (see `InstructionSelector::VisitTailCall').
+class TailCallEliminationPass : public Pass<TailCallEliminationPass> {
+public:
+    constexpr static const char kPassName[] = "tail-call-elimination";
+    constexpr static const int kPassLevel = 1;
+
+    TailCallEliminationPass(base::Arena *arena, OperatorsFactory *ops, ModulesMap *modules,
+                            cpl::SyntaxFeedback *feedback);
+
+    DEF_VAL_GETTER(int, eliminated);
+
+    void RunModule(Module *module);
+    void RunFun(Function *fun);
+    void RunUdt(StructureModel *udt) { ForeachMethod(udt); }
+
+    // Returns the call in tail position of the block, or null if the block does not end with one.
+    static Value *TailCallOf(BasicBlock *block);
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(TailCallEliminationPass);
+private:
+    BasicBlock *NewLoopHeader(Function *fun);
+    // Replace the tail call by a jump to the loop header, returns arguments of the call.
+    std::vector<Value *> TurnToBackEdge(BasicBlock *block, BasicBlock *header);
+
+    int eliminated_ = 0;
+}; // class TailCallEliminationPass
+
+} // namespace ir
+
+} // namespace yalx
+
+#endif // YALX_IR_PASS_TAIL_CALL_ELIMINATION_H_
@@ -0,0 +1,202 @@
+#include "ir/profile.h"
+#include "ir/metadata.h"
+#include "ir/node.h"
+#include "ir/operator.h"
+#include "base/env.h"
+#include "base/io.h"
+#include <inttypes.h>
+#include <algorithm>
+
+namespace yalx::ir {
+
+namespace {
+
+std::vector<std::string_view> SplitWords(std::string_view line) {
+    std::vector<std::string_view> words;
+    size_t i = 0;
+    while (i < line.size()) {
+        while (i < line.size() && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r')) { i++; }
+        auto begin = i;
+        while (i < line.size() && line[i] != ' ' && line[i] != '\t' && line[i] != '\r') { i++; }
+        if (i > begin) {
+            words.push_back(line.substr(begin, i - begin));
+        }
+    }
+    return words;
+}
+
+bool ParseCount(std::string_view word, uint64_t *value) {
+    if (word.empty()) {
+        return false;
+    }
+    uint64_t n = 0;
+    for (auto c : word) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        n = n * 10 + (c - '0');
+    }
+    *value = n;
+    return true;
+}
+
+} // namespace
+
+uint64_t Profile::Site::total() const {
+    uint64_t n = 0;
+    for (const auto &receiver : receivers) { n += receiver.count; }
+    return n;
+}
+
+const Profile::Receiver *Profile::Site::dominant() const {
+    const Receiver *most = nullptr;
+    for (const auto &receiver : receivers) {
+        if (receiver.clazz != kOthersName && (!most || receiver.count > most->count)) {
+            most = &receiver;
+        }
+    }
+    return most;
+}
+
+base::Status Profile::Load(const std::string &file_name, Profile *profile) {
+    std::unique_ptr<base::SequentialFile> file;
+    if (auto rs = base::Env::NewSequentialFile(file_name, &file); rs.fail()) {
+        return rs;
+    }
+    size_t size = 0;
+    if (auto rs = file->Available(&size); rs.fail()) {
+        return rs;
+    }
+    std::string_view text;
+    std::string scratch;
+    if (auto rs = file->Read(size, &text, &scratch); rs.fail()) {
+        return rs;
+    }
+    return profile->Parse(text);
+}
+
+base::Status Profile::Parse(std::string_view text) {
+    FunctionProfile *fun = nullptr;
+    while (!text.empty()) {
+        auto pos = text.find('\n');
+        auto line = text.substr(0, pos);
+        text = pos == std::string_view::npos ? std::string_view{} : text.substr(pos + 1);
+
+        auto words = SplitWords(line);
+        if (words.empty()) {
+            continue;
+        }
+        if (words[0] == "fun") {
+            if (words.size() != 2) {
+                return ERR_CORRUPTION("Bad profile function record");
+            }
+            fun = Add(words[1]);
+        } else if (words[0] == "blocks") {
+            if (!fun) {
+                return ERR_CORRUPTION("Profile blocks record out of function");
+            }
+            fun->blocks.clear();
+            for (size_t i = 1; i < words.size(); i++) {
+                uint64_t count = 0;
+                if (!ParseCount(words[i], &count)) {
+                    return ERR_CORRUPTION("Bad profile block count");
+                }
+                fun->blocks.push_back(count);
+            }
+        } else if (words[0] == "site") {
+            uint64_t index = 0;
+            if (!fun || words.size() < 2 || words.size() % 2 != 0 || !ParseCount(words[1], &index)) {
+                return ERR_CORRUPTION("Bad profile site record");
+            }
+            auto site = &fun->sites[static_cast<int>(index)];
+            site->receivers.clear();
+            for (size_t i = 2; i < words.size(); i += 2) {
+                uint64_t count = 0;
+                if (!ParseCount(words[i + 1], &count)) {
+                    return ERR_CORRUPTION("Bad profile receiver count");
+                }
+                site->receivers.push_back({std::string(words[i]), count});
+            }
+        } else {
+            return ERR_CORRUPTION("Unknown profile record");
+        }
+    }
+    return base::Status::OK();
+}
+
+std::string Profile::ToString() const {
+    std::string buf;
+    auto file = base::NewMemoryWritableFile(&buf);
+    base::PrintingWriter printer(file, true/*ownership*/);
+    for (const auto &[name, fun] : funs_) {
+        printer.Println("fun %s", name.c_str());
+        printer.Write("blocks");
+        for (auto count : fun.blocks) {
+            printer.Print(" %" PRIu64, count);
+        }
+        printer.Writeln();
+        for (const auto &[index, site] : fun.sites) {
+            printer.Print("site %d", index);
+            for (const auto &receiver : site.receivers) {
+                printer.Print(" %s %" PRIu64, receiver.clazz.c_str(), receiver.count);
+            }
+            printer.Writeln();
+        }
+    }
+    return buf;
+}
+
+const Profile::FunctionProfile *Profile::FindOrNull(std::string_view name) const {
+    auto iter = funs_.find(name);
+    return iter == funs_.end() ? nullptr : &iter->second;
+}
+
+int Profile::Annotate(const base::ArenaMap<std::string_view, Module *> &modules) {
+    int annotated = 0;
+    for (auto [name, module] : modules) {
+        for (auto fun : module->funs()) {
+            annotated += Annotate(fun);
+        }
+        for (auto udt : module->structures()) {
+            for (auto method : udt->methods()) {
+                if (method.fun->owns() == module) {
+                    annotated += Annotate(method.fun);
+                }
+            }
+        }
+    }
+    return annotated;
+}
+
+bool Profile::Annotate(Function *fun) {
+    auto profile = FindOrNull(fun->full_name()->ToSlice());
+    if (!profile || profile->blocks.size() != fun->blocks_size()) {
+        return false; // Stale profile: the function was changed.
+    }
+
+    int index = 0;
+    for (size_t i = 0; i < fun->blocks_size(); i++) {
+        auto block = fun->block(i);
+        block->set_frequency(static_cast<int64_t>(profile->blocks[i]));
+        for (auto instr : block->instructions()) {
+            if (!IsProfilingSite(instr)) {
+                continue;
+            }
+            if (auto iter = profile->sites.find(index++); iter != profile->sites.end()) {
+                receivers_[instr] = &iter->second;
+            }
+        }
+    }
+    return true;
+}
+
+const Profile::Site *Profile::ReceiversOf(const Value *call) const {
+    auto iter = receivers_.find(call);
+    return iter == receivers_.end() ? nullptr : iter->second;
+}
+
+bool Profile::IsProfilingSite(const Value *instr) {
+    return instr->Is(Operator::kCallVirtual) || instr->Is(Operator::kCallAbstract);
+}
+
+} // namespace yalx::ir
@@ -0,0 +1,80 @@
+#pragma once
+#ifndef YALX_IR_PROFILE_H_
+#define YALX_IR_PROFILE_H_
+
+#include "base/arena-utils.h"
+#include "base/status.h"
+#include "base/base.h"
+#include <unordered_map>
+#include <string_view>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace yalx::ir {
+
+class Module;
+class Function;
+class Value;
+
+// Execution profile written by the runtime of an instrumented build (see `ProfileInstrumentationPass'), and read by
+// the next build to drive inlining, devirtualization and block layout. The text format, one record per line:
+//   fun <function full name>
+//   blocks <count of block 0> <count of block 1> ...
+//   site <index of virtual call site> <class full name> <count> <class full name> <count> ... [* <count of others>]
+// Counters are indexed by position of blocks and virtual call sites in the function when it was instrumented, so the
+// profile must be applied to the same IR: right after generating, before any other pass.
+class Profile {
+public:
+    static constexpr const char kOthersName[] = "*";
+
+    struct Receiver {
+        std::string clazz; // Full name of class, `kOthersName' for all of unrecorded classes.
+        uint64_t count;
+    }; // struct Receiver
+
+    struct Site {
+        std::vector<Receiver> receivers;
+
+        [[nodiscard]] uint64_t total() const;
+        // The most frequent receiver which is not the others, nullptr if none.
+        [[nodiscard]] const Receiver *dominant() const;
+    }; // struct Site
+
+    struct FunctionProfile {
+        std::vector<uint64_t> blocks;
+        std::map<int, Site> sites;
+    }; // struct FunctionProfile
+
+    Profile() = default;
+
+    static base::Status Load(const std::string &file_name, Profile *profile);
+
+    base::Status Parse(std::string_view text);
+    [[nodiscard]] std::string ToString() const;
+
+    FunctionProfile *Add(std::string_view name) { return &funs_[std::string(name)]; }
+    [[nodiscard]] const FunctionProfile *FindOrNull(std::string_view name) const;
+
+    // Set frequencies of blocks and record receivers of virtual call sites for functions (and methods) in profile.
+    // Returns number of annotated functions, a function is skipped if its blocks do not match the profile.
+    int Annotate(const base::ArenaMap<std::string_view, Module *> &modules);
+    bool Annotate(Function *fun);
+
+    // Receivers of an annotated virtual call site, nullptr if unknown.
+    [[nodiscard]] const Site *ReceiversOf(const Value *call) const;
+
+    [[nodiscard]] bool empty() const { return funs_.empty(); }
+
+    // `CallVirtual' and `CallAbstract' record classes of receivers.
+    static bool IsProfilingSite(const Value *instr);
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(Profile);
+private:
+    std::map<std::string, FunctionProfile, std::less<>> funs_;
+    std::unordered_map<const Value *, const Site *> receivers_;
+}; // class Profile
+
+} // namespace yalx::ir
+
+#endif // YALX_IR_PROFILE_H_
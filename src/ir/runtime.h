@@ -16,6 +16,7 @@ namespace ir {
     V(StringLE) \
     V(StringGT) \
     V(StringGE) \
+    V(StringHashCode) \
     V(Raise)
 
 
@@ -30,6 +31,9 @@ struct RuntimeId {
         return {code};
     }
     
+    bool operator == (const RuntimeId &other) const { return value == other.value; }
+    bool operator != (const RuntimeId &other) const { return !operator == (other); }
+    
     const char *ToString() const;
     
     const Value value;
@@ -32,3 +32,81 @@ TEST_F(HashTableTest, StringKey) {
     ASSERT_EQ(2, *static_cast<int *>(yalx_get_string_key(&htable_, "ok").value));
     ASSERT_EQ(-1, *static_cast<int *>(yalx_get_string_key(&htable_, "fail").value));
 }
+
+TEST_F(HashTableTest, PutGetRemove) {
+    static constexpr int kN = 1000;
+    char key[64];
+    for (int i = 0; i < kN; i++) {
+        snprintf(key, sizeof(key), i % 2 ? "k.%d" : "yalx/lang:lang.long-key.%d", i);
+        *static_cast<int *>(yalx_put_string_key(&htable_, key, sizeof(int)).value) = i;
+    }
+    ASSERT_EQ(kN, htable_.size);
+    for (int i = 0; i < kN; i += 2) {
+        snprintf(key, sizeof(key), i % 2 ? "k.%d" : "yalx/lang:lang.long-key.%d", i);
+        yalx_remove_string_key(&htable_, key);
+    }
+    ASSERT_EQ(kN / 2, htable_.size);
+    for (int i = 0; i < kN; i++) {
+        snprintf(key, sizeof(key), i % 2 ? "k.%d" : "yalx/lang:lang.long-key.%d", i);
+        auto span = yalx_get_string_key(&htable_, key);
+        if (i % 2) {
+            ASSERT_TRUE(span.value != nullptr) << key;
+            ASSERT_EQ(i, *static_cast<int *>(span.value));
+        } else {
+            ASSERT_TRUE(span.value == nullptr) << key;
+        }
+    }
+}
+
+TEST_F(HashTableTest, GrowingValue) {
+    auto span = yalx_put_string_key(&htable_, "ok", 4);
+    ASSERT_EQ(4, span.size);
+    *static_cast<int *>(span.value) = 1;
+    span = yalx_put_string_key(&htable_, "ok", 64);
+    ASSERT_EQ(64, span.size);
+    ASSERT_EQ(1, *static_cast<int *>(span.value));
+    span = yalx_put_string_key(&htable_, "ok", 8);
+    ASSERT_EQ(64, span.size);
+}
+
+TEST_F(HashTableTest, RehashFactor) {
+    hash_table table;
+    yalx_init_hash_table(&table, 0.5f);
+    ASSERT_NEAR(1.1, table.rehash_factor, 0.001);
+    yalx_free_hash_table(&table);
+    yalx_init_hash_table(&table, 1.2f);
+    ASSERT_NEAR(1.2, table.rehash_factor, 0.001);
+    yalx_free_hash_table(&table);
+
+    // The minimum rehash factor grows at a load factor of 0.875
+    char key[16];
+    for (int i = 0; i < 3; i++) {
+        snprintf(key, sizeof(key), "k.%d", i);
+        yalx_put_string_key(&htable_, key, sizeof(int));
+    }
+    ASSERT_EQ(2, htable_.capacity_shift);
+    yalx_put_string_key(&htable_, "k.3", sizeof(int));
+    ASSERT_EQ(3, htable_.capacity_shift);
+    for (int i = 0; i < 4; i++) {
+        snprintf(key, sizeof(key), "k.%d", i);
+        ASSERT_TRUE(yalx_get_string_key(&htable_, key).value != nullptr) << key;
+    }
+
+    // 57 keys in 64 slots: over 0.875, but not over 0.9375
+    hash_table dense;
+    yalx_init_hash_table(&dense, 4.0f);
+    yalx_init_hash_table(&table, 1.1f);
+    for (int i = 0; i < 57; i++) {
+        snprintf(key, sizeof(key), "k.%d", i);
+        yalx_put_string_key(&dense, key, sizeof(int));
+        yalx_put_string_key(&table, key, sizeof(int));
+    }
+    EXPECT_EQ(6, dense.capacity_shift);
+    EXPECT_EQ(7, table.capacity_shift);
+    for (int i = 0; i < 57; i++) {
+        snprintf(key, sizeof(key), "k.%d", i);
+        ASSERT_TRUE(yalx_get_string_key(&dense, key).value != nullptr) << key;
+    }
+    yalx_free_hash_table(&dense);
+    yalx_free_hash_table(&table);
+}
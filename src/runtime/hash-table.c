@@ -2,161 +2,493 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#if defined(YALX_ARCH_X64)
+#include <emmintrin.h>
+#endif
+#if defined(YALX_ARCH_ARM64)
+#include <arm_neon.h>
+#endif
 
-#define hash_table_capacity(map) (1 << (map)->capacity_shift)
-//#define hash_table_slot_index(map, hash_code) ((hash_code) & ((1 << ((map)->capacity_shift)) - 1))
-//#define hash_table_slot_at(map, hash_code) (&(map)->slots[hash_table_slot_index(map, hash_code)])
+// Control bytes:
+// EMPTY    = 0b10000000
+// DELETED  = 0b11111110
+// SENTINEL = 0b11111111, lanes out of capacity in a table smaller than one group
+// FULL     = 0b0hhhhhhh, lowest 7 bits of hash code
+#define CTRL_EMPTY    ((int8_t)-128)
+#define CTRL_DELETED  ((int8_t)-2)
+#define CTRL_SENTINEL ((int8_t)-1)
+
+#define MIN_CAPACITY_SHIFT 2
+#define GROUP_WIDTH_SHIFT 4
+#define MIGRATING_GROUPS_PER_STEP 2
+
+// Open addressing can not hold more than one key per slot, so the rehash factor (keys per bucket of the chained table)
+// is mapped to a load factor in [MIN_LOAD_LIMIT, MAX_LOAD_LIMIT] that the table grows at.
+#define MIN_REHASH_FACTOR 1.1f
+#define MIN_LOAD_LIMIT 0.875f
+#define MAX_LOAD_LIMIT 0.9375f
+
+#define hash_table_capacity(shift) (1 << (shift))
+// A table smaller than one group still has one group of control bytes
+#define hash_table_groups(shift) ((shift) < GROUP_WIDTH_SHIFT ? 1 : hash_table_capacity(shift) / HASH_TABLE_GROUP_WIDTH)
+#define hash_table_ctrl_size(shift) (hash_table_groups(shift) * HASH_TABLE_GROUP_WIDTH)
+
+#define H1(hash_code) ((hash_code) >> 7)
+#define H2(hash_code) ((int8_t)((hash_code) & 0x7f))
 
 static const hash_table_value_span_t hash_table_value = {NULL, 0};
 
-static inline size_t hash_table_key_placement_size(size_t key_size, size_t value_size) {
-    size_t header_size = sizeof(struct hash_table_slot) + key_size;
-    header_size = ROUND_UP(header_size, 4);
-    return header_size + value_size;
+//----------------------------------------------------------------------------------------------------------------------
+// Group probing
+//----------------------------------------------------------------------------------------------------------------------
+#if defined(YALX_ARCH_X64)
+
+typedef uint32_t group_mask_t;
+#define GROUP_MASK_SHIFT 0 // 1 bit per lane
+#define GROUP_LANE_MASK 0x1u
+
+static inline group_mask_t group_match(const int8_t *ctrl, int8_t h2) {
+    const __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return (group_mask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(h2)));
 }
 
-static inline hash_table_value_span_t hash_table_key_value(struct hash_table_slot *node) {
-    hash_table_value_span_t span;
-    span.value = &node->key[(ROUND_UP(node->key_size, 4))];
-    span.size  = node->value_size;
-    return span;
+static inline group_mask_t group_match_empty_or_deleted(const int8_t *ctrl) {
+    // Only EMPTY and DELETED has sign bit
+    return (group_mask_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+}
+
+#elif defined(YALX_ARCH_ARM64)
+
+typedef uint64_t group_mask_t;
+#define GROUP_MASK_SHIFT 2 // 4 bits per lane
+#define GROUP_LANE_MASK 0xfull
+
+static inline group_mask_t neon_movemask(uint8x16_t matched) {
+    const uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(matched), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+
+static inline group_mask_t group_match(const int8_t *ctrl, int8_t h2) {
+    return neon_movemask(vceqq_s8(vld1q_s8(ctrl), vdupq_n_s8(h2)));
+}
+
+static inline group_mask_t group_match_empty_or_deleted(const int8_t *ctrl) {
+    return neon_movemask(vcltzq_s8(vld1q_s8(ctrl)));
+}
+
+#else
+
+typedef uint32_t group_mask_t;
+#define GROUP_MASK_SHIFT 0
+#define GROUP_LANE_MASK 0x1u
+
+static inline group_mask_t group_match(const int8_t *ctrl, int8_t h2) {
+    group_mask_t mask = 0;
+    for (int i = 0; i < HASH_TABLE_GROUP_WIDTH; i++) {
+        mask |= (group_mask_t)(ctrl[i] == h2) << i;
+    }
+    return mask;
 }
 
+static inline group_mask_t group_match_empty_or_deleted(const int8_t *ctrl) {
+    group_mask_t mask = 0;
+    for (int i = 0; i < HASH_TABLE_GROUP_WIDTH; i++) {
+        mask |= (group_mask_t)(ctrl[i] < 0) << i;
+    }
+    return mask;
+}
+
+#endif
+
+static inline group_mask_t group_match_empty(const int8_t *ctrl) { return group_match(ctrl, CTRL_EMPTY); }
+
+// Lanes in capacity of the table
+static inline group_mask_t group_mask_of_capacity(int capacity_shift) {
+    if (capacity_shift >= GROUP_WIDTH_SHIFT) {
+        return ~(group_mask_t)0;
+    }
+    return ((group_mask_t)1 << (hash_table_capacity(capacity_shift) << GROUP_MASK_SHIFT)) - 1;
+}
+
+static inline int group_mask_lowest(group_mask_t mask) {
+    assert(mask != 0);
+#if defined(YALX_USE_GCC) || defined(YALX_USE_CLANG)
+    return __builtin_ctzll((unsigned long long)mask) >> GROUP_MASK_SHIFT;
+#else
+    int i = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        i++;
+    }
+    return i >> GROUP_MASK_SHIFT;
+#endif
+}
+
+static inline group_mask_t group_mask_clear(group_mask_t mask, int lane) {
+    return mask & ~((group_mask_t)GROUP_LANE_MASK << (lane << GROUP_MASK_SHIFT));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Slots
+//----------------------------------------------------------------------------------------------------------------------
 static uint32_t js_hash(const char *p, size_t n) {
     int hash = 1315423911;
     for (const char *s = p; s < p + n; s++) {
         hash ^= ((hash << 5) + (*s) + (hash >> 2));
     }
-    return hash;
+    // Final mixing: H1 and H2 both need well distributed bits
+    uint32_t h = (uint32_t)hash;
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+static inline const char *slot_key(const struct hash_table_slot *slot) {
+    return slot->key_size > HASH_TABLE_INLINE_KEY_SIZE ? slot->key.outline_key : slot->key.inline_key;
+}
+
+static inline void *slot_value(struct hash_table_slot *slot) {
+    return slot->value_size > HASH_TABLE_INLINE_VALUE_SIZE ? slot->value.outline_value : slot->value.inline_value;
 }
 
-static inline struct hash_table_slot *new_hash_table_key(const void *key,
-                                                         size_t key_size,
-                                                         size_t value_size) {
-    size_t size_in_bytes = hash_table_key_placement_size(key_size, value_size);
-    struct hash_table_slot *slot = malloc(size_in_bytes);
-    if (!slot) {
-        return NULL;
+static inline hash_table_value_span_t slot_value_span(struct hash_table_slot *slot) {
+    hash_table_value_span_t span;
+    span.value = slot_value(slot);
+    span.size  = slot->value_size;
+    return span;
+}
+
+static inline int slot_key_equals(const struct hash_table_slot *slot, uint32_t hash_code, const void *key,
+                                  size_t key_size) {
+    return slot->hash_code == hash_code && slot->key_size == key_size && memcmp(slot_key(slot), key, key_size) == 0;
+}
+
+static inline int init_slot(struct hash_table_slot *slot, uint32_t hash_code, const void *key, size_t key_size,
+                            size_t value_size) {
+    slot->hash_code = hash_code;
+    slot->key_size = (uint32_t)key_size;
+    slot->value_size = (uint32_t)value_size;
+    slot->reserved0 = 0;
+    if (key_size > HASH_TABLE_INLINE_KEY_SIZE) {
+        slot->key.outline_key = (char *)malloc(key_size);
+        if (!slot->key.outline_key) {
+            return -1;
+        }
+    }
+    memcpy((void *)slot_key(slot), key, key_size);
+    if (value_size > HASH_TABLE_INLINE_VALUE_SIZE) {
+        slot->value.outline_value = malloc(value_size);
+        if (!slot->value.outline_value) {
+            if (key_size > HASH_TABLE_INLINE_KEY_SIZE) {
+                free(slot->key.outline_key);
+            }
+            return -1;
+        }
+    }
+    dbg_init_zag(slot_value(slot), value_size);
+    return 0;
+}
+
+static inline void free_slot(struct hash_table_slot *slot) {
+    if (slot->key_size > HASH_TABLE_INLINE_KEY_SIZE) {
+        free(slot->key.outline_key);
+    }
+    if (slot->value_size > HASH_TABLE_INLINE_VALUE_SIZE) {
+        free(slot->value.outline_value);
     }
-    dbg_init_zag(slot, size_in_bytes);
-    slot->next = slot;
-    slot->prev = slot;
-    slot->hash_code = js_hash(key, key_size);
-    slot->key_size = (int)key_size;
-    slot->value_size = (int)value_size;
-    memcpy(slot->key, key, key_size);
-    return slot;
 }
 
-static inline struct hash_table_slot *hash_table_slot_at_hash_code(struct hash_table *map, uint32_t hash_code) {
-    const size_t index = hash_code & ((1 << (map->capacity_shift)) - 1);
+static int grow_slot_value(struct hash_table_slot *slot, size_t value_size) {
+    if (value_size <= HASH_TABLE_INLINE_VALUE_SIZE) {
+        slot->value_size = (uint32_t)value_size; // Still in inline value
+        return 0;
+    }
+    void *value = NULL;
+    if (slot->value_size > HASH_TABLE_INLINE_VALUE_SIZE) {
+        value = realloc(slot->value.outline_value, value_size);
+        if (!value) {
+            return -1;
+        }
+    } else {
+        value = malloc(value_size);
+        if (!value) {
+            return -1;
+        }
+        memcpy(value, slot->value.inline_value, slot->value_size);
+    }
+    slot->value.outline_value = value;
+    slot->value_size = (uint32_t)value_size;
+    return 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Probing
+//----------------------------------------------------------------------------------------------------------------------
+static struct hash_table_slot *find_slot(int8_t *ctrl, struct hash_table_slot *slots, int capacity_shift,
+                                         uint32_t hash_code, const void *key, size_t key_size) {
+    const size_t mask = hash_table_groups(capacity_shift) - 1;
+    size_t group = H1(hash_code) & mask;
+    // Triangular probing visits all groups when number of groups is power of 2
+    for (size_t step = 1; step <= mask + 1; step++) {
+        const size_t base = group * HASH_TABLE_GROUP_WIDTH;
+        for (group_mask_t matched = group_match(ctrl + base, H2(hash_code)); matched != 0;) {
+            const int lane = group_mask_lowest(matched);
+            struct hash_table_slot *slot = &slots[base + lane];
+            if (slot_key_equals(slot, hash_code, key, key_size)) {
+                return slot;
+            }
+            matched = group_mask_clear(matched, lane);
+        }
+        if (group_match_empty(ctrl + base)) {
+            return NULL;
+        }
+        group = (group + step) & mask;
+    }
+    return NULL;
+}
+
+static size_t find_insert_position(const int8_t *ctrl, int capacity_shift, uint32_t hash_code) {
+    const size_t mask = hash_table_groups(capacity_shift) - 1;
+    size_t group = H1(hash_code) & mask;
+    for (size_t step = 1;; step++) {
+        const size_t base = group * HASH_TABLE_GROUP_WIDTH;
+        const group_mask_t available = group_match_empty_or_deleted(ctrl + base) &
+                                       group_mask_of_capacity(capacity_shift);
+        if (available) {
+            return base + group_mask_lowest(available);
+        }
+        assert(step <= mask + 1 && "No available slots");
+        group = (group + step) & mask;
+    }
+}
+
+static inline void erase_slot(struct hash_table *map, size_t index) {
+    // If there's any empty in this group, probing sequences never went across this group.
+    const size_t base = index & ~((size_t)HASH_TABLE_GROUP_WIDTH - 1);
+    if (group_match_empty(map->ctrl + base)) {
+        map->ctrl[index] = CTRL_EMPTY;
+    } else {
+        map->ctrl[index] = CTRL_DELETED;
+        map->tombstones++;
+    }
+}
+
+static int alloc_slots(int capacity_shift, int8_t **ctrl, struct hash_table_slot **slots) {
+    const size_t capacity = hash_table_capacity(capacity_shift);
+    const size_t ctrl_size = hash_table_ctrl_size(capacity_shift);
+    *ctrl = (int8_t *)malloc(ctrl_size);
+    *slots = (struct hash_table_slot *)malloc(capacity * sizeof(struct hash_table_slot));
+    if (!*ctrl || !*slots) {
+        free(*ctrl);
+        free(*slots);
+        *ctrl = NULL;
+        *slots = NULL;
+        return -1;
+    }
+    memset(*ctrl, CTRL_EMPTY, capacity);
+    memset(*ctrl + capacity, CTRL_SENTINEL, ctrl_size - capacity);
+    return 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Resizing
+//----------------------------------------------------------------------------------------------------------------------
+static inline struct hash_table_slot *move_slot_to(struct hash_table *map, const struct hash_table_slot *slot) {
+    const size_t index = find_insert_position(map->ctrl, map->capacity_shift, slot->hash_code);
+    if (map->ctrl[index] == CTRL_DELETED) {
+        map->tombstones--;
+    }
+    map->ctrl[index] = H2(slot->hash_code);
+    memcpy(&map->slots[index], slot, sizeof(*slot));
     return &map->slots[index];
 }
 
-static inline struct hash_table_slot *hash_table_slot_at(struct hash_table *map, const void *key, size_t len) {
-    return hash_table_slot_at_hash_code(map, js_hash(key, len));
+static void finish_migrating(struct hash_table *map) {
+    free(map->old_ctrl);
+    free(map->old_slots);
+    map->old_ctrl = NULL;
+    map->old_slots = NULL;
+    map->old_capacity_shift = 0;
+    map->migrated_groups = 0;
 }
 
-static void rehash_if_needed(struct hash_table *map) {
-    const float rate = ((float)map->size) / ((float)hash_table_capacity(map));
-    if (rate <= map->rehash_factor) {
+static void migrate_groups(struct hash_table *map, int n) {
+    if (!map->old_ctrl) {
         return;
     }
-    struct hash_table_slot **linear_nodes = (struct hash_table_slot **)malloc(map->size * sizeof(struct hash_table_slot *));
-    int k = 0;
-    for (int j = 0; j < hash_table_capacity(map); j++){
-        struct hash_table_slot *slot = &map->slots[j];
-        while (!QUEUE_EMPTY(slot)) {
-            struct hash_table_slot *node = slot->next;
-            linear_nodes[k++] = node;
-            QUEUE_REMOVE(node);
-            //free(node);
+    const int n_groups = hash_table_groups(map->old_capacity_shift);
+    for (int i = 0; i < n && map->migrated_groups < n_groups; i++, map->migrated_groups++) {
+        const size_t base = (size_t)map->migrated_groups * HASH_TABLE_GROUP_WIDTH;
+        for (size_t j = base; j < base + HASH_TABLE_GROUP_WIDTH; j++) {
+            if (map->old_ctrl[j] < 0) { // EMPTY, DELETED or SENTINEL
+                continue;
+            }
+            move_slot_to(map, &map->old_slots[j]);
+            // Keep probing sequences of the old slots
+            map->old_ctrl[j] = CTRL_DELETED;
         }
     }
-    map->capacity_shift++;
-    map->slots = (struct hash_table_slot *)realloc(map->slots,
-                                                   hash_table_capacity(map) * sizeof(struct hash_table_slot));
-    for (int j = 0; j < hash_table_capacity(map); j++) {
-        struct hash_table_slot *slot = &map->slots[j];
-        slot->next = slot;
-        slot->prev = slot;
+    if (map->migrated_groups >= n_groups) {
+        finish_migrating(map);
+    }
+}
+
+static void rehash_in_place(struct hash_table *map) {
+    int8_t *ctrl = map->ctrl;
+    struct hash_table_slot *slots = map->slots;
+    if (alloc_slots(map->capacity_shift, &map->ctrl, &map->slots) < 0) {
+        map->ctrl = ctrl;
+        map->slots = slots;
+        return;
+    }
+    map->tombstones = 0;
+    for (size_t i = 0; i < hash_table_capacity(map->capacity_shift); i++) {
+        if (ctrl[i] >= 0) {
+            move_slot_to(map, &slots[i]);
+        }
+    }
+    free(ctrl);
+    free(slots);
+}
+
+// 1.1 -> 0.875, 1.5 -> 0.908, 2.2 and above -> 0.9375
+static inline float load_limit(float rehash_factor) {
+    const float limit = 1.0f - (1.0f - MIN_LOAD_LIMIT) * MIN_REHASH_FACTOR / rehash_factor;
+    return limit > MAX_LOAD_LIMIT ? MAX_LOAD_LIMIT : limit;
+}
+
+static void rehash_if_needed(struct hash_table *map) {
+    const float capacity = (float)hash_table_capacity(map->capacity_shift);
+    if ((float)(map->size + map->tombstones + 1) <= capacity * load_limit(map->rehash_factor)) {
+        return;
+    }
+    // Too many tombstones: just cleanup
+    if (!map->old_ctrl && map->tombstones > map->size / 2) {
+        rehash_in_place(map);
+        return;
+    }
+    if (map->old_ctrl) {
+        migrate_groups(map, hash_table_groups(map->old_capacity_shift)); // Finish last resizing
     }
-    for (int i = 0; i < k; i++) {
-        struct hash_table_slot *node = linear_nodes[i];
-        struct hash_table_slot *slot = hash_table_slot_at_hash_code(map, node->hash_code);
-        QUEUE_INSERT_TAIL(slot, node);
+
+    int8_t *ctrl = NULL;
+    struct hash_table_slot *slots = NULL;
+    if (alloc_slots(map->capacity_shift + 1, &ctrl, &slots) < 0) {
+        return;
     }
-    free(linear_nodes);
+    map->old_ctrl = map->ctrl;
+    map->old_slots = map->slots;
+    map->old_capacity_shift = map->capacity_shift;
+    map->migrated_groups = 0;
+    map->ctrl = ctrl;
+    map->slots = slots;
+    map->capacity_shift++;
+    map->tombstones = 0;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+// APIs
+//----------------------------------------------------------------------------------------------------------------------
 void yalx_init_hash_table(struct hash_table *map, float rehash_factor) {
-    //assert(rehash_factor > 0);
     map->size = 0;
-    map->capacity_shift = 2;
-    map->rehash_factor = rehash_factor < 1.1 ? 1.1 : rehash_factor;
-    map->slots = (struct hash_table_slot *)malloc(hash_table_capacity(map) * sizeof(struct hash_table_slot));
-    if (map->slots) {
-        for (int i = 0; i < hash_table_capacity(map); i++) {
-            struct hash_table_slot *slot = &map->slots[i];
-            slot->prev = slot;
-            slot->next = slot;
-            slot->key_size   = 0;
-            slot->value_size = 0;
-        }
-    }
+    map->capacity_shift = MIN_CAPACITY_SHIFT;
+    map->rehash_factor = rehash_factor < MIN_REHASH_FACTOR ? MIN_REHASH_FACTOR : rehash_factor;
+    map->tombstones = 0;
+    map->old_capacity_shift = 0;
+    map->migrated_groups = 0;
+    map->old_ctrl = NULL;
+    map->old_slots = NULL;
+    alloc_slots(map->capacity_shift, &map->ctrl, &map->slots);
 }
 
 void yalx_free_hash_table(struct hash_table *map) {
-    for (int i = 0; i < hash_table_capacity(map); i++) {
-        struct hash_table_slot *slot = &map->slots[i];
-        while (slot->next != slot) {
-            struct hash_table_slot *key = slot->next;
-            QUEUE_REMOVE(key);
-            free(key);
+    if (map->ctrl) {
+        for (size_t i = 0; i < hash_table_capacity(map->capacity_shift); i++) {
+            if (map->ctrl[i] >= 0) {
+                free_slot(&map->slots[i]);
+            }
+        }
+    }
+    if (map->old_ctrl) {
+        for (size_t i = 0; i < hash_table_capacity(map->old_capacity_shift); i++) {
+            if (map->old_ctrl[i] >= 0) {
+                free_slot(&map->old_slots[i]);
+            }
         }
     }
+    finish_migrating(map);
+    free(map->ctrl);
     free(map->slots);
+    map->ctrl = NULL;
     map->slots = NULL;
+    map->size = 0;
+    map->tombstones = 0;
 }
 
 hash_table_value_span_t yalx_hash_table_put(struct hash_table *map, const void *key, size_t key_size, size_t value_size) {
-    struct hash_table_slot *const slot = hash_table_slot_at(map, key, key_size);
-    for (struct hash_table_slot *node = slot->next; node != slot; node = node->next) {
-        if (node->key_size == key_size && memcmp(node->key, key, key_size) == 0) {
-            if (node->value_size >= value_size) {
-                return hash_table_key_value(node);
-            }
-            QUEUE_REMOVE(node);
-            node = realloc(node, hash_table_key_placement_size(key_size, value_size));
-            QUEUE_INSERT_HEAD(slot, node);
-            return hash_table_key_value(node);
+    migrate_groups(map, MIGRATING_GROUPS_PER_STEP);
+
+    const uint32_t hash_code = js_hash(key, key_size);
+    struct hash_table_slot *slot = find_slot(map->ctrl, map->slots, map->capacity_shift, hash_code, key, key_size);
+    if (!slot && map->old_ctrl) {
+        struct hash_table_slot *old = find_slot(map->old_ctrl, map->old_slots, map->old_capacity_shift, hash_code,
+                                                key, key_size);
+        if (old) {
+            // Move it to new slots first
+            slot = move_slot_to(map, old);
+            map->old_ctrl[old - map->old_slots] = CTRL_DELETED;
         }
     }
-    struct hash_table_slot *node = new_hash_table_key(key, key_size, value_size);
-    QUEUE_INSERT_HEAD(slot, node);
-    map->size++;
+    if (slot) {
+        if (slot->value_size < value_size && grow_slot_value(slot, value_size) < 0) {
+            return hash_table_value;
+        }
+        return slot_value_span(slot);
+    }
+
     rehash_if_needed(map);
-    return hash_table_key_value(node);
+    const size_t index = find_insert_position(map->ctrl, map->capacity_shift, hash_code);
+    slot = &map->slots[index];
+    if (init_slot(slot, hash_code, key, key_size, value_size) < 0) {
+        return hash_table_value;
+    }
+    if (map->ctrl[index] == CTRL_DELETED) {
+        map->tombstones--;
+    }
+    map->ctrl[index] = H2(hash_code);
+    map->size++;
+    return slot_value_span(slot);
 }
 
 hash_table_value_span_t yalx_hash_table_get(struct hash_table *map, const void *key, size_t len) {
-    struct hash_table_slot *const slot = hash_table_slot_at(map, key, len);
-    for (struct hash_table_slot *node = slot->next; node != slot; node = node->next) {
-        if (node->key_size == len && memcmp(node->key, key, len) == 0) {
-            return hash_table_key_value(node);
-        }
+    const uint32_t hash_code = js_hash(key, len);
+    struct hash_table_slot *slot = find_slot(map->ctrl, map->slots, map->capacity_shift, hash_code, key, len);
+    if (!slot && map->old_ctrl) {
+        slot = find_slot(map->old_ctrl, map->old_slots, map->old_capacity_shift, hash_code, key, len);
     }
-    return hash_table_value;
+    return !slot ? hash_table_value : slot_value_span(slot);
 }
 
 void yalx_hash_table_remove(struct hash_table *map, const void *key, size_t len) {
-    struct hash_table_slot *const slot = hash_table_slot_at(map, key, len);
-    for (struct hash_table_slot *node = slot->next; node != slot; node = node->next) {
-        if (node->key_size == len && memcmp(node->key, key, len) == 0) {
-            QUEUE_REMOVE(node);
-            free(node);
+    migrate_groups(map, MIGRATING_GROUPS_PER_STEP);
+
+    const uint32_t hash_code = js_hash(key, len);
+    struct hash_table_slot *slot = find_slot(map->ctrl, map->slots, map->capacity_shift, hash_code, key, len);
+    if (slot) {
+        free_slot(slot);
+        erase_slot(map, slot - map->slots);
+        map->size--;
+        return;
+    }
+    if (map->old_ctrl) {
+        slot = find_slot(map->old_ctrl, map->old_slots, map->old_capacity_shift, hash_code, key, len);
+        if (slot) {
+            free_slot(slot);
+            map->old_ctrl[slot - map->old_slots] = CTRL_DELETED;
             map->size--;
-            break;
         }
     }
 }
@@ -8,13 +8,30 @@
 extern "C" {
 #endif
 
+// Swiss-table style open-addressing hash table:
+// Control bytes are probed by groups (SSE2/NEON if possible), short keys and values are inlined into the slots,
+// removed slots become tombstones, and growing is incremental: the old slots will be migrated step by step in
+// the following put/remove calls.
+//
+// NOTICE: The returned value span is only valid until the next put/remove call on the same table.
+
+#define HASH_TABLE_GROUP_WIDTH        16
+#define HASH_TABLE_INLINE_KEY_SIZE    32
+#define HASH_TABLE_INLINE_VALUE_SIZE  16
+
 struct hash_table_slot {
-    struct hash_table_slot *prev;
-    struct hash_table_slot *next;
     uint32_t hash_code;
-    int key_size;
-    int value_size;
-    char key[1];
+    uint32_t key_size;
+    uint32_t value_size;
+    uint32_t reserved0;
+    union {
+        char inline_key[HASH_TABLE_INLINE_KEY_SIZE];
+        char *outline_key;
+    } key;
+    union {
+        uint64_t inline_value[HASH_TABLE_INLINE_VALUE_SIZE / sizeof(uint64_t)];
+        void *outline_value;
+    } value;
 };
 
 typedef struct hash_table_value_span {
@@ -25,8 +42,15 @@ typedef struct hash_table_value_span {
 struct hash_table {
     int size;     // size of key-pairs
     int capacity_shift; // capacity of slots
-    float rehash_factor;
+    float rehash_factor; // at least 1.1 as the chained table, larger one grows later: at a load factor of 0.875~0.9375
+    int tombstones; // number of deleted slots
+    int8_t *ctrl;
     struct hash_table_slot *slots;
+    // Incremental resizing:
+    int old_capacity_shift;
+    int migrated_groups;
+    int8_t *old_ctrl;
+    struct hash_table_slot *old_slots;
 };
 
 void yalx_init_hash_table(struct hash_table *map, float rehash_factor);
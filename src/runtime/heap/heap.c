@@ -147,6 +147,23 @@ static f64_t fast_boxing_f64_table[] = {
     1.0,
 };
 
+int boxing_cache_high = BOXING_CACHE_DEFAULT_HIGH;
+
+static void boxing_number_pool_final(struct boxing_number_pool *pool) {
+    free(pool->i16_values);
+    free(pool->u16_values);
+    free(pool->i32_values);
+    free(pool->u32_values);
+    free(pool->i64_values);
+    free(pool->u64_values);
+    pool->i16_values = NULL;
+    pool->u16_values = NULL;
+    pool->i32_values = NULL;
+    pool->u32_values = NULL;
+    pool->i64_values = NULL;
+    pool->u64_values = NULL;
+}
+
 static int boxing_number_pool_init(struct heap *h, struct boxing_number_pool *pool) {
     pool->bool_values[0] = yalx_new_small_boxing_number(h, Bool_class);
     pool->bool_values[1] = yalx_new_small_boxing_number(h, Bool_class);
@@ -160,24 +177,44 @@ static int boxing_number_pool_init(struct heap *h, struct boxing_number_pool *po
         pool->i8_values[i] = yalx_new_small_boxing_number(h, I8_class);
         pool->i8_values[i]->box.i8 = ((int8_t)(i - 128));
     }
-    for (int i = 0; i < 201; i++) {
+
+    pool->low = BOXING_CACHE_LOW;
+    pool->high = boxing_cache_high < INT8_MAX ? INT8_MAX : boxing_cache_high;
+    pool->high = pool->high > BOXING_CACHE_MAX_HIGH ? BOXING_CACHE_MAX_HIGH : pool->high;
+    pool->unsigned_high = pool->high - pool->low;
+    const int n_signed = pool->high - pool->low + 1;
+    const int n_unsigned = pool->unsigned_high + 1;
+    pool->i16_values = MALLOC_N(struct yalx_value_number_l *, n_signed);
+    pool->u16_values = MALLOC_N(struct yalx_value_number_l *, n_unsigned);
+    pool->i32_values = MALLOC_N(struct yalx_value_number_l *, n_signed);
+    pool->u32_values = MALLOC_N(struct yalx_value_number_l *, n_unsigned);
+    pool->i64_values = MALLOC_N(struct yalx_value_number_w *, n_signed);
+    pool->u64_values = MALLOC_N(struct yalx_value_number_w *, n_unsigned);
+    if (!pool->i16_values || !pool->u16_values || !pool->i32_values || !pool->u32_values || !pool->i64_values ||
+        !pool->u64_values) {
+        boxing_number_pool_final(pool);
+        return -1;
+    }
+
+    for (int i = 0; i < n_signed; i++) {
+        pool->i16_values[i] = yalx_new_small_boxing_number(h, I16_class);
+        pool->i16_values[i]->box.i16 = ((int16_t)(i + pool->low));
+        
+        pool->i32_values[i] = yalx_new_small_boxing_number(h, I32_class);
+        pool->i32_values[i]->box.i32 = i + pool->low;
+        
+        pool->i64_values[i] = yalx_new_big_boxing_number(h, I64_class);
+        pool->i64_values[i]->box.i64 = i + pool->low;
+    }
+    for (int i = 0; i < n_unsigned; i++) {
         pool->u16_values[i] = yalx_new_small_boxing_number(h, U16_class);
         pool->u16_values[i]->box.u32 = i;
         
-        pool->i16_values[i] = yalx_new_small_boxing_number(h, I16_class);
-        pool->i16_values[i]->box.i16 = ((int16_t)(i - 100));
-        
         pool->u32_values[i] = yalx_new_small_boxing_number(h, U32_class);
         pool->u32_values[i]->box.u32 = i;
         
-        pool->i32_values[i] = yalx_new_small_boxing_number(h, I32_class);
-        pool->i32_values[i]->box.i32 = i - 100;
-        
         pool->u64_values[i] = yalx_new_big_boxing_number(h, U64_class);
         pool->u64_values[i]->box.u64 = i;
-        
-        pool->i64_values[i] = yalx_new_big_boxing_number(h, I64_class);
-        pool->i64_values[i]->box.i64 = i - 100;
     }
     
     for (int i = 0; i < arraysize(fast_boxing_f32_table); i++) {
@@ -284,6 +321,9 @@ struct string_pool_entry *string_pool_ensure_space(struct string_pool *pool, con
 
 int yalx_init_heap(gc_t gc, size_t max_heap_in_bytes, struct heap **receiver) {
     assert(*receiver == NULL); // Make sure has not init.
+#if defined(YALX_COMPACT_HEADER)
+    yalx_class_table_init();
+#endif
 
     switch (gc) {
         case GC_NONE: {
@@ -335,7 +375,9 @@ int yalx_init_heap(gc_t gc, size_t max_heap_in_bytes, struct heap **receiver) {
         string_pool_init(&(*receiver)->kpool_stripes[i], 4);
     }
     
-    boxing_number_pool_init((*receiver), &(*receiver)->fast_boxing_numbers);
+    if (boxing_number_pool_init((*receiver), &(*receiver)->fast_boxing_numbers) < 0) {
+        return -1;
+    }
     yalx_mutex_init(&(*receiver)->mutex);
     return 0;
 }
@@ -348,6 +390,7 @@ void yalx_free_heap(struct heap *h) {
     for (int i = 0; i < KPOOL_STRIPES_SIZE; i++) {
         string_pool_free(&h->kpool_stripes[i]);
     }
+    boxing_number_pool_final(&h->fast_boxing_numbers);
 
     free(h);
 }
@@ -361,7 +404,7 @@ struct allocate_result yalx_heap_allocate(struct heap *h, const struct yalx_clas
     memset(rv.object, 0, size);
     rv.object->refs = 0;
     rv.object->tags = 0;
-    rv.object->klass = (uintptr_t)klass;
+    SET_CLASS(rv.object, klass);
     rv.status = ALLOCATE_OK;
     return rv;
 }
@@ -384,24 +427,28 @@ struct string_pool_entry *yalx_ensure_space_kpool(struct heap *h, const char *z,
 
 void yalx_heap_visit_root(struct heap *h, struct yalx_root_visitor *visitor) {
     {
-    #define VISIT(ty)                        \
+    #define VISIT_N(ty, n)                   \
         visitor->visit_pointers(visitor,     \
             (yalx_ref_t *)pool->ty##_values, \
-            (yalx_ref_t *)pool->ty##_values + arraysize(pool->ty##_values))
+            (yalx_ref_t *)pool->ty##_values + (n))
+    #define VISIT(ty) VISIT_N(ty, arraysize(pool->ty##_values))
         
         struct boxing_number_pool *pool = &h->fast_boxing_numbers;
+        const int n_signed = pool->high - pool->low + 1;
+        const int n_unsigned = pool->unsigned_high + 1;
         VISIT(bool);
         VISIT(i8);
         VISIT(u8);
-        VISIT(i16);
-        VISIT(u16);
-        VISIT(i32);
-        VISIT(u32);
-        VISIT(i64);
-        VISIT(u64);
+        VISIT_N(i16, n_signed);
+        VISIT_N(u16, n_unsigned);
+        VISIT_N(i32, n_signed);
+        VISIT_N(u32, n_unsigned);
+        VISIT_N(i64, n_signed);
+        VISIT_N(u64, n_unsigned);
         VISIT(f32);
         VISIT(f64);
     #undef VISIT
+    #undef VISIT_N
     }
     for (int i = 0; i < arraysize(h->kpool_stripes); i++) {
         struct string_pool *pool = &h->kpool_stripes[i];
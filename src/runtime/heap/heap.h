@@ -62,17 +62,29 @@ struct string_pool {
 }; // struct string_pool
 
 
+// Range of cached boxing numbers: signed in [BOXING_CACHE_LOW, high], unsigned in [0, high - BOXING_CACHE_LOW], so
+// both have the same count of numbers. The high bound is configurable by `yalx_runtime_options::boxing_cache_high'.
+// Cached numbers are always live, so every GC cycle marks them, a wider range is opt-in.
+#define BOXING_CACHE_LOW          (-128)
+#define BOXING_CACHE_DEFAULT_HIGH 127
+#define BOXING_CACHE_MAX_HIGH     INT16_MAX
+
+extern int boxing_cache_high;
+
 // [strong ref] For number boxing:
 struct boxing_number_pool {
     struct yalx_value_number_l *bool_values[2]; // true and false
     struct yalx_value_number_l *i8_values[256]; // all i8
     struct yalx_value_number_l *u8_values[256]; // all u8
-    struct yalx_value_number_l *i16_values[201]; // -100~100 i16
-    struct yalx_value_number_l *u16_values[201]; // 0~200 u16
-    struct yalx_value_number_l *i32_values[201]; // -100~100 i32
-    struct yalx_value_number_l *u32_values[201]; // 0~200 u32
-    struct yalx_value_number_w *i64_values[201]; // -100~100 i32
-    struct yalx_value_number_w *u64_values[201]; // 0~200 u32
+    int low; // low bound of signed numbers
+    int high; // high bound of signed numbers
+    int unsigned_high; // high bound of unsigned numbers
+    struct yalx_value_number_l **i16_values; // low~high i16
+    struct yalx_value_number_l **u16_values; // 0~unsigned_high u16
+    struct yalx_value_number_l **i32_values; // low~high i32
+    struct yalx_value_number_l **u32_values; // 0~unsigned_high u32
+    struct yalx_value_number_w **i64_values; // low~high i64
+    struct yalx_value_number_w **u64_values; // 0~unsigned_high u64
     struct yalx_value_number_l *f32_values[3]; // -1.0 0 1.0
     struct yalx_value_number_w *f64_values[3]; // -1.0 0 1.0
 }; // struct number_pool
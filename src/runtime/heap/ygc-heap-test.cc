@@ -84,7 +84,10 @@ TEST_F(YGCHeapTest, ObjectIteratingInPage) {
     };
     ygc_page_visit_objects(page, &closure);
 
-    EXPECT_EQ(1729, objs.size());
+    // Boxing numbers pool: bool, i8, u8, i16/i32/i64, u16/u32/u64, f32/f64
+    const auto &pool = heap_->fast_boxing_numbers;
+    const size_t n_boxing = 2 + 256 * 2 + (pool.high - pool.low + 1) * 3 + (pool.unsigned_high + 1) * 3 + 3 * 2;
+    EXPECT_EQ(n_boxing + 3, objs.size());
     auto len = objs.size();
 
     EXPECT_EQ(hello, objs[len - 3]);
@@ -24,4 +24,186 @@ void yalx_sem_try_wait(struct yalx_sem *self) {
         rs = sem_trywait(&self->impl);
     } while (rs != 0 && errno == EINTR);
     GUARANTEE(rs == 0, "sem_wait fail");
-}
\ No newline at end of file
+}
+
+#if defined(YALX_OS_LINUX)
+
+#include "runtime/runtime.h"
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <limits.h>
+
+#define MUTEX_LOCKED   1u
+#define MUTEX_HANDOFF  2u // Unlocker passed the lock to a woken waiter directly
+#define MUTEX_STARVING 4u // A waiter parked too many rounds, next unlocking must hand off
+#define MUTEX_WAITER   8u // One parked waiter
+
+#define MUTEX_MAX_SPINS     100
+#define MUTEX_STARVE_ROUNDS 2
+
+static _Thread_local char mutex_owner_token;
+
+static inline uintptr_t current_owner(void) { return (uintptr_t)&mutex_owner_token; }
+
+static inline void futex_wait(_Atomic uint32_t *addr, uint32_t expected) {
+    syscall(SYS_futex, (uint32_t *)addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static inline void futex_wake(_Atomic uint32_t *addr, int n) {
+    syscall(SYS_futex, (uint32_t *)addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+static inline int mutex_cas(struct yalx_mutex *self, uint32_t *expected, uint32_t desired, memory_order order) {
+    return atomic_compare_exchange_weak_explicit(&self->state, expected, desired, order, memory_order_relaxed);
+}
+
+static inline void mutex_acquired(struct yalx_mutex *self) {
+    atomic_store_explicit(&self->owner, current_owner(), memory_order_relaxed);
+}
+
+int yalx_mutex_init(struct yalx_mutex *self) {
+    atomic_init(&self->state, 0);
+    atomic_init(&self->owner, 0);
+    self->spins = 0;
+    self->recursion = 0;
+    self->contentions = 0;
+    self->parks = 0;
+    self->handoffs = 0;
+    return 0;
+}
+
+static void mutex_lock_slow(struct yalx_mutex *self) {
+    // Adaptive spinning: spin at most twice as long as the last successful spinning.
+    int spun = 0;
+    if (ncpus > 1) {
+        const int limit = self->spins * 2 + 10 < MUTEX_MAX_SPINS ? self->spins * 2 + 10 : MUTEX_MAX_SPINS;
+        for (; spun < limit; spun++) {
+            uint32_t s = atomic_load_explicit(&self->state, memory_order_relaxed);
+            if (!(s & (MUTEX_LOCKED | MUTEX_STARVING)) && mutex_cas(self, &s, s | MUTEX_LOCKED, memory_order_acquire)) {
+                self->spins += (spun - self->spins) / 8;
+                self->contentions++;
+                return;
+            }
+            yalx_cpu_relax();
+        }
+    }
+
+    int registered = 0;
+    uint32_t parks = 0;
+    for (;;) {
+        uint32_t s = atomic_load_explicit(&self->state, memory_order_relaxed);
+        if (registered && (s & MUTEX_HANDOFF)) {
+            // LOCKED bit is still set, we own it now.
+            if (mutex_cas(self, &s, s - MUTEX_WAITER - MUTEX_HANDOFF, memory_order_acquire)) {
+                break;
+            }
+            continue;
+        }
+        if (!(s & MUTEX_LOCKED) && (registered || !(s & MUTEX_STARVING))) {
+            uint32_t ns = (s | MUTEX_LOCKED) - (registered ? MUTEX_WAITER : 0);
+            if (mutex_cas(self, &s, ns, memory_order_acquire)) {
+                break;
+            }
+            continue;
+        }
+
+        uint32_t ns = s + (registered ? 0 : MUTEX_WAITER);
+        if (parks >= MUTEX_STARVE_ROUNDS) {
+            ns |= MUTEX_STARVING;
+        }
+        if (ns != s && !mutex_cas(self, &s, ns, memory_order_relaxed)) {
+            continue;
+        }
+        registered = 1;
+        futex_wait(&self->state, ns);
+        parks++;
+    }
+    self->spins += (spun - self->spins) / 8;
+    self->contentions++;
+    self->parks += parks > 0;
+}
+
+void yalx_mutex_lock(struct yalx_mutex *self) {
+    uint32_t s = 0;
+    if (!mutex_cas(self, &s, MUTEX_LOCKED, memory_order_acquire)) {
+        if (atomic_load_explicit(&self->owner, memory_order_relaxed) == current_owner()) {
+            self->recursion++;
+            return;
+        }
+        mutex_lock_slow(self);
+    }
+    mutex_acquired(self);
+}
+
+int yalx_mutex_try_lock(struct yalx_mutex *self) {
+    uint32_t s = atomic_load_explicit(&self->state, memory_order_relaxed);
+    while (!(s & (MUTEX_LOCKED | MUTEX_STARVING))) {
+        if (mutex_cas(self, &s, s | MUTEX_LOCKED, memory_order_acquire)) {
+            mutex_acquired(self);
+            return 0;
+        }
+    }
+    if (atomic_load_explicit(&self->owner, memory_order_relaxed) == current_owner()) {
+        self->recursion++;
+        return 0;
+    }
+    return 1;
+}
+
+void yalx_mutex_unlock(struct yalx_mutex *self) {
+    DCHECK(atomic_load_explicit(&self->owner, memory_order_relaxed) == current_owner());
+    if (self->recursion > 0) {
+        self->recursion--;
+        return;
+    }
+    atomic_store_explicit(&self->owner, 0, memory_order_relaxed);
+
+    uint32_t s = MUTEX_LOCKED;
+    if (mutex_cas(self, &s, 0, memory_order_release)) {
+        return;
+    }
+    for (;;) {
+        if ((s & MUTEX_STARVING) && s >= MUTEX_WAITER) {
+            // Keep the LOCKED bit, the woken waiter owns the lock.
+            self->handoffs++;
+            if (mutex_cas(self, &s, (s & ~MUTEX_STARVING) | MUTEX_HANDOFF, memory_order_release)) {
+                futex_wake(&self->state, 1);
+                return;
+            }
+            self->handoffs--;
+        } else {
+            if (mutex_cas(self, &s, s & ~MUTEX_LOCKED, memory_order_release)) {
+                if (s >= MUTEX_WAITER) {
+                    futex_wake(&self->state, 1);
+                }
+                return;
+            }
+        }
+    }
+}
+
+int yalx_cond_notify_one(struct yalx_cond *self) {
+    atomic_fetch_add_explicit(&self->seq, 1, memory_order_release);
+    futex_wake(&self->seq, 1);
+    return 0;
+}
+
+int yalx_cond_notify_all(struct yalx_cond *self) {
+    atomic_fetch_add_explicit(&self->seq, 1, memory_order_release);
+    futex_wake(&self->seq, INT_MAX);
+    return 0;
+}
+
+int yalx_cond_wait(struct yalx_cond *self, struct yalx_mutex *mutex) {
+    const uint32_t seq = atomic_load_explicit(&self->seq, memory_order_relaxed);
+    const int recursion = mutex->recursion;
+    mutex->recursion = 0;
+    yalx_mutex_unlock(mutex);
+    futex_wait(&self->seq, seq);
+    yalx_mutex_lock(mutex);
+    mutex->recursion = recursion;
+    return 0;
+}
+
+#endif // defined(YALX_OS_LINUX)
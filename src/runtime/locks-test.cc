@@ -1,6 +1,12 @@
 #include "runtime/locks.h"
 #include <gtest/gtest.h>
 #include <thread>
+#include <chrono>
+#if defined(YALX_OS_LINUX)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 
 TEST(LocksTest, Sanity) {
@@ -30,3 +36,111 @@ TEST(LocksTest, ThreadSafe) {
     }
     ASSERT_EQ(5 * k, c);
 }
+
+TEST(LocksTest, MutexThreadSafe) {
+    static const int k = 100000;
+    int c = 0;
+    struct yalx_mutex mutex;
+    ASSERT_EQ(0, yalx_mutex_init(&mutex));
+    
+    std::thread workers[5];
+    for (int i = 0; i < 5; i++) {
+        workers[i] = std::thread([&c](struct yalx_mutex *mutex){
+            for (int i = 0; i < k; i++) {
+                yalx_mutex_lock(mutex);
+                c++;
+                yalx_mutex_unlock(mutex);
+            }
+        }, &mutex);
+    }
+    for (int i = 0; i < 5; i++) {
+        workers[i].join();
+    }
+    ASSERT_EQ(5 * k, c);
+#if defined(YALX_OS_LINUX)
+    EXPECT_LE(mutex.contentions, 5 * k);
+    EXPECT_LE(mutex.parks, mutex.contentions);
+    EXPECT_LE(mutex.handoffs, mutex.parks);
+#endif
+    yalx_mutex_final(&mutex);
+}
+
+#if defined(YALX_OS_LINUX)
+
+// Wake the parked waiter up while the lock is still held, every wake-up is a parking round, so the waiter starves
+// and the unlocking must hand the lock off to it.
+TEST(LocksTest, MutexHandOff) {
+    struct yalx_mutex mutex;
+    ASSERT_EQ(0, yalx_mutex_init(&mutex));
+    for (int attempt = 0; attempt < 10 && mutex.handoffs == 0; attempt++) {
+        yalx_mutex_lock(&mutex);
+        std::thread waiter([](struct yalx_mutex *mutex) {
+            yalx_mutex_lock(mutex);
+            yalx_mutex_unlock(mutex);
+        }, &mutex);
+        for (int i = 0; i < 10; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&mutex.state), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr,
+                    0);
+        }
+        yalx_mutex_unlock(&mutex);
+        waiter.join();
+    }
+    EXPECT_LT(0, mutex.handoffs);
+    EXPECT_LE(mutex.handoffs, mutex.parks);
+    yalx_mutex_final(&mutex);
+}
+
+#endif // defined(YALX_OS_LINUX)
+
+TEST(LocksTest, MutexRecursive) {
+    struct yalx_mutex mutex;
+    ASSERT_EQ(0, yalx_mutex_init(&mutex));
+    yalx_mutex_lock(&mutex);
+    yalx_mutex_lock(&mutex);
+    ASSERT_EQ(0, yalx_mutex_try_lock(&mutex));
+    yalx_mutex_unlock(&mutex);
+    yalx_mutex_unlock(&mutex);
+    
+    int busy = 0;
+    std::thread([&busy](struct yalx_mutex *mutex) { busy = yalx_mutex_try_lock(mutex); }, &mutex).join();
+    ASSERT_NE(0, busy);
+    yalx_mutex_unlock(&mutex);
+    
+    std::thread([&busy](struct yalx_mutex *mutex) {
+        busy = yalx_mutex_try_lock(mutex);
+        if (!busy) { yalx_mutex_unlock(mutex); }
+    }, &mutex).join();
+    ASSERT_EQ(0, busy);
+    yalx_mutex_final(&mutex);
+}
+
+TEST(LocksTest, CondNotify) {
+    struct yalx_mutex mutex;
+    struct yalx_cond cond;
+    ASSERT_EQ(0, yalx_mutex_init(&mutex));
+    ASSERT_EQ(0, yalx_cond_init(&cond));
+    int ready = 0;
+    
+    std::thread waiters[4];
+    for (int i = 0; i < 4; i++) {
+        waiters[i] = std::thread([&]() {
+            yalx_mutex_lock(&mutex);
+            while (!ready) {
+                yalx_cond_wait(&cond, &mutex);
+            }
+            ready++;
+            yalx_mutex_unlock(&mutex);
+        });
+    }
+    yalx_mutex_lock(&mutex);
+    ready = 1;
+    yalx_cond_notify_all(&cond);
+    yalx_mutex_unlock(&mutex);
+    for (int i = 0; i < 4; i++) {
+        waiters[i].join();
+    }
+    ASSERT_EQ(5, ready);
+    yalx_cond_final(&cond);
+    yalx_mutex_final(&mutex);
+}
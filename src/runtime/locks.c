@@ -5,24 +5,28 @@
 #define SPIN_LOCK_BITS 1
 #define SPIN_COUNT 4096
 
-#define PAUSE() (void)0
+static inline int spin_try_lock(struct yalx_spin_lock *lock) {
+    int expected = 0;
+    return atomic_compare_exchange_strong_explicit(&lock->core, &expected, SPIN_LOCK_BITS, memory_order_acquire,
+                                                   memory_order_relaxed);
+}
 
 void yalx_spin_lock(struct yalx_spin_lock *lock) {
+    if (spin_try_lock(lock)) {
+        return;
+    }
+
     for (;;) {
-        int expected = 0;
-        if (atomic_compare_exchange_strong(&lock->core, &expected, SPIN_LOCK_BITS) && expected == 0) {
-            return;
-        }
-        
         if (ncpus > 1) {
             for (int n = 1; n < SPIN_COUNT; n <<= 1) {
 
                 for (int i = 0; i < n; i++) {
-                    PAUSE();
+                    yalx_cpu_relax();
                 }
 
-                expected = 0;
-                if (atomic_compare_exchange_strong(&lock->core, &expected, SPIN_LOCK_BITS) && expected == 0) {
+                // Test before test-and-set: only try CAS when lock looks free, avoid cache-line ping-pong.
+                if (atomic_load_explicit(&lock->core, memory_order_relaxed) == 0 && spin_try_lock(lock)) {
+                    lock->contentions++;
                     return;
                 }
             }
@@ -30,10 +34,14 @@ void yalx_spin_lock(struct yalx_spin_lock *lock) {
         //pthread_yield_np();
         sched_yield();
         //thrd_yield();
+        if (atomic_load_explicit(&lock->core, memory_order_relaxed) == 0 && spin_try_lock(lock)) {
+            lock->contentions++;
+            return;
+        }
     }
 }
 
 
 void yalx_spin_unlock(struct yalx_spin_lock *lock) {
-    atomic_store_explicit(&lock->core, 0, memory_order_relaxed);
+    atomic_store_explicit(&lock->core, 0, memory_order_release);
 }
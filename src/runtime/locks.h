@@ -37,7 +37,76 @@ extern "C" {
 
 #endif // __cplusplus
 
-#if !defined(__STDC_NO_THREADS__) && !defined(__cplusplus)
+#include <stdint.h>
+
+// Hint the cpu we are in a spin-wait loop: `pause' on x64, `yield' on arm64.
+static inline void yalx_cpu_relax(void) {
+#if defined(YALX_ARCH_X64)
+    __asm__ __volatile__ ("pause" ::: "memory");
+#elif defined(YALX_ARCH_ARM64) || defined(__aarch64__)
+    __asm__ __volatile__ ("yield" ::: "memory");
+#else
+    __asm__ __volatile__ ("" ::: "memory");
+#endif
+}
+
+#if defined(YALX_OS_LINUX)
+
+// Futex based mutex:
+// Fast path is a single CAS, the slow path spins adaptively (by the history of this mutex) and then parks on the
+// futex. A waiter parked too many rounds marks the mutex as starving, then the next unlocking hands the lock off
+// directly to a woken waiter instead of releasing it to the spinners. The mutex is recursive like `mtx_recursive'.
+struct yalx_mutex {
+    _Atomic uint32_t state;
+    int32_t spins; // Adaptive spinning estimate
+    _Atomic uintptr_t owner;
+    int recursion;
+    // Contention counters, only updated by the owner:
+    uint32_t contentions; // Acquired by slow path
+    uint32_t parks; // Acquired after parking on futex, a part of contentions
+    uint32_t handoffs; // Handed off to a starving waiter
+};
+
+int yalx_mutex_init(struct yalx_mutex *self);
+
+static inline void yalx_mutex_final(struct yalx_mutex *self) { (void)self; }
+
+void yalx_mutex_lock(struct yalx_mutex *self);
+int yalx_mutex_try_lock(struct yalx_mutex *self);
+void yalx_mutex_unlock(struct yalx_mutex *self);
+
+struct yalx_cond {
+    _Atomic uint32_t seq;
+};
+
+static inline int yalx_cond_init(struct yalx_cond *self) {
+    self->seq = 0;
+    return 0;
+}
+
+static inline void yalx_cond_final(struct yalx_cond *self) { (void)self; }
+
+int yalx_cond_notify_one(struct yalx_cond *self);
+int yalx_cond_notify_all(struct yalx_cond *self);
+int yalx_cond_wait(struct yalx_cond *self, struct yalx_mutex *mutex);
+
+struct yalx_sem {
+    sem_t impl;
+};
+
+static inline int yalx_sem_init(struct yalx_sem *self, unsigned int n) {
+    return sem_init(&self->impl, 0, n);
+}
+
+static inline void yalx_sem_final(struct yalx_sem *self) {
+    sem_destroy(&self->impl);
+}
+
+void yalx_sem_signal(struct yalx_sem *self, unsigned int n);
+void yalx_sem_wait(struct yalx_sem *self);
+void yalx_sem_try_wait(struct yalx_sem *self);
+
+#elif !defined(__STDC_NO_THREADS__) && !defined(__cplusplus)
 struct yalx_mutex {
     mtx_t impl;
 };
@@ -209,9 +278,10 @@ static inline void yalx_mutex_unlock(struct yalx_mutex *self) {
 
 struct yalx_spin_lock {
     _Atomic int core;
+    uint32_t contentions; // Acquired after spinning, only updated by the owner
 };
 
-static inline void yalx_init_spin_lock(struct yalx_spin_lock *lock) { lock->core = 0; }
+static inline void yalx_init_spin_lock(struct yalx_spin_lock *lock) { lock->core = 0; lock->contentions = 0; }
 
 void yalx_spin_lock(struct yalx_spin_lock *lock);
 
@@ -254,7 +254,6 @@ void mm_synchronize_end(struct yalx_mm_thread *mm) {
 }
 
 #define SPIN_COUNT 4096
-#define PAUSE() (void)0
 
 double mm_synchronize_poll(struct yalx_mm_thread *mm) {
     struct machine *mach = thread_local_mach;
@@ -273,12 +272,14 @@ double mm_synchronize_poll(struct yalx_mm_thread *mm) {
         for (int n = 1; n < SPIN_COUNT; n <<= 1) {
 
             for (int i = 0; i < n; i++) {
-                PAUSE();
+                yalx_cpu_relax();
             }
             if (mm_synchronize_state(mm) == NOT_SYNCHRONIZED) {
                 goto end;
             }
-            sched_yield();
+            if (ncpus <= 1) {
+                sched_yield();
+            }
         }
 
         DCHECK(mm->state == SYNCHRONIZED);
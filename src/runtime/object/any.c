@@ -3,13 +3,54 @@
 #include "runtime/object/type.h"
 #include "runtime/heap/object-visitor.h"
 #include "runtime/checking.h"
+#include "runtime/locks.h"
 #include <stdio.h>
 
 
+#if defined(YALX_COMPACT_HEADER)
+
+_Static_assert(sizeof(struct yalx_value_any) == 8, "compact header must be one word");
+
+struct yalx_class *yalx_class_table[YALX_MAX_CLASSES];
+static _Atomic u32_t n_registered_classes = MAX_BUILTIN_TYPES;
+static struct yalx_spin_lock class_table_lock;
+
+void yalx_class_table_init(void) {
+    for (int i = 0; i < MAX_BUILTIN_TYPES; i++) {
+        yalx_class_table[i] = &builtin_classes[i];
+    }
+}
+
+u32_t yalx_class_index(const struct yalx_class *klass) {
+    const enum yalx_builtin_type builtin_ty = yalx_builtin_type(klass);
+    if (builtin_ty != NOT_BUILTIN_TYPE) {
+        return (u32_t)builtin_ty;
+    }
+    // Not builtin classes: `id' is the index of class table after registered.
+    _Atomic uint64_t *id = (_Atomic uint64_t *)&klass->id;
+    uint64_t index = atomic_load_explicit(id, memory_order_acquire);
+    if (index >= MAX_BUILTIN_TYPES) {
+        return (u32_t)index;
+    }
+
+    yalx_spin_lock(&class_table_lock);
+    index = atomic_load_explicit(id, memory_order_relaxed);
+    if (index < MAX_BUILTIN_TYPES) {
+        index = atomic_fetch_add_explicit(&n_registered_classes, 1, memory_order_relaxed);
+        GUARANTEE(index < YALX_MAX_CLASSES, "Too many classes: %u", (u32_t)index);
+        yalx_class_table[index] = (struct yalx_class *)klass;
+        atomic_store_explicit(id, index, memory_order_release);
+    }
+    yalx_spin_unlock(&class_table_lock);
+    return (u32_t)index;
+}
+
+#endif // defined(YALX_COMPACT_HEADER)
+
 size_t yalx_object_size_in_bytes(yalx_ref_t obj) {
     const struct yalx_class *klass = CLASS(obj);
 
-    switch (klass->id) {
+    switch (CLASS_ID(obj)) {
         case Type_string:
             return string_ty_size(klass, (const struct yalx_value_str *) obj);
         case Type_array:
@@ -37,9 +78,7 @@ void struct_shallow_visit(yalx_ref_t host, address_t base, const struct yalx_cla
 }
 
 void yalx_object_shallow_visit(yalx_ref_t obj, struct yalx_object_visitor *visitor) {
-    const struct yalx_class *klass = CLASS(obj);
-
-    switch (klass->id) {
+    switch (CLASS_ID(obj)) {
         case Type_array: {
             struct yalx_value_array const *arr = (struct yalx_value_array *)obj;
             struct yalx_class const *item_ty = arr->item;
@@ -77,6 +116,7 @@ void yalx_object_shallow_visit(yalx_ref_t obj, struct yalx_object_visitor *visit
         } break;
 
         default: {
+            const struct yalx_class *klass = CLASS(obj);
             DCHECK(yalx_is_ref_type(klass) || yalx_is_compact_enum_type(klass));
 
             address_t base_addr = (address_t)obj;
@@ -8,11 +8,23 @@
 extern "C" {
 #endif
 
+#if defined(YALX_COMPACT_HEADER)
+
+// Compact header: 32 bits index of `yalx_class_table' and packed tags in one word.
+#define YALX_VALUE_HEADER \
+    u32_t     klass;      \
+    u16_t     tags;       \
+    u16_t     refs
+
+#else
+
 #define YALX_VALUE_HEADER \
     uintptr_t klass;      \
     u32_t     tags;       \
     u32_t     refs
 
+#endif // defined(YALX_COMPACT_HEADER)
+
 struct yalx_value_any {
     YALX_VALUE_HEADER;
 }; // struct yalx_value_any
@@ -21,7 +33,28 @@ struct yalx_class;
 struct yalx_value_str;
 struct yalx_object_visitor;
 
+#if defined(YALX_COMPACT_HEADER)
+
+#define YALX_MAX_CLASSES (1u << 16)
+
+// Index 0~MAX_BUILTIN_TYPES-1 are builtin classes, others will be registered at first allocating.
+extern struct yalx_class *yalx_class_table[YALX_MAX_CLASSES];
+
+void yalx_class_table_init(void);
+u32_t yalx_class_index(const struct yalx_class *klass);
+
+#define CLASS(ref)  (yalx_class_table[(ref)->klass])
+// Builtin type of object without loading its class
+#define CLASS_ID(ref) ((ref)->klass)
+#define SET_CLASS(ref, k) ((ref)->klass = yalx_class_index(k))
+
+#else
+
 #define CLASS(ref)  ((struct yalx_class *)((ref)->klass & ~1))
+#define CLASS_ID(ref) (CLASS(ref)->id)
+#define SET_CLASS(ref, k) ((ref)->klass = (uintptr_t)(k))
+
+#endif // defined(YALX_COMPACT_HEADER)
 
 typedef struct yalx_value_any *yalx_ref_t;
 typedef struct yalx_value_any **yalx_ref_handle;
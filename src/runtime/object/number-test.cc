@@ -72,3 +72,41 @@ TEST(NumberTest, FloatBoxing) {
     ASSERT_EQ(1, one->box.f32);
     ASSERT_EQ(one, yalx_new_f32(heap, 1));
 }
+
+TEST(NumberTest, BoxingCacheRange) {
+    const auto &pool = heap->fast_boxing_numbers;
+    ASSERT_EQ(BOXING_CACHE_LOW, pool.low);
+    ASSERT_EQ(BOXING_CACHE_DEFAULT_HIGH, pool.high);
+    
+    for (int i = pool.low; i <= pool.high; i++) {
+        auto l = yalx_new_i32(heap, i);
+        ASSERT_EQ(l, yalx_new_i32(heap, i));
+        ASSERT_EQ(i, l->box.i32);
+        
+        auto w = yalx_new_i64(heap, i);
+        ASSERT_EQ(w, yalx_new_i64(heap, i));
+        ASSERT_EQ(i, w->box.i64);
+    }
+    ASSERT_EQ(255, pool.unsigned_high);
+    for (int i = 0; i <= pool.unsigned_high; i++) {
+        auto l = yalx_new_u32(heap, i);
+        ASSERT_EQ(l, yalx_new_u32(heap, i));
+        ASSERT_EQ(i, l->box.u32);
+        
+        auto h = yalx_new_u16(heap, i);
+        ASSERT_EQ(h, yalx_new_u16(heap, i));
+        ASSERT_EQ(i, h->box.u16);
+        
+        auto w = yalx_new_u64(heap, i);
+        ASSERT_EQ(w, yalx_new_u64(heap, i));
+        ASSERT_EQ(i, w->box.u64);
+    }
+    
+    auto large = yalx_new_i32(heap, pool.high + 1);
+    ASSERT_NE(large, yalx_new_i32(heap, pool.high + 1));
+    ASSERT_EQ(pool.high + 1, large->box.i32);
+    
+    auto word = yalx_new_u16(heap, 40000);
+    ASSERT_STREQ("U16", CLASS(word)->name.z);
+    ASSERT_EQ(40000, word->box.u16);
+}
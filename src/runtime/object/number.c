@@ -6,8 +6,9 @@
 #include <stdio.h>
 
 struct yalx_value_number_l *yalx_new_i16(struct heap *heap, i16_t value) {
-    if (value >= -100 && value <= 100) {
-        return heap->fast_boxing_numbers.i16_values[value + 100];
+    const struct boxing_number_pool *pool = &heap->fast_boxing_numbers;
+    if (value >= pool->low && value <= pool->high) {
+        return pool->i16_values[value - pool->low];
     }
     struct yalx_value_number_l *l = yalx_new_small_boxing_number(heap, I16_class);
     l->box.i16 = value;
@@ -15,17 +16,18 @@ struct yalx_value_number_l *yalx_new_i16(struct heap *heap, i16_t value) {
 }
 
 struct yalx_value_number_l *yalx_new_u16(struct heap *heap, u16_t value) {
-    if (value <= 200) {
+    if (value <= heap->fast_boxing_numbers.unsigned_high) {
         return heap->fast_boxing_numbers.u16_values[value];
     }
-    struct yalx_value_number_l *l = yalx_new_small_boxing_number(heap, I16_class);
+    struct yalx_value_number_l *l = yalx_new_small_boxing_number(heap, U16_class);
     l->box.u32 = value;
     return l;
 }
 
 struct yalx_value_number_l *yalx_new_i32(struct heap *heap, i32_t value) {
-    if (value >= -100 && value <= 100) {
-        return heap->fast_boxing_numbers.i32_values[value + 100];
+    const struct boxing_number_pool *pool = &heap->fast_boxing_numbers;
+    if (value >= pool->low && value <= pool->high) {
+        return pool->i32_values[value - pool->low];
     }
     struct yalx_value_number_l *l = yalx_new_small_boxing_number(heap, I32_class);
     l->box.i32 = value;
@@ -33,7 +35,7 @@ struct yalx_value_number_l *yalx_new_i32(struct heap *heap, i32_t value) {
 }
 
 struct yalx_value_number_l *yalx_new_u32(struct heap *heap, u32_t value) {
-    if (value <= 200) {
+    if (value <= heap->fast_boxing_numbers.unsigned_high) {
         return heap->fast_boxing_numbers.u32_values[value];
     }
     struct yalx_value_number_l *l = yalx_new_small_boxing_number(heap, U32_class);
@@ -55,8 +57,9 @@ struct yalx_value_number_l *yalx_new_f32(struct heap *heap, f32_t value) {
 }
 
 struct yalx_value_number_w *yalx_new_i64(struct heap *heap, i64_t value) {
-    if (value >= -100 && value <= 100) {
-        return heap->fast_boxing_numbers.i64_values[value + 100];
+    const struct boxing_number_pool *pool = &heap->fast_boxing_numbers;
+    if (value >= pool->low && value <= pool->high) {
+        return pool->i64_values[value - pool->low];
     }
     struct yalx_value_number_w *w = yalx_new_big_boxing_number(heap, I64_class);
     w->box.i64 = value;
@@ -64,7 +67,7 @@ struct yalx_value_number_w *yalx_new_i64(struct heap *heap, i64_t value) {
 }
 
 struct yalx_value_number_w *yalx_new_u64(struct heap *heap, u64_t value) {
-    if (value <= 200) {
+    if (value <= heap->fast_boxing_numbers.unsigned_high) {
         return heap->fast_boxing_numbers.u64_values[value];
     }
     struct yalx_value_number_w *w = yalx_new_big_boxing_number(heap, U64_class);
@@ -1,7 +1,25 @@
 #include "runtime/object/type.h"
+#include "runtime/object/any.h"
+#include "runtime/object/number.h"
+#include "runtime/heap/heap.h"
 #include "runtime/runtime.h"
 #include <gtest/gtest.h>
 
 TEST(TypeTest, Sanity) {
     dbg_class_output(any_class);
 }
+
+TEST(TypeTest, ObjectHeader) {
+#if defined(YALX_COMPACT_HEADER)
+    ASSERT_EQ(8, sizeof(yalx_value_any));
+#else
+    ASSERT_EQ(16, sizeof(yalx_value_any));
+#endif
+    auto l = yalx_new_i32(heap, 0x7fffffff);
+    ASSERT_EQ(I32_class, CLASS(l));
+    ASSERT_EQ(Type_I32, CLASS_ID(l));
+    
+    auto w = yalx_new_i64(heap, -0x7fffffff);
+    ASSERT_EQ(I64_class, CLASS(w));
+    ASSERT_EQ(Type_I64, CLASS_ID(w));
+}
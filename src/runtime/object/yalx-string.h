@@ -44,9 +44,11 @@ static inline size_t yalx_reserve_string_bytes(const char *z, size_t n) {
     return sizeof(struct yalx_value_str) + n + 1; // 1 for term zero
 }
 
+// Hash over unsigned bytes: the compiler hashes keys of `when' on the host, the result must be the same as the target
+// whatever the signedness of `char' is.
 static inline u32_t yalx_str_hash(const char *z, size_t n) {
     u32_t hash = 1315423911;
-    for (const char *s = z; s < z + n; s++) {
+    for (const unsigned char *s = (const unsigned char *)z; s < (const unsigned char *)z + n; s++) {
         hash ^= ((hash << 5) + (*s) + (hash >> 2));
     }
     return hash;
@@ -0,0 +1,61 @@
+#include "runtime/profile.h"
+#include "runtime/object/type.h"
+#include "gtest/gtest.h"
+#include <string>
+
+
+class ProfileTest : public ::testing::Test {
+public:
+    void SetUp() override {
+        foo_.location = YALX_STR("main:main.Foo");
+        bar_.location = YALX_STR("main:main.Bar");
+        baz_.location = YALX_STR("main:main.Baz");
+    }
+
+    static std::string Dump(struct yalx_profile_record *const *records, size_t n) {
+        FILE *fp = tmpfile();
+        EXPECT_EQ(0, yalx_profile_dump(fp, records, n));
+        std::string buf(ftell(fp), '\0');
+        rewind(fp);
+        EXPECT_EQ(buf.size(), fread(buf.data(), 1, buf.size(), fp));
+        fclose(fp);
+        return buf;
+    }
+
+protected:
+    struct yalx_class foo_ = {};
+    struct yalx_class bar_ = {};
+    struct yalx_class baz_ = {};
+}; // class ProfileTest
+
+
+TEST_F(ProfileTest, Receiver) {
+    struct yalx_profile_site site = {};
+    yalx_profile_receiver(&site, &foo_);
+    yalx_profile_receiver(&site, &bar_);
+    yalx_profile_receiver(&site, &foo_);
+    yalx_profile_receiver(&site, &baz_);
+    EXPECT_EQ(&foo_, site.classes[0]);
+    EXPECT_EQ(2, site.counts[0]);
+    EXPECT_EQ(&bar_, site.classes[1]);
+    EXPECT_EQ(1, site.counts[1]);
+    EXPECT_EQ(1, site.others);
+}
+
+
+TEST_F(ProfileTest, Dump) {
+    u64_t counters[3] = {100, 90, 10};
+    struct yalx_profile_site sites[2] = {};
+    sites[1].classes[0] = &foo_;
+    sites[1].counts[0] = 80;
+    sites[1].classes[1] = &bar_;
+    sites[1].counts[1] = 8;
+    sites[1].others = 2;
+    struct yalx_profile_record record = {"main:main.foo", 3, counters, 2, sites};
+    struct yalx_profile_record *records[1] = {&record};
+
+    // The never called site 0 is not written.
+    EXPECT_EQ("fun main:main.foo\n"
+              "blocks 100 90 10\n"
+              "site 1 main:main.Foo 80 main:main.Bar 8 * 2\n", Dump(records, 1));
+}
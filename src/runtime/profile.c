@@ -0,0 +1,98 @@
+#include "runtime/profile.h"
+#include "runtime/object/type.h"
+#include "runtime/checking.h"
+#if defined(YALX_OS_DARWIN)
+#include <mach-o/getsect.h>
+#include <mach-o/ldsyms.h>
+#endif
+#include <stdlib.h>
+#include <inttypes.h>
+
+#if defined(YALX_OS_LINUX)
+// Provided by linker for the section `yalx_prof`
+extern struct yalx_profile_record *const __start_yalx_prof[] __attribute__((weak));
+extern struct yalx_profile_record *const __stop_yalx_prof[] __attribute__((weak));
+#endif
+
+void yalx_profile_receiver(struct yalx_profile_site *site, const struct yalx_class *klass) {
+    for (int i = 0; i < 2; i++) {
+        if (site->classes[i] == klass) {
+            site->counts[i]++;
+            return;
+        }
+        if (!site->classes[i]) {
+            site->classes[i] = klass;
+            site->counts[i] = 1;
+            return;
+        }
+    }
+    site->others++;
+}
+
+struct yalx_profile_record *const *yalx_profile_registered_records(size_t *n) {
+#if defined(YALX_OS_LINUX)
+    if (!__start_yalx_prof || !__stop_yalx_prof) {
+        *n = 0;
+        return NULL;
+    }
+    *n = __stop_yalx_prof - __start_yalx_prof;
+    return __start_yalx_prof;
+#elif defined(YALX_OS_DARWIN)
+    unsigned long size = 0;
+    uint8_t *data = getsectiondata(&_mh_execute_header, "__DATA", "__yalx_prof", &size);
+    *n = !data ? 0 : size / sizeof(struct yalx_profile_record *);
+    return (struct yalx_profile_record *const *)data;
+#else
+    *n = 0;
+    return NULL;
+#endif
+}
+
+int yalx_profile_dump(FILE *fp, struct yalx_profile_record *const *records, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        const struct yalx_profile_record *record = records[i];
+        fprintf(fp, "fun %s\nblocks", record->name);
+        for (size_t j = 0; j < record->n_counters; j++) {
+            fprintf(fp, " %" PRIu64, record->counters[j]);
+        }
+        fputc('\n', fp);
+
+        for (size_t j = 0; j < record->n_sites; j++) {
+            const struct yalx_profile_site *site = &record->sites[j];
+            if (!site->classes[0] && site->others == 0) {
+                continue; // Never called
+            }
+            fprintf(fp, "site %zd", j);
+            for (int k = 0; k < 2 && site->classes[k]; k++) {
+                const struct yalx_str *location = &site->classes[k]->location;
+                fprintf(fp, " %.*s %" PRIu64, location->n, location->z, site->counts[k]);
+            }
+            if (site->others > 0) {
+                fprintf(fp, " * %" PRIu64, site->others);
+            }
+            fputc('\n', fp);
+        }
+    }
+    return ferror(fp) ? -1 : 0;
+}
+
+int yalx_profile_write(void) {
+    size_t n = 0;
+    struct yalx_profile_record *const *records = yalx_profile_registered_records(&n);
+    if (n == 0) {
+        return 0; // Not an instrumented build
+    }
+
+    const char *file_name = getenv(YALX_PROFILE_FILE_ENV);
+    if (!file_name || !*file_name) {
+        file_name = YALX_PROFILE_DEFAULT_FILE;
+    }
+    FILE *fp = fopen(file_name, "w");
+    if (!fp) {
+        PLOG("Can not open profile file: %s", file_name);
+        return -1;
+    }
+    int rs = yalx_profile_dump(fp, records, n);
+    fclose(fp);
+    return rs;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#ifndef YALX_RUNTIME_PROFILE_H_
+#define YALX_RUNTIME_PROFILE_H_
+
+#include "runtime/runtime.h"
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct yalx_class;
+
+// Default name of profile file, use env `YALX_PROFILE_FILE' to change it.
+#define YALX_PROFILE_DEFAULT_FILE "yalx.profile"
+#define YALX_PROFILE_FILE_ENV     "YALX_PROFILE_FILE"
+
+// Receivers of a virtual call site: the first two classes are recorded, the others are counted together.
+struct yalx_profile_site {
+    const struct yalx_class *classes[2];
+    u64_t counts[2];
+    u64_t others;
+};
+
+// Emitted by compiler for every instrumented function, and linked into `yalx_prof` section.
+// Counters are increased by the instrumented code without any lock, so they're approximate on multi-thread.
+struct yalx_profile_record {
+    const char *name; // full name of function
+    size_t n_counters;
+    u64_t *counters;
+    size_t n_sites;
+    struct yalx_profile_site *sites;
+};
+
+void yalx_profile_receiver(struct yalx_profile_site *site, const struct yalx_class *klass);
+
+struct yalx_profile_record *const *yalx_profile_registered_records(size_t *n);
+
+// Write records in text format of profile (see `ir::Profile'), returns 0 if ok.
+int yalx_profile_dump(FILE *fp, struct yalx_profile_record *const *records, size_t n);
+
+// Write all registered records into the profile file, nothing to do if there is no record.
+int yalx_profile_write(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // YALX_RUNTIME_PROFILE_H_
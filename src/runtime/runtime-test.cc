@@ -68,6 +68,30 @@ TEST(RuntimeTest, PkgInitOnce) {
     ASSERT_TRUE(pkg_has_initialized("testing/test:test"));
 }
 
+TEST(RuntimeTest, PkgInitRecordOnce) {
+    static pkg_init_record pkg;
+    pkg.name = "testing/test:record";
+    auto n = pkg_initialized_count();
+    pkg_init_record_once(nullptr, &pkg);
+    ASSERT_EQ(PKG_INITIALIZED, pkg.state);
+    ASSERT_EQ(n + 1, pkg_initialized_count());
+
+    pkg_init_record_once(nullptr, &pkg);
+    ASSERT_EQ(n + 1, pkg_initialized_count());
+}
+
+static int pkg_initialized_in_init = -1;
+
+static void PkgInitProbe() {
+    pkg_initialized_in_init = pkg_has_initialized("testing/test:probe");
+}
+
+TEST(RuntimeTest, PkgHasInitializedAfterInit) {
+    pkg_init_once(reinterpret_cast<void *>(&PkgInitProbe), "testing/test:probe");
+    ASSERT_EQ(0, pkg_initialized_in_init);
+    ASSERT_TRUE(pkg_has_initialized("testing/test:probe"));
+}
+
 TEST(RuntimeTest, CallReturningVals) {
     int buf[4] = {0};
     call0_returning_vals(buf, sizeof(buf), reinterpret_cast<void *>(asm_stub6));
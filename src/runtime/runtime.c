@@ -15,9 +15,12 @@
 #include "runtime/scheduler.h"
 #include "runtime/process.h"
 #include "runtime/checking.h"
+#include "runtime/profile.h"
 #include <unistd.h>
 #if defined(YALX_OS_DARWIN)
 #include <sys/sysctl.h>
+#include <mach-o/getsect.h>
+#include <mach-o/ldsyms.h>
 #endif
 #if defined(YALX_OS_LINUX)
 #include <sys/sysinfo.h>
@@ -70,30 +73,21 @@ extern uint32_t yalx_magic_number1;
 extern uint32_t yalx_magic_number2;
 extern uint32_t yalx_magic_number3;
 
-#define PKG_RECORD_VAL_SIZE (pointer_size_in_bytes * 2)
 //
-// const str
+// Packages init records:
+// Registered records: emitted by compiler and linked into `yalx_pkgs` section;
+// Dynamic records: created at runtime for the packages has no registered record.
 //
-// global var slots
-//
-static struct hash_table pkg_init_records;
+static struct hash_table pkg_registry; // name -> registered record, read-only after yalx_runtime_init()
+static struct pkg_init_record *_Atomic pkg_dynamic_records = NULL;
 static struct yalx_mutex pkg_init_mutex;
-
-struct lksz_header {
-    int number_of_strings;
-    const char *const sz[1];
-};
-
-struct kstr_header {
-    int number_of_strings;
-    struct yalx_value_str *ks[1];
-};
+static _Atomic int pkg_initialized_counter = 0;
+static _Thread_local char pkg_init_token;
 
 #if defined(YALX_OS_LINUX)
-void *const YALX_DL_HANDLE = RTLD_LOCAL;
-#endif
-#if defined(YALX_OS_DARWIN)
-void *const YALX_DL_HANDLE = RTLD_MAIN_ONLY;
+// Provided by linker for the section `yalx_pkgs`
+extern struct pkg_init_record *const __start_yalx_pkgs[] __attribute__((weak));
+extern struct pkg_init_record *const __stop_yalx_pkgs[] __attribute__((weak));
 #endif
 
 #ifndef NDEBUG
@@ -197,6 +191,84 @@ struct class_load_entry {
     {NULL, NULL} // end of entries
 };
 
+static struct pkg_init_record *const *pkg_registered_records(size_t *n) {
+#if defined(YALX_OS_LINUX)
+    if (!__start_yalx_pkgs || !__stop_yalx_pkgs) {
+        *n = 0;
+        return NULL;
+    }
+    *n = __stop_yalx_pkgs - __start_yalx_pkgs;
+    return __start_yalx_pkgs;
+#elif defined(YALX_OS_DARWIN)
+    unsigned long size = 0;
+    uint8_t *data = getsectiondata(&_mh_execute_header, "__DATA", "__yalx_pkgs", &size);
+    *n = !data ? 0 : size / sizeof(struct pkg_init_record *);
+    return (struct pkg_init_record *const *)data;
+#else
+    *n = 0;
+    return NULL;
+#endif
+}
+
+static void pkg_registry_init(void) {
+    yalx_init_hash_table(&pkg_registry, 1.2f);
+
+    size_t n = 0;
+    struct pkg_init_record *const *records = pkg_registered_records(&n);
+    for (size_t i = 0; i < n; i++) {
+        struct pkg_init_record *const pkg = records[i];
+        hash_table_value_span_t rs = yalx_put_string_key(&pkg_registry, pkg->name, sizeof(pkg));
+        *(struct pkg_init_record **)rs.value = pkg;
+    }
+}
+
+static void pkg_registry_free(void) {
+    yalx_free_hash_table(&pkg_registry);
+
+    struct pkg_init_record *pkg = atomic_exchange(&pkg_dynamic_records, NULL);
+    while (pkg) {
+        struct pkg_init_record *next = pkg->next;
+        free(pkg);
+        pkg = next;
+    }
+    atomic_store_explicit(&pkg_initialized_counter, 0, memory_order_relaxed);
+}
+
+static struct pkg_init_record *pkg_find_record(const char *const plain_name) {
+    hash_table_value_span_t span = yalx_get_string_key(&pkg_registry, plain_name);
+    if (span.value != NULL) {
+        return *(struct pkg_init_record **)span.value;
+    }
+    for (struct pkg_init_record *pkg = atomic_load_explicit(&pkg_dynamic_records, memory_order_acquire);
+         pkg != NULL; pkg = pkg->next) {
+        if (strcmp(pkg->name, plain_name) == 0) {
+            return pkg;
+        }
+    }
+    return NULL;
+}
+
+static struct pkg_init_record *pkg_find_or_new_record(const char *const plain_name) {
+    struct pkg_init_record *pkg = pkg_find_record(plain_name);
+    if (pkg) {
+        return pkg;
+    }
+
+    yalx_mutex_lock(&pkg_init_mutex);
+    pkg = pkg_find_record(plain_name);
+    if (!pkg) {
+        const size_t name_size = strlen(plain_name) + 1;
+        pkg = (struct pkg_init_record *)malloc(sizeof(struct pkg_init_record) + name_size);
+        memset(pkg, 0, sizeof(struct pkg_init_record));
+        memcpy(pkg + 1, plain_name, name_size);
+        pkg->name = (const char *)(pkg + 1);
+        pkg->next = atomic_load_explicit(&pkg_dynamic_records, memory_order_relaxed);
+        atomic_store_explicit(&pkg_dynamic_records, pkg, memory_order_release);
+    }
+    yalx_mutex_unlock(&pkg_init_mutex);
+    return pkg;
+}
+
 int yalx_runtime_init(const struct yalx_runtime_options *options) {
     pointer_shift_in_bytes = yalx_log2(pointer_size_in_bytes);
     pointer_shift_in_bits = yalx_log2(pointer_size_in_bits);
@@ -227,7 +299,10 @@ int yalx_runtime_init(const struct yalx_runtime_options *options) {
     yalx_mutex_init(&mach_threads_mutex);
     yalx_tls_alloc(&tls_mach);
 
-    yalx_init_hash_table(&pkg_init_records, 1.2f);
+    pkg_registry_init();
+    if (options->boxing_cache_high > 0) {
+        boxing_cache_high = options->boxing_cache_high;
+    }
     if (yalx_init_heap(options->gc, options->max_heap_in_bytes, &heap) < 0) {
         goto error;
     }
@@ -305,11 +380,14 @@ error:
 }
 
 void yalx_runtime_eixt(void) {
+    if (yalx_profile_write() < 0) {
+        DLOG(WARN, "Fail to write profile");
+    }
     yalx_uninstall_signals_handler();
 
     yalx_mm_thread_shutdown(&mm_thread);
 
-    yalx_free_hash_table(&pkg_init_records);
+    pkg_registry_free();
     yalx_free_scheduler(&scheduler);
     yalx_free_heap(heap);
 
@@ -323,34 +401,27 @@ void yalx_runtime_eixt(void) {
 
 }
 
-void yalx_global_visit_root(struct yalx_root_visitor *visitor) {
-    yalx_mutex_lock(&pkg_init_mutex);
+static void pkg_visit_record(struct yalx_root_visitor *visitor, struct pkg_init_record *pkg) {
+    if (atomic_load_explicit(&pkg->state, memory_order_acquire) == PKG_UNINITIALIZED || !pkg->kstr) {
+        return; // No constants pool
+    }
+    visitor->visit_pointers(visitor,
+                            (yalx_ref_t *) pkg->kstr->ks,
+                            (yalx_ref_t *) (pkg->kstr->ks + pkg->kstr->number_of_strings));
+    USE(pkg->global_slots);
+    DLOG(INFO, "Visit global slots has not support yet");
+}
 
-    const size_t n = 1u << pkg_init_records.capacity_shift;
+void yalx_global_visit_root(struct yalx_root_visitor *visitor) {
+    size_t n = 0;
+    struct pkg_init_record *const *records = pkg_registered_records(&n);
     for (size_t i = 0; i < n; i++) {
-        struct hash_table_slot *const slot = &pkg_init_records.slots[i];
-        for (struct hash_table_slot *node = slot->next; node != slot; node = node->next) {
-            hash_table_value_span_t span;
-            span.value = &node->key[(ROUND_UP(node->key_size, 4))];
-            span.size  = node->value_size;
-
-            if (span.size < PKG_RECORD_VAL_SIZE) {
-                continue; // No constants pool
-            }
-
-            struct kstr_header *const_str = (struct kstr_header *)(((void **)span.value)[0]);
-            struct pkg_global_slots *global_slots = (struct pkg_global_slots *)(((void **)span.value)[1]);
-
-            visitor->visit_pointers(visitor,
-                                    (yalx_ref_t *) const_str->ks,
-                                    (yalx_ref_t *) (const_str->ks + const_str->number_of_strings));
-
-            USE(global_slots);
-            DLOG(INFO, "Visit global slots has not support yet");
-        }
+        pkg_visit_record(visitor, records[i]);
+    }
+    for (struct pkg_init_record *pkg = atomic_load_explicit(&pkg_dynamic_records, memory_order_acquire);
+         pkg != NULL; pkg = pkg->next) {
+        pkg_visit_record(visitor, pkg);
     }
-
-    yalx_mutex_unlock(&pkg_init_mutex);
 }
 
 int yalx_rt0(int argc, char *argv[]) {
@@ -716,93 +787,59 @@ const struct yalx_class *yalx_find_class(const char *const plain_name) {
 }
 
 void pkg_init_once(void *init_fun, const char *const plain_name) {
-    // $global_slots
-    static const size_t kMaxPostfixSize = 16;
-    char *symbol = NULL;
-    char buf[16] = {0};
-    yalx_mutex_lock(&pkg_init_mutex);
+    DCHECK(plain_name != NULL);
+    pkg_init_record_once(init_fun, pkg_find_or_new_record(plain_name));
+}
 
-    struct hash_table_value_span pkg = yalx_get_string_key(&pkg_init_records, plain_name);
-    if (pkg.value != NULL) {
-        goto done; // Already init
+void pkg_init_record_once(void *init_fun, struct pkg_init_record *pkg) {
+    DCHECK(pkg != NULL);
+    if (atomic_load_explicit(&pkg->state, memory_order_acquire) == PKG_INITIALIZED) {
+        return; // Fast path: already init
     }
-    
-    size_t buf_size = 98;
-    do {
-        //free(symbol);
-        buf_size <<= 1;
-        symbol = (char *)realloc(symbol, buf_size);
-    } while(yalx_name_symbolize(plain_name, symbol, buf_size) < 0);
-    
-    const size_t prefix_len = strlen(symbol);
-    DCHECK(prefix_len > 1);
-    if (prefix_len + kMaxPostfixSize > buf_size) {
-        symbol = (char *)realloc(symbol, prefix_len + kMaxPostfixSize);
-    }
-    strncpy(symbol + prefix_len, "_Lksz", 6);
-    
-#if defined(YALX_OS_POSIX)
-    struct lksz_header *lksz_addr = (struct lksz_header *)dlsym(YALX_DL_HANDLE, symbol + 1/*Skip prefx '_'*/);
-#endif
-    
-    strncpy(symbol + prefix_len, "_Kstr", 6);
 
-#if defined(YALX_OS_POSIX)
-    struct kstr_header *kstr_addr = (struct kstr_header *)dlsym(YALX_DL_HANDLE, symbol + 1/*Skip prefx '_'*/);
-#endif
-    
-    strncpy(symbol + prefix_len, "$global_slots", 14);
-    
-#if defined(YALX_OS_POSIX)
-    struct pkg_global_slots *slots = (struct pkg_global_slots *)dlsym(YALX_DL_HANDLE, symbol + 1/*Skip prefx '_'*/);
-#endif
-    
-    if (!lksz_addr || !kstr_addr) {
-        yalx_hash_table_put(&pkg_init_records, plain_name, strlen(plain_name), 4);
-        goto done; // No constant string will be initializing
+    const uintptr_t self = (uintptr_t)&pkg_init_token;
+    int expected = PKG_UNINITIALIZED;
+    if (!atomic_compare_exchange_strong(&pkg->state, &expected, PKG_INITIALIZING)) {
+        if (atomic_load_explicit(&pkg->owner, memory_order_relaxed) == self) {
+            return; // Ring of imports: this package is initializing by self
+        }
+        while (atomic_load_explicit(&pkg->state, memory_order_acquire) != PKG_INITIALIZED) {
+            sched_yield();
+        }
+        return;
     }
-    assert(lksz_addr->number_of_strings == kstr_addr->number_of_strings);
-    
-    for (int i = 0; i < lksz_addr->number_of_strings; i++) {
-        kstr_addr->ks[i] = yalx_new_string(heap, lksz_addr->sz[i], strlen(lksz_addr->sz[i]));
+    atomic_store_explicit(&pkg->owner, self, memory_order_relaxed);
+
+    if (pkg->lksz && pkg->kstr) {
+        assert(pkg->lksz->number_of_strings == pkg->kstr->number_of_strings);
+        for (int i = 0; i < pkg->lksz->number_of_strings; i++) {
+            pkg->kstr->ks[i] = yalx_new_string(heap, pkg->lksz->sz[i], strlen(pkg->lksz->sz[i]));
+        }
     }
-    
-    hash_table_value_span_t rs = yalx_hash_table_put(&pkg_init_records, plain_name, strlen(plain_name), PKG_RECORD_VAL_SIZE);
-    //TODO: memcpy(rs.value, &slots, sizeof(slots));
-    //*((struct pkg_global_slots **)rs.value) = slots;
-    DCHECK(PKG_RECORD_VAL_SIZE == rs.size);
-    ((void **)rs.value)[0] = kstr_addr;
-    ((void **)rs.value)[1] = slots;
-
-done:
-    yalx_mutex_unlock(&pkg_init_mutex);
-    //printf("pkg init...%s\n", plain_name);
-    free(symbol);
+    //printf("pkg init...%s\n", pkg->name);
     if (init_fun) {
+        char buf[16] = {0};
         call0_returning_vals(buf, sizeof(buf), init_fun);
     }
+
+    atomic_store_explicit(&pkg->owner, 0, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pkg_initialized_counter, 1, memory_order_relaxed);
+    atomic_store_explicit(&pkg->state, PKG_INITIALIZED, memory_order_release);
 }
 
-int pkg_initialized_count(void) { return pkg_init_records.size; }
+int pkg_initialized_count(void) { return atomic_load_explicit(&pkg_initialized_counter, memory_order_relaxed); }
 
 int pkg_has_initialized(const char *const plain_name) {
-    yalx_mutex_lock(&pkg_init_mutex);
-    hash_table_value_span_t span = yalx_get_string_key(&pkg_init_records, plain_name);
-    yalx_mutex_unlock(&pkg_init_mutex);
-    return span.value != NULL;
+    struct pkg_init_record *const pkg = pkg_find_record(plain_name);
+    return pkg != NULL && atomic_load_explicit(&pkg->state, memory_order_acquire) == PKG_INITIALIZED;
 }
 
 const struct pkg_global_slots *pkg_get_global_slots(const char *const plain_name) {
-    const struct pkg_global_slots *rs = NULL;
-    yalx_mutex_lock(&pkg_init_mutex);
-    hash_table_value_span_t span = yalx_get_string_key(&pkg_init_records, plain_name);
-    if (span.value == NULL) {
-        rs = NULL;
-    } else {
-        rs = *(struct pkg_global_slots **)span.value;
+    struct pkg_init_record *const pkg = pkg_find_record(plain_name);
+    if (!pkg || atomic_load_explicit(&pkg->state, memory_order_acquire) != PKG_INITIALIZED) {
+        return NULL;
     }
-    yalx_mutex_unlock(&pkg_init_mutex);
-    return rs;
+    return pkg->global_slots;
 }
 
 void put_field(struct yalx_value_any **address, struct yalx_value_any *field) {
@@ -107,6 +107,7 @@ extern int pointer_mask_in_bits;
 struct yalx_runtime_options {
     size_t max_heap_in_bytes;
     int gc;
+    int boxing_cache_high; // High bound of cached boxing numbers, 0 means default
     // TODO:
 };
 
@@ -226,9 +227,39 @@ struct pkg_global_slots {
     int    marks[0];
 };
 
+struct lksz_header {
+    int number_of_strings;
+    const char *const sz[1];
+};
+
+struct kstr_header {
+    int number_of_strings;
+    struct yalx_value_str *ks[1];
+};
+
+#define PKG_UNINITIALIZED 0
+#define PKG_INITIALIZING  1
+#define PKG_INITIALIZED   2
+
+// Emitted by compiler for every package as `${pkg}$pkg`, and registered at link-time
+// into section `yalx_pkgs`(ELF) or `__DATA,__yalx_pkgs`(Mach-O).
+struct pkg_init_record {
+    _Atomic int state; // PKG_UNINITIALIZED/PKG_INITIALIZING/PKG_INITIALIZED
+    int reserved0;
+    _Atomic uintptr_t owner; // token of initializing thread
+    const char *name; // plain name, e.g: "main:main"
+    const struct lksz_header *lksz;
+    struct kstr_header *kstr;
+    struct pkg_global_slots *global_slots;
+    struct pkg_init_record *next; // runtime only
+};
+
 // runtime libs called by generated code
 void pkg_init_once(void *init_fun, const char *plain_name);
+void pkg_init_record_once(void *init_fun, struct pkg_init_record *pkg);
 int pkg_initialized_count(void);
+// A package is initialized only after its `$init' returned, so both of them see nothing of a package which is still
+// initializing, e.g. from its own `$init' or from a ring of imports.
 int pkg_has_initialized(const char *plain_name);
 
 const struct pkg_global_slots *pkg_get_global_slots(const char *plain_name);
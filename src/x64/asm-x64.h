@@ -349,6 +349,12 @@ public:
         EmitB(0x8D);
         EmitOperand(dst, src);
     }
+    
+    void leal(Register dst, Operand src) {
+        EmitRex(dst, src, 4);
+        EmitB(0x8D);
+        EmitOperand(dst, src);
+    }
 
     //----------------------------------------------------------------------------------------------
     // Stack operations:
@@ -748,6 +754,27 @@ public:
     
     void j(Cond cond, Label *l, Label::Distance distance = Label::kFar);
     
+    // Call/Jump to a symbol out of this buffer: the 32-bit displacement will be fixed by the linker.
+    void call_rel32(int32_t disp) {
+        // 1110 1000 #32-bit disp
+        EmitB(0xE8);
+        EmitDW(disp);
+    }
+    
+    void jmp_rel32(int32_t disp) {
+        // 1110 1001 #32-bit disp
+        EmitB(0xE9);
+        EmitDW(disp);
+    }
+    
+    void j_rel32(Cond cond, int32_t disp) {
+        // 0000 1111 1000 tttn #32-bit disp
+        assert(IsUintN(cond, 4));
+        EmitB(0x0F);
+        EmitB(0x80 | cond);
+        EmitDW(disp);
+    }
+    
     void LikelyJ(Cond cond, Label *l, Label::Distance distance = Label::kFar) {
         PrefixLikely();
         j(cond, l, distance);
@@ -1597,6 +1624,9 @@ public:
     
     // nop n bytes, 1 < n < 9
     void nop(int n);
+
+    // Emit 32 bits of data in the instruction stream, e.g. entries of jump tables.
+    void dc32(uint32_t data) { EmitDW(data); }
     
     //----------------------------------------------------------------------------------------------
     // Prefix